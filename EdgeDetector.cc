@@ -12,27 +12,9 @@
 ************************************************************************/
 namespace TU
 {
-static const float	slant = 0.41421356;	// tan(M_PI/8)
-
 #if defined(SIMD)
 namespace simd
 {
-static inline Is32vec
-dir4(F32vec u, F32vec v)
-{
-    const Is32vec	l4 = cast<int>(u < -v);
-    return (l4 & Is32vec(0x4)) | ((cast<int>(u < v) ^ l4) & Is32vec(0x2));
-}
-
-static inline Is32vec
-dir4x(F32vec u, F32vec v)
-{
-    const Is32vec	l4 = cast<int>(v < zero<float>());
-    return (l4				        & Is32vec(0x4)) |
-	   ((cast<int>(u < zero<float>()) ^ l4) & Is32vec(0x2)) |
-						  Is32vec(0x1);
-}
-
 static inline Is32vec
 dir4x(F32vec u, F32vec v, F32vec lambda)
 {
@@ -43,31 +25,6 @@ dir4x(F32vec u, F32vec v, F32vec lambda)
 						      Is32vec(0x1);
 }
 
-static inline Is32vec
-dir8(F32vec u, F32vec v)
-{
-    const F32vec	su = F32vec(slant) * u,
-			sv = F32vec(slant) * v;
-    const Is32vec	l2 = cast<int>( u <  sv),
-			l4 = cast<int>(su <  -v);
-    return (l4				  & Is32vec(0x4)) |
-	   ((l2 ^ l4)			  & Is32vec(0x2)) |
-	   (((cast<int>(su <   v) ^ l2) |
-	     (cast<int>( u < -sv) ^ l4))  & Is32vec(0x1));
-}
-
-static inline Is32vec
-dir8x(F32vec u, F32vec v)
-{
-    const Is32vec	l2 = cast<int>(u < zero<float>()),
-			l4 = cast<int>(v < zero<float>()),
-			l  = l2 ^ l4;
-    return (l4				& Is32vec(0x4)) |
-	   (l				& Is32vec(0x2)) |
-	   (((cast<int>(u <  v) ^ l2) |
-	     (cast<int>(u < -v) ^ l4))  & Is32vec(0x1));
-}
-
 static inline Is32vec
 dir8x(F32vec u, F32vec v, F32vec lambda)
 {
@@ -91,18 +48,6 @@ eigen(vec<T> a, vec<T> b, vec<T> c)
 }	// namespace simd
 #endif
 
-template <class T> static inline u_int
-dir4(T u, T v)
-{
-    return (u < -v ? (u < v ? 4 : 6) : (u < v ? 2 : 0));
-}
-    
-template <class T> static inline u_int
-dir4x(T u, T v)
-{
-    return (v < 0 ? (u < 0 ? 5 : 7) : (u < 0 ? 3 : 1));
-}
-    
 template <class T> static inline u_int
 dir4x(T u, T v, T lambda)
 {
@@ -110,23 +55,6 @@ dir4x(T u, T v, T lambda)
     return (((lambda < 0) ^ l) << 2) | (l << 1) | 0x1;
 }
     
-template <class T> static inline u_int
-dir8(T u, T v)
-{
-    const T	su = slant * u, sv = slant * v;
-    return (su < -v ?
-	    ( u < -sv ? (u < sv ? (su <   v ? 4 : 5) : 6) : 7) :
-	    (su <   v ? (u < sv ? ( u < -sv ? 3 : 2) : 1) : 0));
-}
-    
-template <class T> static inline u_int
-dir8x(T u, T v)
-{
-    return (v < 0 ?
-	    (u < -v ? (u < 0 ? (u <  v ? 4 : 5) : 6) : 7) :
-	    (u <  v ? (u < 0 ? (u < -v ? 3 : 2) : 1) : 0));
-}
-    
 template <class T> static inline u_int
 dir8x(T u, T v, T lambda)
 {
@@ -232,35 +160,15 @@ const EdgeDetector&
 EdgeDetector::strength(const Image<float>& edgeH,
 		       const Image<float>& edgeV, Image<float>& out) const
 {
+#if defined(TU_SIMD_DISPATCH)
+    const auto	kernel = simd::dispatched_kernels().edge_strength;
+#else
+    const auto	kernel = detail::edgeStrength;
+#endif
     out.resize(edgeH.height(), edgeH.width());
     for (size_t v = 0; v < out.height(); ++v)
-    {
-	auto		eH  = edgeH[v].begin();
-	auto		eV  = edgeV[v].begin();
-	auto		dst = out[v].begin();
-	const auto	end = dst + out.width();
-#if defined(SSE)
-	using namespace	simd;
-	
-	const size_t	nelms = F32vec::size;
-	for (const float* const end2 = dst + F32vec::floor(out.width());
-	     dst < end2; )
-	{
-	    const F32vec	fH = load(eH), fV = load(eV);
-	    
-	    store(dst, sqrt(fH * fH + fV * fV));
-	    eH  += nelms;
-	    eV  += nelms;
-	    dst += nelms;
-	}
-#endif
-	while (dst < end)
-	{
-	    *dst++ = std::sqrt(*eH * *eH + *eV * *eV);
-	    ++eH;
-	    ++eV;
-	}
-    }
+	kernel(edgeH[v].begin(), edgeV[v].begin(), out[v].begin(),
+	       out.width());
 
     return *this;
 }
@@ -276,39 +184,16 @@ const EdgeDetector&
 EdgeDetector::direction4(const Image<float>& edgeH,
 			 const Image<float>& edgeV, Image<u_char>& out) const
 {
+#if defined(TU_SIMD_DISPATCH)
+    const auto	kernel = simd::dispatched_kernels().edge_direction4;
+#else
+    const auto	kernel = detail::edgeDirection4;
+#endif
     out.resize(edgeH.height(), edgeH.width());
     for (size_t v = 0; v < out.height(); ++v)
-    {
-	auto		eH = edgeH[v].begin();
-	auto		eV = edgeV[v].begin();
-	auto		dst = out[v].begin();
-	const auto	end = dst + out.width();
-#if defined(SIMD)
-	using namespace	simd;
+	kernel(edgeH[v].begin(), edgeV[v].begin(), out[v].begin(),
+	       out.width());
 
-	const size_t	nelms = F32vec::size;
-	for (const u_char* const end2 = dst + Iu8vec::floor(out.width());
-	     dst < end2; dst += Iu8vec::size)
-	{
-	    const Is32vec	d0 = dir4(load(eH), load(eV));
-	    eH += nelms;
-	    eV += nelms;
-	    const Is32vec	d1 = dir4(load(eH), load(eV));
-	    eH += nelms;
-	    eV += nelms;
-	    const Is32vec	d2 = dir4(load(eH), load(eV));
-	    eH += nelms;
-	    eV += nelms;
-	    const Is32vec	d3 = dir4(load(eH), load(eV));
-	    eH += nelms;
-	    eV += nelms;
-	    store(dst, cvt<u_char>(cvt<short>(d0, d1), cvt<short>(d2, d3)));
-	}
-#endif
-	while (dst < end)
-	    *dst++ = dir4(*eH++, *eV++);
-    }
-    
     return *this;
 }
     
@@ -316,39 +201,16 @@ const EdgeDetector&
 EdgeDetector::direction4x(const Image<float>& edgeH,
 			  const Image<float>& edgeV, Image<u_char>& out) const
 {
+#if defined(TU_SIMD_DISPATCH)
+    const auto	kernel = simd::dispatched_kernels().edge_direction4x;
+#else
+    const auto	kernel = detail::edgeDirection4x;
+#endif
     out.resize(edgeH.height(), edgeH.width());
     for (size_t v = 0; v < out.height(); ++v)
-    {
-	auto		eH  = edgeH[v].begin();
-	auto		eV  = edgeV[v].begin();
-	auto		dst = out[v].begin();
-	const auto	end = dst + out.width();
-#if defined(SIMD)
-	using namespace	simd;
+	kernel(edgeH[v].begin(), edgeV[v].begin(), out[v].begin(),
+	       out.width());
 
-	const size_t	nelms = F32vec::size;
-	for (const u_char* const end2 = dst + Iu8vec::floor(out.width());
-	     dst < end2; dst += Iu8vec::size)
-	{
-	    const Is32vec	d0 = dir4x(load(eH), load(eV));
-	    eH += nelms;
-	    eV += nelms;
-	    const Is32vec	d1 = dir4x(load(eH), load(eV));
-	    eH += nelms;
-	    eV += nelms;
-	    const Is32vec	d2 = dir4x(load(eH), load(eV));
-	    eH += nelms;
-	    eV += nelms;
-	    const Is32vec	d3 = dir4x(load(eH), load(eV));
-	    eH += nelms;
-	    eV += nelms;
-	    store(dst, cvt<u_char>(cvt<short>(d0, d1), cvt<short>(d2, d3)));
-	}
-#endif
-	while (dst < end)
-	    *dst++ = dir4x(*eH++, *eV++);
-    }
-    
     return *this;
 }
     
@@ -363,39 +225,16 @@ const EdgeDetector&
 EdgeDetector::direction8(const Image<float>& edgeH,
 			 const Image<float>& edgeV, Image<u_char>& out) const
 {
+#if defined(TU_SIMD_DISPATCH)
+    const auto	kernel = simd::dispatched_kernels().edge_direction8;
+#else
+    const auto	kernel = detail::edgeDirection8;
+#endif
     out.resize(edgeH.height(), edgeH.width());
     for (size_t v = 0; v < out.height(); ++v)
-    {
-	auto		eH = edgeH[v].begin();
-	auto		eV = edgeV[v].begin();
-	auto		dst = out[v].begin();
-	const auto	end = dst + out.width();
-#if defined(SIMD)
-	using namespace	simd;
+	kernel(edgeH[v].begin(), edgeV[v].begin(), out[v].begin(),
+	       out.width());
 
-	const size_t	nelms = F32vec::size;
-	for (const u_char* const end2 = dst + Iu8vec::floor(out.width());
-	     dst < end2; dst += Iu8vec::size)
-	{
-	    const Is32vec	d0 = dir8(load(eH), load(eV));
-	    eH += nelms;
-	    eV += nelms;
-	    const Is32vec	d1 = dir8(load(eH), load(eV));
-	    eH += nelms;
-	    eV += nelms;
-	    const Is32vec	d2 = dir8(load(eH), load(eV));
-	    eH += nelms;
-	    eV += nelms;
-	    const Is32vec	d3 = dir8(load(eH), load(eV));
-	    eH += nelms;
-	    eV += nelms;
-	    store(dst, cvt<u_char>(cvt<short>(d0, d1), cvt<short>(d2, d3)));
-	}
-#endif
-	while (dst < end)
-	    *dst++ = dir8(*eH++, *eV++);
-    }
-    
     return *this;
 }
     
@@ -403,39 +242,16 @@ const EdgeDetector&
 EdgeDetector::direction8x(const Image<float>& edgeH,
 			  const Image<float>& edgeV, Image<u_char>& out) const
 {
+#if defined(TU_SIMD_DISPATCH)
+    const auto	kernel = simd::dispatched_kernels().edge_direction8x;
+#else
+    const auto	kernel = detail::edgeDirection8x;
+#endif
     out.resize(edgeH.height(), edgeH.width());
     for (size_t v = 0; v < out.height(); ++v)
-    {
-	auto		eH = edgeH[v].begin();
-	auto		eV = edgeV[v].begin();
-	auto		dst = out[v].begin();
-	const auto	end = dst + out.width();
-#if defined(SIMD)
-	using namespace	simd;
+	kernel(edgeH[v].begin(), edgeV[v].begin(), out[v].begin(),
+	       out.width());
 
-	const size_t	nelms = F32vec::size;
-	for (const u_char* const end2 = dst + Iu8vec::floor(out.width());
-	     dst < end2; dst += Iu8vec::size)
-	{
-	    const Is32vec	d0 = dir8x(load(eH), load(eV));
-	    eH += nelms;
-	    eV += nelms;
-	    const Is32vec	d1 = dir8x(load(eH), load(eV));
-	    eH += nelms;
-	    eV += nelms;
-	    const Is32vec	d2 = dir8x(load(eH), load(eV));
-	    eH += nelms;
-	    eV += nelms;
-	    const Is32vec	d3 = dir8x(load(eH), load(eV));
-	    eH += nelms;
-	    eV += nelms;
-	    store(dst, cvt<u_char>(cvt<short>(d0, d1), cvt<short>(d2, d3)));
-	}
-#endif
-	while (dst < end)
-	    *dst++ = dir8x(*eH++, *eV++);
-    }
-    
     return *this;
 }
     
@@ -0,0 +1,162 @@
+/*!
+  \file		MappedFile.cc
+  \author	Toshio UESHIBA
+  \brief	クラス TU::MappedFile の実装
+*/
+#include "TU/MappedFile.h"
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace TU
+{
+/************************************************************************
+*  class MappedFile							*
+************************************************************************/
+//! 何もマップしていないオブジェクトを作る．
+MappedFile::MappedFile()
+    :_p(nullptr), _size(0)
+{
+}
+
+//! 既存のファイルを読み込み用にマップする．
+/*!
+  \param path	ファイル名
+  \param access	マップされた領域へのアクセスパターン
+*/
+MappedFile::MappedFile(const char* path, Access access)
+    :_p(nullptr), _size(0)
+{
+    open(path, access);
+}
+
+//! 指定された大きさのファイルを生成し，書き込み用にマップする．
+/*!
+  \param path	ファイル名
+  \param size	ファイルのバイト数
+*/
+MappedFile::MappedFile(const char* path, size_t size)
+    :_p(nullptr), _size(0)
+{
+    create(path, size);
+}
+
+MappedFile::MappedFile(MappedFile&& file)
+    :_p(file._p), _size(file._size)
+{
+    file._p    = nullptr;
+    file._size = 0;
+}
+
+//! マップを解除する．
+MappedFile::~MappedFile()
+{
+    close();
+}
+
+MappedFile&
+MappedFile::operator =(MappedFile&& file)
+{
+    if (this != &file)
+    {
+	close();
+	std::swap(_p,    file._p);
+	std::swap(_size, file._size);
+    }
+
+    return *this;
+}
+
+//! 既存のファイルを読み込み用にマップする．
+/*!
+  マップされた領域は書き込み時コピーとなるので，書き込んでもファイルは
+  変更されない．アクセスパターンはカーネルによる先読みと読み終えた
+  ページの解放の方針として伝えられる．
+  \param path	ファイル名
+  \param access	マップされた領域へのアクセスパターン
+*/
+void
+MappedFile::open(const char* path, Access access)
+{
+    close();
+
+    const int	fd = ::open(path, O_RDONLY);
+    if (fd < 0)
+	throw std::runtime_error(std::string("TU::MappedFile::open: cannot open ") + path + "!!");
+
+    struct stat	st;
+    if (::fstat(fd, &st) < 0)
+    {
+	::close(fd);
+	throw std::runtime_error(std::string("TU::MappedFile::open: cannot stat ") + path + "!!");
+    }
+
+    if (st.st_size > 0)
+    {
+	void* const	p = ::mmap(nullptr, st.st_size, PROT_READ | PROT_WRITE,
+				   MAP_PRIVATE, fd, 0);
+	if (p == MAP_FAILED)
+	{
+	    ::close(fd);
+	    throw std::runtime_error(std::string("TU::MappedFile::open: cannot map ") + path + "!!");
+	}
+	::madvise(p, st.st_size, (access == SEQUENTIAL ? MADV_SEQUENTIAL :
+				  access == RANDOM     ? MADV_RANDOM :
+							 MADV_NORMAL));
+	_p    = static_cast<char*>(p);
+	_size = st.st_size;
+    }
+    ::close(fd);
+}
+
+//! 指定された大きさのファイルを生成し，書き込み用にマップする．
+/*!
+  既存のファイルは切り詰められる．生成直後の内容は全て0である．
+  \param path	ファイル名
+  \param size	ファイルのバイト数
+*/
+void
+MappedFile::create(const char* path, size_t size)
+{
+    close();
+
+    const int	fd = ::open(path, O_RDWR | O_CREAT | O_TRUNC, 0666);
+    if (fd < 0)
+	throw std::runtime_error(std::string("TU::MappedFile::create: cannot open ") + path + "!!");
+
+    if (::ftruncate(fd, size) < 0)
+    {
+	::close(fd);
+	throw std::runtime_error(std::string("TU::MappedFile::create: cannot resize ") + path + "!!");
+    }
+
+    if (size > 0)
+    {
+	void* const	p = ::mmap(nullptr, size, PROT_READ | PROT_WRITE,
+				   MAP_SHARED, fd, 0);
+	if (p == MAP_FAILED)
+	{
+	    ::close(fd);
+	    throw std::runtime_error(std::string("TU::MappedFile::create: cannot map ") + path + "!!");
+	}
+	_p    = static_cast<char*>(p);
+	_size = size;
+    }
+    ::close(fd);
+}
+
+//! マップを解除する．
+void
+MappedFile::close()
+{
+    if (_p)
+	::munmap(_p, _size);
+    _p	  = nullptr;
+    _size = 0;
+}
+
+}
@@ -260,6 +260,103 @@ SURFCreator::BoxFilter::getWy(size_t x, size_t y)
 	 - _integralImage.crop2(x - _w1, x + _w1, y,	   y + _w1);
 }
 
+#if TU_SURF_SIMD
+//! 各レーンの番号に step を掛けた値 (0, step, 2*step, ...) を返す
+inline simd::Is32vec
+SURFCreator::BoxFilter::simdLanes(int step)
+{
+    using namespace	simd;
+
+    alignas(sizeof(Is32vec)) int32_t	lanes[Is32vec::size];
+    for (size_t n = 0; n < Is32vec::size; ++n)
+	lanes[n] = int32_t(n) * step;
+    return load<true>(lanes);
+}
+
+//! 同じ行に並ぶ複数のboxの和を積分画像からgatherによって一括して求める
+inline simd::F32vec
+SURFCreator::BoxFilter::simdCrop2(simd::Is32vec umin, simd::Is32vec umax,
+				  int vmin, int vmax) const
+{
+    using namespace	simd;
+
+    umax = umax + Is32vec(1);
+    ++vmax;
+    const value_type*	pmin = &_integralImage[vmin][0];
+    const value_type*	pmax = &_integralImage[vmax][0];
+    return lookup(pmax, umax) + lookup(pmin, umin)
+	 - lookup(pmin, umax) - lookup(pmax, umin);
+}
+
+inline simd::F32vec
+SURFCreator::BoxFilter::simdGetWx(simd::Is32vec x, int y) const
+{
+    using namespace	simd;
+
+    const Is32vec	w1(_w1);
+    return simdCrop2(x,	     x + w1, y - _w1, y + _w1)
+	 - simdCrop2(x - w1, x,	     y - _w1, y + _w1);
+}
+
+inline simd::F32vec
+SURFCreator::BoxFilter::simdGetWy(simd::Is32vec x, int y) const
+{
+    using namespace	simd;
+
+    const Is32vec	w1(_w1);
+    return simdCrop2(x - w1, x + w1, y - _w1, y	     )
+	 - simdCrop2(x - w1, x + w1, y,	      y + _w1);
+}
+
+//! 同じ行に並ぶ複数の点について checkBoundsW() と同じ判定を一括して行う
+inline simd::Iu32vec
+SURFCreator::BoxFilter::simdCheckBoundsW(simd::Is32vec x, int y) const
+{
+    using namespace	simd;
+
+    if (y <= _w1 || y + _w1 >= int(_integralImage.height()) - 1)
+	return Iu32vec(0);
+    return (x > Is32vec(_w1)) &
+	   (x < Is32vec(int(_integralImage.width()) - 1 - _w1));
+}
+
+//! 同じ行に並ぶ複数のサンプル点のうち有効な点のHarr wavelet値を一括して求める
+/*!
+  無効な点は最初の有効な点に置き換えてからgatherするので，積分画像の範囲外を
+  読むことはない．valid, wx, wy は F32vec の大きさに整列していなければならない．
+  \param x	サンプル点の横座標
+  \param y	サンプル点の縦座標
+  \param mask	有効なサンプル点を示すマスク
+  \param valid	mask の各要素が返される
+  \param wx	横方向のHarr wavelet値が返される
+  \param wy	縦方向のHarr wavelet値が返される
+  \return	有効な点が1つでもあれば true, そうでなければ false
+*/
+inline bool
+SURFCreator::BoxFilter::simdGetW(simd::Is32vec x, int y, simd::Iu32vec mask,
+				 uint32_t valid[],
+				 value_type wx[], value_type wy[]) const
+{
+    using namespace	simd;
+
+    constexpr size_t	N = Is32vec::size;
+    store<true>(valid, mask);
+    const size_t	n0 = std::find_if(valid, valid + N,
+					  [](uint32_t m){ return m != 0; })
+			   - valid;
+    if (n0 == N)
+	return false;
+
+    alignas(sizeof(Is32vec)) int32_t	xa[N];
+    store<true>(xa, x);
+    const Is32vec	xs = select(mask, x, Is32vec(xa[n0]));
+    store<true>(wx, simdGetWx(xs, y));
+    store<true>(wy, simdGetWy(xs, y));
+
+    return true;
+}
+#endif
+
 inline SURFCreator::BoxFilter&
 SURFCreator::BoxFilter::setY(size_t y)
 {
@@ -394,6 +491,52 @@ SURFCreator::assignOrientation(Feature<T, D>& feature) const
 
   // 半径6*sigmaの円内におけるHarr wavelet値を計算する．
     HarrResponse*	respEnd = resp;
+#if TU_SURF_SIMD
+  // 同じ行に並ぶ F32vec::size 個のサンプル点のHarr wavelet値を一括して求める．
+  // 特徴点毎にサンプリング間隔と窓が異なり，特徴点間の並列化は
+  // makeDescriptors() が行うので，複数の特徴点をまたいだ一括処理はしない．
+    using namespace	simd;
+
+    constexpr int	N = F32vec::size;
+    const Is32vec	di	 = BoxFilter::simdLanes(1),
+			xoffsets = BoxFilter::simdLanes(step);
+
+    for (int j = -9; j <= 9; ++j)
+    {
+	const int	y = yc + j * step;
+
+	for (int i = -9; i <= 9; i += N)
+	{
+	    const Is32vec	x = Is32vec(xc + i * step) + xoffsets;
+	    const Iu32vec	mask = ((Is32vec(i) + di) < Is32vec(10))
+				     & boxFilter.simdCheckBoundsW(x, y);
+	    alignas(sizeof(F32vec)) uint32_t	valid[N];
+	    alignas(sizeof(F32vec)) value_type	wxs[N], wys[N];
+	    if (!boxFilter.simdGetW(x, y, mask, valid, wxs, wys))
+		continue;
+
+	  // keep points in a circular region of diameter 6s
+	    for (int n = 0; n < N; ++n)
+	    {
+		const int	sqrad = (i + n) * (i + n) + j * j;
+		if (valid[n] && sqrad <= 81)
+		{
+		    value_type	wx  = wxs[n],
+				wy  = wys[n];
+		    value_type	len = std::sqrt(wx * wx + wy * wy);
+		    if (len > 0)
+		    {
+			value_type	orientation = std::atan2(wy, wx),
+					ponderation = len * Exp1(sqrad);
+			*respEnd++ = HarrResponse(orientation, ponderation);
+			*respEnd++ = HarrResponse(orientation + 2*M_PI,
+						  ponderation);
+		    }
+		}
+	    }
+	}
+    }
+#else
     for (int j = -9; j <= 9; ++j)
     { 
 	const int	y = yc + j * step;
@@ -420,6 +563,7 @@ SURFCreator::assignOrientation(Feature<T, D>& feature) const
 	    }
 	}
     }
+#endif
     std::sort(resp, respEnd);	// orientation によって昇順にソート
 
   // 幅が M_PI/3 のsliding windowを用いて特徴点の方向を推定する．
@@ -500,6 +644,65 @@ SURFCreator::makeDescriptor(Feature<T, D>& feature) const
 		bins[y][x][v] = 0;
     
   // Go through all the pixels in the bounding box.
+#if TU_SURF_SIMD
+  // 同じ行に並ぶ F32vec::size 個のサンプル点の回転座標とHarr wavelet値を
+  // 一括して求め，有効なサンプル点についてのみ投票する．assignOrientation()
+  // と同様に，複数の特徴点をまたいだ一括処理はしない．
+    using namespace	simd;
+
+    constexpr int	N = F32vec::size;
+    const Is32vec	di	 = BoxFilter::simdLanes(1),
+			xoffsets = BoxFilter::simdLanes(step);
+
+    for (int j = -radius; j <= radius; ++j)
+    {
+	const int	y = yc + j * step;
+
+	for (int i = -radius; i <= radius; i += N)
+	{
+	    const Is32vec	iv = Is32vec(i) + di;
+	    const F32vec	fi = cvt<float>(iv);
+	    const F32vec	u = ((F32vec(cos) * fi - F32vec(sin * j))
+				     * F32vec(step) - F32vec(du))
+				  / F32vec(stepSample),
+				v = ((F32vec(sin) * fi + F32vec(cos * j))
+				     * F32vec(step) - F32vec(dv))
+				  / F32vec(stepSample);
+	    const F32vec	uIdx = F32vec(NSubRegions / 2.0 - 0.5) + u,
+				vIdx = F32vec(NSubRegions / 2.0 - 0.5) + v;
+	    const Is32vec	x = Is32vec(xc + i * step) + xoffsets;
+
+	  // サンプル点が窓内，ヒストグラム内かつ画像内にあるか調べる．
+	    const Iu32vec	mask = (iv < Is32vec(radius + 1))
+				     & cast<uint32_t>((F32vec(-1) <= uIdx) &
+						      (uIdx < F32vec(NSubRegions)) &
+						      (F32vec(-1) <= vIdx) &
+						      (vIdx < F32vec(NSubRegions)))
+				     & boxFilter.simdCheckBoundsW(x, y);
+	    alignas(sizeof(F32vec)) uint32_t	valid[N];
+	    alignas(sizeof(F32vec)) value_type	wxs[N], wys[N];
+	    if (!boxFilter.simdGetW(x, y, mask, valid, wxs, wys))
+		continue;
+
+	    alignas(sizeof(F32vec)) value_type	us[N], vs[N], sq[N];
+	    store<true>(us, uIdx);
+	    store<true>(vs, vIdx);
+	    store<true>(sq, u * u + v * v);
+
+	    for (int n = 0; n < N; ++n)
+		if (valid[n])
+		{
+		    const value_type	ex = Exp2(int(sq[n]));
+		    const value_type	wx = wxs[n] * ex,
+					wy = wys[n] * ex;
+		    const value_type	wu = cos * wx + sin * wy,
+					wv = sin * wx - cos * wy; // ?? pano-matic
+
+		    vote<D>(us[n], vs[n], wu, wv, bins);
+		}
+	}
+    }
+#else
     for (int j = -radius; j <= radius; ++j)
     {
 	for (int i = -radius; i <= radius; ++i)
@@ -536,6 +739,7 @@ SURFCreator::makeDescriptor(Feature<T, D>& feature) const
 	    }		
 	}
     }
+#endif
 
   // Transform back to vector.
   // Fill the vector with the values of the square...
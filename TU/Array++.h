@@ -1129,6 +1129,15 @@ namespace detail
       mutable cache_t	_cache;		// _l * _r の計算結果
   };
 
+  //! 2つの2次元配列式の積を product_opnode 以外で評価するか判定する
+  /*!
+    TU/simd/Array++.h において gemm() を用いる場合に特殊化される．
+  */
+  template <class L, class R, class=void>
+  struct has_blocked_product : std::false_type
+  {
+  };
+
   struct bit_xor
   {
       template <class X_, class Y_>
@@ -1186,11 +1195,11 @@ operator *(L&& l, R&& r)
   \return	積を表す演算子ノード
 */
 template <class L, class R,
-	  std::enable_if_t<((!is_transposed<L>::value && rank<L>() == 2) &&
-			    (rank<R>() == 1 || rank<R>() == 2)) ||
-			   (is_transposed<L>::value &&
-			    (!is_transposed<R>::value && rank<R>() == 2))>*
-	  = nullptr>
+	  std::enable_if_t<(((!is_transposed<L>::value && rank<L>() == 2) &&
+			     (rank<R>() == 1 || rank<R>() == 2)) ||
+			    (is_transposed<L>::value &&
+			     (!is_transposed<R>::value && rank<R>() == 2))) &&
+			   !detail::has_blocked_product<L, R>::value>* = nullptr>
 inline auto
 operator *(L&& l, R&& r)
 {
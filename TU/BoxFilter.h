@@ -8,6 +8,9 @@
 
 #include "TU/Filter2.h"
 #include "TU/Array++.h"
+#if defined(TU_SIMD_DISPATCH)
+#  include "TU/simd/dispatch.h"
+#endif
 
 namespace TU
 {
@@ -281,6 +284,16 @@ class BoxFilter2 : public Filter2<BoxFilter2<T> >
     template <class IN, class OUT>
     void	convolveRows(IN ib, IN ie, OUT out, bool shift)	const	;
     
+  private:
+#if defined(TU_SIMD_DISPATCH)
+    template <class IN, class OUT>
+    static bool	dispatchRows(IN, IN, OUT, bool)		{ return false; }
+    bool	dispatchRows(range_iterator<const float*, 0, 0> ib,
+			     range_iterator<const float*, 0, 0> ie,
+			     range_iterator<float*, 0, 0> out,
+			     bool shift)			const	;
+#endif
+
   private:
     size_t		_winSizeV;
     BoxFilter<T>	_colFilter;
@@ -300,9 +313,13 @@ BoxFilter2<T>::convolveRows(IN ib, IN ie, OUT out, bool shift) const
     using	std::cbegin;
     using	std::cend;
     
-    if (std::distance(ib, ie) < winSizeV())
+    if (size_t(std::distance(ib, ie)) < winSizeV())
 	throw std::runtime_error("BoxFilter2::convolveRows(): not enough rows!");
 
+#if defined(TU_SIMD_DISPATCH)
+    if (dispatchRows(ib, ie, out, shift))
+	return;
+#endif
     if (shift)
 	std::advance(out, offsetV());
     
@@ -311,5 +328,28 @@ BoxFilter2<T>::convolveRows(IN ib, IN ie, OUT out, bool shift) const
 	_colFilter.convolve(cbegin(*row), cend(*row), begin(*out), shift);
 }
 
+#if defined(TU_SIMD_DISPATCH)
+//! 実行時に選ばれたSIMD命令セット向けの実装で畳み込みを行う
+/*!
+  float型の2次元配列に対する畳み込みのみが対象となる．
+  \return	実行時に選ばれた実装で処理したらtrue，そうでなければfalse
+*/
+template <class T> inline bool
+BoxFilter2<T>::dispatchRows(range_iterator<const float*, 0, 0> ib,
+			    range_iterator<const float*, 0, 0> ie,
+			    range_iterator<float*, 0, 0> out, bool shift) const
+{
+    if (!std::is_same<T, float>::value)
+	return false;
+
+    simd::dispatched_kernels().box_filter_rows(ib.base(), ib.stride(),
+					       std::distance(ib, ie),
+					       (*ib).size(),
+					       out.base(), out.stride(),
+					       winSizeV(), winSizeH(), shift);
+    return true;
+}
+#endif
+
 }
 #endif	// !TU_BOXFILTER_H
@@ -31,6 +31,8 @@ class IntrinsicBase
     IntrinsicBase(const matrix33_type& K)				;
     
     point2_type		u(const point2_type& x)			const	;
+    void		u(const PointBatch<element_type>& x,
+			  PointBatch<element_type>& u)		const	;
     point2_type		xFromU(const point2_type& u)		const	;
     matrix22_type	jacobian(const point2_type& x)		const	;
 
@@ -112,6 +114,19 @@ IntrinsicBase<T>::u(const point2_type& x) const
     return {_k00*x[0] + _k01*x[1] + _u0[0], _k*x[1] + _u0[1]};
 }
     
+//! SoA形式の点群の各点のcanonical画像座標を画像座標に直す．
+/*!
+  \param x	canonical画像座標における投影点の点群(2行)
+  \param u	画像座標における投影点の点群(2行)
+*/
+template <class T> inline void
+IntrinsicBase<T>::u(const PointBatch<element_type>& x,
+		    PointBatch<element_type>& u) const
+{
+    transform(Matrix<element_type, 2, 3>{{_k00, _k01, _u0[0]},
+					 {0,    _k,   _u0[1]}}, x, u);
+}
+    
 //! 画像座標における投影点の2次元位置をcanonical画像座標系に直す．
 /*!
   \param u	画像座標系における投影点の2次元位置
@@ -734,7 +749,11 @@ class IntrinsicWithDistortion : public I
 			    element_type d1=0, element_type d2=0)	;
 
     point2_type		u(const point2_type& x)			const	;
+    void		u(const PointBatch<element_type>& x,
+			  PointBatch<element_type>& u)		const	;
     point2_type		xd(const point2_type& x)		const	;
+    void		xd(const PointBatch<element_type>& x,
+			   PointBatch<element_type>& xd)	const	;
     point2_type		xFromU(const point2_type& u)		const	;
     matrix22_type	jacobian(const point2_type& x)		const	;
     element_type	d1()					const	;
@@ -812,6 +831,55 @@ IntrinsicWithDistortion<I>::xd(const point2_type& x) const
     return {tmp * x[0], tmp * x[1]};
 }
     
+//! SoA形式の点群の各点のcanonical画像座標を画像座標に直す．
+/*!
+  \param x	canonical画像座標における投影点の点群(2行)
+  \param u	放射歪曲を付加した画像座標における投影点の点群(2行)
+*/
+template <class I> inline void
+IntrinsicWithDistortion<I>::u(const PointBatch<element_type>& x,
+			      PointBatch<element_type>& u) const
+{
+    xd(x, u);
+    super::u(u, u);
+}
+
+//! SoA形式の点群の各点に放射歪曲を付加する．
+/*!
+  \param x	canonical画像座標における投影点の点群(2行)
+  \param xd	放射歪曲付加後のcanonical画像座標における点群(2行)
+*/
+template <class I> void
+IntrinsicWithDistortion<I>::xd(const PointBatch<element_type>& x,
+			       PointBatch<element_type>& xd) const
+{
+    using batch		= detail::point_batch<element_type>;
+    using vec_type	= typename batch::vec_type;
+
+    if (x.nrow() != 2)
+	throw std::invalid_argument("TU::IntrinsicWithDistortion<I>::xd(): mismatched dimension of points!!");
+    xd.resize(2, x.ncol());
+
+    const auto	x0 = batch::row(x, 0);
+    const auto	x1 = batch::row(x, 1);
+    const auto	y0 = batch::row(xd, 0);
+    const auto	y1 = batch::row(xd, 1);
+    const vec_type	one(1), d1(_d1), d2(_d2);
+
+    batch::for_each(x.ncol(), [=](size_t k)
+			      {
+				  const auto	u = batch::load(x0 + k);
+				  const auto	v = batch::load(x1 + k);
+				  const auto	sqr = batch::fma(u, u, v*v);
+				  const auto	tmp = batch::fma(
+							sqr,
+							batch::fma(sqr, d2, d1),
+							one);
+				  batch::store(y0 + k, tmp * u);
+				  batch::store(y1 + k, tmp * v);
+			      });
+}
+    
 //! 画像座標における投影点の2次元位置をcanonical画像座標系に直す．
 /*!
   \param u	画像座標系における投影点の2次元位置
@@ -1055,7 +1123,11 @@ class CanonicalCamera
 
     point2_type		x(const point3_type& X, matrix_type* J=nullptr,
 			  matrix_type* H=nullptr)		const	;
+    void		x(const PointBatch<element_type>& X,
+			  PointBatch<element_type>& x)		const	;
     matrix23_type	jacobian(const point3_type& X)		const	;
+    void		jacobian(const PointBatch<element_type>& X,
+				 PointBatch<element_type>& J)	const	;
     matrix34_type	Pc()					const	;
     const point3_type&	t()					const	;
     const matrix33_type&
@@ -1189,6 +1261,30 @@ CanonicalCamera<T>::jacobian(const point3_type& X) const
     return J;
 }
 
+//! SoA形式の3次元点群の各点の投影点のcanonical画像座標を求める．
+/*!
+  \param X	対象点群(3行)
+  \param x	canonical画像座標における投影点の点群(2行)
+*/
+template <class T> inline void
+CanonicalCamera<T>::x(const PointBatch<element_type>& X,
+		      PointBatch<element_type>& x) const
+{
+    project(Pc(), X, x);
+}
+
+//! SoA形式の3次元点群の各点において投影点のその点の座標に関するヤコビ行列を求める．
+/*!
+  \param X	対象点群(3行)
+  \param J	2x3ヤコビ行列を行優先で並べた6行の点群
+*/
+template <class T> inline void
+CanonicalCamera<T>::jacobian(const PointBatch<element_type>& X,
+			     PointBatch<element_type>& J) const
+{
+    TU::jacobian(Pc(), X, J);
+}
+
 //! 3次元ユークリッド空間からcanonical画像平面への投影行列を求める．
 /*!
   \return	canonical画像平面への投影行列，すなわち
@@ -1441,6 +1537,8 @@ class Camera : public CanonicalCamera<typename I::element_type>, public I
     point2_type		operator ()(const point3_type& X,
 				    matrix_type* J=nullptr,
 				    matrix_type* H=nullptr)	const	;
+    void		operator ()(const PointBatch<element_type>& X,
+				    PointBatch<element_type>& u) const	;
     matrix23_type	jacobian(const point3_type& X)		const	;
     matrix34_type	P()					const	;
     void		setProjection(const matrix34_type& P)		;
@@ -1569,6 +1667,19 @@ Camera<I>::operator ()(const point3_type& X,
     return intrinsic_type::u(extrinsic_type::x(X, J, H), J, H);
 }
 
+//! SoA形式の3次元点群の各点の投影点の画像座標を求める．
+/*!
+  \param X	対象点群(3行)
+  \param u	画像座標における投影点の点群(2行)
+*/
+template <class I> inline void
+Camera<I>::operator ()(const PointBatch<element_type>& X,
+		       PointBatch<element_type>& u) const
+{
+    extrinsic_type::x(X, u);
+    intrinsic_type::u(u, u);
+}
+
 template <class I> inline typename Camera<I>::matrix23_type
 Camera<I>::jacobian(const point3_type& X) const
 {
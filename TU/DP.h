@@ -218,5 +218,344 @@ DP<DOM, T>::put(std::ostream& out) const
     return out << std::endl;
 }
 
+/************************************************************************
+*  class LabelDP<T>							*
+************************************************************************/
+//! 離散ラベル列に対する評価関数の最小化を動的計画法によって行うクラス
+/*!
+  各ステージの変数は 0, 1,..., K-1 のいずれかのラベルをとり，評価関数は
+  データ項と隣接ステージ間の平滑化項
+  \f$\lambda g(x_{i-1} - x_i)\f$の和である．\f$g\f$が線形
+  (\f$|d|\f$)，2次(\f$d^2\f$)および打ち切り線形
+  (\f$\min(|d|, \tau)\f$)のいずれかであれば，一般化距離変換を用いることに
+  より，1ステージあたり O(K^2) ではなく O(K) の計算量で最適化できる．
+  \param T	評価関数の値の型
+*/
+template <class T>
+class LabelDP
+{
+  public:
+  //! 平滑化項の種類
+    enum Smoothness
+    {
+	LINEAR,			//!< 線形: \f$|d|\f$
+	QUADRATIC,		//!< 2次: \f$d^2\f$
+	TRUNCATED_LINEAR	//!< 打ち切り線形: \f$\min(|d|, \tau)\f$
+    };
+
+    using value_type	= T;
+    using label_type	= u_int;
+
+  public:
+    explicit LabelDP(value_type lambda=1,
+		     Smoothness smoothness=LINEAR,
+		     value_type threshold=1)				;
+
+    value_type		lambda()				const	;
+    LabelDP&		setLambda(value_type lambda)			;
+    Smoothness		smoothness()				const	;
+    value_type		threshold()				const	;
+    LabelDP&		setSmoothness(Smoothness smoothness,
+				      value_type threshold=1)		;
+    LabelDP&		initialize(size_t nstages, size_t nlabels)	;
+    size_t		nstages()				const	;
+    size_t		nlabels()				const	;
+    template <class DITER, class OUT>
+    value_type		operator ()(DITER data, OUT out)		;
+
+  private:
+    void		transform(label_type* prev)			;
+    void		transformLinear(label_type* prev)		;
+    void		transformQuadratic(label_type* prev)		;
+    
+  private:
+    value_type		_lambda;	//!< 平滑化項の係数
+    Smoothness		_smoothness;	//!< 平滑化項の種類
+    value_type		_threshold;	//!< 打ち切り線形の閾値
+    Array<value_type>	_vals;		//!< 前ステージまでの評価関数の最小値
+    Array<value_type>	_mins;		//!< 距離変換の結果
+    Array2<label_type>	_prev;		//!< 各ノードの最適な前ステージのラベル
+    Array<label_type>	_v;		//!< 下側包絡線をなす放物線の頂点
+    Array<double>	_z;		//!< 下側包絡線をなす放物線の境界
+};
+
+//! 動的計画法による最適化器を生成する．
+/*!
+  \param lambda		平滑化項の係数
+  \param smoothness	平滑化項の種類
+  \param threshold	打ち切り線形の閾値
+*/
+template <class T> inline
+LabelDP<T>::LabelDP(value_type lambda,
+		    Smoothness smoothness, value_type threshold)
+    :_lambda(lambda), _smoothness(smoothness), _threshold(threshold),
+     _vals(), _mins(), _prev(), _v(), _z()
+{
+}
+
+//! 平滑化項の係数を返す．
+/*!
+  \return	平滑化項の係数
+*/ 
+template <class T> inline typename LabelDP<T>::value_type
+LabelDP<T>::lambda() const
+{
+    return _lambda;
+}
+
+//! 平滑化項の係数をセットする．
+/*!
+  \param lambda	平滑化項の係数
+  \return	この最適化器
+*/ 
+template <class T> inline LabelDP<T>&
+LabelDP<T>::setLambda(value_type lambda)
+{
+    _lambda = lambda;
+    return *this;
+}
+
+//! 平滑化項の種類を返す．
+/*!
+  \return	平滑化項の種類
+*/ 
+template <class T> inline typename LabelDP<T>::Smoothness
+LabelDP<T>::smoothness() const
+{
+    return _smoothness;
+}
+
+//! 打ち切り線形の閾値を返す．
+/*!
+  \return	閾値
+*/ 
+template <class T> inline typename LabelDP<T>::value_type
+LabelDP<T>::threshold() const
+{
+    return _threshold;
+}
+
+//! 平滑化項の種類をセットする．
+/*!
+  \param smoothness	平滑化項の種類
+  \param threshold	打ち切り線形の閾値
+  \return		この最適化器
+*/ 
+template <class T> inline LabelDP<T>&
+LabelDP<T>::setSmoothness(Smoothness smoothness, value_type threshold)
+{
+    _smoothness = smoothness;
+    _threshold  = threshold;
+    return *this;
+}
+
+//! 最適化する関数の定義域をセットする．
+/*!
+  \param nstages	ステージ数
+  \param nlabels	各ステージの変数がとり得るラベルの数
+  \return		この最適化器
+*/ 
+template <class T> LabelDP<T>&
+LabelDP<T>::initialize(size_t nstages, size_t nlabels)
+{
+    if (nlabels == 0)
+	throw std::invalid_argument("LabelDP<T>::initialize(): domain of each stage cannot be empty");
+
+    _vals.resize(nlabels);
+    _mins.resize(nlabels);
+    _prev.resize(nstages, nlabels);
+    _v.resize(nlabels);
+    _z.resize(nlabels + 1);
+
+    return *this;
+}
+
+//! ステージ数を返す．
+/*!
+  \return	ステージ数
+*/ 
+template <class T> inline size_t
+LabelDP<T>::nstages() const
+{
+    return _prev.nrow();
+}
+
+//! 各ステージの変数がとり得るラベルの数を返す．
+/*!
+  \return	ラベル数
+*/ 
+template <class T> inline size_t
+LabelDP<T>::nlabels() const
+{
+    return _vals.size();
+}
+
+//! 与えられたデータ項の列に対して評価関数を最適化するラベル列を求める．
+/*!
+  \param data	最初のステージのデータ項を指す反復子．*data はラベル数と
+		同じ長さの範囲で，その各要素が各ラベルに対するデータ項の値
+  \param out	最適値を与えるラベル列の出力先を指す反復子．末尾のステージの
+		ラベルから先に出力されるので，逆反復子を与えること．
+  \return	最適化された最小値
+*/ 
+template <class T> template <class DITER, class OUT>
+typename LabelDP<T>::value_type
+LabelDP<T>::operator ()(DITER data, OUT out)
+{
+    using	std::cbegin;
+    
+    if (nstages() == 0)
+	return 0;
+
+  // 最初のステージの各ラベルについてデータ項の値を求める．
+    std::copy_n(cbegin(*data), nlabels(), _vals.begin());
+
+  // 2番目以降のステージについて，前ステージの最小値を距離変換して
+  // データ項を加える．
+    for (size_t i = 1; i < nstages(); ++i)
+    {
+	++data;
+	transform(_prev[i].begin());
+	std::transform(_mins.cbegin(), _mins.cend(), cbegin(*data),
+		       _vals.begin(), std::plus<value_type>());
+    }
+
+  // 最終ステージの最小値を与えるラベルから順に辿る．
+    auto	x = label_type(std::min_element(_vals.cbegin(), _vals.cend())
+			       - _vals.cbegin());
+    const auto	minval = _vals[x];
+    for (size_t i = nstages(); i-- > 0; )
+    {
+	*out = x;
+	++out;
+	x = _prev[i][x];
+    }
+
+    return minval;
+}
+
+/*
+ *  private member functions
+ */
+//! 前ステージまでの最小値 _vals を平滑化項で距離変換して _mins に収める．
+/*!
+  \param prev	各ラベルについて最小値を与える前ステージのラベルの出力先
+*/
+template <class T> void
+LabelDP<T>::transform(label_type* prev)
+{
+    switch (_smoothness)
+    {
+      case QUADRATIC:
+	transformQuadratic(prev);
+	break;
+
+      case TRUNCATED_LINEAR:
+      {
+	transformLinear(prev);
+
+      // 前ステージの最小値に閾値分のコストを加えたもので打ち切る．
+	const auto	xmin = label_type(std::min_element(_vals.cbegin(),
+							   _vals.cend())
+					  - _vals.cbegin());
+	const auto	val = _vals[xmin] + _lambda * _threshold;
+	for (size_t x = 0; x < _mins.size(); ++x)
+	    if (val < _mins[x])
+	    {
+		_mins[x] = val;
+		prev[x]  = xmin;
+	    }
+      }
+	break;
+
+      default:
+	transformLinear(prev);
+	break;
+    }
+}
+
+//! 線形の平滑化項に対する距離変換を前向きと後ろ向きの2回の走査で行う．
+template <class T> void
+LabelDP<T>::transformLinear(label_type* prev)
+{
+    const auto	K = _vals.size();
+
+    _mins[0] = _vals[0];
+    prev[0]  = 0;
+    for (size_t x = 1; x < K; ++x)
+    {
+	const value_type	val = _mins[x-1] + _lambda;
+	if (val < _vals[x])
+	{
+	    _mins[x] = val;
+	    prev[x]  = prev[x-1];
+	}
+	else
+	{
+	    _mins[x] = _vals[x];
+	    prev[x]  = x;
+	}
+    }
+
+    for (size_t x = K - 1; x-- > 0; )
+    {
+	const value_type	val = _mins[x+1] + _lambda;
+	if (val < _mins[x])
+	{
+	    _mins[x] = val;
+	    prev[x]  = prev[x+1];
+	}
+    }
+}
+
+//! 2次の平滑化項に対する距離変換を放物線の下側包絡線を用いて行う．
+template <class T> void
+LabelDP<T>::transformQuadratic(label_type* prev)
+{
+    const auto	K = _vals.size();
+
+    if (_lambda <= 0)		// 平滑化項がなければ前ステージの最小値
+    {
+	const auto	xmin = label_type(std::min_element(_vals.cbegin(),
+							   _vals.cend())
+					  - _vals.cbegin());
+	std::fill(_mins.begin(), _mins.end(), _vals[xmin]);
+	std::fill(prev, prev + K, xmin);
+	return;
+    }
+
+  // 頂点 (q, _vals[q]) を持つ放物線の下側包絡線を求める．
+    const auto	intersection = [this](label_type q, label_type p)
+			       {
+				   return (double(_vals[q]) + double(_lambda)*q*q
+					 - double(_vals[p]) - double(_lambda)*p*p)
+					/ (2.0 * double(_lambda) * (q - p));
+			       };
+    size_t	k = 0;
+    _v[0] = 0;
+    _z[0] = -std::numeric_limits<double>::infinity();
+    _z[1] =  std::numeric_limits<double>::infinity();
+    for (label_type q = 1; q < K; ++q)
+    {
+	auto	s = intersection(q, _v[k]);
+	while (s <= _z[k])
+	    s = intersection(q, _v[--k]);
+	_v[++k]	 = q;
+	_z[k]	 = s;
+	_z[k+1] = std::numeric_limits<double>::infinity();
+    }
+
+  // 各ラベルにおける包絡線の値を求める．
+    k = 0;
+    for (label_type x = 0; x < K; ++x)
+    {
+	while (_z[k+1] < x)
+	    ++k;
+	const auto	d = value_type(x) - value_type(_v[k]);
+	_mins[x] = _vals[_v[k]] + _lambda * d * d;
+	prev[x]	 = _v[k];
+    }
+}
+
 }
 #endif	// !TU_DP_H
@@ -150,6 +150,8 @@ template <class T> class DericheConvolver2
     DericheConvolver2&	initialize(coeff_type alpha)			;
     using		super::grainSize;
     using		super::setGrainSize;
+    using		super::tileSize;
+    using		super::setTileSize;
     
     template <class IN, class OUT>
     void		smooth(IN ib, IN ie, OUT out)			;
@@ -163,6 +165,9 @@ template <class T> class DericheConvolver2
     void		diffHV(IN ib, IN ie, OUT out)			;
     template <class IN, class OUT>
     void		diffVV(IN ib, IN ie, OUT out)			;
+    template <class IN, class S, class H, class V, class HH, class HV, class VV>
+    void		derivatives(IN ib, IN ie, S smooth, H diffH, V diffV,
+				    HH diffHH, HV diffHV, VV diffVV)	;
 };
 
 //! Canny-Deriche核のalpha値を設定する
@@ -261,6 +266,32 @@ DericheConvolver2<T>::diffVV(IN ib, IN ie, OUT out)
 	  .template convolve<IN, OUT>(ib, ie, out);
 }
 
+//! 平滑化と1, 2階偏微分のうち必要なものを入力の1回の走査で求める
+/*!
+  横方向の平滑化と1, 2階微分の結果は，それを用いる全ての出力で共有される．
+  \param ib	入力2次元データ配列の先頭行を指す反復子
+  \param ie	入力2次元データ配列の末尾の次の行を指す反復子
+  \param smooth	平滑化結果の先頭行を指す反復子
+  \param diffH	横方向1階微分の先頭行を指す反復子
+  \param diffV	縦方向1階微分の先頭行を指す反復子
+  \param diffHH	横方向2階微分の先頭行を指す反復子
+  \param diffHV	縦横両方向2階微分の先頭行を指す反復子
+  \param diffVV	縦方向2階微分の先頭行を指す反復子．いずれの出力も
+		nullptr を与えれば計算されない
+*/
+template <class T>
+template <class IN, class S, class H, class V, class HH, class HV, class VV>
+inline void
+DericheConvolver2<T>::derivatives(IN ib, IN ie, S smooth, H diffH, V diffV,
+				  HH diffHH, HV diffHV, VV diffVV)
+{
+    super::derivatives(ib, ie,
+		       {{IIRF().initialize(coeffs::_c0, IIRF::Zeroth),
+			 IIRF().initialize(coeffs::_c1, IIRF::First),
+			 IIRF().initialize(coeffs::_c2, IIRF::Second)}},
+		       smooth, diffH, diffV, diffHH, diffHV, diffVV, false);
+}
+
 }
 #endif	// !TU_DERICHECONVOLVER_H
 
@@ -6,10 +6,199 @@
 #ifndef	TU_EDGEDETECTOR_H
 #define	TU_EDGEDETECTOR_H
 
+#include "TU/simd/simd.h"
 #include "TU/Image++.h"
+#if defined(TU_SIMD_DISPATCH)
+#  include "TU/simd/dispatch.h"
+#endif
 
 namespace TU
 {
+namespace detail
+{
+/************************************************************************
+*  edge strength/direction kernels					*
+************************************************************************/
+constexpr float	slant = 0.41421356;	// tan(M_PI/8)
+    
+#if defined(SIMD)
+inline simd::Is32vec
+dir4(simd::F32vec u, simd::F32vec v)
+{
+    using namespace	simd;
+    
+    const Is32vec	l4 = cast<int>(u < -v);
+    return (l4 & Is32vec(0x4)) | ((cast<int>(u < v) ^ l4) & Is32vec(0x2));
+}
+
+inline simd::Is32vec
+dir4x(simd::F32vec u, simd::F32vec v)
+{
+    using namespace	simd;
+    
+    const Is32vec	l4 = cast<int>(v < zero<float>());
+    return (l4				        & Is32vec(0x4)) |
+	   ((cast<int>(u < zero<float>()) ^ l4) & Is32vec(0x2)) |
+						  Is32vec(0x1);
+}
+
+inline simd::Is32vec
+dir8(simd::F32vec u, simd::F32vec v)
+{
+    using namespace	simd;
+    
+    const F32vec	su = F32vec(slant) * u,
+			sv = F32vec(slant) * v;
+    const Is32vec	l2 = cast<int>( u <  sv),
+			l4 = cast<int>(su <  -v);
+    return (l4				  & Is32vec(0x4)) |
+	   ((l2 ^ l4)			  & Is32vec(0x2)) |
+	   (((cast<int>(su <   v) ^ l2) |
+	     (cast<int>( u < -sv) ^ l4))  & Is32vec(0x1));
+}
+
+inline simd::Is32vec
+dir8x(simd::F32vec u, simd::F32vec v)
+{
+    using namespace	simd;
+    
+    const Is32vec	l2 = cast<int>(u < zero<float>()),
+			l4 = cast<int>(v < zero<float>()),
+			l  = l2 ^ l4;
+    return (l4				& Is32vec(0x4)) |
+	   (l				& Is32vec(0x2)) |
+	   (((cast<int>(u <  v) ^ l2) |
+	     (cast<int>(u < -v) ^ l4))  & Is32vec(0x1));
+}
+#endif
+
+template <class T> inline u_int
+dir4(T u, T v)
+{
+    return (u < -v ? (u < v ? 4 : 6) : (u < v ? 2 : 0));
+}
+    
+template <class T> inline u_int
+dir4x(T u, T v)
+{
+    return (v < 0 ? (u < 0 ? 5 : 7) : (u < 0 ? 3 : 1));
+}
+    
+template <class T> inline u_int
+dir8(T u, T v)
+{
+    const T	su = slant * u, sv = slant * v;
+    return (su < -v ?
+	    ( u < -sv ? (u < sv ? (su <   v ? 4 : 5) : 6) : 7) :
+	    (su <   v ? (u < sv ? ( u < -sv ? 3 : 2) : 1) : 0));
+}
+    
+template <class T> inline u_int
+dir8x(T u, T v)
+{
+    return (v < 0 ?
+	    (u < -v ? (u < 0 ? (u <  v ? 4 : 5) : 6) : 7) :
+	    (u <  v ? (u < 0 ? (u < -v ? 3 : 2) : 1) : 0));
+}
+
+//! 1行分のエッジ強度を求める
+/*!
+  \param eH	横方向1階微分入力の先頭
+  \param eV	縦方向1階微分入力の先頭
+  \param out	エッジ強度出力の先頭
+  \param n	画素数
+*/
+inline void
+edgeStrength(const float* eH, const float* eV, float* out, size_t n)
+{
+    const auto	end = out + n;
+#if defined(SSE)
+    using namespace	simd;
+	
+    constexpr size_t	nelms = F32vec::size;
+    for (const float* const end2 = out + F32vec::floor(n); out < end2; )
+    {
+	const F32vec	fH = load(eH), fV = load(eV);
+	    
+	store(out, sqrt(fH * fH + fV * fV));
+	eH  += nelms;
+	eV  += nelms;
+	out += nelms;
+    }
+#endif
+    while (out < end)
+    {
+	*out++ = std::sqrt(*eH * *eH + *eV * *eV);
+	++eH;
+	++eV;
+    }
+}
+
+//! 1行分のエッジ方向を求める
+/*!
+  \param eH	横方向1階微分入力の先頭
+  \param eV	縦方向1階微分入力の先頭
+  \param out	エッジ方向出力の先頭
+  \param n	画素数
+  \param dir	1階微分の組からエッジ方向を求める関数．スカラとSIMDベクトル
+		の双方を引数にとれなければならない
+*/
+template <class DIR> inline void
+edgeDirection(const float* eH, const float* eV, u_char* out, size_t n,
+	      DIR dir)
+{
+    const auto	end = out + n;
+#if defined(SIMD)
+    using namespace	simd;
+
+    constexpr size_t	nelms = F32vec::size;
+    for (const u_char* const end2 = out + Iu8vec::floor(n);
+	 out < end2; out += Iu8vec::size)
+    {
+	const Is32vec	d0 = dir(load(eH), load(eV));
+	eH += nelms;
+	eV += nelms;
+	const Is32vec	d1 = dir(load(eH), load(eV));
+	eH += nelms;
+	eV += nelms;
+	const Is32vec	d2 = dir(load(eH), load(eV));
+	eH += nelms;
+	eV += nelms;
+	const Is32vec	d3 = dir(load(eH), load(eV));
+	eH += nelms;
+	eV += nelms;
+	store(out, cvt<u_char>(cvt<short>(d0, d1), cvt<short>(d2, d3)));
+    }
+#endif
+    while (out < end)
+	*out++ = dir(*eH++, *eV++);
+}
+
+inline void
+edgeDirection4(const float* eH, const float* eV, u_char* out, size_t n)
+{
+    edgeDirection(eH, eV, out, n, [](auto u, auto v){ return dir4(u, v); });
+}
+
+inline void
+edgeDirection4x(const float* eH, const float* eV, u_char* out, size_t n)
+{
+    edgeDirection(eH, eV, out, n, [](auto u, auto v){ return dir4x(u, v); });
+}
+
+inline void
+edgeDirection8(const float* eH, const float* eV, u_char* out, size_t n)
+{
+    edgeDirection(eH, eV, out, n, [](auto u, auto v){ return dir8(u, v); });
+}
+
+inline void
+edgeDirection8x(const float* eH, const float* eV, u_char* out, size_t n)
+{
+    edgeDirection(eH, eV, out, n, [](auto u, auto v){ return dir8x(u, v); });
+}
+}	// namespace detail
+    
 /************************************************************************
 *  class EdgeDetector							*
 ************************************************************************/
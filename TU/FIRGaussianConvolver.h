@@ -143,6 +143,8 @@ class FIRGaussianConvolver2 : public  FIRGaussianCoefficients<D, T>,
     FIRGaussianConvolver2&	initialize(coeff_type sigma)		;
     using			super::grainSize;
     using			super::setGrainSize;
+    using			super::tileSize;
+    using			super::setTileSize;
     
     template <class IN, class OUT>
     void	smooth(IN ib, IN ie, OUT out, bool shift=false)		;
@@ -156,6 +158,10 @@ class FIRGaussianConvolver2 : public  FIRGaussianCoefficients<D, T>,
     void	diffHV(IN ib, IN ie, OUT out, bool shift=false)		;
     template <class IN, class OUT>
     void	diffVV(IN ib, IN ie, OUT out, bool shift=false)		;
+    template <class IN, class S, class H, class V, class HH, class HV, class VV>
+    void	derivatives(IN ib, IN ie, S smooth, H diffH, V diffV,
+			    HH diffHH, HV diffHV, VV diffVV,
+			    bool shift=false)				;
 };
 
 //! Gauss核のsigma値を設定する
@@ -265,6 +271,38 @@ FIRGaussianConvolver2<D, T>::diffVV(IN ib, IN ie, OUT out, bool shift)
     super::initialize(coeffs::_c0, coeffs::_c2)
 	.template convolve<IN, OUT>(ib, ie, out, shift);
 }
+
+//! 平滑化と1, 2階偏微分のうち必要なものを入力の1回の走査で求める
+/*!
+  横方向の平滑化と1, 2階微分の結果は，それを用いる全ての出力で共有される．
+  \param ib	入力2次元データ配列の先頭行を指す反復子
+  \param ie	入力2次元データ配列の末尾の次の行を指す反復子
+  \param smooth	平滑化結果の先頭行を指す反復子
+  \param diffH	横方向1階微分の先頭行を指す反復子
+  \param diffV	縦方向1階微分の先頭行を指す反復子
+  \param diffHH	横方向2階微分の先頭行を指す反復子
+  \param diffHV	縦横両方向2階微分の先頭行を指す反復子
+  \param diffVV	縦方向2階微分の先頭行を指す反復子．いずれの出力も
+		nullptr を与えれば計算されない
+  \param shift	trueならば，入力データと対応するよう，出力位置を水平/垂直
+		方向にそれぞれ offsetH(), offsetV() だけシフトする
+*/
+template <size_t D, class T>
+template <class IN, class S, class H, class V, class HH, class HV, class VV>
+inline void
+FIRGaussianConvolver2<D, T>::derivatives(IN ib, IN ie,
+					 S smooth, H diffH, V diffV,
+					 HH diffHH, HV diffHV, VV diffVV,
+					 bool shift)
+{
+    using FIRF	= FIRFilter<2*D+1, T>;
     
+    super::derivatives(ib, ie,
+		       {{FIRF().initialize(coeffs::_c0),
+			 FIRF().initialize(coeffs::_c1),
+			 FIRF().initialize(coeffs::_c2)}},
+		       smooth, diffH, diffV, diffHH, diffHV, diffVV, shift);
+}
+
 }
 #endif	// !TU_FIRGAUSSIANCONVOLVER_H
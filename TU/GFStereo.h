@@ -165,6 +165,8 @@ class GFStereo : public StereoBase<GFStereo<SCORE, DISP> >
 	GuideArray			F;	// 1 x W
 	ScoreVecArray2TupleArray	A;
 	DisparityArray			dminL;	// 1 x (W - N + 1)
+	FloatArray			dRprev;	// 1 x (W - N + 1)
+	FloatArray			dRnext;	// 1 x (W - N + 1)
 	FloatArray			delta;	// 1 x (W - N + 1)
 	DisparityArray			dminR;	// 1 x (W + D - 1)
 	ScoreVecArray			RminR;	// 1 x D
@@ -227,6 +229,7 @@ class GFStereo : public StereoBase<GFStereo<SCORE, DISP> >
     using	super::nextFrame;
     using	super::selectDisparities;
     using	super::pruneDisparities;
+    using	super::setScoreIncrements;
 
     template <class COL, class COL_RV>
     void	initializeFilterParameters(COL colL, COL colLe,
@@ -247,12 +250,13 @@ class GFStereo : public StereoBase<GFStereo<SCORE, DISP> >
 				   const_reverse_col_siterator colBe,
 				   COL colG,
 				   reverse_col_diterator dminL,
-				   reverse_col_fiterator delta,
+				   reverse_col_fiterator dRprev,
+				   reverse_col_fiterator dRnext,
 				   DMIN_RV dminRV, RMIN_RV RminRV) const;
 
   private:
     Parameters					_params;
-    typename super::template Pool<Buffers>	_bufferPool;
+    Pool<Buffers>	_bufferPool;
 };
 
 template <class SCORE, class DISP>
@@ -293,7 +297,7 @@ GFStereo<SCORE, DISP>::match(ROW rowL, ROW rowLe, ROW rowR, ROW_D rowD)
     if (H < 2*N || W < 2*N)			// 充分な行数／列数があるか確認
 	return;
     
-    auto* const	buffers = _bufferPool.get();	// 各種作業領域を確保
+    const auto	buffers = _bufferPool.acquire();	// 各種作業領域を確保
     buffers->initialize(N, D, W);
     
     auto		rowLp = rowL;
@@ -359,7 +363,8 @@ GFStereo<SCORE, DISP>::match(ROW rowL, ROW rowLe, ROW rowR, ROW_D rowD)
 		computeDisparities(crbegin(B), crend(B),
 				   crbegin(*rowG) + N - 1,
 				   buffers->dminL.rbegin(),
-				   buffers->delta.rbegin(),
+				   buffers->dRprev.rbegin(),
+				   buffers->dRnext.rbegin(),
 				   buffers->dminR.end() - D + 1,
 				   make_dummy_iterator(&(buffers->RminR)));
 		++boxB;
@@ -370,7 +375,9 @@ GFStereo<SCORE, DISP>::match(ROW rowL, ROW rowLe, ROW rowR, ROW_D rowD)
 		selectDisparities(buffers->dminL.cbegin(),
 				  buffers->dminL.cend(),
 				  buffers->dminR.cbegin(),
-				  buffers->delta.cbegin(),
+				  buffers->dRprev.data(),
+				  buffers->dRnext.data(),
+				  buffers->delta.data(),
 				  begin(*rowD) + N - 1);
 	    }
 	    
@@ -381,7 +388,6 @@ GFStereo<SCORE, DISP>::match(ROW rowL, ROW rowLe, ROW rowR, ROW_D rowD)
 	++rowR;
     }
 
-    _bufferPool.put(buffers);
     nextFrame();
 }
     
@@ -397,7 +403,7 @@ GFStereo<SCORE, DISP>::match(ROW rowL, ROW rowLe, ROW rowLlast,
     if (H < 2*N || W < 2*N)			// 充分な行数／列数があるか確認
 	return;
 
-    auto* const	buffers = _bufferPool.get();
+    const auto	buffers = _bufferPool.acquire();
     buffers->initialize(N, D, W, H);		// 各種作業領域を確保
 
     auto		v = H;
@@ -478,7 +484,8 @@ GFStereo<SCORE, DISP>::match(ROW rowL, ROW rowLe, ROW rowLlast,
 		computeDisparities(crbegin(B), crend(B),
 				   crbegin(*rowG) + N - 1,
 				   buffers->dminL.rbegin(),
-				   buffers->delta.rbegin(),
+				   buffers->dRprev.rbegin(),
+				   buffers->dRnext.rbegin(),
 				   make_zip_iterator(
 				       buffers->dminR.end() - D + 1,
 				       make_vertical_iterator(
@@ -494,7 +501,9 @@ GFStereo<SCORE, DISP>::match(ROW rowL, ROW rowLe, ROW rowLlast,
 		selectDisparities(buffers->dminL.cbegin(),
 				  buffers->dminL.cend(),
 				  buffers->dminR.cbegin(),
-				  buffers->delta.cbegin(),
+				  buffers->dRprev.data(),
+				  buffers->dRnext.data(),
+				  buffers->delta.data(),
 				  begin(*rowD) + N - 1);
 	    }
 
@@ -520,7 +529,6 @@ GFStereo<SCORE, DISP>::match(ROW rowL, ROW rowLe, ROW rowLlast,
 	}
     }
     
-    _bufferPool.put(buffers);
     nextFrame();
 }
 
@@ -742,7 +750,8 @@ GFStereo<SCORE, DISP>::computeDisparities(const_reverse_col_siterator colB,
 					  const_reverse_col_siterator colBe,
 					  COL colG,
 					  reverse_col_diterator dminL,
-					  reverse_col_fiterator delta,
+					  reverse_col_fiterator dRprev,
+					  reverse_col_fiterator dRnext,
 					  DMIN_RV dminRV, RMIN_RV RminRV) const
 {
     ScoreVecArray	R(size(*colB));
@@ -792,12 +801,11 @@ GFStereo<SCORE, DISP>::computeDisparities(const_reverse_col_siterator colB,
       	const auto	dL = maskRV.dL();		// 左画像から見た視差
 	const auto	Rb = R.cbegin();
 #endif
-	const auto	dsw1 = _params.disparitySearchWidth - 1;
 	*dminL = dL;
-	*delta = (dL == 0 || dL == dsw1 ? 0 :
-		  0.5f * float(Rb[dL-1] - Rb[dL+1]) /
-		  float(std::max(Rb[dL-1] - Rb[dL], Rb[dL+1] - Rb[dL]) + 1));
-	++delta;
+	setScoreIncrements(Rb, dL, _params.disparitySearchWidth,
+			   *dRprev, *dRnext);
+	++dRprev;
+	++dRnext;
 	++dminL;
 	++RminRV;
     }
@@ -833,6 +841,8 @@ GFStereo<SCORE, DISP>::Buffers::initialize(size_t N, size_t D, size_t W)
     }
     
     dminL.resize(W - 2*N + 2);
+    dRprev.resize(dminL.size());
+    dRnext.resize(dminL.size());
     delta.resize(dminL.size());
     dminR.resize(dminL.size() + D - 1);
     RminR.resize(DD);
@@ -7,6 +7,7 @@
 #define TU_GEOMETRYPP_H
 
 #include "TU/Minimize.h"
+#include "TU/PointBatch.h"
 #include <limits>
 
 namespace TU
@@ -660,6 +661,18 @@ class Projectivity : public std::conditional_t<(DO==0 || DI==0),
     element_type	distance(const std::pair<IN, OUT>& pair) const	;
     template <class T_, size_t D_>
     jacobian_type	jacobian(const Array<T_, D_>& x)	 const	;
+    template <size_t DO_=DO, size_t DI_=DI>
+    std::enable_if_t<DO_ != 0 && DI_ != 0>
+			operator ()(const PointBatch<T>& x,
+				    PointBatch<T>& y)		 const	;
+    template <size_t DO_=DO, size_t DI_=DI>
+    std::enable_if_t<DO_ != 0 && DI_ != 0>
+			mapP(const PointBatch<T>& x,
+			     PointBatch<T>& y)			 const	;
+    template <size_t DO_=DO, size_t DI_=DI>
+    std::enable_if_t<DO_ != 0 && DI_ != 0>
+			jacobian(const PointBatch<T>& x,
+				 PointBatch<T>& J)		 const	;
     template <class T_, size_t D_>
     derivative_type	derivative(const Array<T_, D_>& x)	 const	;
     template <size_t DO_=DO, size_t DI_=DI>
@@ -922,6 +935,48 @@ Projectivity<T, DO, DI>::jacobian(const Array<T_, D_>& x) const -> jacobian_type
     return J;
 }
 
+//! SoA形式の点群の各点に射影変換を適用してその非同次座標を求める．
+/*!
+  入力空間と出力空間の次元がコンパイル時に決まっている場合に限る．
+  \param x	入力点群(inDim() 行の非同次座標または inDim()+1 行の同次座標)
+  \param y	射影変換された点群(outDim() 行の非同次座標)
+*/
+template <class T, size_t DO, size_t DI> template <size_t DO_, size_t DI_>
+inline std::enable_if_t<DO_ != 0 && DI_ != 0>
+Projectivity<T, DO, DI>::operator ()(const PointBatch<T>& x,
+				     PointBatch<T>& y) const
+{
+    project(*this, x, y);
+}
+
+//! SoA形式の点群の各点に射影変換を適用してその同次座標を求める．
+/*!
+  入力空間と出力空間の次元がコンパイル時に決まっている場合に限る．
+  \param x	入力点群(inDim() 行の非同次座標または inDim()+1 行の同次座標)
+  \param y	射影変換された点群(outDim()+1 行の同次座標)
+*/
+template <class T, size_t DO, size_t DI> template <size_t DO_, size_t DI_>
+inline std::enable_if_t<DO_ != 0 && DI_ != 0>
+Projectivity<T, DO, DI>::mapP(const PointBatch<T>& x, PointBatch<T>& y) const
+{
+    transform(*this, x, y);
+}
+
+//! SoA形式の点群の各点においてその点の座標に関するヤコビ行列を求める．
+/*!
+  入力空間と出力空間の次元がコンパイル時に決まっている場合に限る．
+  \param x	入力点群(inDim() 行の非同次座標)
+  \param J	outDim() x inDim() ヤコビ行列を行優先で並べた
+		outDim()*inDim() 行の点群
+*/
+template <class T, size_t DO, size_t DI> template <size_t DO_, size_t DI_>
+inline std::enable_if_t<DO_ != 0 && DI_ != 0>
+Projectivity<T, DO, DI>::jacobian(const PointBatch<T>& x,
+				  PointBatch<T>& J) const
+{
+    TU::jacobian(*this, x, J);
+}
+
 //! 与えられた点における1階微分行列を返す．
 /*!
   変換された点の射影変換行列成分に関する1階微分を計算する．
@@ -81,8 +81,8 @@ ICIA<MAP>::initialize(const IMAGE& src)
     Array2<value_type>		edgeH(size<0>(src), size<1>(src));
     Array2<value_type>		edgeV(size<0>(src), size<1>(src));
     DericheConvolver2<float>	convolver(_params.alpha);
-    convolver.diffH(cbegin(src), cend(src), edgeH.begin());
-    convolver.diffV(cbegin(src), cend(src), edgeV.begin());
+    convolver.derivatives(cbegin(src), cend(src), nullptr,
+			  edgeH.begin(), edgeV.begin(), nullptr, nullptr, nullptr);
 
     initialize(edgeH, edgeV);
 }
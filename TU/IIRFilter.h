@@ -6,6 +6,8 @@
 #ifndef	TU_IIRFILTER_H
 #define	TU_IIRFILTER_H
 
+#include <algorithm>
+#include <vector>
 #include "TU/SeparableFilter2.h"
 
 namespace TU
@@ -91,8 +93,8 @@ class iir_filter_iterator
 		    if (_n == 0)
 		    {
 			_n = 1;
-			_ibuf[0] = *super::base();
 			resize_values(val_is_array());
+			_ibuf[0] = *super::base();
 			_obuf[0] = inpro<0>(index<0>());
 			return _obuf[0];
 		    }
@@ -109,9 +111,9 @@ class iir_filter_iterator
 		    if (_n == 0)
 		    {
 			_n = 1;
+			resize_values(val_is_array());
 			_obuf[0] = inpro<0>(index<0>());
 			_ibuf[0] = *super::base();
-			resize_values(val_is_array());
 			return _obuf[0];
 		    }
 		    else
@@ -128,8 +130,8 @@ class iir_filter_iterator
 		    {
 		      case 0:
 			_n = 1;
-			_ibuf[0] = *super::base();
 			resize_values(val_is_array());
+			_ibuf[0] = *super::base();
 			_obuf[0] = inpro<0>(index<0>());
 			return _obuf[0];
 		      case 1:
@@ -157,9 +159,9 @@ class iir_filter_iterator
 		    {
 		      case 0:
 			_n = 1;
+			resize_values(val_is_array());
 			_obuf[0] = inpro<0>(index<0>());
 			_ibuf[0] = *super::base();
-			resize_values(val_is_array());
 			return _obuf[0];
 		      case 1:
 			_n = 2;
@@ -184,37 +186,23 @@ class iir_filter_iterator
     reference	dereference(selector<D_, true>) const
 		{
 		    const auto	n = _n;
-		    _ibuf[n] = *super::base();
-		    switch (++_n)
-		    {
-		      case 1:
+		    if (n == 0)
 			resize_values(val_is_array());
-			break;
-		      case D:
+		    _ibuf[n] = *super::base();
+		    if (++_n == D)
 			_n = 0;
-			break;
-		      default:
-			break;
-		    }
 		    return (_obuf[n] = (this->*_inpro[n])(index<0>()));
 		}
     template <size_t D_>
     reference	dereference(selector<D_, false>) const
 		{
 		    const auto	n = _n;
+		    if (n == 0)
+			resize_values(val_is_array());
 		    _obuf[n] = (this->*_inpro[n])(index<0>());
 		    _ibuf[n] = *super::base();
-		    switch (++_n)
-		    {
-		      case 1:
-			resize_values(val_is_array());
-			break;
-		      case D:
+		    if (++_n == D)
 			_n = 0;
-			break;
-		      default:
-			break;
-		    }
 		    return _obuf[n];
 		}
 
@@ -244,15 +232,20 @@ class iir_filter_iterator
 			 + inpro<N_>(index<I_+1>());
 		}
 
+  // 要素が配列の場合，最初の要素と同じ大きさの0で過去の入出力を初期化する
     void	resize_values(std::true_type) const
 		{
-		    if (_ibuf[0].size() != _ibuf[D-1].size())
-		    {
-			for (size_t i = 1; i < D; ++i)
-			    _ibuf[i] = _ibuf[0];
+		    using	std::size;
+		    
+		    const auto	n = size(*super::base());
+		    if (_ibuf[D-1].size() != n)
 			for (size_t i = 0; i < D; ++i)
-			    _obuf[i] = _ibuf[0];
-		    }
+			{
+			    _ibuf[i].resize(n);
+			    _ibuf[i] = 0;
+			    _obuf[i].resize(n);
+			    _obuf[i] = 0;
+			}
 		}
     void	resize_values(std::false_type) const
 		{
@@ -451,6 +444,8 @@ template <size_t D, class T=float> class BidirectionalIIRFilter
     void	limits(T& limit0, T& limit1, T& limit2)		const	;
     template <class IN, class OUT>
     OUT		convolve(IN ib, IN ie, OUT out, bool=false)	const	;
+    template <class IN, class OUT>
+    OUT		convolveRows(IN ib, IN ie, OUT out, bool=false)	const	;
 
     const coeffs_type&		ciF()		const	{return _iirF.ci();}
     const coeffs_type&		coF()		const	{return _iirF.co();}
@@ -459,7 +454,99 @@ template <size_t D, class T=float> class BidirectionalIIRFilter
 
     constexpr static size_t	outSize(size_t inSize)	{return inSize;}
     constexpr static size_t	offset()		{return 0;}
-	
+
+  private:
+  // 入出力の各要素が算術型を要素とする1次元配列ならば，その各成分を
+  // SIMDベクトルの各レーンに割り当てて独立な系列として並列に処理できる
+    template <class IN_, class OUT_>
+    using lanes_available = std::integral_constant<
+				bool,
+#if defined(SIMD)
+				(std::is_same<T, float>::value ||
+				 std::is_same<T, double>::value) &&
+				rank<iterator_value<IN_> >()  == 1 &&
+				rank<iterator_value<OUT_> >() == 1 &&
+				std::is_arithmetic<
+				    element_t<iterator_value<IN_> > >::value &&
+				std::is_arithmetic<
+				    element_t<iterator_value<OUT_> > >::value
+#else
+				false
+#endif
+				>;
+
+    template <class IN, class OUT>
+    OUT		convolve(IN ib, IN ie, OUT out, std::false_type)	const	;
+    template <class IN, class OUT>
+    OUT		convolveRows(IN ib, IN ie, OUT out, std::false_type)	const	;
+#if defined(SIMD)
+    using vec_type	= simd::vec<T>;
+
+    template <class IN, class OUT>
+    OUT		convolve(IN ib, IN ie, OUT out, std::true_type)	const	;
+    template <class IN, class OUT>
+    OUT		convolveRows(IN ib, IN ie, OUT out, std::true_type)	const	;
+    void	convolveLanes(const vec_type* x, vec_type* y, size_t n)	const	;
+
+  // 漸化式の依存関係を短くするため，直前の出力 ys[D-1] の項を最後に加える
+    template <size_t... J_>
+    static vec_type	inpro(const vec_type ci[], const vec_type co[],
+			      const vec_type xs[], const vec_type ys[],
+			      std::index_sequence<J_...>)
+			{
+			    auto	val = ci[0]*xs[0];
+			    ((val = simd::fma(ci[J_+1], xs[J_+1], val)), ...);
+			    ((val = simd::fma(co[J_], ys[J_], val)), ...);
+			    return simd::fma(co[D-1], ys[D-1], val);
+			}
+    template <size_t... J_>
+    static void		shift(vec_type v[], vec_type x,
+			      std::index_sequence<J_...>)
+			{
+			    ((v[J_] = v[J_+1]), ...);
+			    v[D-1] = x;
+			}
+    template <class ITER_, size_t... J_>
+    static void		broadcast(vec_type v[], ITER_ c,
+				  std::index_sequence<J_...>)
+			{
+			    ((v[J_] = vec_type(c[J_])), ...);
+			}
+    template <size_t... J_>
+    static void		broadcast(vec_type v[], vec_type x,
+				  std::index_sequence<J_...>)
+			{
+			    ((v[J_] = x), ...);
+			}
+
+    template <class ITER_>
+    static vec_type	load(ITER_ p, size_t n)
+			{
+			    alignas(sizeof(vec_type)) T	buf[vec_type::size] = {};
+			    std::copy_n(p, n, buf);
+			    return simd::load<true>(buf);
+			}
+    static vec_type	load(const T* p, size_t n)
+			{
+			    return (n == vec_type::size ?
+				    simd::load<false>(p) : load<const T*>(p, n));
+			}
+    template <class ITER_>
+    static void		store(ITER_ p, vec_type x, size_t n)
+			{
+			    alignas(sizeof(vec_type)) T	buf[vec_type::size];
+			    simd::store<true>(buf, x);
+			    std::copy_n(buf, n, p);
+			}
+    static void		store(T* p, vec_type x, size_t n)
+			{
+			    if (n == vec_type::size)
+				simd::store<false>(p, x);
+			    else
+				store<T*>(p, x, n);
+			}
+#endif
+    
   private:
     IIRFilter<D, T>	_iirF;
     IIRFilter<D, T>	_iirB;
@@ -590,6 +677,28 @@ BidirectionalIIRFilter<D, T>::limits(T& limit0, T& limit1, T& limit2) const
 */
 template <size_t D, class T> template <class IN, class OUT> inline OUT
 BidirectionalIIRFilter<D, T>::convolve(IN ib, IN ie, OUT out, bool) const
+{
+    return convolve(ib, ie, out, lanes_available<IN, OUT>());
+}
+
+//! 与えられた2次元配列の各行に横方向のフィルタによる畳み込みを行う.
+/*!
+  SIMD命令が使える場合は，vec<T>::size 行ずつまとめてレジスタ内で転置し，
+  各行をベクトルの各レーンに割り当てて並列に処理する．
+  \param ib	入力2次元データ配列の先頭行を指す反復子
+  \param ie	入力2次元データ配列の末尾の次の行を指す反復子
+  \param out	出力2次元データ配列の先頭行を指す反復子
+  \return	出力2次元データ配列の末尾の次の行を指す反復子
+*/
+template <size_t D, class T> template <class IN, class OUT> inline OUT
+BidirectionalIIRFilter<D, T>::convolveRows(IN ib, IN ie, OUT out, bool) const
+{
+    return convolveRows(ib, ie, out, lanes_available<IN, OUT>());
+}
+
+template <size_t D, class T> template <class IN, class OUT> OUT
+BidirectionalIIRFilter<D, T>::convolve(IN ib, IN ie, OUT out,
+				       std::false_type) const
 {
     auto	oute = out;
     std::advance(oute, std::distance(ib, ie));
@@ -602,6 +711,172 @@ BidirectionalIIRFilter<D, T>::convolve(IN ib, IN ie, OUT out, bool) const
 
     return oute;
 }
+
+template <size_t D, class T> template <class IN, class OUT> OUT
+BidirectionalIIRFilter<D, T>::convolveRows(IN ib, IN ie, OUT out,
+					   std::false_type) const
+{
+    using	std::cbegin;
+    using	std::cend;
+    using	std::begin;
+
+    for (; ib != ie; ++ib, ++out)
+	convolve(cbegin(*ib), cend(*ib), begin(*out));
+
+    return out;
+}
+
+#if defined(SIMD)
+//! 各列をSIMDベクトルの各レーンに割り当てて縦方向の畳み込みを行う
+template <size_t D, class T> template <class IN, class OUT> OUT
+BidirectionalIIRFilter<D, T>::convolve(IN ib, IN ie, OUT out,
+				       std::true_type) const
+{
+    using	std::cbegin;
+    using	std::begin;
+    using	std::size;
+
+    constexpr size_t	N  = vec_type::size;
+    constexpr size_t	NV = 4;
+    const size_t	nrow = std::distance(ib, ie);
+    if (nrow == 0)
+	return out;
+
+  // 各行の連続した NV 本のベクトル分をまとめて読み書きし，
+  // ベクトル1本分の幅の列ごとに漸化式を適用する．
+    const size_t		ncol = size(*ib);
+    std::vector<vec_type>	x(NV*nrow), y(NV*nrow);
+    for (size_t col = 0; col < ncol; col += NV*N)
+    {
+	const auto	nv = std::min(NV, (ncol - col + N - 1)/N);
+
+	auto	row = ib;
+	for (size_t r = 0; r < nrow; ++r, ++row)
+	{
+	    const auto	p = cbegin(*row) + col;
+	    for (size_t v = 0; v < nv; ++v)
+		x[v*nrow + r] = load(p + v*N, std::min(N, ncol - col - v*N));
+	}
+
+	for (size_t v = 0; v < nv; ++v)
+	    convolveLanes(x.data() + v*nrow, y.data() + v*nrow, nrow);
+
+	auto	o = out;
+	for (size_t r = 0; r < nrow; ++r, ++o)
+	{
+	    const auto	p = begin(*o) + col;
+	    for (size_t v = 0; v < nv; ++v)
+		store(p + v*N, y[v*nrow + r], std::min(N, ncol - col - v*N));
+	}
+    }
+
+    std::advance(out, nrow);
+    return out;
+}
+
+//! vec<T>::size 行ずつ転置し，各行をSIMDベクトルの各レーンに割り当てて横方向の畳み込みを行う
+template <size_t D, class T> template <class IN, class OUT> OUT
+BidirectionalIIRFilter<D, T>::convolveRows(IN ib, IN ie, OUT out,
+					   std::true_type) const
+{
+    using	std::cbegin;
+    using	std::begin;
+    using	std::size;
+
+    constexpr size_t	N = vec_type::size;
+    if (ib == ie)
+	return out;
+
+    const size_t		ncol = size(*ib);
+    std::vector<vec_type>	x(ncol), y(ncol);
+    while (ib != ie)
+    {
+	const size_t	m = std::min(N, size_t(std::distance(ib, ie)));
+	
+      // m(<= N) 行を N 列ずつ転置して，各列をベクトルとして並べる．
+	for (size_t col = 0; col < ncol; col += N)
+	{
+	    const auto	n = std::min(N, ncol - col);
+	    vec_type	blk[N];
+	    auto	row = ib;
+	    for (size_t i = 0; i < N; ++i)
+		if (i < m)
+		{
+		    blk[i] = load(cbegin(*row) + col, n);
+		    ++row;
+		}
+		else
+		    blk[i] = vec_type(0);
+	    simd::transpose(blk);
+	    std::copy_n(blk, n, x.begin() + col);
+	}
+
+	convolveLanes(x.data(), y.data(), ncol);
+
+      // 結果を N 列ずつ転置して m 行に書き戻す．
+	for (size_t col = 0; col < ncol; col += N)
+	{
+	    const auto	n = std::min(N, ncol - col);
+	    vec_type	blk[N];
+	    std::copy_n(y.begin() + col, n, blk);
+	    std::fill(blk + n, blk + N, vec_type(0));
+	    simd::transpose(blk);
+	    auto	o = out;
+	    for (size_t i = 0; i < m; ++i)
+	    {
+		store(begin(*o) + col, blk[i], n);
+		++o;
+	    }
+	}
+
+	std::advance(ib,  m);
+	std::advance(out, m);
+    }
+
+    return out;
+}
+
+//! SIMDベクトルの各レーンを独立なデータ列とみなして両側フィルタを適用する
+/*!
+  \param x	入力データ列の先頭
+  \param y	出力データ列の先頭
+  \param n	データ列の長さ
+*/
+template <size_t D, class T> void
+BidirectionalIIRFilter<D, T>::convolveLanes(const vec_type* x, vec_type* y,
+					    size_t n) const
+{
+  // 過去の入出力をレジスタに保持できるよう，添字は全てコンパイル時に定める．
+    constexpr auto	all  = std::make_index_sequence<D>();
+    constexpr auto	past = std::make_index_sequence<D-1>();
+    vec_type		ci[D], co[D], xs[D], ys[D];
+
+  // 後退フィルタ: xs[j] = x[i+D-j], ys[j] = y[i+D-j]
+    broadcast(ci, ciB().rbegin(), all);
+    broadcast(co, coB().rbegin(), all);
+    broadcast(xs, vec_type(0), all);
+    broadcast(ys, vec_type(0), all);
+    for (size_t i = n; i-- > 0; )
+    {
+	const auto	val = inpro(ci, co, xs, ys, past);
+	shift(xs, x[i], past);
+	shift(ys, y[i] = val, past);
+    }
+
+  // 前進フィルタ: xs[j] = x[i-D+1+j], ys[j] = y[i-D+j]
+    broadcast(ci, ciF().begin(), all);
+    broadcast(co, coF().begin(), all);
+    broadcast(xs, vec_type(0), all);
+    broadcast(ys, vec_type(0), all);
+    for (size_t i = 0; i < n; ++i)
+    {
+	shift(xs, x[i], past);
+	const auto	val = inpro(ci, co, xs, ys, past);
+	shift(ys, val, past);
+	y[i] = y[i] + val;
+    }
+}
+#endif
     
 /************************************************************************
 *  class BidirectionalIIRFilter2<D, T>					*
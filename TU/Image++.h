@@ -2147,6 +2147,12 @@ class GenericImage : public ImageBase<GenericImage>
   */
     const ImageFormat&	format()		const	{ return _format; }
 
+  //! BMP_8形式の画像のカラーマップを返す．
+  /*!
+    \return	カラーマップ
+  */
+    const Array<BGRA>&	colormap()		const	{ return _colormap; }
+
   //! 入力ストリームから画像を読み込む．
   /*!
     \param in	入力ストリーム
@@ -2182,7 +2188,7 @@ class GenericImage : public ImageBase<GenericImage>
 			    _a.resize(h, w);
 			}
 			       
-  private:
+  protected:
     array2_type		_a;
     ImageFormat		_format;
     Array<BGRA>		_colormap;
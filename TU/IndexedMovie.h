@@ -0,0 +1,461 @@
+/*!
+  \file		IndexedMovie.h
+  \author	Toshio UESHIBA
+  \brief	クラス TU::IndexedMovie の定義と実装
+*/
+#ifndef TU_INDEXEDMOVIE_H
+#define TU_INDEXEDMOVIE_H
+
+#include <list>
+#include <vector>
+#include "TU/MappedImage.h"
+#include "TU/Manip.h"
+
+namespace TU
+{
+/************************************************************************
+*  class IndexedMovie<T>						*
+************************************************************************/
+//! ムービーファイルをメモリにマップして任意のフレームを読み出すクラス
+/*!
+  ファイルの形式は Movie<T>::save() が書き出すものと同じである．
+  各フレームのファイル中の位置はヘッダから求められるので，全フレームを
+  読み込まずに任意のフレームに定数時間で移動できる．
+
+  全ビューの画素データの形式が画素の型と一致し，各行が上から順に
+  パディングなしで並んでいれば，各ビューの画像はマップされた領域を
+  そのまま参照する．そうでなければ，フレームは必要になった時点で変換
+  されて読み込まれ，最近使われたものから指定された枚数だけ保持される．
+  \param T	画素の型
+*/
+template <class T> class IndexedMovie
+{
+  public:
+  //! 各ビューの幅と高さのペア
+    typedef std::pair<size_t, size_t>			Size;
+
+  private:
+  //! ビュー
+    struct View : public Image<T>
+    {
+	View()	:Image<T>(), format(ImageFormat::DEFAULT), offset(0)	{}
+
+	ImageFormat	format;	//!< 画素データの形式
+	size_t		offset;	//!< フレームの先頭からの画像データ領域のオフセット
+    };
+
+  //! 変換されて読み込まれたフレーム
+    struct Frame
+    {
+	size_t			frame;	//!< フレーム番号
+	std::vector<Image<T> >	images;	//!< 各ビューの画像
+    };
+
+    typedef std::list<Frame>				Frames;
+
+  public:
+    IndexedMovie()							;
+    explicit		IndexedMovie(const char* path)			;
+
+  // General information.
+    bool		isCircularMode()			const	;
+    IndexedMovie<T>&	setCircularMode(bool circular)			;
+    size_t		nviews()				const	;
+    size_t		width(size_t view)			const	;
+    size_t		height(size_t view)			const	;
+    const Image<T>&	image(size_t view)			const	;
+    bool		isMapped()				const	;
+    size_t		cacheSize()				const	;
+    IndexedMovie<T>&	setCacheSize(size_t n)				;
+
+  // Handling frames.
+			operator bool()				const	;
+    size_t		nframes()				const	;
+    size_t		currentFrame()				const	;
+    IndexedMovie<T>&	setFrame(size_t frame)				;
+    IndexedMovie<T>&	rewind()					;
+    IndexedMovie<T>&	operator ++()					;
+    IndexedMovie<T>&	operator --()					;
+
+  // Restore movie.
+    void		restore(const char* path)			;
+
+  private:
+    IndexedMovie<T>&	setFrameToViews()				;
+    const Frame&	loadFrame(size_t frame)				;
+
+  private:
+    MappedFile		_file;		//!< マップされたムービーファイル
+    bool		_circular;	//!< 循環モード/非循環モード
+    bool		_mapped;	//!< 各ビューがマップされた領域を参照するならtrue
+    Array<View>		_views;		//!< ビューの並び
+    size_t		_offset;	//!< ファイルの先頭からの先頭フレームのオフセット
+    size_t		_nbytes;	//!< 1フレームあたりのバイト数
+    size_t		_nframes;	//!< フレーム数
+    size_t		_cFrame;	//!< 現フレームの番号
+    Frames		_cache;		//!< 読み込み済みのフレーム(新しい順)
+    size_t		_ncached;	//!< 保持するフレームの最大数
+};
+
+//! 空のムービーを生成する．
+template <class T> inline
+IndexedMovie<T>::IndexedMovie()
+    :_file(), _circular(false), _mapped(false), _views(), _offset(0),
+     _nbytes(0), _nframes(0), _cFrame(0), _cache(), _ncached(1)
+{
+}
+
+//! ムービーファイルをマップしてムービーを生成する．
+/*!
+  \param path	ファイル名
+*/
+template <class T> inline
+IndexedMovie<T>::IndexedMovie(const char* path)
+    :IndexedMovie()
+{
+    restore(path);
+}
+
+//! 循環モードであるか調べる．
+/*!
+  \return	循環モードであればtrue, そうでなければfalse
+*/
+template <class T> inline bool
+IndexedMovie<T>::isCircularMode() const
+{
+    return _circular;
+}
+
+//! 循環/非循環モードを設定する．
+/*!
+  循環モードに設定する場合は，現フレームがムービーの末尾であれば先頭に設定する．
+  \param circular	循環モードであればtrue, そうでなければfalse
+  \return		このムービー
+*/
+template <class T> IndexedMovie<T>&
+IndexedMovie<T>::setCircularMode(bool circular)
+{
+    _circular = circular;
+
+    if (_circular && _cFrame == _nframes)
+	return rewind();
+    else
+	return *this;
+}
+
+//! ビュー数を返す．
+/*!
+  \return	view数
+*/
+template <class T> inline size_t
+IndexedMovie<T>::nviews() const
+{
+    return _views.size();
+}
+
+//! 指定されたビューに対応する画像の幅を返す．
+/*!
+  \param view	ビュー番号
+  \return	画像の幅
+*/
+template <class T> inline size_t
+IndexedMovie<T>::width(size_t view) const
+{
+    return _views[view].width();
+}
+
+//! 指定されたビューに対応する画像の高さを返す．
+/*!
+  \param view	ビュー番号
+  \return	画像の高さ
+*/
+template <class T> inline size_t
+IndexedMovie<T>::height(size_t view) const
+{
+    return _views[view].height();
+}
+
+//! 現在のフレームの指定されたビューに対応する画像を返す．
+/*!
+  \param view	ビュー番号
+  \return	画像
+*/
+template <class T> inline const Image<T>&
+IndexedMovie<T>::image(size_t view) const
+{
+    return _views[view];
+}
+
+//! 各ビューの画像がマップされた領域をそのまま参照しているか調べる．
+/*!
+  \return	参照していればtrue, フレーム毎に変換して読み込まれていれば
+		false
+*/
+template <class T> inline bool
+IndexedMovie<T>::isMapped() const
+{
+    return _mapped;
+}
+
+//! 変換されて読み込まれたフレームを保持する最大数を返す．
+/*!
+  \return	フレーム数
+*/
+template <class T> inline size_t
+IndexedMovie<T>::cacheSize() const
+{
+    return _ncached;
+}
+
+//! 変換されて読み込まれたフレームを保持する最大数を設定する．
+/*!
+  \param n	フレーム数．0を指定した場合は1とみなす．
+  \return	このムービー
+*/
+template <class T> IndexedMovie<T>&
+IndexedMovie<T>::setCacheSize(size_t n)
+{
+    _ncached = std::max(n, size_t(1));
+
+  // 現フレームは先頭にあるので，末尾から捨てても参照は無効にならない．
+    while (_cache.size() > _ncached)
+	_cache.pop_back();
+
+    return *this;
+}
+
+//! 現フレームの状態を調べる．
+/*!
+  \return	現フレームが最後のフレームの次に達していればfalse,
+		そうでなければtrue
+*/
+template <class T> inline
+IndexedMovie<T>::operator bool() const
+{
+    return (_cFrame != _nframes);
+}
+
+//! フレーム数を返す．
+/*!
+  \return	フレーム数
+*/
+template <class T> inline size_t
+IndexedMovie<T>::nframes() const
+{
+    return _nframes;
+}
+
+//! 現在のフレーム番号を返す．
+/*!
+  \return	フレーム番号
+*/
+template <class T> inline size_t
+IndexedMovie<T>::currentFrame() const
+{
+    return _cFrame;
+}
+
+//! 現フレームを指定する．
+/*!
+  frame >= nframes() の場合は現フレームは nframes() が返す値に設定され，
+  #operator bool() でfalseが返される状態になる．
+  \param frame	フレーム番号
+  \return	このムービー
+*/
+template <class T> inline IndexedMovie<T>&
+IndexedMovie<T>::setFrame(size_t frame)
+{
+    _cFrame = std::min(frame, _nframes);
+
+    return setFrameToViews();
+}
+
+//! 現フレームをムービーの先頭に戻す．
+/*!
+  \return	このムービー
+*/
+template <class T> inline IndexedMovie<T>&
+IndexedMovie<T>::rewind()
+{
+    return setFrame(0);
+}
+
+//! 現フレームを1つ先に進める．
+/*!
+  現フレームが既に最後のフレームの次に達していたら( #operator bool() で
+  falseが返される状態になっていたら)，何もせずにリターンする．
+  現フレームが最後のフレームである場合，循環モードでないならばさらに
+  最後のフレームの次に進み， #operator bool() でfalseが返される状態になる．
+  循環モードならば先頭フレームに移動する．
+  \return	このムービー
+*/
+template <class T> inline IndexedMovie<T>&
+IndexedMovie<T>::operator ++()
+{
+    if (_cFrame == _nframes)
+	return *this;
+
+    if (++_cFrame == _nframes && _circular)	// 末尾に達し，
+	_cFrame = 0;				// かつ循環モードならば先頭へ
+
+    return setFrameToViews();
+}
+
+//! 現在のフレームを1つ前に戻す．
+/*!
+  現フレームがムービーの先頭の場合，循環モードでないならばムービーの
+  最後のフレームの次に移動し， #operator bool() でfalseが返される状態になる．
+  循環モードならば最後のフレームに移動する．
+  \return	このムービー
+*/
+template <class T> inline IndexedMovie<T>&
+IndexedMovie<T>::operator --()
+{
+    if (_cFrame == 0)			// ムービーの先頭ならば...
+    {
+	_cFrame = _nframes;		// 最後のフレームの次に移動する．
+
+	if (_circular && _nframes > 0)	// さらに循環モードならば...
+	    --_cFrame;			// 最後のフレームに戻る．
+    }
+    else
+	--_cFrame;
+
+    return setFrameToViews();
+}
+
+//! ムービーファイルをメモリにマップする．
+/*!
+  ヘッダを読み込んで各フレームの位置を求める．画素データはこの時点では
+  読み込まれない．末尾の不完全なフレームは無視される．現フレームは先頭の
+  フレームとなる．
+  \param path	ファイル名
+*/
+template <class T> void
+IndexedMovie<T>::restore(const char* path)
+{
+    using namespace	std;
+
+  // フレーム間を任意に移動するので，順次読み込み用の先読みと解放を
+  // 行わないようにマップする．
+    MappedFile	file(path, MappedFile::NORMAL);
+
+  // ファイルの先頭文字が'M'であることを確認する．
+    imemstream	in(file.data(), file.size());
+    char	c;
+    if (!in.get(c) || c != 'M')
+	throw runtime_error("TU::IndexedMovie<T>::restore: not a movie file!!");
+    _cache.clear();
+
+  // ビュー数を読み込み，各ビューのヘッダを読み込む．
+    size_t	nv;
+    in >> nv >> skipl;
+    _views.resize(nv);
+
+    _nbytes = 0;
+    for (auto& view : _views)
+    {
+	detail::ImageHeader	header;
+	view.format = header.restoreHeader(in);
+	if (!in)
+	    throw runtime_error("TU::IndexedMovie<T>::restore: failed to read the header!!");
+
+	view.P	    = header.P;
+	view.d1	    = header.d1;
+	view.d2	    = header.d2;
+	view.offset = _nbytes;
+	view.resize(0, 0);		// 古いマップへの参照を外す
+	view.resize(header.nrow(), header.ncol());
+	_nbytes += view.format.ncolors() * sizeof(BGRA)
+		 + view.format.nbytesPerRow(header.ncol()) * header.nrow();
+    }
+    _file    = std::move(file);
+    _offset  = in.tellg();
+    _nframes = (_nbytes > 0 ? (_file.size() - _offset) / _nbytes : 0);
+
+  // 全ビューの画素データをそのまま参照できるか調べる．
+    _mapped = (_nbytes % alignof(T) == 0);
+    for (const auto& view : _views)
+	_mapped = _mapped					&&
+		  view.format.type() == view.defaultType()	&&
+		  detail::isPlainFormat(view.format.type())	&&
+		  8*sizeof(T) == view.format.depth()		&&
+		  !view.format.bottomToTop()			&&
+		  view.format.nbytesForPadding(view.width()) == 0	&&
+		  detail::isAligned<T>(_file.data() + _offset + view.offset);
+
+    rewind();
+}
+
+/*
+ *  private member functions
+ */
+//! 現フレームを個々のビューにセットする．
+/*!
+  現フレームが最後のフレームの次に達していれば，ビューは変化しない．
+  \return	このムービー
+*/
+template <class T> IndexedMovie<T>&
+IndexedMovie<T>::setFrameToViews()
+{
+    if (_cFrame == _nframes)
+	return *this;
+
+    if (_mapped)
+    {
+	const auto	p = _file.data() + _offset + _cFrame * _nbytes;
+	for (auto& view : _views)
+	    view.resize(reinterpret_cast<T*>(p + view.offset),
+			view.height(), view.width());
+    }
+    else
+    {
+	auto&	frame = loadFrame(_cFrame);
+	for (size_t i = 0; i < _views.size(); ++i)
+	    _views[i].resize(const_cast<T*>(frame.images[i].data()),
+			     _views[i].height(), _views[i].width());
+    }
+
+    return *this;
+}
+
+//! 指定されたフレームを変換して読み込む．
+/*!
+  既に読み込まれていればそれを，そうでなければ最も長く使われていない
+  フレームの領域に読み込んで返す．返されるフレームは _cache の先頭になる．
+  \param frame	フレーム番号
+  \return	読み込まれたフレーム
+*/
+template <class T> const typename IndexedMovie<T>::Frame&
+IndexedMovie<T>::loadFrame(size_t frame)
+{
+    for (auto iter = _cache.begin(); iter != _cache.end(); ++iter)
+	if (iter->frame == frame)
+	{
+	    _cache.splice(_cache.begin(), _cache, iter);
+	    return _cache.front();
+	}
+
+    if (_cache.size() < _ncached)
+    {
+	_cache.emplace_front();
+	for (const auto& view : _views)
+	    _cache.front().images.emplace_back(view.width(), view.height());
+    }
+    else
+	_cache.splice(_cache.begin(), _cache, std::prev(_cache.end()));
+
+    auto&	entry = _cache.front();
+    entry.frame = _nframes;		// 読み込みに失敗した場合に備えて無効化
+    imemstream	in(_file.data(), _file.size());
+    in.seekg(_offset + frame * _nbytes);
+    for (size_t i = 0; i < _views.size(); ++i)
+	if (!entry.images[i].restoreData(in, _views[i].format))
+	    throw std::runtime_error("TU::IndexedMovie<T>::loadFrame: failed to read the frame!!");
+    entry.frame = frame;
+
+    return entry;
+}
+
+}
+#endif	// !TU_INDEXEDMOVIE_H
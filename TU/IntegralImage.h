@@ -1,12 +1,15 @@
 /*!
   \file		IntegralImage.h
   \author	Toshio UESHIBA
-  \brief	クラス TU::IntegralImage, TU::DiagonalIntegralImage の定義と実装
+  \brief	クラス TU::IntegralImage, TU::MultiIntegralImage,
+		TU::DiagonalIntegralImage の定義と実装
 */
 #ifndef	TU_INTEGRALIMAGE_H
 #define	TU_INTEGRALIMAGE_H
 
+#include <algorithm>
 #include "TU/Image++.h"
+#include "TU/simd/simd.h"
 #ifdef USE_TBB
 #  include <tbb/parallel_for.h>
 #  include <tbb/blocked_range.h>
@@ -14,10 +17,205 @@
 
 namespace TU
 {
+namespace detail
+{
+/************************************************************************
+*  integral image construction						*
+************************************************************************/
+//! 要素型 T の行の加算にSIMD命令が使えるか
+template <class T>
+using integral_simd = std::integral_constant<
+			  bool,
+#if defined(SIMD)
+			  std::is_same<T, float>::value  ||
+			  std::is_same<T, double>::value ||
+			  std::is_same<T, int>::value    ||
+			  std::is_same<T, u_int>::value
+#else
+			  false
+#endif
+			  >;
+
+template <class T> inline void
+add_row(T* dst, const T* src, size_t n, std::false_type)
+{
+    for (const auto end = dst + n; dst != end; ++dst, ++src)
+	*dst += *src;
+}
+
+#if defined(SIMD)
+template <class T> inline void
+add_row(T* dst, const T* src, size_t n, std::true_type)
+{
+    constexpr size_t	N = simd::vec<T>::size;
+
+    const auto	end = dst + n/N*N;
+    for (; dst != end; dst += N, src += N)
+	simd::store<false>(dst, simd::load<false>(dst) +
+				simd::load<false>(src));
+    add_row(dst, src, n%N, std::false_type());
+}
+#endif
+
+//! 行 src の各要素を行 dst の対応する要素に加える．
+template <class T> inline void
+add_row(T* dst, const T* src, size_t n)
+{
+    add_row(dst, src, n, integral_simd<T>());
+}
+
+//! 各画素が N チャンネルの値を持つ画像の積分画像を作る．
+/*!
+  積分画像の各行にはそれぞれの画素の N 個のチャンネルが連続して格納される．
+  まず各行を独立に横方向に累積し，次に上の行を順次加えて縦方向に累積する．
+  TBB が使える場合は前者を行毎に，後者を列のブロック毎に並列に処理する．
+  \param a	積分画像．(height + 1) 行 (width + 1)*N 列の大きさを持つこと
+  \param width	原画像の幅
+  \param height	原画像の高さ
+  \param src	src(u, v, vals) で画素 (u, v) の N 個のチャンネル値を
+		vals に書き込む関数
+*/
+template <size_t N, class A, class SRC> void
+integral_initialize(A& a, size_t width, size_t height, SRC src)
+{
+    using T = typename A::element_type;
+
+    const auto	scan = [&a, width, &src](size_t v)
+			{
+			    T*	dst = a[v+1].begin();
+			    T	val[N];
+			    for (size_t k = 0; k < N; ++k)
+				dst[k] = val[k] = 0;	// 0列目は0
+
+			    for (size_t u = 0; u < width; ++u)
+			    {
+				dst += N;
+				src(u, v, dst);
+				for (size_t k = 0; k < N; ++k)
+				    dst[k] = (val[k] += dst[k]);
+			    }
+			};
+    
+    std::fill_n(a[0].begin(), (width + 1)*N, T(0));	// 0行目はすべて0
+#ifdef USE_TBB
+    tbb::parallel_for(tbb::blocked_range<size_t>(0, height, 16),
+		      [&scan](const tbb::blocked_range<size_t>& r)
+		      {
+			  for (auto v = r.begin(); v != r.end(); ++v)
+			      scan(v);
+		      });
+    tbb::parallel_for(tbb::blocked_range<size_t>(N, (width + 1)*N, 1024),
+		      [&a, height](const tbb::blocked_range<size_t>& r)
+		      {
+			  for (size_t v = 1; v <= height; ++v)
+			      add_row(a[v].begin() + r.begin(),
+				      a[v-1].begin() + r.begin(), r.size());
+		      });
+#else
+    for (size_t v = 0; v < height; ++v)
+    {
+	scan(v);
+	add_row(a[v+1].begin() + N, a[v].begin() + N, width*N);
+    }
+#endif
+}
+
+//! 原画像の長方形領域が変化したときに積分画像を更新する．
+/*!
+  領域内の行については領域の左端以降を，領域より下の行については
+  領域の下端における変化分を加えることによって，領域の左上の部分を
+  読むことなく更新する．浮動小数点型では丸め誤差が蓄積しうるので，
+  呼び出し側で適宜 integral_initialize() によって作り直すこと．
+  \param a	integral_initialize() で作られた積分画像
+  \param src	integral_initialize() と同じ関数
+  \param u0	領域の左上隅の横座標
+  \param v0	領域の左上隅の縦座標
+  \param w	領域の幅
+  \param h	領域の高さ
+*/
+template <size_t N, class A, class SRC> void
+integral_update(A& a, SRC src, size_t u0, size_t v0, size_t w, size_t h)
+{
+    using T = typename A::element_type;
+
+    const size_t	width  = a.ncol()/N - 1;
+    const size_t	height = a.nrow() - 1;
+    u0 = std::min(u0, width);
+    v0 = std::min(v0, height);
+    w  = std::min(w, width  - u0);
+    h  = std::min(h, height - v0);
+    if (w == 0 || h == 0)
+	return;
+
+  // 更新前の上の行と現在の行の第 u0 列以降
+    const size_t	n = (width + 1 - u0)*N;
+    Array<T>		buf(2*n);
+    T*			prvOld = buf.data();
+    T*			curOld = prvOld + n;
+    std::copy_n(a[v0].begin() + u0*N, n, prvOld);
+
+  // 領域内の各行を更新
+    for (size_t v = v0; v < v0 + h; ++v)
+    {
+	const T*	prv = a[v].begin() + u0*N;	// 更新済みの上の行
+	T*		cur = a[v+1].begin() + u0*N;
+	std::copy_n(cur, n, curOld);
+
+      // 第 u0 列における行方向の累積値から始めて領域内の画素を累積
+	T	val[N];
+	for (size_t k = 0; k < N; ++k)
+	    val[k] = curOld[k] - prvOld[k];
+	for (size_t i = N; i <= w*N; i += N)
+	{
+	    src(u0 + i/N - 1, v, cur + i);
+	    for (size_t k = 0; k < N; ++k)
+		cur[i + k] = prv[i + k] + (val[k] += cur[i + k]);
+	}
+
+      // 領域より右は行方向の累積値の変化分を加える
+	for (size_t k = 0; k < N; ++k)
+	    val[k] -= curOld[w*N + k] - prvOld[w*N + k];
+	for (size_t i = (w + 1)*N; i < n; i += N)
+	    for (size_t k = 0; k < N; ++k)
+		cur[i + k] = prv[i + k] + (curOld[i + k] - prvOld[i + k])
+			   + val[k];
+
+	std::swap(prvOld, curOld);
+    }
+
+  // 領域より下の各行に領域の最下行における変化分を加える
+    const T*	cur = a[v0 + h].begin() + u0*N;
+    for (size_t i = 0; i < n; ++i)
+	prvOld[i] = cur[i] - prvOld[i];
+
+    const auto	shift = [&a, u0, n, prvOld](size_t v)
+			{
+			    add_row(a[v].begin() + u0*N, prvOld, n);
+			};
+#ifdef USE_TBB
+    tbb::parallel_for(tbb::blocked_range<size_t>(v0 + h + 1, height + 1, 16),
+		      [&shift](const tbb::blocked_range<size_t>& r)
+		      {
+			  for (auto v = r.begin(); v != r.end(); ++v)
+			      shift(v);
+		      });
+#else
+    for (size_t v = v0 + h + 1; v <= height; ++v)
+	shift(v);
+#endif
+}
+}	// namespace detail
+
 /************************************************************************
 *  class IntegralImage<T>						*
 ************************************************************************/
 //! 積分画像(integral image)を表すクラス
+/*!
+  T が浮動小数点型の場合，update() による部分更新を繰り返すと丸め誤差が
+  蓄積するので，部分更新が maxUpdates() 回続くと次の update() では積分画像
+  全体を作り直す．
+  \param T	積分画像の画素の型
+*/
 template <class T>
 class IntegralImage : public Image<T>
 {
@@ -53,6 +251,9 @@ class IntegralImage : public Image<T>
 
     template <class S> IntegralImage&
 		initialize(const Image<S>& image)			;
+    template <class S> IntegralImage&
+		update(const Image<S>& image,
+		       size_t u, size_t v, size_t w, size_t h)		;
     T		crop(int u, int v, int w, int h)		const	;
     T		crop2(int umin, int umax, int vmin, int vmax)	const	;
     T		crossVal(int u, int v, int cropSize)		const	;
@@ -61,14 +262,23 @@ class IntegralImage : public Image<T>
 
     size_t	originalWidth()					const	;
     size_t	originalHeight()				const	;
+    size_t	maxUpdates()			const	{ return _maxUpdates; }
+    void	setMaxUpdates(size_t n)			{ _maxUpdates = n; }
     
     using	super::width;
     using	super::height;
+
+  private:
+    constexpr static size_t	DefaultMaxUpdates = 8;
+
+    size_t	_nupdates;	//!< 最後に全体を作ってからの部分更新の回数
+    size_t	_maxUpdates;	//!< 全体を作り直すまでの部分更新の最大回数
 };
 
 //! 空の積分画像を作る
 template <class T> inline
 IntegralImage<T>::IntegralImage()
+    :_nupdates(0), _maxUpdates(DefaultMaxUpdates)
 {
 }
     
@@ -78,12 +288,15 @@ IntegralImage<T>::IntegralImage()
 */
 template <class T> template <class S> inline
 IntegralImage<T>::IntegralImage(const Image<S>& image)
+    :_nupdates(0), _maxUpdates(DefaultMaxUpdates)
 {
     initialize(image);
 }
     
 //! 与えられた画像から積分画像を作る
 /*!
+  各行の横方向の累積と縦方向の累積に分けて計算し，後者にはSIMD命令を用いる．
+  TBB が使える場合はそれぞれを並列に処理する．
   \param image		入力画像
   \return		この積分画像
 */
@@ -94,19 +307,40 @@ IntegralImage<T>::initialize(const Image<S>& image)
     super::resize(image.height() + 1, image.width() + 1);
 
   // 上と左に余白を入れる
-    (*this)[0] = 0;					// 0行目はすべて0
-    for (size_t v = 1; v < height(); ++v)
-    {
-	T*		dst = (*this)[v].begin();
-	*dst = 0;					// 0列目は0
-
-	const S*	src = image[v-1].begin();
-	T		val = 0;			// この行のこの画素までの和
-	const T*	prv = (*this)[v-1].begin();	// 1行上
-	const T* const	end = dst + width();
-	while (++dst < end)
-	    *dst = (val += *src++) + *(++prv);
-    }
+    detail::integral_initialize<1>(*this, image.width(), image.height(),
+				   [&image](size_t u, size_t v, T* val)
+				   { *val = image[v][u]; });
+    _nupdates = 0;
+
+    return *this;
+}
+
+//! 原画像の長方形領域が変化したときに積分画像を更新する
+/*!
+  画像の大きさは積分画像を作ったときと同じでなければならない．
+  領域の左上の部分は再計算されない．ただし，T が浮動小数点型であって
+  部分更新が既に maxUpdates() 回続いている場合は，丸め誤差の蓄積を
+  断つために全体を作り直す．
+  \param image		領域内が変化した入力画像
+  \param u		領域の左上隅の横座標
+  \param v		領域の左上隅の縦座標
+  \param w		領域の幅
+  \param h		領域の高さ
+  \return		この積分画像
+*/
+template <class T> template <class S> IntegralImage<T>&
+IntegralImage<T>::update(const Image<S>& image,
+			 size_t u, size_t v, size_t w, size_t h)
+{
+    if (image.width() != originalWidth() || image.height() != originalHeight())
+	throw std::invalid_argument("TU::IntegralImage<T>::update(): mismatched image size!!");
+    if (std::is_floating_point<T>::value && _nupdates++ >= _maxUpdates)
+	return initialize(image);
+    
+    detail::integral_update<1>(*this,
+			       [&image](size_t u, size_t v, T* val)
+			       { *val = image[v][u]; },
+			       u, v, w, h);
 
     return *this;
 }
@@ -213,6 +447,173 @@ IntegralImage<T>::originalHeight() const
     return height() - 1;
 }
 
+/************************************************************************
+*  class MultiIntegralImage<T, N>					*
+************************************************************************/
+//! 複数のチャンネルの積分画像をまとめて表すクラス
+/*!
+  原画像の各画素から求めた N 個のチャンネル値(例えば I, I^2, Ix, Iy)の
+  積分画像を，画素毎にチャンネルを連続させて(interleaved)1枚の配列に保持する．
+  IntegralImage と同様に，T が浮動小数点型の場合は部分更新が maxUpdates() 回
+  続くと次の update() で全体を作り直す．
+  \param T	チャンネル値の型
+  \param N	チャンネル数
+*/
+template <class T, size_t N>
+class MultiIntegralImage : public Array2<T>
+{
+  private:
+    using super	= Array2<T>;
+
+  public:
+    using channels_type	= Vector<T, N>;	//!< 全チャンネルの値の型
+    
+  public:
+    MultiIntegralImage()
+	:_nupdates(0), _maxUpdates(DefaultMaxUpdates)			{}
+    template <class S, class FUNC>
+    MultiIntegralImage(const Image<S>& image, FUNC func)
+	:_nupdates(0), _maxUpdates(DefaultMaxUpdates)
+    {
+	initialize(image, func);
+    }
+
+    template <class S, class FUNC> MultiIntegralImage&
+		initialize(const Image<S>& image, FUNC func)		;
+    template <class S, class FUNC> MultiIntegralImage&
+		update(const Image<S>& image, FUNC func,
+		       size_t u, size_t v, size_t w, size_t h)		;
+    channels_type
+		crop(int u, int v, int w, int h)		const	;
+
+    size_t	originalWidth()		const	{ return super::ncol()/N - 1; }
+    size_t	originalHeight()	const	{ return super::nrow() - 1; }
+    size_t	maxUpdates()		const	{ return _maxUpdates; }
+    void	setMaxUpdates(size_t n)		{ _maxUpdates = n; }
+    
+  private:
+    template <class S, class FUNC>
+    static auto	source(const Image<S>& image, FUNC& func)
+		{
+		    return [&image, &func](size_t u, size_t v, T* val)
+			   {
+			       const channels_type	x = func(image, u, v);
+			       std::copy_n(x.begin(), N, val);
+			   };
+		}
+
+  private:
+    constexpr static size_t	DefaultMaxUpdates = 8;
+
+    size_t	_nupdates;	//!< 最後に全体を作ってからの部分更新の回数
+    size_t	_maxUpdates;	//!< 全体を作り直すまでの部分更新の最大回数
+};
+
+//! 与えられた画像から各チャンネルの積分画像を作る
+/*!
+  \param image		入力画像
+  \param func		func(image, u, v) で画素 (u, v) の全チャンネルの値を
+			channels_type 型で返す関数
+  \return		この積分画像
+*/
+template <class T, size_t N> template <class S, class FUNC>
+MultiIntegralImage<T, N>&
+MultiIntegralImage<T, N>::initialize(const Image<S>& image, FUNC func)
+{
+    super::resize(image.height() + 1, (image.width() + 1)*N);
+    detail::integral_initialize<N>(*this, image.width(), image.height(),
+				   source(image, func));
+    _nupdates = 0;
+    return *this;
+}
+    
+//! 原画像の長方形領域が変化したときに各チャンネルの積分画像を更新する
+/*!
+  func が近傍の画素を参照する場合は，その範囲だけ広げた領域を与えること．
+  \param image		領域内が変化した入力画像
+  \param func		initialize() に与えたものと同じ関数
+  \param u		領域の左上隅の横座標
+  \param v		領域の左上隅の縦座標
+  \param w		領域の幅
+  \param h		領域の高さ
+  \return		この積分画像
+*/
+template <class T, size_t N> template <class S, class FUNC>
+MultiIntegralImage<T, N>&
+MultiIntegralImage<T, N>::update(const Image<S>& image, FUNC func,
+				 size_t u, size_t v, size_t w, size_t h)
+{
+    if (image.width() != originalWidth() || image.height() != originalHeight())
+	throw std::invalid_argument("TU::MultiIntegralImage<T, N>::update(): mismatched image size!!");
+    if (std::is_floating_point<T>::value && _nupdates++ >= _maxUpdates)
+	return initialize(image, func);
+
+    detail::integral_update<N>(*this, source(image, func), u, v, w, h);
+    return *this;
+}
+    
+//! 原画像に設定した長方形ウィンドウ内の各チャンネルの総和を返す
+/*!
+  \param u		ウィンドウの左上隅の横座標
+  \param v		ウィンドウの左上隅の縦座標
+  \param w		ウィンドウの幅
+  \param h		ウィンドウの高さ
+  \return		ウィンドウ内の各チャンネルの総和
+*/
+template <class T, size_t N> typename MultiIntegralImage<T, N>::channels_type
+MultiIntegralImage<T, N>::crop(int u, int v, int w, int h) const
+{
+    channels_type	sum;
+    sum = 0;
+    
+    const int	u1 = std::min(u + w, int(originalWidth())),
+		v1 = std::min(v + h, int(originalHeight()));
+    if (u > int(originalWidth()) || v > int(originalHeight()) ||
+	u1 < 0 || v1 < 0)
+	return sum;
+    if (u < 0)
+	u = 0;
+    if (v < 0)
+	v = 0;
+
+    const T	*p00 = (*this)[v ].begin() + u *N,
+		*p01 = (*this)[v ].begin() + u1*N,
+		*p10 = (*this)[v1].begin() + u *N,
+		*p11 = (*this)[v1].begin() + u1*N;
+    for (size_t k = 0; k < N; ++k)
+	sum[k] = p11[k] + p00[k] - p01[k] - p10[k];
+
+    return sum;
+}
+
+/************************************************************************
+*  class IntensityChannels<T>						*
+************************************************************************/
+//! 画素値 I，その自乗 I^2，横方向と縦方向の中心差分 Ix, Iy を返す関数オブジェクト
+/*!
+  MultiIntegralImage<T, 4> のチャンネルを与えるために用いる．画像の境界では
+  片側差分を用いる．I^2 の積分値は大きくなるので，大きな画像に対しては
+  T を double とするのがよい．
+  \param T	チャンネル値の型
+*/
+template <class T>
+struct IntensityChannels
+{
+    template <class S> Vector<T, 4>
+    operator ()(const Image<S>& image, size_t u, size_t v) const
+    {
+	const auto	ul = (u > 0 ? u - 1 : u);
+	const auto	ur = (u + 1 < image.width()  ? u + 1 : u);
+	const auto	vu = (v > 0 ? v - 1 : v);
+	const auto	vd = (v + 1 < image.height() ? v + 1 : v);
+	const T		val = image[v][u];
+
+	return {val, val*val,
+		(T(image[v][ur]) - T(image[v][ul]))/T(std::max(ur - ul, size_t(1))),
+		(T(image[vd][u]) - T(image[vu][u]))/T(std::max(vd - vu, size_t(1)))};
+    }
+};
+
 /************************************************************************
 *  class DiagonalIntegralImage<T>					*
 ************************************************************************/
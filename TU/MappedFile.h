@@ -0,0 +1,138 @@
+/*!
+  \file		MappedFile.h
+  \author	Toshio UESHIBA
+  \brief	メモリにマップされたファイルに関するクラスの定義と実装
+*/
+#ifndef TU_MAPPEDFILE_H
+#define TU_MAPPEDFILE_H
+
+#include <cstddef>
+#include <iostream>
+#include <streambuf>
+
+namespace TU
+{
+/************************************************************************
+*  class MappedFile							*
+************************************************************************/
+//! メモリにマップされたファイルを表すクラス
+/*!
+  読み込み用に開いたファイルは書き込み時コピー(copy-on-write)でマップ
+  されるので，マップされた領域に書き込んでもファイルは変更されない．
+  書き込み用に生成したファイルへの書き込みは，ファイルに反映される．
+*/
+class MappedFile
+{
+  public:
+  //! マップされた領域へのアクセスパターン
+    enum Access
+    {
+	NORMAL,		//!< 特に指定しない
+	SEQUENTIAL,	//!< 先頭から順に読む
+	RANDOM		//!< 任意の位置を読む
+    };
+
+  public:
+    MappedFile()						;
+    explicit	MappedFile(const char* path,
+			   Access access=SEQUENTIAL)		;
+		MappedFile(const char* path, size_t size)	;
+		MappedFile(MappedFile&& file)			;
+		~MappedFile()					;
+    MappedFile&	operator =(MappedFile&& file)			;
+
+		MappedFile(const MappedFile&)			= delete;
+    MappedFile&	operator =(const MappedFile&)			= delete;
+
+    void	open(const char* path, Access access=SEQUENTIAL)	;
+    void	create(const char* path, size_t size)		;
+    void	close()						;
+
+  //! ファイルがマップされているか調べる．
+  /*!
+    \return	マップされていればtrue
+  */
+    bool	is_open()		const	{ return _p != nullptr; }
+
+  //! マップされた領域の先頭を返す．
+  /*!
+    \return	マップされた領域の先頭へのポインタ
+  */
+    char*	data()				{ return _p; }
+
+  //! マップされた領域の先頭を返す．
+  /*!
+    \return	マップされた領域の先頭へのポインタ
+  */
+    const char*	data()			const	{ return _p; }
+
+  //! マップされた領域のバイト数を返す．
+  /*!
+    \return	マップされた領域のバイト数
+  */
+    size_t	size()			const	{ return _size; }
+
+  private:
+    char*	_p;		//!< マップされた領域の先頭
+    size_t	_size;		//!< マップされた領域のバイト数
+};
+
+/************************************************************************
+*  class imemstream							*
+************************************************************************/
+//! メモリ上の文字列を読み込む入力ストリームクラス
+/*!
+  文字列はコピーされずにそのまま読み込まれる．
+*/
+class imemstream : public std::istream
+{
+  private:
+    class membuf : public std::streambuf
+    {
+      public:
+	membuf(const char* p, size_t n)
+	{
+	    const auto	q = const_cast<char*>(p);
+	    setg(q, q, q + n);
+	}
+
+      protected:
+	virtual pos_type	seekoff(off_type off,
+					std::ios_base::seekdir dir,
+					std::ios_base::openmode)
+				{
+				    char*	p = (dir == std::ios_base::beg ?
+						     eback() :
+						     dir == std::ios_base::end ?
+						     egptr() : gptr()) + off;
+				    if (p < eback() || p > egptr())
+					return pos_type(off_type(-1));
+				    setg(eback(), p, egptr());
+				    return pos_type(p - eback());
+				}
+	virtual pos_type	seekpos(pos_type pos,
+					std::ios_base::openmode which)
+				{
+				    return seekoff(off_type(pos),
+						   std::ios_base::beg, which);
+				}
+    };
+
+  public:
+  //! メモリ上の文字列から入力ストリームを作る．
+  /*!
+    \param p	文字列の先頭
+    \param n	文字列のバイト数
+  */
+    imemstream(const char* p, size_t n)
+	:std::istream(nullptr), _buf(p, n)
+    {
+	rdbuf(&_buf);
+    }
+
+  private:
+    membuf	_buf;		//!< 文字列を参照するストリームバッファ
+};
+
+}
+#endif	// !TU_MAPPEDFILE_H
@@ -0,0 +1,472 @@
+/*!
+  \file		MappedImage.h
+  \author	Toshio UESHIBA
+  \brief	メモリにマップされた画像ファイルの読み書きに関するクラスの定義と実装
+*/
+#ifndef TU_MAPPEDIMAGE_H
+#define TU_MAPPEDIMAGE_H
+
+#include <cstring>
+#include <fstream>
+#include <sstream>
+#include "TU/Image++.h"
+#include "TU/MappedFile.h"
+
+namespace TU
+{
+namespace detail
+{
+/************************************************************************
+*  class ImageHeader							*
+************************************************************************/
+//! 画素領域を確保せずに画像のヘッダだけを読み込むためのクラス
+class ImageHeader : public ImageBase<ImageHeader>
+{
+  public:
+    ImageHeader() :_nrow(0), _ncol(0), _format(ImageFormat::DEFAULT)	{}
+
+    size_t		nrow()			const	{ return _nrow; }
+    size_t		ncol()			const	{ return _ncol; }
+    const ImageFormat&	format()		const	{ return _format; }
+    ImageFormat::Type	defaultType()		const	{ return _format.type(); }
+    void		resize(size_t h, size_t w, const ImageFormat& format)
+			{
+			    _nrow   = h;
+			    _ncol   = w;
+			    _format = format;
+			}
+
+  private:
+    size_t		_nrow;
+    size_t		_ncol;
+    ImageFormat		_format;
+};
+
+//! 1画素が sizeof(T) バイトの要素1つでそのまま表される画素フォーマットか調べる
+inline bool
+isPlainFormat(ImageFormat::Type type)
+{
+    switch (type)
+    {
+      case ImageFormat::U_CHAR:
+      case ImageFormat::SHORT:
+      case ImageFormat::INT:
+      case ImageFormat::FLOAT:
+      case ImageFormat::DOUBLE:
+      case ImageFormat::RGB_24:
+      case ImageFormat::BMP_24:
+      case ImageFormat::BMP_32:
+	return true;
+      default:
+	break;
+    }
+
+    return false;
+}
+
+template <class T> inline bool
+isAligned(const void* p)
+{
+    return reinterpret_cast<uintptr_t>(p) % alignof(T) == 0;
+}
+
+//! PBMヘッダの直後の画素データが align バイト境界に揃うように注釈行を挿入する
+/*!
+  \param header	PBMヘッダ
+  \param align	境界のバイト数
+*/
+inline void
+alignPBMHeader(std::string& header, size_t align)
+{
+    constexpr size_t	MinLength = 11;		// "# Padding:\n"
+
+    if (header.size() % align == 0)
+	return;
+
+  // 末尾の2行(幅と高さ，最大画素値)の直前に挿入する．
+    const auto	pos = header.rfind('\n', header.rfind('\n',
+						     header.size() - 2) - 1) + 1;
+    const auto	npads = (align - (header.size() + MinLength) % align) % align;
+    header.insert(pos, "# Padding:" + std::string(npads, ' ') + '\n');
+}
+}	// namespace detail
+
+/************************************************************************
+*  class MappedImage<T>							*
+************************************************************************/
+//! メモリにマップされたPBM/BMPファイルから読み込まれる画像クラス
+/*!
+  ファイル中の画素フォーマットがこの画像の画素の型と一致し，各行が上から
+  順にパディングなしで並んでいれば，画素データはコピーされずにマップされた
+  領域をそのまま参照する．マップは書き込み時コピーであるから，画素に
+  書き込んでもファイルは変更されない．そうでなければ，画素データはマップ
+  された領域から直接この画像の型に変換される．
+  \param T	画素の型
+*/
+template <class T>
+class MappedImage : public Image<T>
+{
+  private:
+    using super	= Image<T>;
+
+  public:
+    MappedImage()	:super(), _file()				{}
+    explicit
+    MappedImage(const char* path)
+	:super(), _file()
+    {
+	restore(path);
+    }
+
+		MappedImage(const MappedImage&)			= delete;
+    MappedImage&	operator =(const MappedImage&)		= delete;
+
+    using	super::operator =;
+    using	super::width;
+    using	super::height;
+    using	super::P;
+    using	super::d1;
+    using	super::d2;
+
+    bool	restore(const char* path)				;
+
+  //! 画素データがマップされたファイルの領域を参照しているか調べる．
+  /*!
+    \return	参照していればtrue
+  */
+    bool	mapped()			const	{ return _file.is_open(); }
+
+  private:
+    template <class T_>
+    bool	restoreRows(const char* p, const ImageFormat& format)	;
+
+  private:
+    MappedFile	_file;
+};
+
+//! 画像ファイルをメモリにマップして読み込む．
+/*!
+  \param path	ファイル名
+  \return	画素データがマップされた領域をそのまま参照していればtrue,
+		この画像の領域に変換されてコピーされていればfalse
+*/
+template <class T> bool
+MappedImage<T>::restore(const char* path)
+{
+  // ヘッダを検証するまでは，現在マップされている領域を解除しない．
+    MappedFile		file(path);
+    imemstream		in(file.data(), file.size());
+    detail::ImageHeader	header;
+    const auto		format = header.restoreHeader(in);
+    if (!in)
+	throw std::runtime_error("TU::MappedImage<T>::restore(): failed to read the header!!");
+
+    const size_t	h = header.nrow(), w = header.ncol();
+    const size_t	offset = in.tellg();
+    const auto		p = file.data() + offset;
+
+    if (detail::isPlainFormat(format.type()) &&
+	offset + format.nbytesPerRow(w) * h > file.size())
+	throw std::runtime_error("TU::MappedImage<T>::restore(): truncated file!!");
+
+    P  = header.P;
+    d1 = header.d1;
+    d2 = header.d2;
+
+  // 画素フォーマットが一致すればマップされた領域をそのまま参照する．
+    if (format.type() == super::defaultType()	&&
+	detail::isPlainFormat(format.type())	&&
+	8*sizeof(T) == format.depth()		&&
+	!format.bottomToTop()			&&
+	format.nbytesForPadding(w) == 0		&&
+	detail::isAligned<T>(p))
+    {
+	_file = std::move(file);
+	super::resize(reinterpret_cast<T*>(p), h, w);
+	return true;
+    }
+
+  // そうでなければ，マップされた領域から直接変換する．古いマップを参照
+  // したままだと同じ大きさへの resize() で領域が確保されないので，先に
+  // 参照を外す．
+    if (_file.is_open())
+	super::resize(0, 0);
+    super::resize(h, w);
+
+    bool	done = false;
+    switch (format.type())
+    {
+      case ImageFormat::U_CHAR:
+	done = restoreRows<u_char>(p, format);
+	break;
+      case ImageFormat::SHORT:
+	done = restoreRows<short >(p, format);
+	break;
+      case ImageFormat::INT:
+	done = restoreRows<int	 >(p, format);
+	break;
+      case ImageFormat::FLOAT:
+	done = restoreRows<float >(p, format);
+	break;
+      case ImageFormat::DOUBLE:
+	done = restoreRows<double>(p, format);
+	break;
+      case ImageFormat::RGB_24:
+	done = restoreRows<RGB	 >(p, format);
+	break;
+      case ImageFormat::BMP_24:
+	done = restoreRows<BGR	 >(p, format);
+	break;
+      case ImageFormat::BMP_32:
+	done = restoreRows<BGRA	 >(p, format);
+	break;
+      default:
+	break;
+    }
+    if (!done)		// YUV画像，カラーマップ付きBMPおよび境界外の画素
+	super::restoreData(in, format);
+
+    _file.close();
+
+    return false;
+}
+
+template <class T> template <class T_> bool
+MappedImage<T>::restoreRows(const char* p, const ImageFormat& format)
+{
+    if (!detail::isAligned<T_>(p))
+	return false;
+
+    const auto	nbytes = format.nbytesPerRow(width());
+    for (size_t v = 0; v < height(); ++v, p += nbytes)
+    {
+	const auto	src = reinterpret_cast<const T_*>(p);
+	auto&&		row = (*this)[format.bottomToTop() ?
+				      height() - 1 - v : v];
+	std::copy(make_pixel_iterator(src),
+		  make_pixel_iterator(src + width()),
+		  make_pixel_iterator(row.begin()));
+    }
+
+    return true;
+}
+
+/************************************************************************
+*  class MappedGenericImage						*
+************************************************************************/
+//! メモリにマップされたPBM/BMPファイルから読み込まれる総称画像クラス
+/*!
+  各行が上から順にパディングなしで並んでいれば，画素データはコピーされずに
+  マップされた領域をそのまま参照する．
+*/
+class MappedGenericImage : public GenericImage
+{
+  public:
+    MappedGenericImage()	:GenericImage(), _file()		{}
+    explicit
+    MappedGenericImage(const char* path)
+	:GenericImage(), _file()
+    {
+	restore(path);
+    }
+
+		MappedGenericImage(const MappedGenericImage&)	= delete;
+    MappedGenericImage&
+		operator =(const MappedGenericImage&)		= delete;
+
+    bool	restore(const char* path)				;
+
+  //! 画素データがマップされたファイルの領域を参照しているか調べる．
+  /*!
+    \return	参照していればtrue
+  */
+    bool	mapped()			const	{ return _file.is_open(); }
+
+  private:
+    MappedFile	_file;
+};
+
+//! 画像ファイルをメモリにマップして読み込む．
+/*!
+  \param path	ファイル名
+  \return	画素データがマップされた領域をそのまま参照していればtrue,
+		この画像の領域にコピーされていればfalse
+*/
+inline bool
+MappedGenericImage::restore(const char* path)
+{
+  // ヘッダを検証するまでは，現在マップされている領域を解除しない．
+    MappedFile		file(path);
+    imemstream		in(file.data(), file.size());
+    detail::ImageHeader	header;
+    const auto		format = header.restoreHeader(in);
+    if (!in)
+	throw std::runtime_error("TU::MappedGenericImage::restore(): failed to read the header!!");
+
+    const size_t	h = header.nrow();
+    const size_t	nbytes = (format.depth()*header.ncol() + 7) / 8;
+
+    if (!format.bottomToTop() && format.nbytesForPadding(header.ncol()) == 0)
+    {
+	const size_t	offset = size_t(in.tellg())
+			       + format.ncolors()*sizeof(BGRA);
+	if (offset + nbytes*h > file.size())
+	    throw std::runtime_error("TU::MappedGenericImage::restore(): truncated file!!");
+
+	_format = format;
+	P	= header.P;
+	d1	= header.d1;
+	d2	= header.d2;
+	_colormap.resize(_format.ncolors());
+	_colormap.restore(in);
+	_file = std::move(file);
+	_a.resize(_file.data() + offset, h, nbytes);
+	return true;
+    }
+
+    _format = format;
+    P	    = header.P;
+    d1	    = header.d1;
+    d2	    = header.d2;
+    if (_file.is_open())	// 古いマップへの参照を外す
+	_a.resize(0, 0);
+    _a.resize(h, nbytes);
+    restoreData(in);
+    _file.close();
+
+    return false;
+}
+
+/************************************************************************
+*  global functions							*
+************************************************************************/
+namespace detail
+{
+template <class T_, class T, class ALLOC> void
+saveMapped(const Image<T, ALLOC>& image, const char* path,
+	   ImageFormat::Type type)
+{
+    std::ostringstream	out;
+    image.saveHeader(out, type);
+    auto		header = out.str();
+    if (header[0] == 'P')
+	detail::alignPBMHeader(header, alignof(T_));
+
+    const ImageFormat	format(type);
+    const auto		nbytes = format.nbytesPerRow(image.width());
+    MappedFile		file(path, header.size() + nbytes*image.height());
+    std::memcpy(file.data(), header.data(), header.size());
+
+    auto		p = file.data() + header.size();
+    Array<T_>		buf(image.width());
+    for (const auto& row : image)
+    {
+	using	std::begin;
+	using	std::end;
+
+	if (detail::isAligned<T_>(p))
+	    std::copy(make_pixel_iterator(begin(row)),
+		      make_pixel_iterator(end(row)),
+		      make_pixel_iterator(reinterpret_cast<T_*>(p)));
+	else
+	{
+	    std::copy(make_pixel_iterator(begin(row)),
+		      make_pixel_iterator(end(row)),
+		      make_pixel_iterator(buf.begin()));
+	    std::memcpy(p, buf.data(), buf.size()*sizeof(T_));
+	}
+	p += nbytes;		// パディングは生成時に0で埋められている
+    }
+}
+}	// namespace detail
+
+//! 指定した画素の型で画像をメモリにマップしたファイルに書き出す．
+/*!
+  書き出される内容は Image<T, ALLOC>::save() と同じである．ただし，PBM
+  形式の場合は，画素データが画素の境界に揃うようにヘッダに注釈行が挿入
+  される．YUV画像とカラーマップ付きのBMP画像は，通常のファイル出力で
+  書き出される．
+  \param image	画像
+  \param path	ファイル名
+  \param type	画素の型．ただし，#ImageFormat::DEFAULT を指定した場合は，
+		画像の画素の型で書き出される．
+*/
+template <class T, class ALLOC> void
+saveMapped(const Image<T, ALLOC>& image, const char* path,
+	   ImageFormat::Type type=ImageFormat::DEFAULT)
+{
+    if (type == ImageFormat::DEFAULT)
+	type = image.defaultType();
+
+    switch (type)
+    {
+      case ImageFormat::U_CHAR:
+	detail::saveMapped<u_char>(image, path, type);
+	break;
+      case ImageFormat::SHORT:
+	detail::saveMapped<short >(image, path, type);
+	break;
+      case ImageFormat::INT:
+	detail::saveMapped<int	 >(image, path, type);
+	break;
+      case ImageFormat::FLOAT:
+	detail::saveMapped<float >(image, path, type);
+	break;
+      case ImageFormat::DOUBLE:
+	detail::saveMapped<double>(image, path, type);
+	break;
+      case ImageFormat::RGB_24:
+	detail::saveMapped<RGB	 >(image, path, type);
+	break;
+      case ImageFormat::BMP_24:
+	detail::saveMapped<BGR	 >(image, path, type);
+	break;
+      case ImageFormat::BMP_32:
+	detail::saveMapped<BGRA	 >(image, path, type);
+	break;
+      default:
+      {
+	std::ofstream	out(path, std::ios::binary);
+	if (!out || !image.save(out, type))
+	    throw std::runtime_error("TU::saveMapped(): cannot write the image!!");
+      }
+	break;
+    }
+}
+
+//! 総称画像をメモリにマップしたファイルに書き出す．
+/*!
+  書き出される内容は GenericImage::save() と同じである．
+  \param image	総称画像
+  \param path	ファイル名
+*/
+inline void
+saveMapped(const GenericImage& image, const char* path)
+{
+    std::ostringstream	out;
+    image.saveHeader(out, image.format().type());
+    const auto		header = out.str();
+
+    const auto&		format	 = image.format();
+    const auto&		colormap = image.colormap();
+    const size_t	ncolors	 = (colormap.size() > 0 ? 256 : 0);
+    const size_t	nbytes	 = (format.depth()*image.width() + 7) / 8;
+    const size_t	npads	 = format.nbytesForPadding(image.width());
+    MappedFile		file(path, header.size() + ncolors*sizeof(BGRA) +
+				   (nbytes + npads)*image.height());
+
+    auto		p = file.data();
+    std::memcpy(p, header.data(), header.size());
+    p += header.size();
+    std::memcpy(p, colormap.data(), colormap.size()*sizeof(BGRA));
+    p += ncolors*sizeof(BGRA);		// 残りのカラーマップは0で埋められている
+
+    for (size_t v = 0; v < image.height(); ++v, p += nbytes + npads)
+    {
+	const auto	row = (format.bottomToTop() ? image.height() - 1 - v : v);
+	std::memcpy(p, image.data() + row*nbytes, nbytes);
+    }
+}
+
+}
+#endif	// !TU_MAPPEDIMAGE_H
@@ -0,0 +1,288 @@
+/*!
+  \file		PointBatch.h
+  \author	Toshio UESHIBA
+  \brief	SoA形式の点群に対する一括座標変換の定義と実装
+*/
+#ifndef TU_POINTBATCH_H
+#define TU_POINTBATCH_H
+
+#include <stdexcept>
+#include <string>
+#include "TU/Array++.h"
+#include "TU/simd/simd.h"
+#if defined(USE_TBB)
+#  include <tbb/parallel_for.h>
+#  include <tbb/blocked_range.h>
+#endif
+
+namespace TU
+{
+/************************************************************************
+*  type alias: PointBatch<T>						*
+************************************************************************/
+//! 多数の点を座標成分毎に連続して格納するSoA(structure of arrays)形式の点群
+/*!
+  第 d 行に全点の第 d 座標を並べた2次元配列である．SIMD命令が使える場合は
+  各行の先頭がSIMDベクトルの境界に揃えられ，行の長さはSIMDベクトルの
+  要素数の倍数に切り上げられるので，一括変換では端数処理を要しない．
+  \param T	座標の型
+*/
+#if defined(SIMD)
+template <class T> using PointBatch = Array2<T, 0, 0, simd::allocator<T> >;
+#else
+template <class T> using PointBatch = Array2<T>;
+#endif
+
+namespace detail
+{
+/************************************************************************
+*  struct point_batch<T>						*
+************************************************************************/
+//! PointBatch<T> の各行をSIMDベクトル単位で読み書きするための補助クラス
+template <class T>
+struct point_batch
+{
+#if defined(SIMD)
+    using vec_type	= simd::vec<T>;
+
+    constexpr static size_t	Size = vec_type::size;
+
+    static vec_type	load(const T* p)	{ return simd::load<true>(p); }
+    static void		store(T* p, vec_type x)	{ simd::store<true>(p, x); }
+    static vec_type	fma(vec_type x, vec_type y, vec_type z)
+			{
+			    return simd::fma(x, y, z);
+			}
+#else
+    using vec_type	= T;
+
+    constexpr static size_t	Size = 1;
+
+    static vec_type	load(const T* p)	{ return *p; }
+    static void		store(T* p, vec_type x)	{ *p = x; }
+    static vec_type	fma(vec_type x, vec_type y, vec_type z)
+			{
+			    return x*y + z;
+			}
+#endif
+
+  //! 点群の第 i 行の先頭を返す．
+    static const T*	row(const PointBatch<T>& a, size_t i)
+			{
+			    const T*	p = a.data();
+			    return p + i*a.stride();
+			}
+  //! 点群の第 i 行の先頭を返す．
+    static T*		row(PointBatch<T>& a, size_t i)
+			{
+			    T*	p = a.data();
+			    return p + i*a.stride();
+			}
+
+  //! n 個の点をSIMDベクトルの要素数ずつに分けて関数を適用する．
+  /*!
+    TBB が使える場合は並列に処理する．
+    \param n	点の数
+    \param func	各ベクトルの先頭の点の番号を引数とする関数
+  */
+    template <class FUNC>
+    static void		for_each(size_t n, FUNC func)
+			{
+			    const size_t	nvecs = (n + Size - 1)/Size;
+#if defined(USE_TBB)
+			    tbb::parallel_for(
+				tbb::blocked_range<size_t>(0, nvecs, 256),
+				[&func](const tbb::blocked_range<size_t>& r)
+				{
+				    for (auto i = r.begin(); i != r.end(); ++i)
+					func(i*Size);
+				});
+#else
+			    for (size_t i = 0; i < nvecs; ++i)
+				func(i*Size);
+#endif
+			}
+};
+
+//! 入力点群が行列に対して非同次座標か同次座標のいずれかであることを確かめる．
+template <class T> inline bool
+is_homogeneous(const PointBatch<T>& X, size_t ncol, const char* func)
+{
+    if (X.nrow() + 1 == ncol)
+	return false;
+    if (X.nrow() != ncol)
+	throw std::invalid_argument(std::string(func) +
+				    ": mismatched dimension of points!!");
+    return true;
+}
+}	// namespace detail
+
+/************************************************************************
+*  batched transformations						*
+************************************************************************/
+//! 点群の各点に行列を掛ける．
+/*!
+  入力点群の行数が行列の列数より1少なければ各点の最後に1を補った同次座標
+  とみなす．X と Y の行数が等しければ X と Y は同一でもよい．
+  \param A	R x C 行列
+  \param X	C 行または C-1 行の入力点群
+  \param Y	R 行の出力点群
+*/
+template <class T, size_t R, size_t C> void
+transform(const Array2<T, R, C>& A, const PointBatch<T>& X, PointBatch<T>& Y)
+{
+    static_assert(R != 0 && C != 0, "TU::transform(): fixed-size matrix required!!");
+
+    using batch		= detail::point_batch<T>;
+    using vec_type	= typename batch::vec_type;
+
+    const auto	homogeneous = detail::is_homogeneous(X, C, "TU::transform()");
+    const auto	n = X.ncol();
+    Y.resize(R, n);
+
+    vec_type	a[R][C];
+    for (size_t i = 0; i < R; ++i)
+	for (size_t j = 0; j < C; ++j)
+	    a[i][j] = vec_type(A[i][j]);
+
+    const T*	x[C];
+    T*		y[R];
+    for (size_t j = 0; j < X.nrow(); ++j)
+	x[j] = batch::row(X, j);
+    for (size_t i = 0; i < R; ++i)
+	y[i] = batch::row(Y, i);
+
+    batch::for_each(n, [&](size_t k)
+			{
+			    vec_type	v[C];
+			    for (size_t j = 0; j < C - 1; ++j)
+				v[j] = batch::load(x[j] + k);
+			    v[C-1] = (homogeneous ? batch::load(x[C-1] + k)
+						  : vec_type(1));
+
+			    for (size_t i = 0; i < R; ++i)
+			    {
+				auto	val = a[i][0] * v[0];
+				for (size_t j = 1; j < C; ++j)
+				    val = batch::fma(a[i][j], v[j], val);
+				batch::store(y[i] + k, val);
+			    }
+			});
+}
+
+//! 点群の各点を行列によって射影変換し，その非同次座標を求める．
+/*!
+  入力点群の行数が行列の列数より1少なければ各点の最後に1を補った同次座標
+  とみなす．X と Y の行数が等しければ X と Y は同一でもよい．
+  \param P	R x C 射影変換行列
+  \param X	C 行または C-1 行の入力点群
+  \param Y	R-1 行の出力点群
+*/
+template <class T, size_t R, size_t C> void
+project(const Array2<T, R, C>& P, const PointBatch<T>& X, PointBatch<T>& Y)
+{
+    static_assert(R > 1 && C != 0, "TU::project(): fixed-size matrix required!!");
+
+    using batch		= detail::point_batch<T>;
+    using vec_type	= typename batch::vec_type;
+
+    const auto	homogeneous = detail::is_homogeneous(X, C, "TU::project()");
+    const auto	n = X.ncol();
+    Y.resize(R - 1, n);
+
+    vec_type	a[R][C];
+    for (size_t i = 0; i < R; ++i)
+	for (size_t j = 0; j < C; ++j)
+	    a[i][j] = vec_type(P[i][j]);
+
+    const T*	x[C];
+    T*		y[R-1];
+    for (size_t j = 0; j < X.nrow(); ++j)
+	x[j] = batch::row(X, j);
+    for (size_t i = 0; i < R - 1; ++i)
+	y[i] = batch::row(Y, i);
+
+    batch::for_each(n, [&](size_t k)
+			{
+			    vec_type	v[C];
+			    for (size_t j = 0; j < C - 1; ++j)
+				v[j] = batch::load(x[j] + k);
+			    v[C-1] = (homogeneous ? batch::load(x[C-1] + k)
+						  : vec_type(1));
+
+			    vec_type	val[R];
+			    for (size_t i = 0; i < R; ++i)
+			    {
+				val[i] = a[i][0] * v[0];
+				for (size_t j = 1; j < C; ++j)
+				    val[i] = batch::fma(a[i][j], v[j], val[i]);
+			    }
+
+			    const auto	w = vec_type(1) / val[R-1];
+			    for (size_t i = 0; i < R - 1; ++i)
+				batch::store(y[i] + k, val[i] * w);
+			});
+}
+
+//! 点群の各点において射影変換の入力点の非同次座標に関するヤコビ行列を求める．
+/*!
+  出力点 \f$y_i = \TUtvec{p}{i}\TUud{x}{}/\TUtvec{p}{R-1}\TUud{x}{}\f$ の
+  入力点 \f$x_j\f$ に関する微分
+  \f$(p_{ij} - y_i p_{R-1,j})/\TUtvec{p}{R-1}\TUud{x}{}\f$ を
+  第 i*(C-1) + j 行に格納する．
+  \param P	R x C 射影変換行列
+  \param X	C-1 行の入力点群
+  \param J	(R-1)*(C-1) 行のヤコビ行列の点群
+*/
+template <class T, size_t R, size_t C> void
+jacobian(const Array2<T, R, C>& P, const PointBatch<T>& X, PointBatch<T>& J)
+{
+    static_assert(R > 1 && C > 1, "TU::jacobian(): fixed-size matrix required!!");
+
+    using batch		= detail::point_batch<T>;
+    using vec_type	= typename batch::vec_type;
+
+    if (X.nrow() + 1 != C)
+	throw std::invalid_argument("TU::jacobian(): mismatched dimension of points!!");
+    const auto	n = X.ncol();
+    J.resize((R - 1)*(C - 1), n);
+
+    vec_type	a[R][C];
+    for (size_t i = 0; i < R; ++i)
+	for (size_t j = 0; j < C; ++j)
+	    a[i][j] = vec_type(P[i][j]);
+
+    const T*	x[C-1];
+    T*		d[(R-1)*(C-1)];
+    for (size_t j = 0; j < C - 1; ++j)
+	x[j] = batch::row(X, j);
+    for (size_t i = 0; i < (R - 1)*(C - 1); ++i)
+	d[i] = batch::row(J, i);
+
+    batch::for_each(n, [&](size_t k)
+			{
+			    vec_type	v[C-1];
+			    for (size_t j = 0; j < C - 1; ++j)
+				v[j] = batch::load(x[j] + k);
+
+			    vec_type	val[R];
+			    for (size_t i = 0; i < R; ++i)
+			    {
+				val[i] = a[i][C-1];
+				for (size_t j = 0; j < C - 1; ++j)
+				    val[i] = batch::fma(a[i][j], v[j], val[i]);
+			    }
+
+			    const auto	w = vec_type(1) / val[R-1];
+			    for (size_t i = 0; i < R - 1; ++i)
+			    {
+				const auto	y = val[i] * w;
+				for (size_t j = 0; j < C - 1; ++j)
+				    batch::store(d[i*(C-1) + j] + k,
+						 (a[i][j] - y*a[R-1][j]) * w);
+			    }
+			});
+}
+
+}	// namespace TU
+#endif	// !TU_POINTBATCH_H
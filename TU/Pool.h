@@ -0,0 +1,96 @@
+/*!
+  \file		Pool.h
+  \author	Toshio UESHIBA
+  \brief	クラス TU::Pool の定義と実装
+*/
+#ifndef TU_POOL_H
+#define TU_POOL_H
+
+#include <memory>
+#include <vector>
+#if defined(USE_TBB)
+#  include <tbb/enumerable_thread_specific.h>
+#endif
+
+namespace TU
+{
+/************************************************************************
+*  class Pool<T>							*
+************************************************************************/
+//! 呼び出し間で再利用される作業領域のプール
+/*!
+  作業領域は取り出したスレッド毎に保持されるので，スレッド間で排他制御を
+  行わずに再利用できる．取り出した作業領域は Handle が破棄されるまで
+  他の呼び出しに渡されない．プールを複製しても作業領域は複製されない．
+  \param T	作業領域の型
+*/
+template <class T>
+class Pool
+{
+  public:
+  //! プールから取り出された作業領域．破棄されるとプールに返却される．
+    class Handle
+    {
+      public:
+		Handle(Pool& pool)	:_pool(pool), _value(pool.get()){}
+		Handle(const Handle&)				= delete;
+	Handle&	operator =(const Handle&)			= delete;
+		~Handle()			{ _pool.put(_value); }
+
+	T&	operator *()		const	{ return *_value; }
+	T*	operator ->()		const	{ return _value.get(); }
+	T*	get()			const	{ return _value.get(); }
+
+      private:
+	Pool&			_pool;
+	std::unique_ptr<T>	_value;
+    };
+
+  public:
+		Pool()					:_values()	{}
+		Pool(const Pool&)			:_values()	{}
+    Pool&	operator =(const Pool&)			{ return *this; }
+
+  //! 作業領域を取り出す．
+  /*!
+    \return	取り出した作業領域．破棄されると作業領域はプールに戻る．
+  */
+    Handle	acquire()			{ return Handle(*this); }
+
+  private:
+    using values_type	= std::vector<std::unique_ptr<T> >;
+
+    std::unique_ptr<T>
+		get()
+		{
+		    auto&	values = local();
+		    if (values.empty())
+			return std::unique_ptr<T>(new T);
+		    auto	value = std::move(values.back());
+		    values.pop_back();
+		    return value;
+		}
+    void	put(std::unique_ptr<T>& value)
+		{
+		    local().push_back(std::move(value));
+		}
+    values_type&
+		local()
+		{
+#if defined(USE_TBB)
+		    return _values.local();
+#else
+		    return _values;
+#endif
+		}
+
+  private:
+#if defined(USE_TBB)
+    tbb::enumerable_thread_specific<values_type>	_values;
+#else
+    values_type						_values;
+#endif
+};
+
+}	// namespace TU
+#endif	// !TU_POOL_H
@@ -0,0 +1,393 @@
+/*!
+  \file		PyramidStereo.h
+  \author	Toshio UESHIBA
+  \brief	クラス TU::PyramidStereo の定義と実装
+*/
+#ifndef TU_PYRAMIDSTEREO_H
+#define TU_PYRAMIDSTEREO_H
+
+#include <memory>
+#include <vector>
+#include <algorithm>
+#include <cmath>
+#include "TU/Image++.h"
+#include "TU/BoxFilter.h"
+#include "TU/StereoBase.h"
+#if defined(USE_TBB)
+#  include <tbb/parallel_for.h>
+#  include <tbb/blocked_range2d.h>
+#  include <tbb/enumerable_thread_specific.h>
+#endif
+
+namespace TU
+{
+/************************************************************************
+*  class PyramidStereo<STEREO, T, DISP>					*
+************************************************************************/
+//! 画像ピラミッドによって視差の探索範囲を段階的に絞り込むステレオマッチングクラス
+/*!
+  平行化された左右画像を縦横1/2ずつ nlevels() 回縮小し，最も粗い段でのみ
+  全探索範囲のマッチングを行う．それより細かい段では画像を grainSize 行
+  tileWidth() 列ずつのタイルに分け，各タイルを覆う1段粗い視差画像の視差の
+  範囲を2倍して margin() だけ広げた範囲のみを探索する．SADStereo, GFStereo
+  は視差方向にSIMD化された評価値を画素の移動に伴って逐次更新するので，
+  探索範囲は画素毎ではなくタイル毎に共通とする．右画像から見た逆方向探索も
+  タイル内で閉じて行われるので，タイルの境界付近では全探索の結果と若干
+  異なることがある．2眼ステレオのみを扱う．
+  \param STEREO	ステレオマッチングクラス(SADStereo, GFStereo)
+  \param T	入力画像の画素の型
+  \param DISP	視差画像の画素の型
+*/
+template <class STEREO, class T, class DISP=float>
+class PyramidStereo
+{
+  public:
+    using stereo_type	 = STEREO;
+    using Parameters	 = typename stereo_type::Parameters;
+    using image_type	 = Image<T>;
+    using disparity_type = Image<DISP>;
+
+  private:
+  //! タイル毎の探索範囲．右画像の列のずれが offset から offset + width - 1
+    struct Band
+    {
+	size_t	offset;
+	size_t	width;
+    };
+
+  //! スレッド毎の作業領域
+    struct Worker
+    {
+	std::unique_ptr<stereo_type>	stereo;
+	image_type			tileL;		// 左画像のタイル
+	image_type			tileR;		// 右画像のタイル
+	disparity_type			tileD;		// 視差画像のタイル
+    };
+
+  public:
+  //! ステレオマッチングオブジェクトを生成する．
+  /*!
+    \param params	最も細かい段(入力画像)におけるパラメータ
+    \param nlevels	画像を縮小する回数
+    \param margin	1段粗い視差の範囲を広げる量
+    \param tileWidth	探索範囲を共通とするタイルの幅
+  */
+		PyramidStereo(const Parameters& params, size_t nlevels=2,
+			      size_t margin=2, size_t tileWidth=128)
+		    :_stereo(params), _nlevels(nlevels), _margin(margin),
+		     _tileWidth(std::max(tileWidth, size_t(1))),
+		     _imagesL(nlevels + 1), _imagesR(nlevels + 1),
+		     _disparityMaps(nlevels + 1)
+		{
+		    setParameters(params);
+		}
+
+    const Parameters&
+		getParameters()			const	{ return _params; }
+    void	setParameters(const Parameters& params)			;
+
+  //! 画像を縮小する回数を返す．
+    size_t	nlevels()			const	{ return _nlevels; }
+
+  //! 1段粗い視差の範囲を広げる量を返す．
+    size_t	margin()			const	{ return _margin; }
+
+  //! 探索範囲を共通とするタイルの幅を返す．
+    size_t	tileWidth()			const	{ return _tileWidth; }
+
+    void	operator ()(const image_type& imageL,
+			    const image_type& imageR,
+			    disparity_type& disparityMap)		;
+
+  private:
+    size_t	levelWidth(size_t l) const
+		{
+		    const size_t	n = size_t(1) << l;
+		    return ceilWidth((_params.disparitySearchWidth + n - 1)/n);
+		}
+  // 第 l 段の最大視差．右画像の平行化に合わせるため2の冪で割った実数とする．
+    float	levelMax(size_t l) const
+		{
+		    return float(_params.disparityMax)/float(size_t(1) << l);
+		}
+  // 視差の探索幅は視差と画素の双方のSIMDベクトルの要素数の倍数とする．
+    static size_t
+		ceilWidth(size_t n)
+		{
+#if defined(SIMD)
+		    return simd::vec<T>::ceil(
+			simd::vec<typename stereo_type::Disparity>::ceil(n));
+#else
+		    return n;
+#endif
+		}
+    Worker&	worker()
+		{
+#if defined(USE_TBB)
+		    return _workers.local();
+#else
+		    return _worker;
+#endif
+		}
+    void	setBands(size_t l, size_t height, size_t width)		;
+    void	matchLevel(size_t l, const image_type& imageL,
+			   const image_type& imageR,
+			   disparity_type& disparityMap)		;
+    void	matchTile(size_t l, size_t i, size_t j,
+			  const image_type& imageL,
+			  const image_type& imageR,
+			  disparity_type& disparityMap)			;
+    void	halve(const image_type& in, image_type& out)		;
+
+  private:
+    Parameters				_params;
+    stereo_type				_stereo;	// 重なり幅を求めるため
+    const size_t			_nlevels;
+    const size_t			_margin;
+    const size_t			_tileWidth;
+    std::vector<image_type>		_imagesL;	// 段毎の左画像
+    std::vector<image_type>		_imagesR;	// 段毎の右画像
+    std::vector<disparity_type>		_disparityMaps;	// 段毎の視差画像
+    Image<float>			_sums;		// 縮小用の作業領域
+    Array2<Band>			_bands;		// タイル毎の探索範囲
+#if defined(USE_TBB)
+    tbb::enumerable_thread_specific<Worker>	_workers;
+#else
+    Worker				_worker;
+#endif
+};
+
+template <class STEREO, class T, class DISP> void
+PyramidStereo<STEREO, T, DISP>::setParameters(const Parameters& params)
+{
+  // 最大視差は右画像の平行化に合わせた値なので探索幅に合わせて変えない．
+    _params = params;
+    _params.disparitySearchWidth = ceilWidth(_params.disparitySearchWidth);
+    if (_params.grainSize == 0)
+	_params.grainSize = 1;
+    _stereo.setParameters(_params);
+}
+
+//! 平行化された左右画像から視差画像を求める．
+/*!
+  \param imageL		平行化された左画像
+  \param imageR		平行化された右画像．getParameters() の探索幅と
+			最大視差に合わせて平行化されたもの
+  \param disparityMap	左画像と同じ大きさの視差画像が返される
+*/
+template <class STEREO, class T, class DISP> void
+PyramidStereo<STEREO, T, DISP>::operator ()(const image_type& imageL,
+					    const image_type& imageR,
+					    disparity_type& disparityMap)
+{
+  // 画像ピラミッドを生成する．
+    for (size_t l = 1; l <= _nlevels; ++l)
+    {
+	halve(l == 1 ? imageL : _imagesL[l-1], _imagesL[l]);
+	halve(l == 1 ? imageR : _imagesR[l-1], _imagesR[l]);
+    }
+
+  // 粗い段から順にマッチングを行う．
+    for (size_t l = _nlevels + 1; l-- != 0; )
+    {
+	const auto&	L = (l == 0 ? imageL : _imagesL[l]);
+	const auto&	R = (l == 0 ? imageR : _imagesR[l]);
+	auto&		D = (l == 0 ? disparityMap : _disparityMaps[l]);
+
+	D.resize(L.height(), L.width());
+	D = 0;
+	setBands(l, L.height(), L.width());
+	matchLevel(l, L, R, D);
+    }
+}
+
+//! 第 l 段の各タイルの探索範囲を1段粗い視差画像から求める．
+template <class STEREO, class T, class DISP> void
+PyramidStereo<STEREO, T, DISP>::setBands(size_t l, size_t height, size_t width)
+{
+    const auto	h	= _params.grainSize;
+    const auto	w	= _tileWidth;
+    const auto	overlap	= _stereo.getOverlap();
+    const auto	dsw	= levelWidth(l);
+
+    _bands.resize((height + h - 1)/h, (width + w - 1)/w);
+
+    if (l == _nlevels)		// 最も粗い段では全範囲を探索する．
+    {
+	for (auto&& row : _bands)
+	    for (auto& band : row)
+		band = {0, dsw};
+	return;
+    }
+
+    const auto&	coarse = _disparityMaps[l + 1];
+    const auto	dmax   = levelMax(l);
+
+    for (size_t i = 0; i < _bands.nrow(); ++i)
+    {
+	const auto	vb = (i*h)/2;
+	const auto	ve = std::min((i*h + h + overlap + 1)/2 + 1,
+				      coarse.height());
+
+	for (size_t j = 0; j < _bands.ncol(); ++j)
+	{
+	    const auto	ub = (j*w)/2;
+	    const auto	ue = std::min((j*w + w + overlap + 1)/2 + 1,
+				      coarse.width());
+
+	    auto	offMin = std::numeric_limits<float>::max();
+	    auto	offMax = -offMin;
+	    for (auto v = vb; v < ve; ++v)
+	    {
+		const auto&	row = coarse[v];
+		for (auto u = ub; u < ue; ++u)
+		    if (row[u] > 0)
+		    {
+		      // 粗い視差を2倍してこの段の最大視差からのずれに直す．
+			const auto	off = dmax - 2*float(row[u]);
+			offMin = std::min(offMin, off);
+			offMax = std::max(offMax, off);
+		    }
+	    }
+
+	    auto&	band = _bands[i][j];
+	    if (offMin > offMax)	// 有効な視差がなければ全範囲を探索
+	    {
+		band = {0, dsw};
+		continue;
+	    }
+
+	    const auto	lo = std::floor(offMin) - float(_margin);
+	    const auto	hi = std::ceil(offMax)  + float(_margin + 1);
+	    const auto	last  = std::min(size_t(std::max(hi, 0.0f)), dsw - 1);
+	    const auto	first = std::min(size_t(std::max(lo, 0.0f)), last);
+	    band.width  = ceilWidth(last + 1 - first);
+	    band.offset = std::min(first, dsw - band.width);
+	}
+    }
+}
+
+//! 第 l 段においてタイル毎に探索範囲を絞ってマッチングを行う．
+template <class STEREO, class T, class DISP> void
+PyramidStereo<STEREO, T, DISP>::matchLevel(size_t l,
+					   const image_type& imageL,
+					   const image_type& imageR,
+					   disparity_type& disparityMap)
+{
+#if defined(USE_TBB)
+    tbb::parallel_for(tbb::blocked_range2d<size_t>(0, _bands.nrow(), 1,
+						   0, _bands.ncol(), 1),
+		      [&](const tbb::blocked_range2d<size_t>& r)
+		      {
+			  for (auto i = r.rows().begin();
+			       i != r.rows().end(); ++i)
+			      for (auto j = r.cols().begin();
+				   j != r.cols().end(); ++j)
+				  matchTile(l, i, j,
+					    imageL, imageR, disparityMap);
+		      });
+#else
+    for (size_t i = 0; i < _bands.nrow(); ++i)
+	for (size_t j = 0; j < _bands.ncol(); ++j)
+	    matchTile(l, i, j, imageL, imageR, disparityMap);
+#endif
+}
+
+//! 第 l 段の第 i 行第 j 列のタイルについてマッチングを行う．
+/*!
+  タイルの左右画像は，ウィンドウの大きさに応じた重なりを含めて作業領域に
+  切り出される．右画像は探索範囲の下限だけ左にずらして切り出されるので，
+  タイルで求まる視差に段の最大視差からタイルの最大視差と下限を引いた値を
+  加えると段全体の視差となる．この値が0以下となる画素は無効とする．
+*/
+template <class STEREO, class T, class DISP> void
+PyramidStereo<STEREO, T, DISP>::matchTile(size_t l, size_t i, size_t j,
+					  const image_type& imageL,
+					  const image_type& imageR,
+					  disparity_type& disparityMap)
+{
+    auto&	w = worker();
+    if (!w.stereo)
+	w.stereo.reset(new stereo_type(_params));
+
+    const auto&	band = _bands[i][j];
+    auto	params = _params;
+    params.disparitySearchWidth = band.width;
+    params.disparityMax		= band.width;
+    w.stereo->setParameters(params);
+    const auto	shift = levelMax(l) - float(band.offset)
+		      - float(w.stereo->getParameters().disparityMax);
+
+    const auto	overlap = w.stereo->getOverlap();
+    const auto	vb = i*_params.grainSize;
+    const auto	ve = std::min(vb + _params.grainSize + overlap,
+			      imageL.height());
+    const auto	ub = j*_tileWidth;
+    const auto	ue = std::min(ub + _tileWidth + overlap, imageL.width());
+    const auto	WL = ue - ub;
+    const auto	WR = WL + band.width - 1;
+    const auto	uR = ub + band.offset;
+
+  // 左右画像のタイルを切り出す．右画像の範囲外は右端の画素で埋める．
+    w.tileL.resize(ve - vb, WL);
+    w.tileR.resize(ve - vb, WR);
+    for (auto v = vb; v < ve; ++v)
+    {
+	const auto&	rowL  = imageL[v];
+	const auto&	rowR  = imageR[v];
+	auto&&		tileL = w.tileL[v - vb];
+	auto&&		tileR = w.tileR[v - vb];
+	std::copy_n(rowL.begin() + ub, WL, tileL.begin());
+	for (size_t u = 0; u < WR; ++u)
+	    tileR[u] = rowR[std::min(uR + u, imageR.width() - 1)];
+    }
+
+    w.tileD.resize(ve - vb, WL);
+    w.tileD = 0;
+    w.stereo->match(w.tileL.cbegin(), w.tileL.cend(),
+		    w.tileR.cbegin(), w.tileD.begin());
+
+  // 重なりを除いたタイルの内部の視差を書き出す．
+    const auto	o  = overlap/2;
+    const auto	round = (std::is_integral<DISP>::value ? 0.5f : 0.0f);
+    const auto	ve_ = std::min(vb + o + _params.grainSize, ve);
+    const auto	ue_ = std::min(ub + o + _tileWidth, ue);
+    if (ue_ <= ub + o)
+	return;
+    for (auto v = vb + o; v < ve_; ++v)
+    {
+	const auto&	tileD = w.tileD[v - vb];
+	std::transform(tileD.begin() + o, tileD.begin() + (ue_ - ub),
+		       disparityMap[v].begin() + ub + o,
+		       [shift, round](const auto& d)
+		       {
+			   const auto	dd = float(d) + shift;
+			   return (d > 0 && dd > 0 ? DISP(dd + round) : DISP(0));
+		       });
+    }
+}
+
+//! 2x2画素の平均をとって画像を縦横1/2に縮小する．
+template <class STEREO, class T, class DISP> void
+PyramidStereo<STEREO, T, DISP>::halve(const image_type& in, image_type& out)
+{
+    out.resize(in.height()/2, in.width()/2);
+    if (out.height() == 0 || out.width() == 0)
+	return;
+
+    _sums.resize(in.height() - 1, in.width() - 1);
+    BoxFilter2<float>(2, 2).convolve(in.cbegin(), in.cend(), _sums.begin());
+
+  // 整数型の画素は切り捨てずに四捨五入する．
+    const auto	round = (std::is_integral<T>::value ? 0.5f : 0.0f);
+    for (size_t v = 0; v < out.height(); ++v)
+    {
+	const auto&	sum = _sums[2*v];
+	auto&&		row = out[v];
+	for (size_t u = 0; u < out.width(); ++u)
+	    row[u] = T(0.25f*sum[2*u] + round);
+    }
+}
+
+}
+#endif	// !TU_PYRAMIDSTEREO_H
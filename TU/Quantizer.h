@@ -7,82 +7,374 @@
 #define TU_QUANTIZER_H
 
 #include <vector>
+#include <algorithm>
 #include "TU/Vector++.h"
 
 namespace TU
 {
+namespace detail
+{
 /************************************************************************
-*  class QuantizerBase<T>						*
+*  class ColorHistogram<T>						*
 ************************************************************************/
+//! RGB空間の3次元ヒストグラムに基づいて色を量子化するクラス
+/*!
+  各色成分を上位 Bits ビットで量子化した 2^Bits x 2^Bits x 2^Bits 個の
+  cellに画素を投票し，その累積モーメントを用いたWuの分割法によって
+  RGB空間を直方体のboxに分割する．分割のコストは画素数によらず
+  cell数のみに比例し，各画素の量子化はcellからboxへの表引きで済む．
+  \param T	r, g, b の各成分を持つ色の型
+*/
 template <class T>
-class QuantizerBase
+class ColorHistogram
 {
   public:
-    using value_type	= T;
+    constexpr static size_t	Bits  = 5;			//!< 各成分のビット数
+    constexpr static size_t	Dim   = (1 << Bits) + 1;	//!< 各軸のcell数+1
+    constexpr static size_t	Shift = 8 - Bits;
 
   private:
-    template <class PITER>
-    class BinProps
+  // (lo, hi] で与えられるcell範囲内の画素数，各成分の和，自乗和
+    struct Moments
     {
-      public:
-	using element_type	= float;
-	using vector_type	= Vector<element_type, 3>;
-	
-      public:
-	BinProps(PITER begin, PITER end)				;
-	BinProps(PITER begin, PITER end, const u_char T::* c, size_t n,
-		 const vector_type& sum, const vector_type& sqsum)
-	    :_begin(begin), _end(end), _c(c), _n(n),
-	     _sum(sum), _var((n*sqsum - square(sum)) / (n*n))		{}
-
-	PITER		begin()			const	{ return _begin; }
-	PITER		end()			const	{ return _end; }
-	value_type	mean() const
+	Moments&	operator +=(const Moments& m)
 			{
-			    return value_type(u_char(_sum[0]/_n),
-					      u_char(_sum[1]/_n),
-					      u_char(_sum[2]/_n));
+			    n += m.n; r += m.r; g += m.g; b += m.b;
+			    sq += m.sq;
+			    return *this;
 			}
-	element_type	maxVariance() const
+	Moments&	operator -=(const Moments& m)
 			{
-			    return std::max({_var[0], _var[1], _var[2]});
+			    n -= m.n; r -= m.r; g -= m.g; b -= m.b;
+			    sq -= m.sq;
+			    return *this;
+			}
+	Moments		operator +(const Moments& m) const
+			{
+			    auto	tmp = *this;
+			    return tmp += m;
+			}
+	Moments		operator -(const Moments& m) const
+			{
+			    auto	tmp = *this;
+			    return tmp -= m;
+			}
+	double		energy() const
+			{
+			    return (double(r)*r + double(g)*g + double(b)*b)/n;
 			}
-	BinProps	split()				;
-	
-      private:
-	static element_type	square(element_type x)	{ return x*x; }
-	static vector_type	square(const vector_type& x)
-				{
-				    return {x[0]*x[0], x[1]*x[1], x[2]*x[2]};
-				}
 	
-      private:
-	PITER			_begin;
-	PITER			_end;
-	const u_char T::*	_c;
-	size_t			_n;
-	vector_type		_sum;
-	vector_type		_var;
+	ptrdiff_t	n  = 0;
+	ptrdiff_t	r  = 0;
+	ptrdiff_t	g  = 0;
+	ptrdiff_t	b  = 0;
+	ptrdiff_t	sq = 0;
+    };
+
+  // 各軸について (lo, hi] の範囲のcellから成る直方体
+    struct Box
+    {
+	size_t	lo[3];
+	size_t	hi[3];
     };
+
+  public:
+    void	clear()
+		{
+		    if (_moments.size() == 0)	// 初めて使うときに領域を確保
+		    {
+			_moments.resize(Dim*Dim*Dim);
+			_lut.resize(Dim*Dim*Dim);
+		    }
+		    for (auto& m : _moments)
+			m = Moments();
+		}
+    void	add(const T& x)
+		{
+		    auto&	m = _moments[cell(x)];
+		    ++m.n;
+		    m.r  += x.r;
+		    m.g  += x.g;
+		    m.b  += x.b;
+		    m.sq += int(x.r)*x.r + int(x.g)*x.g + int(x.b)*x.b;
+		}
+    void	accumulate()						;
+    size_t	cut(size_t nboxes)					;
+    double	distortion()					const	;
+    size_t	nboxes()		const	{ return _boxes.size(); }
+    bool	mean(size_t i, T& x)				const	;
+    size_t	operator ()(const T& x)	const	{ return _lut[cell(x)]; }
+    
+  private:
+    static size_t	cell(const T& x)
+			{
+			    return index((x.r >> Shift) + 1,
+					 (x.g >> Shift) + 1, (x.b >> Shift) + 1);
+			}
+    static size_t	index(size_t r, size_t g, size_t b)
+			{
+			    return (r*Dim + g)*Dim + b;
+			}
+    Moments		volume(const Box& box)			const	;
+    double		variance(const Box& box) const
+			{
+			    const auto	m = volume(box);
+			    return (m.n ? m.sq - m.energy() : 0);
+			}
+    double		maximize(const Box& box, size_t dir,
+				 const Moments& whole, size_t& pos) const;
+    bool		split(Box& box1, Box& box2)		const	;
+    
+  private:
+    Array<Moments>	_moments;	// cellの累積モーメント
+    Array<u_short>	_lut;		// cellからboxの番号への表
+    std::vector<Box>	_boxes;
+};
+
+//! 各cellのモーメントを原点からの累積値に置き換える．
+template <class T> void
+ColorHistogram<T>::accumulate()
+{
+    for (size_t r = 1; r < Dim; ++r)
+    {
+	Moments	area[Dim];
+
+	for (size_t g = 1; g < Dim; ++g)
+	{
+	    Moments	line;
+
+	    for (size_t b = 1; b < Dim; ++b)
+	    {
+		auto&	m = _moments[index(r, g, b)];
+		line	+= m;
+		area[b] += line;
+		m	 = _moments[index(r - 1, g, b)];
+		m	+= area[b];
+	    }
+	}
+    }
+}
+
+//! RGB空間を高々 nboxes 個のboxに分割し，各cellにboxの番号を付ける．
+/*!
+  accumulate() の後に呼ぶこと．
+  \param nboxes	boxの最大数
+  \return	実際に得られたboxの数
+*/
+template <class T> size_t
+ColorHistogram<T>::cut(size_t nboxes)
+{
+    nboxes = std::max(std::min(nboxes, size_t(1) << (3*Bits)), size_t(1));
+    
+    _boxes.resize(1);
+    _boxes[0] = {{0, 0, 0}, {Dim - 1, Dim - 1, Dim - 1}};
+    std::vector<double>	vars(1, variance(_boxes[0]));
     
+  // 分散最大のboxを分散の和が最も減少するように二分割することを繰り返す．
+    for (size_t next = 0; _boxes.size() < nboxes; )
+    {
+	Box	box;
+	if (split(_boxes[next], box))
+	{
+	    vars[next] = variance(_boxes[next]);
+	    _boxes.push_back(box);
+	    vars.push_back(variance(box));
+	}
+	else
+	    vars[next] = 0;		// 分割不能
+
+	next = std::max_element(vars.begin(), vars.end()) - vars.begin();
+	if (vars[next] <= 0)
+	    break;
+    }
+
+  // 各cellに属するboxの番号を付ける．
+    for (size_t i = 0; i < _boxes.size(); ++i)
+    {
+	const auto&	box = _boxes[i];
+	for (size_t r = box.lo[0] + 1; r <= box.hi[0]; ++r)
+	    for (size_t g = box.lo[1] + 1; g <= box.hi[1]; ++g)
+		for (size_t b = box.lo[2] + 1; b <= box.hi[2]; ++b)
+		    _lut[index(r, g, b)] = i;
+    }
+
+    return _boxes.size();
+}
+
+//! 現在のboxに対する量子化誤差の自乗の画素あたりの平均値を返す．
+template <class T> double
+ColorHistogram<T>::distortion() const
+{
+    const auto&	all = _moments[index(Dim - 1, Dim - 1, Dim - 1)];
+    if (all.n == 0)
+	return 0;
+    
+    double	d = 0;
+    for (const auto& box : _boxes)
+	d += variance(box);
+
+    return d / all.n;
+}
+
+//! 第 i 番目のboxに属する画素の平均色を求める．
+/*!
+  \param i	boxの番号
+  \param x	平均色が返される．boxが空ならば変更されない
+  \return	boxが空でなければtrue, 空ならばfalse
+*/
+template <class T> bool
+ColorHistogram<T>::mean(size_t i, T& x) const
+{
+    const auto	m = volume(_boxes[i]);
+    if (m.n == 0)
+	return false;
+
+    x.r = (m.r + m.n/2) / m.n;
+    x.g = (m.g + m.n/2) / m.n;
+    x.b = (m.b + m.n/2) / m.n;
+
+    return true;
+}
+
+template <class T> typename ColorHistogram<T>::Moments
+ColorHistogram<T>::volume(const Box& box) const
+{
+    const auto&	lo = box.lo;
+    const auto&	hi = box.hi;
+    
+    return _moments[index(hi[0], hi[1], hi[2])]
+	 - _moments[index(hi[0], hi[1], lo[2])]
+	 - _moments[index(hi[0], lo[1], hi[2])]
+	 + _moments[index(hi[0], lo[1], lo[2])]
+	 - _moments[index(lo[0], hi[1], hi[2])]
+	 + _moments[index(lo[0], hi[1], lo[2])]
+	 + _moments[index(lo[0], lo[1], hi[2])]
+	 - _moments[index(lo[0], lo[1], lo[2])];
+}
+
+//! boxを第 dir 軸に垂直な平面で二分割したときの分割の良さの最大値を求める．
+/*!
+  \param box	boxの範囲
+  \param dir	分割する軸
+  \param whole	boxのモーメント
+  \param pos	最適な分割位置が返される．分割不能ならば変更されない
+  \return	分割の良さ(両側の energy() の和)の最大値．分割不能ならば0
+*/
+template <class T> double
+ColorHistogram<T>::maximize(const Box& box, size_t dir,
+			    const Moments& whole, size_t& pos) const
+{
+    double	max = 0;
+    auto	lower = box;
+    for (lower.hi[dir] = box.lo[dir] + 1; lower.hi[dir] < box.hi[dir];
+	 ++lower.hi[dir])
+    {
+	const auto	half = volume(lower);
+	if (half.n == 0 || half.n == whole.n)
+	    continue;
+
+	const auto	val = half.energy() + (whole - half).energy();
+	if (val > max)
+	{
+	    max = val;
+	    pos = lower.hi[dir];
+	}
+    }
+
+    return max;
+}
+
+//! box1 を二分割し，上側を box2 に移す．
+template <class T> bool
+ColorHistogram<T>::split(Box& box1, Box& box2) const
+{
+    const auto	whole = volume(box1);
+    size_t	dir = 3, pos = 0;
+    double	max = 0;
+    for (size_t d = 0; d < 3; ++d)
+    {
+	size_t		p;
+	const auto	val = maximize(box1, d, whole, p);
+	if (val > max)
+	{
+	    max = val;
+	    dir = d;
+	    pos = p;
+	}
+    }
+
+    if (dir == 3)
+	return false;
+
+    box2 = box1;
+    box1.hi[dir] = pos;
+    box2.lo[dir] = pos;
+    
+    return true;
+}
+
+}	// namespace detail
+
+/************************************************************************
+*  class QuantizerBase<T>						*
+************************************************************************/
+template <class T>
+class QuantizerBase
+{
+  public:
+    using value_type	= T;
+
   public:
+		QuantizerBase()
+		    :_persistent(false), _tolerance(0.2),
+		     _distortion(0), _nbinsRequested(0)			{}
+    
     const T&	operator [](size_t i)	const	{ return _bins[i]; }
     size_t	size()			const	{ return _bins.size(); }
 
+  //! 連続するフレームに対してパレットを使い回すか否かを返す．
+    bool	persistent()		const	{ return _persistent; }
+  //! 連続するフレームに対してパレットを使い回すか否かを指定する．
+  /*!
+    使い回す場合，量子化誤差がパレットを作成したときの (1 + tolerance())
+    倍以内に収まる限りboxの分割を保ったまま各binの代表色のみを更新する．
+    色の量子化にのみ有効である．
+  */
+    void	setPersistent(bool on)		{ _persistent = on; }
+    float	tolerance()		const	{ return _tolerance; }
+    void	setTolerance(float tol)		{ _tolerance = tol; }
+  //! 次回の量子化においてパレットを作り直させる．
+    void	refreshPalette()		{ _nbinsRequested = 0; }
+    
   protected:
     template <class PAIR>
-    void	quantize(std::vector<PAIR>& in_out, size_t nbins,
-			 std::true_type)				;
-    template <class PAIR>
-    void	quantize(std::vector<PAIR>& in_out, size_t nbins,
-			 std::false_type)				;
+    void	quantize(std::vector<PAIR>& in_out, size_t nbins)	;
+    void	clearHistogram()		{ _histogram.clear(); }
+    template <class ITER>
+    void	addToHistogram(ITER ib, ITER ie)
+		{
+		    for (; ib != ie; ++ib)
+			_histogram.add(*ib);
+		}
+    void	buildPalette(size_t nbins)				;
+    template <class ITER, class IDX>
+    void	index(ITER ib, ITER ie, IDX idx) const
+		{
+		    for (; ib != ie; ++ib, ++idx)
+			*idx = _histogram(*ib);
+		}
 	    
   private:
-    std::vector<T>	_bins;
+    std::vector<T>		_bins;
+    detail::ColorHistogram<T>	_histogram;	// 色の量子化にのみ使用
+    bool			_persistent;
+    float			_tolerance;
+    double			_distortion;	// パレット作成時の量子化誤差
+    size_t			_nbinsRequested;
 };
 
 template <class T> template <class PAIR> void
-QuantizerBase<T>::quantize(std::vector<PAIR>& io, size_t nbins, std::true_type)
+QuantizerBase<T>::quantize(std::vector<PAIR>& io, size_t nbins)
 {
     std::sort(io.begin(), io.end(),
 	      [](const PAIR& x, const PAIR& y){return *x.first < *y.first;});
@@ -131,132 +423,30 @@ QuantizerBase<T>::quantize(std::vector<PAIR>& io, size_t nbins, std::true_type)
 	*binBase->second = idx;
 }
 
-template <class T> template <class PAIR> void
-QuantizerBase<T>::quantize(std::vector<PAIR>& io, size_t nbins, std::false_type)
+//! 3次元ヒストグラムからパレットを作成または更新する．
+template <class T> void
+QuantizerBase<T>::buildPalette(size_t nbins)
 {
-    using piterator	= typename std::vector<PAIR>::iterator;
-    using props_type	= BinProps<piterator>;
+    _histogram.accumulate();
 
-    const auto	comp = [](const props_type& x, const props_type& y)
-			{ return x.maxVariance() < y.maxVariance(); };
-	
-    std::vector<props_type>	props;
-    props.push_back(props_type(io.begin(), io.end()));
-    std::make_heap(props.begin(), props.end(), comp);
-
-    for (size_t n = 1; n < nbins; ++n)
+    if (_persistent && nbins == _nbinsRequested &&
+	_histogram.distortion() <= (1 + _tolerance)*_distortion)
     {
-	std::pop_heap(props.begin(), props.end(), comp);
-	auto	prop1 = props.back();
-	props.pop_back();
-
-	auto	prop2 = prop1.split();
-
-	props.push_back(prop1);
-	std::push_heap(props.begin(), props.end(), comp);
-	props.push_back(prop2);
-	std::push_heap(props.begin(), props.end(), comp);
+      // boxの分割を保ったまま各binの代表色を現在の平均色に更新
+	for (size_t i = 0; i < _bins.size(); ++i)
+	    _histogram.mean(i, _bins[i]);
+	return;
     }
 
-  // 入力データの各元をbinの代表元にマップ
-    for (size_t idx = 0; idx < props.size(); ++idx)
-    {
-	_bins.push_back(props[idx].mean());
-	for (auto& x: props[idx])
-	    *x.second = idx;
-    }
+  // RGB空間を分割し直して新たなパレットを作成
+    _bins.resize(_histogram.cut(nbins));
+    for (size_t i = 0; i < _bins.size(); ++i)
+	if (!_histogram.mean(i, _bins[i]))
+	    _bins[i] = T();
+    _distortion	    = _histogram.distortion();
+    _nbinsRequested = nbins;
 }
 
-/*
- *  QuantizerBase<T>::BinProps<PITER>
- */
-template <class T> template <class PITER>
-QuantizerBase<T>::BinProps<PITER>::BinProps(PITER begin, PITER end)
-    :_begin(begin), _end(end), _c(nullptr), _n(0)
-{
-    for (auto iter = _begin; iter != _end; ++iter)
-    {
-	vector_type	x;
-	x[0] = iter->first->r;
-	x[1] = iter->first->g;
-	x[2] = iter->first->b;
-	
-	++_n;
-	_sum += x;
-	_var += square(x);
-    }
-
-    if (_n)
-	_var = (_n*_var - square(_sum)) / (_n*_n);
-}
-    
-template <class T>
-template <class PITER> typename QuantizerBase<T>::template BinProps<PITER>
-QuantizerBase<T>::BinProps<PITER>::split()
-{
-    using pair_type	= iterator_value<PITER>;
-
-  // 要素への反復子の配列を作り，昇順にソート
-    const u_char T::*	c = (_var[0] > _var[1] ?
-			     _var[0] > _var[2] ? &T::r : &T::b :
-			     _var[1] > _var[2] ? &T::g : &T::b);
-    if (c != _c)
-	std::sort(_begin, _end,
-		  [=](const pair_type& x, const pair_type& y)
-		  { return x.first->*c < y.first->*c; });
-    
-  // 大津の判別基準により最適なしきい値を決定．
-    const size_t	i = (_var[0] > _var[1] ?
-			     _var[0] > _var[2] ? 0 : 2 :
-			     _var[1] > _var[2] ? 1 : 2);
-    auto		border = _begin;
-    auto		head   = _begin;
-    const auto		mean = _sum[i]/_n;
-    size_t		n = 0;			// しきい値以下の要素数
-    vector_type		sum;			// しきい値以下の累積値
-    vector_type		sqsum;			// しきい値以下の自乗累積値
-    size_t		n1 = 0;
-    vector_type		sum1;
-    vector_type		sqsum1;
-    element_type	interVarianceMax = 0;	// クラス間分散の最大値
-    for (auto iter = _begin; iter != _end; ++iter)
-    {
-	vector_type	x;
-	x[0] = iter->first->r;
-	x[1] = iter->first->g;
-	x[2] = iter->first->b;
-	
-	if (iter->first->*c != head->first->*c)
-	{
-	    const auto	interVariance = square(sum[i] - n*mean) / (n*(_n - n));
-	    if (interVariance > interVarianceMax)
-	    {
-		interVarianceMax = interVariance;
-		border		 = iter;
-		n1		 = n;
-		sum1		 = sum;
-		sqsum1		 = sqsum;
-	    }
-	    head = iter;
-	}
-	
-	++n;
-	sum   += x;
-	sqsum += square(x);
-    }
-
-    const BinProps	props(border, _end,
-			      c, n - n1, sum - sum1, sqsum - sqsum1);
-    
-    _end = border;
-    _c	 = c;
-    _n	 = n1;
-    _sum = sum1;
-    _var = (n1*sqsum1 - square(sum1)) / (n1*n1);
-    
-    return props;
-}
-    
 /*
  *  QuantizerBase<u_char> : specialized
  */
@@ -266,6 +456,9 @@ class QuantizerBase<u_char>
   public:
     size_t	operator [](size_t i)	const	{ return i; }
     size_t	size()			const	{ return 256; }
+    bool	persistent()		const	{ return false; }
+    void	setPersistent(bool)		{}
+    void	refreshPalette()		{}
 };
     
 /************************************************************************
@@ -294,6 +487,12 @@ class Quantizer : public QuantizerBase<T>
 	{
 	    return out << quantizer._indices;
 	}
+
+  private:
+    template <class ITER>
+    void	quantize(ITER ib, ITER ie, size_t nbins, std::true_type);
+    template <class ITER>
+    void	quantize(ITER ib, ITER ie, size_t nbins, std::false_type);
     
   private:
     Array<size_t>	_indices;
@@ -303,18 +502,32 @@ template <class T> template <class ITER>
 std::enable_if_t<!std::is_same<iterator_value<ITER>, u_char>::value,
 		 const Array<size_t>&>
 Quantizer<T>::operator ()(ITER ib, ITER ie, size_t nbins)
+{
+    _indices.resize(std::distance(ib, ie));
+    quantize(ib, ie, nbins, std::is_arithmetic<T>());
+
+    return _indices;
+}
+
+template <class T> template <class ITER> void
+Quantizer<T>::quantize(ITER ib, ITER ie, size_t nbins, std::true_type)
 {
     using pair_type = std::pair<ITER, Array<size_t>::iterator>;
 
-    _indices.resize(std::distance(ib, ie));
-    
     std::vector<pair_type>	io;
     for (auto idx = _indices.begin(); ib != ie; ++ib, ++idx)
 	io.push_back(pair_type(ib, idx));
 
-    super::quantize(io, nbins, std::is_arithmetic<T>());
+    super::quantize(io, nbins);
+}
 
-    return _indices;
+template <class T> template <class ITER> void
+Quantizer<T>::quantize(ITER ib, ITER ie, size_t nbins, std::false_type)
+{
+    super::clearHistogram();
+    super::addToHistogram(ib, ie);
+    super::buildPalette(nbins);
+    super::index(ib, ie, _indices.begin());
 }
     
 /************************************************************************
@@ -344,6 +557,12 @@ class Quantizer2 : public QuantizerBase<T>
 	    return out << quantizer._indices;
 	}
 
+  private:
+    template <class ROW>
+    void	quantize(ROW ib, ROW ie, size_t nbins, std::true_type)	;
+    template <class ROW>
+    void	quantize(ROW ib, ROW ie, size_t nbins, std::false_type)	;
+
   private:
     Array2<size_t>	_indices;
 };
@@ -353,11 +572,18 @@ std::enable_if_t<!std::is_same<value_t<iterator_value<ROW> >, u_char>::value,
 		 const Array2<size_t>&>
 Quantizer2<T>::operator ()(ROW ib, ROW ie, size_t nbins)
 {
-    using pair_type = std::pair<iterator_t<iterator_reference<ROW> >,
-				Array<size_t>::iterator>;
-    
     _indices.resize(std::distance(ib, ie),
 		    (ib == ie ? 0 : std::distance(ib->begin(), ib->end())));
+    quantize(ib, ie, nbins, std::is_arithmetic<T>());
+
+    return _indices;
+}
+
+template <class T> template <class ROW> void
+Quantizer2<T>::quantize(ROW ib, ROW ie, size_t nbins, std::true_type)
+{
+    using pair_type = std::pair<iterator_t<iterator_reference<ROW> >,
+				Array<size_t>::iterator>;
     
     std::vector<pair_type>	io;
     for (auto row = _indices.begin(); ib != ie; ++ib, ++row)
@@ -367,9 +593,22 @@ Quantizer2<T>::operator ()(ROW ib, ROW ie, size_t nbins)
 	    io.push_back(pair_type(col, idx));
     }
 
-    super::quantize(io, nbins, std::is_arithmetic<T>());
+    super::quantize(io, nbins);
+}
 
-    return _indices;
+//! 3次元ヒストグラムを介して色を量子化する．
+template <class T> template <class ROW> void
+Quantizer2<T>::quantize(ROW ib, ROW ie, size_t nbins, std::false_type)
+{
+    super::clearHistogram();
+    for (auto row = ib; row != ie; ++row)
+	super::addToHistogram(row->begin(), row->end());
+
+    super::buildPalette(nbins);
+
+    auto	idx = _indices.begin();
+    for (auto row = ib; row != ie; ++row, ++idx)
+	super::index(row->begin(), row->end(), idx->begin());
 }
 
 }
@@ -8,6 +8,9 @@
 
 #include "TU/StereoBase.h"
 #include "TU/BoxFilter.h"
+#if defined(TU_SIMD_DISPATCH)
+#  include "TU/simd/dispatch.h"
+#endif
 
 namespace TU
 {
@@ -71,6 +74,8 @@ class SADStereo : public StereoBase<SADStereo<SCORE, DISP> >
 	
 	ScoreVecArray2		Q;	// W x D
 	DisparityArray		dminL;	// 1 x (W - N + 1)
+	FloatArray		dRprev;	// 1 x (W - N + 1)
+	FloatArray		dRnext;	// 1 x (W - N + 1)
 	FloatArray		delta;	// 1 x (W - N + 1)
 	DisparityArray		dminR;	// 1 x (W + D - 1)
 	ScoreVecArray		RminR;	// 1 x D
@@ -134,6 +139,7 @@ class SADStereo : public StereoBase<SADStereo<SCORE, DISP> >
     using	super::nextFrame;
     using	super::selectDisparities;
     using	super::pruneDisparities;
+    using	super::setScoreIncrements;
     
     template <class COL, class COL_RV>
     void	initializeDissimilarities(COL colL, COL colLe,
@@ -143,16 +149,25 @@ class SADStereo : public StereoBase<SADStereo<SCORE, DISP> >
     void	updateDissimilarities(COL colL, COL colLe, COL_RV colRV,
 				      COL colLp, COL_RV colRVp,
 				      col_siterator colQ)	const	;
+#if defined(TU_SIMD_DISPATCH)
+    void	updateDissimilarities(const u_char* colL,
+				      const u_char* colLe,
+				      const u_char* colRV,
+				      const u_char* colLp,
+				      const u_char* colRVp,
+				      col_siterator colQ)	const	;
+#endif
     template <class DMIN_RV, class RMIN_RV>
     void	computeDisparities(const_reverse_col_siterator colQ,
 				   const_reverse_col_siterator colQe,
 				   reverse_col_diterator dminL,
-				   reverse_col_fiterator delta,
+				   reverse_col_fiterator dRprev,
+				   reverse_col_fiterator dRnext,
 				   DMIN_RV dminRV, RMIN_RV RminRV) const;
 
   private:
     Parameters					_params;
-    typename super::template Pool<Buffers>	_bufferPool;
+    Pool<Buffers>	_bufferPool;
 };
     
 template <class SCORE, class DISP>
@@ -193,7 +208,7 @@ SADStereo<SCORE, DISP>::match(ROW rowL, ROW rowLe, ROW rowR, ROW_D rowD)
     if (H < N || W < N)				// 充分な行数／列数があるか確認
 	return;
 
-    auto* const	buffers = _bufferPool.get();	// 各種作業領域を確保
+    const auto	buffers = _bufferPool.acquire();	// 各種作業領域を確保
     buffers->initialize(N, D, W);
 
     std::advance(rowD, N/2);	// 出力行をウィンドウサイズの半分だけ進める
@@ -229,20 +244,21 @@ SADStereo<SCORE, DISP>::match(ROW rowL, ROW rowLe, ROW rowR, ROW_D rowD)
 	    buffers->RminR = std::numeric_limits<Score>::max();
 	    computeDisparities(buffers->Q.crbegin(), buffers->Q.crend(),
 			       buffers->dminL.rbegin(),
-			       buffers->delta.rbegin(),
+			       buffers->dRprev.rbegin(),
+			       buffers->dRnext.rbegin(),
 			       buffers->dminR.end() - D + 1,
 			       make_dummy_iterator(&(buffers->RminR)));
 	    start(3);
 	    selectDisparities(buffers->dminL.cbegin(), buffers->dminL.cend(),
-			      buffers->dminR.cbegin(), buffers->delta.cbegin(),
-			      begin(*rowD) + N/2);
+			      buffers->dminR.cbegin(),
+			      buffers->dRprev.data(), buffers->dRnext.data(),
+			      buffers->delta.data(), begin(*rowD) + N/2);
 	    ++rowD;
 	}
 
 	++rowR;
     }
 
-    _bufferPool.put(buffers);
     nextFrame();
 }
 
@@ -260,7 +276,7 @@ SADStereo<SCORE, DISP>::match(ROW rowL, ROW rowLe, ROW rowLlast,
     if (H < N || W < N)				// 充分な行数／列数があるか確認
 	return;
 
-    auto* const	buffers = _bufferPool.get();	// 各種作業領域を確保
+    const auto	buffers = _bufferPool.acquire();	// 各種作業領域を確保
     buffers->initialize(N, D, W, H);
     
     std::advance(rowD, N/2);	// 出力行をウィンドウサイズの半分だけ進める
@@ -310,7 +326,8 @@ SADStereo<SCORE, DISP>::match(ROW rowL, ROW rowLe, ROW rowLlast,
 	    buffers->RminR = std::numeric_limits<Score>::max();
 	    computeDisparities(buffers->Q.crbegin(), buffers->Q.crend(),
 			       buffers->dminL.rbegin(),
-			       buffers->delta.rbegin(),
+			       buffers->dRprev.rbegin(),
+			       buffers->dRnext.rbegin(),
 			       make_zip_iterator(
 				   buffers->dminR.end() - D + 1,
 				   make_vertical_iterator(
@@ -320,8 +337,9 @@ SADStereo<SCORE, DISP>::match(ROW rowL, ROW rowLe, ROW rowLlast,
 				   buffers->RminV.rbegin()));
 	    start(3);
 	    selectDisparities(buffers->dminL.cbegin(), buffers->dminL.cend(),
-			      buffers->dminR.cbegin(), buffers->delta.cbegin(),
-			      begin(*rowD) + N/2);
+			      buffers->dminR.cbegin(),
+			      buffers->dRprev.data(), buffers->dRnext.data(),
+			      buffers->delta.data(), begin(*rowD) + N/2);
 
 	    ++rowD;
 	}
@@ -347,7 +365,6 @@ SADStereo<SCORE, DISP>::match(ROW rowL, ROW rowLe, ROW rowLlast,
 	}
     }
 
-    _bufferPool.put(buffers);
     nextFrame();
 }
 
@@ -501,11 +518,39 @@ SADStereo<SCORE, DISP>::updateDissimilarities(COL colL,  COL colLe,
     }
 }
 
+#if defined(TU_SIMD_DISPATCH)
+template <class SCORE, class DISP> inline void
+SADStereo<SCORE, DISP>::updateDissimilarities(const u_char* colL,
+					      const u_char* colLe,
+					      const u_char* colRV,
+					      const u_char* colLp,
+					      const u_char* colRVp,
+					      col_siterator colQ) const
+{
+  // 輝度差のみを用いる2眼ステレオの場合は実行時に選ばれた実装を用いる．
+    if (!std::is_same<Score, short>::value || _params.blend > 0)
+    {
+	updateDissimilarities<const u_char*, const u_char*>(colL, colLe,
+							     colRV,
+							     colLp, colRVp,
+							     colQ);
+	return;
+    }
+
+    const auto	Q = reinterpret_cast<short*>(colQ.base().base());
+    simd::dispatched_kernels().sad_update(
+	colL, colLe, colRV, colLp, colRVp, Q,
+	reinterpret_cast<short*>((colQ + 1).base().base()) - Q,
+	(*colQ).size() * ScoreVec::size, _params.intensityDiffMax);
+}
+#endif
+
 template <class SCORE, class DISP> template <class DMIN_RV, class RMIN_RV> void
 SADStereo<SCORE, DISP>::computeDisparities(const_reverse_col_siterator colQ,
 					   const_reverse_col_siterator colQe,
 					   reverse_col_diterator dminL,
-					   reverse_col_fiterator delta,
+					   reverse_col_fiterator dRprev,
+					   reverse_col_fiterator dRnext,
 					   DMIN_RV dminRV,
 					   RMIN_RV RminRV) const
 {
@@ -552,12 +597,11 @@ SADStereo<SCORE, DISP>::computeDisparities(const_reverse_col_siterator colQ,
       	const auto	dL = maskRV.dL();		// 左画像から見た視差
 	const auto	R  = boxR->cbegin();
 #endif
-	const auto	dsw1 = _params.disparitySearchWidth - 1;
 	*dminL = dL;
-	*delta = (dL == 0 || dL == dsw1 ? 0 :
-		  0.5f * float(R[dL-1] - R[dL+1]) /
-		  float(std::max(R[dL-1] - R[dL], R[dL+1] - R[dL]) + 1));
-	++delta;
+	setScoreIncrements(R, dL, _params.disparitySearchWidth,
+			   *dRprev, *dRnext);
+	++dRprev;
+	++dRnext;
 	++dminL;
 	++RminRV;
     }
@@ -578,6 +622,8 @@ SADStereo<SCORE, DISP>::Buffers::initialize(size_t N, size_t D, size_t W)
     Q = 0;
 
     dminL.resize(W - N + 1);
+    dRprev.resize(dminL.size());
+    dRnext.resize(dminL.size());
     delta.resize(dminL.size());
     dminR.resize(dminL.size() + D - 1);
     RminR.resize(DD);
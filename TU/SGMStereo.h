@@ -0,0 +1,781 @@
+/*!
+  \file		SGMStereo.h
+  \author	Toshio UESHIBA
+  \brief	Semi-Global Matchingによるステレオマッチングクラスの定義と実装
+*/
+#ifndef TU_SGMSTEREO_H
+#define TU_SGMSTEREO_H
+
+#include "TU/StereoBase.h"
+#if defined(USE_TBB)
+#  include <tbb/parallel_for.h>
+#endif
+
+namespace TU
+{
+/************************************************************************
+*  class SGMStereo<SCORE, DISP>						*
+************************************************************************/
+//! Semi-Global Matchingによるステレオマッチングクラス
+/*!
+  各画素の視差毎の非類似度を windowSize x windowSize の窓内の輝度差の和
+  として求め，それを4方向または8方向の経路に沿って平滑化コスト
+  (視差の差が1ならば P1, 2以上ならば P2)の下で集積する．経路はそれぞれ
+  画像全体に渡るので，短冊に分割して並列処理する StereoBase の
+  operator () は用いず，画像全体を一度に処理する．並列化は経路の集積の
+  内部で行われる．非類似度や集積結果の作業領域をメンバとして保持するので
+  operator () は const でなく，1つのオブジェクトを複数のスレッドから同時に
+  用いることはできない．
+  \param SCORE	非類似度の型
+  \param DISP	視差の型
+*/
+template <class SCORE, class DISP>
+class SGMStereo : public StereoBase<SGMStereo<SCORE, DISP> >
+{
+  public:
+    using Score			= SCORE;
+    using Disparity		= DISP;
+
+  private:
+    using super			= StereoBase<SGMStereo<Score, Disparity> >;
+#if defined(SIMD)
+    using ScoreVec		= simd::vec<Score>;
+    using DisparityVec		= simd::vec<Disparity>;
+#else
+    using ScoreVec		= Score;
+    using DisparityVec		= Disparity;
+#endif
+    using ScoreVecArray		= Array<ScoreVec>;
+    using ScoreVecArray2	= Array2<ScoreVec>;
+    using col_siterator		= typename ScoreVecArray2::iterator;
+    using ScoreArray		= Array<Score>;
+    using ScoreArray2		= Array2<Score>;
+    using DisparityArray	= Array<Disparity>;
+    using DisparityArray2	= Array2<Disparity>;
+    using FloatArray		= Array<float>;
+
+  //! 1行分の視差の選択に用いる作業領域
+    struct Buffers
+    {
+	void	initialize(size_t D, size_t W)			;
+
+	DisparityArray		dminL;	// 1 x (W - N + 1)
+	FloatArray		dRprev;	// 1 x (W - N + 1)
+	FloatArray		dRnext;	// 1 x (W - N + 1)
+	FloatArray		delta;	// 1 x (W - N + 1)
+	DisparityArray		dminR;	// 1 x (W - N + 1 + D - 1)
+	ScoreArray		RminR;	// 1 x (W - N + 1 + D - 1)
+    };
+
+  //! 上下方向の経路の集積に用いる作業領域
+  /*!
+    現在の行と前の行の集積値を交互に用いる．
+  */
+    struct Paths
+    {
+	void	initialize(size_t npaths, size_t DD, size_t W)	;
+	void	swap()					{ curr ^= 1; }
+
+	ScoreVecArray	L[2];		// 2 x (npaths x (W - N + 1) x DD)
+	ScoreArray	minL[2];	// 2 x (npaths x (W - N + 1))
+	size_t		npaths;		// 経路の数
+	size_t		curr;		// 現在の行の集積値の添字
+    };
+
+  public:
+    struct Parameters : public super::Parameters
+    {
+	Parameters()	:windowSize(5), intensityDiffMax(20),
+			 P1(40), P2(400), npaths(8)			{}
+
+	std::istream&	get(std::istream& in)
+			{
+			    super::Parameters::get(in);
+			    in >> windowSize >> intensityDiffMax
+			       >> P1 >> P2 >> npaths;
+
+			    return in;
+			}
+	std::ostream&	put(std::ostream& out) const
+			{
+			    using namespace	std;
+
+			    super::Parameters::put(out);
+			    cerr << "  window size:                        ";
+			    out << windowSize << endl;
+			    cerr << "  maximum intensity difference:       ";
+			    out << intensityDiffMax << endl;
+			    cerr << "  penalty for disparity change of 1:  ";
+			    out << P1 << endl;
+			    cerr << "  penalty for larger change:          ";
+			    out << P2 << endl;
+			    cerr << "  number of paths (4 or 8):           ";
+			    out << npaths << endl;
+
+			    return out;
+			}
+
+	size_t	windowSize;		//!< ウィンドウのサイズ
+	size_t	intensityDiffMax;	//!< 輝度差の最大値
+	Score	P1;			//!< 視差が1だけ変化する場合のペナルティ
+	Score	P2;			//!< 視差が2以上変化する場合のペナルティ
+	size_t	npaths;			//!< 集積する経路の数(4または8)
+    };
+
+  public:
+    SGMStereo()	:super(*this, 4), _params()				{}
+    SGMStereo(const Parameters& params)
+	:super(*this, 4), _params(params)				{}
+
+    const Parameters&
+		getParameters()					const	;
+    void	setParameters(const Parameters& params)			;
+    size_t	getOverlap()					const	;
+    template <class ROW, class ROW_D>
+    void	operator ()(ROW rowL, ROW rowLe,
+			    ROW rowR, ROW_D rowD)			;
+    template <class ROW, class ROW_D>
+    void	operator ()(ROW rowL, ROW rowLe, ROW rowLlast,
+			    ROW rowR, ROW rowV, ROW_D rowD)		;
+    template <class ROW, class ROW_D>
+    void	match(ROW rowL, ROW rowLe, ROW rowR, ROW_D rowD)	;
+    template <class ROW, class ROW_D>
+    void	match(ROW rowL, ROW rowLe, ROW rowLlast,
+		      ROW rowR, ROW rowV, ROW_D rowD)			;
+
+  private:
+    using	super::start;
+    using	super::nextFrame;
+    using	super::selectDisparities;
+    using	super::pruneDisparities;
+    using	super::setScoreIncrements;
+
+    template <class ROW, class COLRV>
+    void	computeCosts(ROW rowL, COLRV colRV,
+			     size_t vb, size_t ve)			;
+    template <class COL, class COL_RV>
+    void	addDissimilarities(COL colL, COL colLe, COL_RV colRV,
+				   col_siterator colQ)		const	;
+    template <class COL, class COL_RV>
+    void	subtractDissimilarities(COL colL, COL colLe, COL_RV colRV,
+					col_siterator colQ)	const	;
+    void	aggregateHorizontally(size_t vb, size_t ve)		;
+    void	aggregateVertically(size_t v, size_t ub, size_t ue,
+				    bool forward)			;
+    Score	startPath(const ScoreVec* C, ScoreVec* L)	const	;
+    Score	updatePath(const ScoreVec* C, const ScoreVec* Lp,
+			   Score minLp, ScoreVec* L)		const	;
+    template <class COL_D>
+    void	computeDisparities(size_t v, Buffers& buffers,
+				   COL_D colD)			const	;
+    void	computeVerticalDisparities(size_t ub, size_t ue)	;
+    ScoreVec*	cost(size_t v, size_t u)			;
+    ScoreVec*	score(size_t v, size_t u)			;
+    const Score*
+		aggregatedScores(size_t v, size_t u)		const	;
+    template <class ROW, class COLRV, class ROW_D>
+    void	matchImage(ROW rowL, ROW rowLe, COLRV colRV,
+			   ROW_D rowD, bool trinocular)			;
+
+#if defined(SIMD)
+    static ScoreVec	lower(ScoreVec prev, ScoreVec curr)
+			{
+			    return simd::shift_r<ScoreVec::size-1>(prev, curr);
+			}
+    static ScoreVec	upper(ScoreVec curr, ScoreVec next)
+			{
+			    return simd::shift_r<1>(curr, next);
+			}
+    static Score	hmin(ScoreVec x)	{ return simd::hmin(x); }
+#else
+    static ScoreVec	lower(ScoreVec prev, ScoreVec)	{ return prev; }
+    static ScoreVec	upper(ScoreVec, ScoreVec next)	{ return next; }
+    static Score	hmin(ScoreVec x)		{ return x; }
+#endif
+    static Score	infinity()
+			{
+			    return std::numeric_limits<Score>::max() / 2;
+			}
+
+  private:
+    Parameters					_params;
+    size_t					_W;	// W - N + 1
+    size_t					_H;	// H - N + 1
+    size_t					_DD;	// D / ScoreVec::size
+    ScoreVecArray				_C;	// _H x _W x DD
+    ScoreVecArray				_S;	// _H x _W x DD
+    Paths					_paths;
+    DisparityArray2				_dminV;	// _W x (_H + D - 1)
+    Pool<ScoreVecArray2>	_colPool;
+    Pool<Buffers>	_bufferPool;
+};
+
+template <class SCORE, class DISP>
+inline const typename SGMStereo<SCORE, DISP>::Parameters&
+SGMStereo<SCORE, DISP>::getParameters() const
+{
+    return _params;
+}
+
+template <class SCORE, class DISP> inline void
+SGMStereo<SCORE, DISP>::setParameters(const Parameters& params)
+{
+    _params = params;
+#if defined(SIMD)
+    _params.disparitySearchWidth
+	= simd::vec<Disparity>::ceil(_params.disparitySearchWidth);
+#endif
+    if (_params.disparityMax < _params.disparitySearchWidth)
+	_params.disparityMax = _params.disparitySearchWidth;
+    if (_params.npaths != 4)
+	_params.npaths = 8;
+}
+
+template <class SCORE, class DISP> inline size_t
+SGMStereo<SCORE, DISP>::getOverlap() const
+{
+    return _params.windowSize - 1;
+}
+
+//! 2眼ステレオマッチングを行う．
+/*!
+  経路が画像全体に渡るので，短冊に分割せずに画像全体を一度に処理する．
+*/
+template <class SCORE, class DISP> template <class ROW, class ROW_D> inline void
+SGMStereo<SCORE, DISP>::operator ()(ROW rowL, ROW rowLe,
+				    ROW rowR, ROW_D rowD)
+{
+    match(rowL, rowLe, rowR, rowD);
+}
+
+//! 3眼ステレオマッチングを行う．
+/*!
+  経路が画像全体に渡るので，短冊に分割せずに画像全体を一度に処理する．
+*/
+template <class SCORE, class DISP> template <class ROW, class ROW_D> inline void
+SGMStereo<SCORE, DISP>::operator ()(ROW rowL, ROW rowLe, ROW rowLlast,
+				    ROW rowR, ROW rowV, ROW_D rowD)
+{
+    match(rowL, rowLe, rowLlast, rowR, rowV, rowD);
+}
+
+template <class SCORE, class DISP> template <class ROW, class ROW_D> void
+SGMStereo<SCORE, DISP>::match(ROW rowL, ROW rowLe, ROW rowR, ROW_D rowD)
+{
+    matchImage(rowL, rowLe,
+	       [rowR](size_t v)
+	       {
+		   using	std::cbegin;
+
+		   return cbegin(*(rowR + v));
+	       },
+	       rowD, false);
+}
+
+template <class SCORE, class DISP> template <class ROW, class ROW_D> void
+SGMStereo<SCORE, DISP>::match(ROW rowL, ROW rowLe, ROW rowLlast,
+			      ROW rowR, ROW rowV, ROW_D rowD)
+{
+    const size_t	cV = std::distance(rowL, rowLlast);
+    matchImage(rowL, rowLe,
+	       [rowR, rowV, cV](size_t v)
+	       {
+		   using	std::cbegin;
+
+		   return make_zip_iterator(cbegin(*(rowR + v)),
+					    make_vertical_iterator(rowV,
+								   cV - 1 - v));
+	       },
+	       rowD, true);
+}
+
+//! 画像全体に対してステレオマッチングを行う．
+/*!
+  \param rowL		左画像の最初の行
+  \param rowLe		左画像の最後の行の次
+  \param colRV		行番号を与えると右画像(と上画像)の対応する画素列の
+			先頭を返す関数
+  \param rowD		視差画像の最初の行
+  \param trinocular	3眼ステレオならtrue
+*/
+template <class SCORE, class DISP>
+template <class ROW, class COLRV, class ROW_D> void
+SGMStereo<SCORE, DISP>::matchImage(ROW rowL, ROW rowLe, COLRV colRV,
+				   ROW_D rowD, bool trinocular)
+{
+    using	std::size;
+
+    start(0);
+    const size_t	N = _params.windowSize,
+			D = _params.disparitySearchWidth,
+			H = std::distance(rowL, rowLe),
+			W = (H != 0 ? size(*rowL) : 0);
+    if (H < N || W < N)				// 充分な行数／列数があるか確認
+	return;
+
+#if defined(SIMD)
+    _DD = D / ScoreVec::size;
+#else
+    _DD = D;
+#endif
+    _H = H - N + 1;
+    _W = W - N + 1;
+    _C.resize(_H * _W * _DD);
+    _S.resize(_H * _W * _DD);
+    _paths.initialize((_params.npaths == 4 ? 1 : 3), _DD, _W);
+
+  // 各画素の視差毎の非類似度を求める．
+#if defined(USE_TBB)
+    tbb::parallel_for(tbb::blocked_range<size_t>(0, _H, _params.grainSize),
+		      [=](const tbb::blocked_range<size_t>& r)
+		      {
+			  computeCosts(rowL, colRV, r.begin(), r.end());
+		      });
+#else
+    computeCosts(rowL, colRV, 0, _H);
+#endif
+
+  // 左右方向の経路に沿って集積する．
+    start(1);
+#if defined(USE_TBB)
+    tbb::parallel_for(tbb::blocked_range<size_t>(0, _H, _params.grainSize),
+		      [this](const tbb::blocked_range<size_t>& r)
+		      {
+			  aggregateHorizontally(r.begin(), r.end());
+		      });
+#else
+    aggregateHorizontally(0, _H);
+#endif
+
+  // 上下方向および斜め方向の経路に沿って集積する．各行の画素は
+  // 互いに独立に処理できる．
+    for (const auto forward : {true, false})
+    {
+	for (size_t n = 0; n < _H; ++n)
+	{
+	    const auto	v = (forward ? n : _H - 1 - n);
+#if defined(USE_TBB)
+	    tbb::parallel_for(tbb::blocked_range<size_t>(0, _W,
+							 _params.grainSize),
+			      [=](const tbb::blocked_range<size_t>& r)
+			      {
+				  aggregateVertically(v, r.begin(), r.end(),
+						      forward);
+			      });
+#else
+	    aggregateVertically(v, 0, _W, forward);
+#endif
+	    _paths.swap();
+	}
+    }
+
+  // 上画像からの逆方向視差探索のために，上画像の各画素の最適視差を求める．
+    start(2);
+    if (trinocular && _params.doVerticalBackMatch)
+    {
+	_dminV.resize(_W, _H + D - 1);
+#if defined(USE_TBB)
+	tbb::parallel_for(tbb::blocked_range<size_t>(0, _W,
+						     _params.grainSize),
+			  [this](const tbb::blocked_range<size_t>& r)
+			  {
+			      computeVerticalDisparities(r.begin(), r.end());
+			  });
+#else
+	computeVerticalDisparities(0, _W);
+#endif
+    }
+
+  // 各行の視差を求める．
+    std::advance(rowD, N/2);	// 出力行をウィンドウサイズの半分だけ進める
+    const auto	selectRows = [=](size_t vb, size_t ve)
+			     {
+				 using	std::begin;
+
+				 const auto	buffers = _bufferPool.acquire();
+				 buffers->initialize(D, _W);
+
+				 auto	row = rowD;
+				 std::advance(row, vb);
+				 for (size_t v = vb; v != ve; ++v, ++row)
+				 {
+				     computeDisparities(v, *buffers,
+							begin(*row) + N/2);
+				     if (trinocular &&
+					 _params.doVerticalBackMatch)
+					 pruneDisparities(
+					     make_vertical_iterator(
+						 _dminV.cbegin(), _H - 1 - v),
+					     make_vertical_iterator(
+						 _dminV.cend(),   _H - 1 - v),
+					     begin(*row) + N/2);
+				 }
+
+			     };
+#if defined(USE_TBB)
+    tbb::parallel_for(tbb::blocked_range<size_t>(0, _H, _params.grainSize),
+		      [&selectRows](const tbb::blocked_range<size_t>& r)
+		      {
+			  selectRows(r.begin(), r.end());
+		      });
+#else
+    selectRows(0, _H);
+#endif
+    nextFrame();
+}
+
+//! 指定された範囲の行について，各画素の視差毎の非類似度を求める．
+/*!
+  \param vb	最初の出力行
+  \param ve	最後の出力行の次
+*/
+template <class SCORE, class DISP> template <class ROW, class COLRV> void
+SGMStereo<SCORE, DISP>::computeCosts(ROW rowL, COLRV colRV,
+				     size_t vb, size_t ve)
+{
+    using	std::cbegin;
+    using	std::cend;
+    using	std::size;
+
+    const size_t	N = _params.windowSize;
+    const auto		Q = _colPool.acquire();	// 窓の縦方向の非類似度の和
+    Q->resize(size(*rowL), _DD);
+    *Q = 0;
+
+    std::advance(rowL, vb);
+    for (size_t n = 0; n < N - 1; ++n)
+	addDissimilarities(cbegin(*(rowL + n)), cend(*(rowL + n)),
+			   colRV(vb + n), Q->begin());
+
+    for (size_t v = vb; v != ve; ++v)
+    {
+	addDissimilarities(cbegin(*(rowL + N - 1)), cend(*(rowL + N - 1)),
+			   colRV(v + N - 1), Q->begin());
+
+      // 窓の横方向の和をとる．
+	const ScoreVec* const	colQ = Q->data();
+	const size_t		stride = Q->stride();
+	ScoreVec*		colC = cost(v, 0);
+	for (size_t k = 0; k < _DD; ++k)
+	{
+	    ScoreVec	sum = colQ[k];
+	    for (size_t u = 1; u < N; ++u)
+		sum += colQ[u*stride + k];
+	    colC[k] = sum;
+	}
+	for (size_t u = 1; u < _W; ++u)
+	{
+	    const auto	head = colQ + (u + N - 1)*stride;
+	    const auto	tail = colQ + (u - 1)*stride;
+	    const auto	colCp = colC;
+	    colC += _DD;
+	    for (size_t k = 0; k < _DD; ++k)
+		colC[k] = colCp[k] + head[k] - tail[k];
+	}
+
+	subtractDissimilarities(cbegin(*rowL), cend(*rowL), colRV(v),
+				Q->begin());
+	++rowL;
+    }
+
+}
+
+template <class SCORE, class DISP> template <class COL, class COL_RV> void
+SGMStereo<SCORE, DISP>::addDissimilarities(COL colL, COL colLe, COL_RV colRV,
+					   col_siterator colQ) const
+{
+    using pixel_t	= iterator_value<COL>;
+    using diff_t	= Diff<pixel_t>;
+#if defined(SIMD)
+    using qiterator	= simd::cvtup_iterator<subiterator<col_siterator> >;
+#else
+    using qiterator	= subiterator<col_siterator>;
+#endif
+    for (; colL != colLe; ++colL)
+    {
+	const auto	diff = diff_t(*colL, _params.intensityDiffMax);
+	auto		in   = make_col_accessor(colRV);
+
+	for (qiterator Q(colQ->begin()), Qe(colQ->end()); Q != Qe; ++Q, ++in)
+	    *Q += diff(*in);
+
+	++colRV;
+	++colQ;
+    }
+}
+
+template <class SCORE, class DISP> template <class COL, class COL_RV> void
+SGMStereo<SCORE, DISP>::subtractDissimilarities(COL colL, COL colLe,
+						COL_RV colRV,
+						col_siterator colQ) const
+{
+    using pixel_t	= iterator_value<COL>;
+    using diff_t	= Diff<pixel_t>;
+#if defined(SIMD)
+    using qiterator	= simd::cvtup_iterator<subiterator<col_siterator> >;
+#else
+    using qiterator	= subiterator<col_siterator>;
+#endif
+    for (; colL != colLe; ++colL)
+    {
+	const auto	diff = diff_t(*colL, _params.intensityDiffMax);
+	auto		in   = make_col_accessor(colRV);
+
+	for (qiterator Q(colQ->begin()), Qe(colQ->end()); Q != Qe; ++Q, ++in)
+	    *Q -= diff(*in);
+
+	++colRV;
+	++colQ;
+    }
+}
+
+//! 経路の始点の画素の集積値を求める．
+/*!
+  \param C	始点の画素の視差毎の非類似度
+  \param L	始点の画素の視差毎の集積値の出力先
+  \return	L の最小値
+*/
+template <class SCORE, class DISP>
+inline typename SGMStereo<SCORE, DISP>::Score
+SGMStereo<SCORE, DISP>::startPath(const ScoreVec* C, ScoreVec* L) const
+{
+    using	std::min;
+
+    ScoreVec	minL(infinity());
+    for (size_t k = 0; k < _DD; ++k)
+    {
+	L[k] = C[k];
+	minL = min(minL, C[k]);
+    }
+
+    return hmin(minL);
+}
+
+//! 1つの経路上で，前の画素の集積値から現画素の集積値を求める．
+/*!
+  \param C	現画素の視差毎の非類似度
+  \param Lp	前の画素の視差毎の集積値
+  \param minLp	Lp の最小値
+  \param L	現画素の視差毎の集積値の出力先
+  \return	L の最小値
+*/
+template <class SCORE, class DISP>
+inline typename SGMStereo<SCORE, DISP>::Score
+SGMStereo<SCORE, DISP>::updatePath(const ScoreVec* C, const ScoreVec* Lp,
+				   Score minLp, ScoreVec* L) const
+{
+    using	std::min;
+
+    const ScoreVec	P1(_params.P1), P2(minLp + _params.P2), M(minLp);
+    ScoreVec		prev(infinity()), curr(Lp[0]), minL(infinity());
+    for (size_t k = 0; k < _DD; ++k)
+    {
+	const ScoreVec	next = (k + 1 < _DD ? Lp[k+1] : ScoreVec(infinity()));
+	const ScoreVec	neighbor = min(lower(prev, curr), upper(curr, next))
+				 + P1;
+	const ScoreVec	val = C[k] + min(min(curr, neighbor), P2) - M;
+	L[k] = val;
+	minL = min(minL, val);
+	prev = curr;
+	curr = next;
+    }
+
+    return hmin(minL);
+}
+
+//! 指定された範囲の行について，左右方向の経路に沿って集積する．
+template <class SCORE, class DISP> void
+SGMStereo<SCORE, DISP>::aggregateHorizontally(size_t vb, size_t ve)
+{
+    ScoreVecArray	Lbuf(2*_DD);	// 現画素と前の画素の集積値
+    ScoreVec* const	L[] = {Lbuf.data(), Lbuf.data() + _DD};
+
+    for (size_t v = vb; v != ve; ++v)
+    {
+	const ScoreVec* const	C = cost(v, 0);
+	ScoreVec* const		S = score(v, 0);
+
+      // 左から右へ
+	auto	minL = startPath(C, S);
+	for (size_t u = 1; u < _W; ++u)
+	    minL = updatePath(C + u*_DD, S + (u - 1)*_DD, minL, S + u*_DD);
+
+      // 右から左へ
+	size_t	curr = 0;
+	minL = startPath(C + (_W - 1)*_DD, L[curr]);
+	for (size_t u = _W; u-- > 0; )
+	{
+	    if (u + 1 < _W)
+	    {
+		minL = updatePath(C + u*_DD, L[curr], minL, L[curr ^ 1]);
+		curr ^= 1;
+	    }
+
+	    const auto	s = S + u*_DD;
+	    const auto	l = L[curr];
+	    for (size_t k = 0; k < _DD; ++k)
+		s[k] += l[k];
+	}
+    }
+}
+
+//! 指定された行の画素について，上下方向と斜め方向の経路に沿って集積する．
+/*!
+  前の行の集積値は _paths の curr ^ 1 番目に収められており，この行の
+  集積値は curr 番目に書き込まれる．
+  \param v		行
+  \param ub		最初の画素
+  \param ue		最後の画素の次
+  \param forward	上から下へ集積するならtrue, 下から上ならfalse
+*/
+template <class SCORE, class DISP> void
+SGMStereo<SCORE, DISP>::aggregateVertically(size_t v, size_t ub, size_t ue,
+					    bool forward)
+{
+    const auto		first = (forward ? v == 0 : v == _H - 1);
+    ScoreVec* const	L     = _paths.L[_paths.curr].data();
+    const ScoreVec*	Lp    = _paths.L[_paths.curr ^ 1].data();
+    Score* const	minL  = _paths.minL[_paths.curr].data();
+    const Score*	minLp = _paths.minL[_paths.curr ^ 1].data();
+
+    for (size_t u = ub; u != ue; ++u)
+    {
+	const auto	c = cost(v, u);
+	const auto	s = score(v, u);
+
+	for (size_t i = 0; i < _paths.npaths; ++i)
+	{
+	  // i = 0: 真上(真下)から，1: 左上(左下)から，2: 右上(右下)から
+	    const auto	j = i*_W + u;
+	    const auto	l = L + j*_DD;
+
+	    if (first || (i == 1 && u == 0) || (i == 2 && u + 1 == _W))
+		minL[j] = startPath(c, l);
+	    else
+	    {
+		const auto	jp = (i == 1 ? j - 1 : i == 2 ? j + 1 : j);
+		minL[j] = updatePath(c, Lp + jp*_DD, minLp[jp], l);
+	    }
+
+	    for (size_t k = 0; k < _DD; ++k)
+		s[k] += l[k];
+	}
+    }
+}
+
+//! 指定された行の各画素について，集積値を最小化する視差を求める．
+template <class SCORE, class DISP> template <class COL_D> void
+SGMStereo<SCORE, DISP>::computeDisparities(size_t v, Buffers& buffers,
+					   COL_D colD) const
+{
+    const size_t	D = _params.disparitySearchWidth;
+
+    buffers.RminR = std::numeric_limits<Score>::max();
+    for (size_t u = 0; u < _W; ++u)
+    {
+	const auto	R = aggregatedScores(v, u);
+
+      // 左画像から見た視差
+	const size_t	dL = std::min_element(R, R + D) - R;
+	buffers.dminL[u] = dL;
+	setScoreIncrements(R, dL, D, buffers.dRprev[u], buffers.dRnext[u]);
+
+      // 右画像から見た視差
+	const auto	RminR = buffers.RminR.begin() + u;
+	const auto	dminR = buffers.dminR.begin() + u;
+	for (size_t d = 0; d < D; ++d)
+	    if (R[d] < RminR[d])
+	    {
+		RminR[d] = R[d];
+		dminR[d] = d;
+	    }
+    }
+
+    selectDisparities(buffers.dminL.cbegin(), buffers.dminL.cend(),
+		      buffers.dminR.cbegin(),
+		      buffers.dRprev.data(), buffers.dRnext.data(),
+		      buffers.delta.data(), colD);
+}
+
+//! 指定された範囲の列について，上画像から見た各画素の最適視差を求める．
+template <class SCORE, class DISP> void
+SGMStereo<SCORE, DISP>::computeVerticalDisparities(size_t ub, size_t ue)
+{
+    const size_t	D = _params.disparitySearchWidth;
+    ScoreArray		RminV(_H + D - 1);
+
+    for (size_t u = ub; u != ue; ++u)
+    {
+	RminV = std::numeric_limits<Score>::max();
+	const auto	dminV = _dminV[u].begin();
+
+	for (size_t v = 0; v < _H; ++v)
+	{
+	    const auto	R = aggregatedScores(v, u);
+	    const auto	y = _H - 1 - v;
+	    for (size_t d = 0; d < D; ++d)
+		if (R[d] < RminV[y + d])
+		{
+		    RminV[y + d] = R[d];
+		    dminV[y + d] = d;
+		}
+	}
+    }
+}
+
+//! 指定された画素の視差毎の非類似度を返す．
+template <class SCORE, class DISP>
+inline typename SGMStereo<SCORE, DISP>::ScoreVec*
+SGMStereo<SCORE, DISP>::cost(size_t v, size_t u)
+{
+    return static_cast<ScoreVec*>(_C.data()) + (v*_W + u)*_DD;
+}
+
+//! 指定された画素の視差毎の集積値を返す．
+template <class SCORE, class DISP>
+inline typename SGMStereo<SCORE, DISP>::ScoreVec*
+SGMStereo<SCORE, DISP>::score(size_t v, size_t u)
+{
+    return static_cast<ScoreVec*>(_S.data()) + (v*_W + u)*_DD;
+}
+
+//! 指定された画素の視差毎の集積値をスカラーの配列として返す．
+template <class SCORE, class DISP>
+inline const typename SGMStereo<SCORE, DISP>::Score*
+SGMStereo<SCORE, DISP>::aggregatedScores(size_t v, size_t u) const
+{
+    return reinterpret_cast<const Score*>(
+	       static_cast<const ScoreVec*>(_S.data()) + (v*_W + u)*_DD);
+}
+
+/************************************************************************
+*  class SGMStereo<SCORE, DISP>::Buffers				*
+************************************************************************/
+template <class SCORE, class DISP> void
+SGMStereo<SCORE, DISP>::Buffers::initialize(size_t D, size_t W)
+{
+    dminL.resize(W);
+    dRprev.resize(W);
+    dRnext.resize(W);
+    delta.resize(W);
+    dminR.resize(W + D - 1);
+    RminR.resize(dminR.size());
+}
+
+/************************************************************************
+*  class SGMStereo<SCORE, DISP>::Paths					*
+************************************************************************/
+template <class SCORE, class DISP> void
+SGMStereo<SCORE, DISP>::Paths::initialize(size_t npaths, size_t DD, size_t W)
+{
+    for (size_t j = 0; j < 2; ++j)
+    {
+	L[j].resize(npaths * W * DD);
+	minL[j].resize(npaths * W);
+    }
+    this->npaths = npaths;
+    curr = 0;
+}
+
+}
+#endif	// !TU_SGMSTEREO_H
@@ -16,6 +16,19 @@
 #  include <tbb/spin_mutex.h>
 #endif
 
+//! 方向と記述子の計算において同じ行に並ぶサンプル点をSIMDで一括処理するか
+/*!
+  Is32vec の要素の取り出しにSSE4が必要であり，F32vec と Is32vec の要素数が
+  等しくなければならないので，AVX2なしのAVXでは使わない．
+*/
+#if !defined(TU_SURF_SIMD)
+#  if defined(SSE4) && (defined(AVX2) || !defined(AVX))
+#    define TU_SURF_SIMD	1
+#  else
+#    define TU_SURF_SIMD	0
+#  endif
+#endif
+
 namespace TU
 {
 template <class F>	class Sieve;
@@ -78,6 +91,18 @@ class SURFCreator
 #endif
 	value_type	getWx(size_t x, size_t y);
 	value_type	getWy(size_t x, size_t y);
+#if TU_SURF_SIMD
+	static simd::Is32vec
+			simdLanes(int step)				;
+	simd::F32vec	simdCrop2(simd::Is32vec umin, simd::Is32vec umax,
+				  int vmin, int vmax)		const	;
+	simd::F32vec	simdGetWx(simd::Is32vec x, int y)	const	;
+	simd::F32vec	simdGetWy(simd::Is32vec x, int y)	const	;
+	simd::Iu32vec	simdCheckBoundsW(simd::Is32vec x, int y) const	;
+	bool		simdGetW(simd::Is32vec x, int y, simd::Iu32vec mask,
+				 uint32_t valid[],
+				 value_type wx[], value_type wy[])	const	;
+#endif
 
 	bool		checkBounds(int x, int y)		const	;
 	bool		checkBoundsW(int x, int y)		const	;
@@ -195,13 +220,29 @@ class SURFCreator
 
     template <class F, class T, class OUT>
     void	createSURFs(const Image<T>& image, OUT out)	const	;
+    template <class F, class T, class OUT>
+    void	createSURFs(const Image<T>& image,
+			    size_t u, size_t v, size_t w, size_t h,
+			    OUT out)				const	;
     template <class T, class F>
     void	detectFeatures(const Image<T>& image,
 			       Inserter<F>& insert)		const	;
+    template <class T, class F>
+    void	detectFeatures(const Image<T>& image,
+			       size_t u, size_t v, size_t w, size_t h,
+			       Inserter<F>& insert)		const	;
     template <class ITER>
     void	makeDescriptors(ITER begin, ITER end)		const	;
     
   private:
+    template <class F, class OUT>
+    void	createSURFs(OUT out)				const	;
+    template <class F>
+    void	detectFeatures(Inserter<F>& insert)		const	;
+    template <class T>
+    void	updateIntegralImage(const Image<T>& image,
+				    size_t u, size_t v,
+				    size_t w, size_t h)		const	;
     template <class T, size_t D>
     void	assignOrientation(Feature<T, D>& feature)	const	;
     template <class T, size_t D>
@@ -260,14 +301,41 @@ SURFCreator::getParameters() const
 //! 画像からSURF特徴を抽出
 template <class F, class T, class OUT> void
 SURFCreator::createSURFs(const Image<T>& image, OUT out) const
+{
+    _integralImage.initialize(image);	// 積分画像を作る
+    createSURFs<F>(out);
+}
+
+//! 前回の画像から長方形領域のみが変化した画像からSURF特徴を抽出
+/*!
+  積分画像を作り直す代わりに，変化した領域に基づいて更新する．
+  画像の大きさが前回と異なる場合は積分画像を作り直す．
+  \param image	入力画像
+  \param u	変化した領域の左上隅の横座標
+  \param v	変化した領域の左上隅の縦座標
+  \param w	変化した領域の幅
+  \param h	変化した領域の高さ
+  \param out	SURF特徴の出力先
+*/
+template <class F, class T, class OUT> void
+SURFCreator::createSURFs(const Image<T>& image,
+			 size_t u, size_t v, size_t w, size_t h, OUT out) const
+{
+    updateIntegralImage(image, u, v, w, h);
+    createSURFs<F>(out);
+}
+
+template <class F, class OUT> void
+SURFCreator::createSURFs(OUT out) const
 {
     typedef typename Sieve<F>::Inserter		Inserter;
     
   // 画像全体を10x10のバケットに区切り，各バケットにスコアの高い順に高々10個の
   // SURFを登録する．
-    Sieve<F>	sieve(image.height(), image.width(), 10, 10, 10);
+    Sieve<F>	sieve(_integralImage.originalHeight(),
+		      _integralImage.originalWidth(), 10, 10, 10);
     Inserter	insert(sieve);
-    detectFeatures(image, insert);
+    detectFeatures(insert);
     
   // 各SURF特徴点に向きと特徴ベクトルを与える．
 #if defined(USE_TBB)		  // Sieveの反復子はrandom access不可
@@ -285,7 +353,32 @@ template <class T, class F> void
 SURFCreator::detectFeatures(const Image<T>& image, Inserter<F>& insert) const
 {
     _integralImage.initialize(image);	// 積分画像を作る
-    
+    detectFeatures(insert);
+}
+
+template <class T, class F> void
+SURFCreator::detectFeatures(const Image<T>& image,
+			    size_t u, size_t v, size_t w, size_t h,
+			    Inserter<F>& insert) const
+{
+    updateIntegralImage(image, u, v, w, h);
+    detectFeatures(insert);
+}
+
+template <class T> void
+SURFCreator::updateIntegralImage(const Image<T>& image,
+				 size_t u, size_t v, size_t w, size_t h) const
+{
+    if (_integralImage.height() == image.height() + 1 &&
+	_integralImage.width()  == image.width()  + 1)
+	_integralImage.update(image, u, v, w, h);
+    else
+	_integralImage.initialize(image);
+}
+
+template <class F> void
+SURFCreator::detectFeatures(Inserter<F>& insert) const
+{
     Array<size_t>		borderSizes(_params.nScales);
     Array<Matrix<value_type> >	det(_params.nScales);
     for (size_t s = 0; s < det.size(); ++s)
@@ -6,7 +6,12 @@
 #ifndef TU_SEPARABLEFILTER2_H
 #define TU_SEPARABLEFILTER2_H
 
+#include <array>
+#include <tuple>
+#include <utility>
+#include <vector>
 #include "TU/Array++.h"
+#include "TU/Pool.h"
 #if defined(USE_TBB)
 #  include <tbb/parallel_for.h>
 #  include <tbb/blocked_range.h>
@@ -19,6 +24,15 @@ namespace TU
 ************************************************************************/
 //! 水平/垂直方向に分離可能な2次元フィルタを実装するための基底クラス
 /*!
+  畳み込みは tileSize() バイト程度の作業領域に収まるタイル単位で行われ，
+  作業領域は呼び出し間で再利用される．USE_TBB を指定した場合は作業領域が
+  スレッド毎にプールされるので，同一のフィルタを複数のスレッドから同時に
+  用いてもよい．setTileSize(0) とすると，画像全体の大きさの作業領域を
+  呼び出しごとに確保する従来の方法で畳み込む．
+  横方向フィルタを共有する複数の縦横フィルタの組による畳み込みは，
+  フィルタ群を与えた convolve() によって入力の1回の走査で行える．
+  1次元フィルタが複数行をまとめて処理する convolveRows() を持つ場合は，
+  タイル単位の畳み込みにおける横方向フィルタの適用にそれを用いる．
   \param F	1次元フィルタの型
 */
 template <class F>
@@ -26,8 +40,14 @@ class SeparableFilter2
 {
   public:
     using	filter_type = F;
-#if defined(USE_TBB)
+
+    template <size_t N_>
+    using	indices_type = std::array<std::pair<size_t, size_t>, N_>;
+    
   private:
+    using	buf_type = Array2<typename F::element_type>;
+
+#if defined(USE_TBB)
     template <class IN_, class OUT_>
     class ConvolveRows
     {
@@ -105,9 +125,7 @@ class SeparableFilter2
 		    std::advance(ie, r.end());
 		    auto	out = _out;
 		    std::advance(out, r.begin());
-		    for (; in != ie; ++in, ++out)
-			_filterH.convolve(cbegin(*in), cend(*in),
-					  begin(*out), _shift);
+		    convolveRows(_filterH, in, ie, out, _shift, 0);
 		}
 
       private:
@@ -116,18 +134,108 @@ class SeparableFilter2
 	const OUT_	_out;
 	const bool	_shift;
     };
+
+    template <class IN_, class OUT_>
+    class ConvolveBands
+    {
+      public:
+	ConvolveBands(const F& filterH, const F& filterV,
+		      IN_ in, OUT_ out, size_t nrowsBand, Pool<buf_type>& bufs)
+	    :_filterH(filterH), _filterV(filterV),
+	     _in(in), _out(out), _nrowsBand(nrowsBand), _bufs(bufs)	{}
+
+	void	operator ()(const tbb::blocked_range<size_t>& r) const
+		{
+		    const auto	buf = _bufs.acquire();
+		    convolveBands(_filterH, _filterV, _in, _out,
+				  r.begin(), r.end(), _nrowsBand, *buf);
+		}
+
+      private:
+	const F		_filterH;  // cache等の内部状態を持ち得るので参照は不可
+	const F		_filterV;
+	const IN_	_in;
+	const OUT_	_out;
+	const size_t	_nrowsBand;
+	Pool<buf_type>&	_bufs;
+    };
+
+    template <class IN_, size_t NH_>
+    class ConvolveRowsMulti
+    {
+      public:
+	ConvolveRowsMulti(const std::array<F, NH_>& filtersH,
+			  const std::array<bool, NH_>& used,
+			  IN_ in, buf_type* bufs)
+	    :_filtersH(filtersH), _used(used), _in(in), _bufs(bufs)	{}
+
+	void	operator ()(const tbb::blocked_range<size_t>& r) const
+		{
+		    convolveRowsMulti(_filtersH, _used, _in, _bufs,
+				      r.begin(), r.end());
+		}
+
+      private:
+	const std::array<F, NH_>	_filtersH;  // 参照は不可
+	const std::array<bool, NH_>	_used;
+	const IN_			_in;
+	buf_type* const			_bufs;
+    };
+
+    template <size_t NV_, class... OUT_>
+    class ConvolveStripsMulti
+    {
+      public:
+	ConvolveStripsMulti(const std::array<F, NV_>& filtersV,
+			    const indices_type<sizeof...(OUT_)>& indices,
+			    const buf_type* bufs,
+			    const std::tuple<OUT_...>& outs,
+			    size_t offH, size_t offV)
+	    :_filtersV(filtersV), _indices(indices), _bufs(bufs),
+	     _outs(outs), _offH(offH), _offV(offV)			{}
+
+	void	operator ()(const tbb::blocked_range<size_t>& r) const
+		{
+		    convolveStripsMulti(_filtersV, _indices, _bufs, _outs,
+					r.begin(), r.size(), _offH, _offV,
+					std::index_sequence_for<OUT_...>());
+		}
+
+      private:
+	const std::array<F, NV_>		_filtersV;  // 参照は不可
+	const indices_type<sizeof...(OUT_)>	_indices;
+	const buf_type* const			_bufs;
+	const std::tuple<OUT_...>		_outs;
+	const size_t				_offH;
+	const size_t				_offV;
+    };
 #endif
   public:
-    SeparableFilter2()	:_filterH(), _filterV(), _grainSize(1)		{}
+    SeparableFilter2()
+	:_filterH(), _filterV(), _grainSize(1), _tileSize(DefaultTileSize)
+    {
+    }
     template <class ARGH_, class ARGV_>
     SeparableFilter2(const ARGH_& argH, const ARGV_& argV)
-	:_filterH(argH), _filterV(argV), _grainSize(1)			{}
+	:_filterH(argH), _filterV(argV),
+	 _grainSize(1), _tileSize(DefaultTileSize)
+    {
+    }
     
     template <class IN_, class OUT_>
     void	convolve(IN_ ib, IN_ ie, OUT_ out,
 			 bool shift=false)	const	;
+    template <class IN_, size_t NH_, size_t NV_, class... OUT_>
+    void	convolve(IN_ ib, IN_ ie,
+			 const std::array<F, NH_>& filtersH,
+			 const std::array<F, NV_>& filtersV,
+			 const indices_type<sizeof...(OUT_)>& indices,
+			 const std::tuple<OUT_...>& outs,
+			 bool shift=false)		const	;
     size_t	grainSize()			const	{ return _grainSize; }
     void	setGrainSize(size_t gs)			{ _grainSize = gs; }
+    size_t	tileSize()			const	{ return _tileSize; }
+    void	setTileSize(size_t ts)			{ _tileSize = ts; }
     const F&	filterH()			const	{ return _filterH; }
     const F&	filterV()			const	{ return _filterV; }
     size_t	outSizeH(size_t inSizeH) const
@@ -150,11 +258,85 @@ class SeparableFilter2
   protected:
     F&		filterH()				{ return _filterH; }
     F&		filterV()				{ return _filterV; }
+    template <class IN_, class S_, class H_, class V_,
+	      class HH_, class HV_, class VV_>
+    void	derivatives(IN_ ib, IN_ ie, const std::array<F, 3>& filters,
+			    S_ smooth, H_ diffH, V_ diffV,
+			    HH_ diffHH, HV_ diffHV, VV_ diffVV,
+			    bool shift)			const	;
+
+  private:
+    template <class IN_, class OUT_>
+    void	convolveTiles(IN_ ib, IN_ ie, OUT_ out,
+			      bool shift)		const	;
+    template <class IN_, class OUT_>
+    static void	convolveBands(const F& filterH, const F& filterV,
+			      IN_ in, OUT_ out, size_t rb, size_t re,
+			      size_t nrowsBand, buf_type& buf)		;
+    template <class IN_, size_t NH_>
+    static void	convolveRowsMulti(const std::array<F, NH_>& filtersH,
+				  const std::array<bool, NH_>& used,
+				  IN_ in, buf_type* bufs,
+				  size_t rb, size_t re)			;
+    template <size_t NV_, class... OUT_, size_t... I_>
+    static void	convolveStripsMulti(const std::array<F, NV_>& filtersV,
+				    const indices_type<sizeof...(OUT_)>& indices,
+				    const buf_type* bufs,
+				    const std::tuple<OUT_...>& outs,
+				    size_t col, size_t n,
+				    size_t offH, size_t offV,
+				    std::index_sequence<I_...>)		;
+    template <class OUT_>
+    static void	convolveStrip(const F& filterV, const buf_type& buf,
+			      OUT_ out, size_t col, size_t n,
+			      size_t offH, size_t offV)			;
+    static void	convolveStrip(const F&, const buf_type&, std::nullptr_t,
+			      size_t, size_t, size_t, size_t)		{}
+    template <class F_, class IN_, class OUT_>
+    static auto	convolveRows(const F_& filter,
+			     IN_ ib, IN_ ie, OUT_ out, bool shift, int)
+		    -> decltype(filter.convolveRows(ib, ie, out, shift))
+		{
+		    return filter.convolveRows(ib, ie, out, shift);
+		}
+    template <class F_, class IN_, class OUT_>
+    static OUT_	convolveRows(const F_& filter,
+			     IN_ ib, IN_ ie, OUT_ out, bool shift, long)
+		{
+		    using	std::cbegin;
+		    using	std::cend;
+		    using	std::begin;
+
+		    for (; ib != ie; ++ib, ++out)
+			filter.convolve(cbegin(*ib), cend(*ib),
+					begin(*out), shift);
+		    return out;
+		}
+    template <class F_>
+    static auto	winSize(const F_& filter, int)
+		    -> decltype(filter.winSize())
+		{
+		    return filter.winSize();
+		}
+    template <class F_>
+    static size_t
+		winSize(const F_&, long)
+		{
+		    return 0;		// 無限インパルス応答
+		}
 
   private:
-    F		_filterH;
-    F		_filterV;
-    size_t	_grainSize;
+    constexpr static size_t	DefaultTileSize = 256*1024;
+    constexpr static size_t	MinStripWidth	= 256;
+    
+    F			_filterH;
+    F			_filterV;
+    size_t		_grainSize;
+    size_t		_tileSize;	//!< タイル1つ分の作業領域のバイト数
+    mutable Pool<buf_type>
+			_buf;		//!< 呼び出し間で再利用される作業領域
+    mutable Pool<std::vector<buf_type> >
+			_bufs;		//!< フィルタ群による畳み込みの作業領域
 };
     
 //! 与えられた2次元配列とこのフィルタの畳み込みを行う
@@ -168,7 +350,6 @@ class SeparableFilter2
 template <class F> template <class IN_, class OUT_> void
 SeparableFilter2<F>::convolve(IN_ ib, IN_ ie, OUT_ out, bool shift) const
 {
-    using buf_type	= Array2<typename filter_type::element_type>;
     using std::size;
     
     if (ib == ie)
@@ -176,6 +357,12 @@ SeparableFilter2<F>::convolve(IN_ ib, IN_ ie, OUT_ out, bool shift) const
 
     if (shift)
 	std::advance(out, offsetV());
+
+    if (_tileSize != 0)
+    {
+	convolveTiles(ib, ie, out, shift);
+	return;
+    }
     
 #if defined(CACHE_FRIENDLY)
     buf_type	buf(_filterV.outSize(std::distance(ib, ie)), size(*ib));
@@ -223,5 +410,300 @@ SeparableFilter2<F>::convolve(IN_ ib, IN_ ie, OUT_ out, bool shift) const
 #endif
 }
 
+//! 与えられた2次元配列とこのフィルタの畳み込みをタイル単位で行う
+/*!
+  横方向フィルタを各行に適用した結果を転置せずに作業領域に書き込み，
+  それに縦方向フィルタを行単位で適用する．縦方向フィルタが有限長
+  (winSize()を持つ)ならば，全行を数行ずつの帯に分け，帯ごとに両方向の
+  フィルタをまとめて適用するので，作業領域は tileSize() バイト程度で済む．
+  そうでなければ，全行に横方向フィルタを適用した後，縦方向フィルタを
+  tileSize() バイト程度に収まる幅の縦長の短冊ごとに適用する．
+  \param ib	入力2次元データ配列の先頭行を指す反復子
+  \param ie	入力2次元データ配列の末尾の次の行を指す反復子
+  \param out	出力2次元データ配列の先頭行を指す反復子
+  \param shift	trueならば，出力位置を水平方向に offsetH() だけシフトする
+*/
+template <class F> template <class IN_, class OUT_> void
+SeparableFilter2<F>::convolveTiles(IN_ ib, IN_ ie, OUT_ out, bool shift) const
+{
+    using element_type	= typename filter_type::element_type;
+    using std::size;
+    using std::begin;
+    
+    const size_t	nrow = std::distance(ib, ie);
+    const size_t	D    = winSize(_filterV, 0);
+    if (nrow < D || size(*ib) < winSize(_filterH, 0))
+	return;			// 出力が空
+
+    const size_t	ncol = outSizeH(size(*ib));
+    const auto		rows = make_range_iterator(
+				   begin(*out) + (shift ? offsetH() : 0),
+				   stride(out), ncol);
+
+    if (D == 0)		// 縦方向フィルタが無限インパルス応答を持つ場合
+    {
+      // 行単位の縦方向フィルタの呼び出しに伴うオーバーヘッドを償却するため，
+      // 短冊の幅は MinStripWidth 要素以上とする．
+	const size_t	w = std::max(_tileSize/(nrow*sizeof(element_type))
+				     /MinStripWidth*MinStripWidth,
+				     MinStripWidth);
+	const auto	buf = _buf.acquire();
+	buf->resize(nrow, ncol);
+
+#if defined(USE_TBB)
+	using convolveH	= ConvolveH<IN_, typename buf_type::iterator>;
+	using convolveV	= ConvolveV<typename buf_type::const_iterator,
+				    std::decay_t<decltype(rows)> >;
+
+	tbb::parallel_for(tbb::blocked_range<size_t>(0, nrow, _grainSize),
+			  convolveH(_filterH, ib, buf->begin(), false));
+	tbb::parallel_for(tbb::blocked_range<size_t>(0, ncol, w),
+			  convolveV(_filterV, buf->cbegin(), buf->cend(), rows));
+#else
+	convolveRows(_filterH, ib, ie, buf->begin(), false, 0);
+
+	const auto	bufb = buf->cbegin();
+	const auto	bufe = buf->cend();
+	for (size_t col = 0; col < ncol; col += w)
+	{
+	    const auto	n = std::min(w, ncol - col);
+	    
+	    _filterV.convolve(make_range_iterator(bufb->cbegin() + col,
+						  stride(bufb), n),
+			      make_range_iterator(bufe->cbegin() + col,
+						  stride(bufe), n),
+			      make_range_iterator(rows->begin() + col,
+						  stride(rows), n));
+	}
+#endif
+    }
+    else		// 縦方向フィルタが有限長の場合
+    {
+	const size_t	nrowsBand = std::max(_tileSize/(ncol*sizeof(element_type)),
+					     D);
+	const size_t	nrowOut = _filterV.outSize(nrow);
+	
+#if defined(USE_TBB)
+	using convolveBands = ConvolveBands<IN_, std::decay_t<decltype(rows)> >;
+
+	tbb::parallel_for(tbb::blocked_range<size_t>(
+			      0, nrowOut, std::max(nrowsBand, _grainSize)),
+			  convolveBands(_filterH, _filterV,
+					ib, rows, nrowsBand, _buf));
+#else
+	const auto	buf = _buf.acquire();
+	convolveBands(_filterH, _filterV, ib, rows, 0, nrowOut, nrowsBand, *buf);
+#endif
+    }
+}
+
+//! 出力2次元データ配列の指定された範囲の行を帯単位で計算する
+/*!
+  \param filterH	横方向フィルタ
+  \param filterV	縦方向フィルタ(有限長)
+  \param in		入力2次元データ配列の先頭行を指す反復子
+  \param out		出力2次元データ配列の先頭行を指す反復子
+  \param rb		計算する出力の先頭行
+  \param re		計算する出力の末尾の次の行
+  \param nrowsBand	1つの帯に含まれる出力の行数
+  \param buf		作業領域
+*/
+template <class F> template <class IN_, class OUT_> void
+SeparableFilter2<F>::convolveBands(const F& filterH, const F& filterV,
+				   IN_ in, OUT_ out, size_t rb, size_t re,
+				   size_t nrowsBand, buf_type& buf)
+{
+    using std::size;
+    
+    const size_t	D = winSize(filterV, 0);
+
+    buf.resize(nrowsBand + D - 1, filterH.outSize(size(*in)));
+    std::advance(in,  rb);
+    std::advance(out, rb);
+
+    for (size_t r = rb; r < re; r += nrowsBand)
+    {
+	const size_t	n = std::min(nrowsBand, re - r);
+	size_t		i = 0;
+
+      // 直前の帯の末尾 D-1 行に対する横方向フィルタの出力を再利用する．
+	if (r != rb)
+	{
+	    std::copy(buf.cbegin() + nrowsBand,
+		      buf.cbegin() + nrowsBand + D - 1, buf.begin());
+	    i = D - 1;
+	}
+	
+	for (auto row = buf.begin() + i; i < n + D - 1; ++i, ++in, ++row)
+	    filterH.convolve(std::cbegin(*in), std::cend(*in), row->begin());
+
+	out = filterV.convolve(buf.cbegin(), buf.cbegin() + n + D - 1, out);
+    }
+}
+
+//! 横方向フィルタを共有する複数のフィルタと与えられた2次元配列の畳み込みを行う
+/*!
+  i番目の出力は，横方向フィルタ filtersH[indices[i].first] と縦方向フィルタ
+  filtersV[indices[i].second] による畳み込みの結果である．各横方向フィルタは
+  入力の1回の走査で全行に適用されて作業領域に保持され，それを用いる全ての
+  出力で共有される．縦方向フィルタは，作業領域の tileSize() バイト程度に
+  収まる幅の縦長の短冊ごとに，全ての出力についてまとめて適用される．
+  \param ib		入力2次元データ配列の先頭行を指す反復子
+  \param ie		入力2次元データ配列の末尾の次の行を指す反復子
+  \param filtersH	横方向フィルタの並び
+  \param filtersV	縦方向フィルタの並び
+  \param indices	各出力に用いる横方向/縦方向フィルタの番号の組の並び
+  \param outs		各出力2次元データ配列の先頭行を指す反復子の組．
+			nullptr を与えた出力は計算されない
+  \param shift		trueならば，入力データと対応するよう，出力位置を水平/
+			垂直方向にそれぞれ offsetH(), offsetV() だけシフトする
+*/
+template <class F> template <class IN_, size_t NH_, size_t NV_, class... OUT_>
+void
+SeparableFilter2<F>::convolve(IN_ ib, IN_ ie,
+			      const std::array<F, NH_>& filtersH,
+			      const std::array<F, NV_>& filtersV,
+			      const indices_type<sizeof...(OUT_)>& indices,
+			      const std::tuple<OUT_...>& outs, bool shift) const
+{
+    using element_type	= typename filter_type::element_type;
+    using std::size;
+
+    constexpr bool	nulls[] = {std::is_null_pointer<OUT_>::value...};
+    
+    const size_t	nrow = std::distance(ib, ie);
+    if (nrow == 0 || nrow < winSize(filtersV[0], 0) ||
+	size(*ib) < winSize(filtersH[0], 0))
+	return;			// 出力が空
+
+  // 計算すべき出力が用いる横方向フィルタだけを入力に適用する．
+    const size_t	ncol = filtersH[0].outSize(size(*ib));
+    std::array<bool, NH_>	used{};
+    size_t			nused = 0;
+    for (size_t i = 0; i < sizeof...(OUT_); ++i)
+	if (!nulls[i] && !used[indices[i].first])
+	{
+	    used[indices[i].first] = true;
+	    ++nused;
+	}
+    if (nused == 0)
+	return;
+
+    const auto	bufs = _bufs.acquire();
+    bufs->resize(NH_);
+    for (size_t k = 0; k < NH_; ++k)
+	if (used[k])
+	    (*bufs)[k].resize(nrow, ncol);
+
+    const size_t	offH = (shift ? filtersH[0].offset() : 0);
+    const size_t	offV = (shift ? filtersV[0].offset() : 0);
+    const size_t	w = std::max(_tileSize/(nused*nrow*sizeof(element_type))
+				     /MinStripWidth*MinStripWidth,
+				     MinStripWidth);
+#if defined(USE_TBB)
+    using convolveH	= ConvolveRowsMulti<IN_, NH_>;
+    using convolveV	= ConvolveStripsMulti<NV_, OUT_...>;
+
+    tbb::parallel_for(tbb::blocked_range<size_t>(0, nrow, _grainSize),
+		      convolveH(filtersH, used, ib, bufs->data()));
+    tbb::parallel_for(tbb::blocked_range<size_t>(0, ncol, w),
+		      convolveV(filtersV, indices, bufs->data(), outs,
+				offH, offV));
+#else
+    convolveRowsMulti(filtersH, used, ib, bufs->data(), 0, nrow);
+    for (size_t col = 0; col < ncol; col += w)
+	convolveStripsMulti(filtersV, indices, bufs->data(), outs,
+			    col, std::min(w, ncol - col), offH, offV,
+			    std::index_sequence_for<OUT_...>());
+#endif
+}
+
+//! 0, 1, 2階微分フィルタの組による平滑化と1, 2階偏微分を1回の走査で求める
+/*!
+  \param ib		入力2次元データ配列の先頭行を指す反復子
+  \param ie		入力2次元データ配列の末尾の次の行を指す反復子
+  \param filters	0, 1, 2階微分フィルタの並び
+  \param smooth		平滑化結果の先頭行を指す反復子
+  \param diffH		横方向1階微分の先頭行を指す反復子
+  \param diffV		縦方向1階微分の先頭行を指す反復子
+  \param diffHH		横方向2階微分の先頭行を指す反復子
+  \param diffHV		縦横両方向2階微分の先頭行を指す反復子
+  \param diffVV		縦方向2階微分の先頭行を指す反復子
+  \param shift		trueならば，入力データと対応するよう，出力位置を水平/
+			垂直方向にそれぞれ offsetH(), offsetV() だけシフトする
+*/
+template <class F>
+template <class IN_, class S_, class H_, class V_, class HH_, class HV_,
+	  class VV_> inline void
+SeparableFilter2<F>::derivatives(IN_ ib, IN_ ie,
+				 const std::array<F, 3>& filters,
+				 S_ smooth, H_ diffH, V_ diffV,
+				 HH_ diffHH, HV_ diffHV, VV_ diffVV,
+				 bool shift) const
+{
+    constexpr indices_type<6>	indices = {{{0, 0}, {1, 0}, {0, 1},
+					    {2, 0}, {1, 1}, {0, 2}}};
+
+    convolve(ib, ie, filters, filters, indices,
+	     std::make_tuple(smooth, diffH, diffV, diffHH, diffHV, diffVV),
+	     shift);
+}
+
+//! 入力2次元データ配列の指定された範囲の行に複数の横方向フィルタを適用する
+/*!
+  \param filtersH	横方向フィルタの並び
+  \param used		各横方向フィルタを適用するか否か
+  \param in		入力2次元データ配列の先頭行を指す反復子
+  \param bufs		各横方向フィルタの出力を保持する作業領域の並び
+  \param rb		処理する先頭行
+  \param re		処理する末尾の次の行
+*/
+template <class F> template <class IN_, size_t NH_> void
+SeparableFilter2<F>::convolveRowsMulti(const std::array<F, NH_>& filtersH,
+				       const std::array<bool, NH_>& used,
+				       IN_ in, buf_type* bufs,
+				       size_t rb, size_t re)
+{
+    auto	ie = in;
+    std::advance(in, rb);
+    std::advance(ie, re);
+
+    for (size_t k = 0; k < NH_; ++k)
+	if (used[k])
+	    convolveRows(filtersH[k], in, ie, bufs[k].begin() + rb, false, 0);
+}
+
+//! 作業領域の指定された短冊に各出力の縦方向フィルタを適用する
+template <class F> template <size_t NV_, class... OUT_, size_t... I_> void
+SeparableFilter2<F>::convolveStripsMulti(
+    const std::array<F, NV_>& filtersV,
+    const indices_type<sizeof...(OUT_)>& indices,
+    const buf_type* bufs, const std::tuple<OUT_...>& outs,
+    size_t col, size_t n, size_t offH, size_t offV,
+    std::index_sequence<I_...>)
+{
+    (convolveStrip(filtersV[indices[I_].second], bufs[indices[I_].first],
+		   std::get<I_>(outs), col, n, offH, offV), ...);
+}
+
+template <class F> template <class OUT_> void
+SeparableFilter2<F>::convolveStrip(const F& filterV, const buf_type& buf,
+				   OUT_ out, size_t col, size_t n,
+				   size_t offH, size_t offV)
+{
+    using std::begin;
+
+    const auto	bufb = buf.cbegin();
+    const auto	bufe = buf.cend();
+    std::advance(out, offV);
+    
+    filterV.convolve(make_range_iterator(bufb->cbegin() + col,
+					 stride(bufb), n),
+		     make_range_iterator(bufe->cbegin() + col,
+					 stride(bufe), n),
+		     make_range_iterator(begin(*out) + offH + col,
+					 stride(out), n));
+}
+
 }
 #endif	// !TU_SEPARABLEFILTER2_H
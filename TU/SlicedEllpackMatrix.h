@@ -0,0 +1,249 @@
+/*!
+  \file		SlicedEllpackMatrix.h
+  \author	Toshio UESHIBA
+  \brief	クラス TU::SlicedEllpackMatrix の定義と実装
+*/
+#ifndef TU_SLICEDELLPACKMATRIX_H
+#define TU_SLICEDELLPACKMATRIX_H
+
+#include "TU/SparseMatrix++.h"
+#include "TU/simd/simd.h"
+#include <cstdint>
+#include <numeric>
+
+namespace TU
+{
+/************************************************************************
+*  class SlicedEllpackMatrix<T>						*
+************************************************************************/
+//! SELL-C-σ形式による疎行列
+/*!
+  行を長さ σ の窓毎に成分数の降順に並べ替えた後，C 行ずつのスライスに
+  分け，各スライスを最長の行に合わせて0で埋めて列優先で格納する．C は
+  SIMDベクトルの要素数に等しいので，スライス内の C 行の積和を1本の
+  SIMDベクトルで計算できる．構造の変更はできないので，SparseMatrix から
+  生成して行列とベクトルの積を繰り返し計算する場合に用いる．
+  \param T	成分の型
+*/
+template <class T>
+class SlicedEllpackMatrix
+{
+  public:
+    using element_type	= T;		//!< 成分の型
+    using index_type	= std::conditional_t<sizeof(T) == 8,
+					     int64_t, int32_t>;
+					//!< 列番号の型
+#if defined(SIMD)
+    constexpr static size_t	C = simd::vec<T>::size;	//!< スライスの行数
+#else
+    constexpr static size_t	C = 8;			//!< スライスの行数
+#endif
+
+  public:
+    SlicedEllpackMatrix()	:_nrow(0), _ncol(0)			{}
+    template <bool SYM>
+    explicit	SlicedEllpackMatrix(const SparseMatrix<T, SYM>& A,
+				    size_t sigma=32*C)			;
+
+    template <bool SYM>
+    void	initialize(const SparseMatrix<T, SYM>& A,
+			   size_t sigma=32*C)				;
+
+  //! 行列の行数を返す．
+  /*!
+    \return	行列の行数
+  */
+    size_t	nrow()				const	{ return _nrow; }
+
+  //! 行列の列数を返す．
+  /*!
+    \return	行列の列数
+  */
+    size_t	ncol()				const	{ return _ncol; }
+
+  //! 0埋めを含めて格納されている成分数を返す．
+  /*!
+    \return	格納されている成分数
+  */
+    size_t	nelements()			const	{ return _values.size(); }
+
+    void	multiply(const Vector<T>& x, Vector<T>& y)	const	;
+
+  private:
+    size_t	nslices()		const	{ return _offsets.size() - 1; }
+    void	multiply(const T* x, T* y, size_t sb, size_t se) const	;
+#if defined(SIMD)
+    static simd::vec<T>
+		gather(const T* x, const index_type* col)		;
+#endif
+
+  private:
+    size_t			_nrow;		//!< 行の数
+    size_t			_ncol;		//!< 列の数
+    std::vector<size_t>		_offsets;	//!< 各スライスの先頭成分の通し番号
+    std::vector<size_t>		_rows;		//!< スライスの各行の元の行番号
+    std::vector<index_type>	_columns;	//!< 各成分の列番号
+    std::vector<T>		_values;	//!< 各成分の値
+};
+
+//! 疎行列からSELL-C-σ形式の疎行列を生成する．
+/*!
+  \param A	疎行列
+  \param sigma	行を並べ替える窓の長さ
+*/
+template <class T> template <bool SYM> inline
+SlicedEllpackMatrix<T>::SlicedEllpackMatrix(const SparseMatrix<T, SYM>& A,
+					    size_t sigma)
+    :_nrow(0), _ncol(0)
+{
+    initialize(A, sigma);
+}
+
+//! 疎行列からSELL-C-σ形式の疎行列を生成する．
+/*!
+  対称行列の場合は，下三角部分も陽に格納する．
+  \param A	疎行列
+  \param sigma	行を並べ替える窓の長さ．C の倍数に切り上げられる．
+*/
+template <class T> template <bool SYM> void
+SlicedEllpackMatrix<T>::initialize(const SparseMatrix<T, SYM>& A,
+				   size_t sigma)
+{
+    const auto	R = A.rows();
+    const auto	length = [&R](size_t i)
+			 { return R.rowIndex[i+1] - R.rowIndex[i]; };
+
+    _nrow = A.nrow();
+    _ncol = A.ncol();
+    sigma = std::max((sigma + C - 1) / C, size_t(1)) * C;
+
+  // 長さ sigma の窓毎に行を成分数の降順に並べ替える．
+    const auto	ns = (_nrow + C - 1) / C;
+    _rows.resize(ns * C);
+    std::iota(_rows.begin(), _rows.end(), 0);
+    for (size_t i = 0; i < _nrow; i += sigma)
+	std::stable_sort(_rows.begin() + i,
+			 _rows.begin() + std::min(i + sigma, _nrow),
+			 [&length](size_t i, size_t j)
+			 { return length(i) > length(j); });
+
+  // 各スライスの幅を最長の行に合わせて先頭位置を決める．
+    _offsets.resize(ns + 1);
+    _offsets[0] = 0;
+    for (size_t s = 0; s < ns; ++s)
+    {
+	size_t	w = 0;
+	for (size_t l = 0; l < C; ++l)
+	{
+	    const auto	i = _rows[s*C + l];
+	    if (i < _nrow)
+		w = std::max<size_t>(w, length(i));
+	}
+	_offsets[s+1] = _offsets[s] + w*C;
+    }
+
+  // 各スライスの成分を列優先で格納する．0埋めした成分の列番号は0とする．
+    _columns.assign(_offsets[ns], 0);
+    _values.assign(_offsets[ns], T(0));
+    for (size_t s = 0; s < ns; ++s)
+	for (size_t l = 0; l < C; ++l)
+	{
+	    const auto	i = _rows[s*C + l];
+	    if (i >= _nrow)
+		continue;
+
+	    for (size_t k = 0, n = R.rowIndex[i]; n < R.rowIndex[i+1]; ++k, ++n)
+	    {
+		_columns[_offsets[s] + k*C + l] = R.columns[n];
+		_values[_offsets[s] + k*C + l]  = R.values[n];
+	    }
+	}
+}
+
+//! 疎行列とベクトルの積を与えられたベクトルに書き込む．
+/*!
+  USE_TBB が定義されていればスライスを分割して並列に計算する．
+  \param x	ベクトル
+  \param y	結果のベクトル
+*/
+template <class T> void
+SlicedEllpackMatrix<T>::multiply(const Vector<T>& x, Vector<T>& y) const
+{
+    if (x.size() != ncol())
+	throw std::invalid_argument("TU::SlicedEllpackMatrix<T>::multiply(): mismatched size!");
+
+    y.resize(nrow());
+#if defined(USE_TBB)
+    tbb::parallel_for(tbb::blocked_range<size_t>(0, nslices()),
+		      [this, &x, &y](const tbb::blocked_range<size_t>& r)
+		      {
+			  multiply(x.data(), y.data(), r.begin(), r.end());
+		      });
+#else
+    multiply(x.data(), y.data(), 0, nslices());
+#endif
+}
+
+//! 指定された範囲のスライスについて疎行列とベクトルの積を求める．
+/*!
+  \param x	ベクトルの先頭
+  \param y	結果のベクトルの先頭
+  \param sb	最初のスライス
+  \param se	最後のスライスの次
+*/
+template <class T> void
+SlicedEllpackMatrix<T>::multiply(const T* x, T* y, size_t sb, size_t se) const
+{
+    for (size_t s = sb; s < se; ++s)
+    {
+	const auto	val = _values.data()  + _offsets[s];
+	const auto	col = _columns.data() + _offsets[s];
+	const auto	w   = (_offsets[s+1] - _offsets[s]) / C;
+#if defined(SIMD)
+	using	namespace simd;
+
+	vec<T>	acc(0);
+	for (size_t k = 0; k < w; ++k)
+	    acc += load(val + k*C) * gather(x, col + k*C);
+
+	T	sum[C];
+	store(sum, acc);
+#else
+	T	sum[C] = {};
+	for (size_t k = 0; k < w; ++k)
+	    for (size_t l = 0; l < C; ++l)
+		sum[l] += val[k*C + l] * x[col[k*C + l]];
+#endif
+	for (size_t l = 0; l < C; ++l)
+	{
+	    const auto	i = _rows[s*C + l];
+	    if (i < _nrow)
+		y[i] = sum[l];
+	}
+    }
+}
+
+#if defined(SIMD)
+//! 与えられた列番号のベクトルの成分を集めてSIMDベクトルにする．
+/*!
+  AVX2 以降では gather 命令を用いる．
+  \param x	ベクトルの先頭
+  \param col	C 個の列番号の先頭
+  \return	集めた成分から成るSIMDベクトル
+*/
+template <class T> inline simd::vec<T>
+SlicedEllpackMatrix<T>::gather(const T* x, const index_type* col)
+{
+#  if defined(AVX2)
+    return simd::lookup(x, simd::load(col));
+#  else
+    T	tmp[C];
+    for (size_t l = 0; l < C; ++l)
+	tmp[l] = x[col[l]];
+    return simd::load(tmp);
+#  endif
+}
+#endif
+
+}
+#endif	// !TU_SLICEDELLPACKMATRIX_H
@@ -6,24 +6,69 @@
 #ifndef TU_SPARSEMATRIXPP_H
 #define TU_SPARSEMATRIXPP_H
 
-#include "TU/Vector++.h"
+#include "TU/BlockDiagonalMatrix++.h"
 #include <vector>
 #include <map>
 #include <algorithm>
 #include <functional>
-#include <mkl_pardiso.h>
+#include <iterator>
+#include <stdexcept>
+#if defined(USE_MKL)
+#  include <mkl_pardiso.h>
+#endif
+#if defined(USE_TBB)
+#  include <tbb/parallel_for.h>
+#  include <tbb/blocked_range.h>
+#  include <tbb/enumerable_thread_specific.h>
+#endif
 
 namespace TU
 {
+template <class T>	class SparseLDL;
+template <class T>	class IncompleteCholeskyPreconditioner;
+template <class T>	class SlicedEllpackMatrix;
+
+namespace detail
+{
+  //! 疎行列の各行の成分を列番号順に並べた表現
+  /*!
+    SparseMatrix の積の計算に用いる．対称行列の下三角部分も陽に保持する．
+  */
+  template <class T, class I>
+  struct SparseRows
+  {
+      size_t		ncol;		//!< 列の数
+      std::vector<I>	rowIndex;	//!< 各行の先頭成分の通し番号
+      std::vector<I>	columns;	//!< 各成分の列番号
+      std::vector<T>	values;		//!< 各成分の値
+  };
+}	// namespace detail
+
 /************************************************************************
 *  class SparseMatrix<T, SYM>						*
 ************************************************************************/
 //! Intel Math-Kernel Library(MKL)のフォーマットによる疎行列
+/*!
+  USE_MKL が定義されていれば solve() は MKL PARDISO を用い，そうでなければ
+  対称行列に限って SparseLDL を用いる．
+*/
 template <class T, bool SYM=false>
 class SparseMatrix
 {
   public:
     using element_type	= T;		//!< 成分の型
+#if defined(USE_TBB)
+  //! multiply() 等がスレッド毎に積を累積するための作業領域
+    using workspace_type = tbb::enumerable_thread_specific<
+				Vector<element_type> >;
+#else
+    struct workspace_type	{};
+#endif
+#if defined(USE_MKL)
+    using index_type	= _INTEGER_t;	//!< 成分の通し番号と列番号の型
+#else
+    using index_type	= int;		//!< 成分の通し番号と列番号の型
+#endif
 
   private:
     template <class S>
@@ -60,6 +105,16 @@ class SparseMatrix
     template <class S, size_t D>
     Vector<element_type>
 			operator  *(const Vector<S, D>& v)	const	;
+    void		multiply(const Vector<element_type>& x,
+				 Vector<element_type>& y)	const	;
+    void		multiply(const Vector<element_type>& x,
+				 Vector<element_type>& y,
+				 workspace_type& ws)		const	;
+    void		multiplyTransposed(const Vector<element_type>& x,
+					   Vector<element_type>& y) const;
+    void		multiplyTransposed(const Vector<element_type>& x,
+					   Vector<element_type>& y,
+					   workspace_type& ws)	const	;
     template <class S, size_t D, class T2, bool SYM2>
     friend Vector<S>	operator  *(const Vector<S, D>& v,
 				    const SparseMatrix<T2, SYM2>& A)	;
@@ -102,22 +157,50 @@ class SparseMatrix
     std::ostream&	put(std::ostream& out)			const	;
     
     friend class SparseMatrix<element_type, !SYM>;
+    friend class SparseLDL<element_type>;
+    friend class IncompleteCholeskyPreconditioner<element_type>;
+    friend class SlicedEllpackMatrix<element_type>;
 
   private:
+    using Rows		= detail::SparseRows<T, index_type>;
+
     template <class OP>
     SparseMatrix	binary_op(const SparseMatrix& B, OP op)	const	;
+    Rows		rows()					const	;
+    Rows		transposed_rows()			const	;
+    Rows		transposed_stored_rows()		const	;
+    static Rows		product(const Rows& A, const Rows& B, bool upper);
     template <bool SYM2>
-    bool		inner_product(const SparseMatrix<T, SYM2>& B,
-				      size_t i, size_t j, T& val) const	;
+    static SparseMatrix<T, SYM2>
+			from_rows(Rows&& R)				;
     int			index(size_t i, size_t j,
 			      bool throwExcept=false)		const	;
+    void		multiply(const Vector<element_type>& x,
+				 Vector<element_type>& y,
+				 size_t ib, size_t ie)		const	;
+    void		multiplyTransposed(const Vector<element_type>& x,
+					   Vector<element_type>& y,
+					   size_t ib, size_t ie) const	;
+#if defined(USE_TBB)
+    static Vector<element_type>&
+			local(workspace_type& ws, size_t n)		;
+#endif
+#if defined(USE_MKL)
     static int		pardiso_precision()				;
+#else
+    Vector<element_type>
+			solve(const Vector<element_type>& b,
+			      std::true_type)			const	;
+    Vector<element_type>
+			solve(const Vector<element_type>& b,
+			      std::false_type)			const	;
+#endif
     static char		skipws(std::istream& in)			;
     
   private:
     size_t			_ncol;		//!< 列の数
-    std::vector<_INTEGER_t>	_rowIndex;	//!< 各行の先頭成分の通し番号
-    std::vector<_INTEGER_t>	_columns;	//!< 各成分の列番号
+    std::vector<index_type>	_rowIndex;	//!< 各行の先頭成分の通し番号
+    std::vector<index_type>	_columns;	//!< 各成分の列番号
     std::vector<element_type>	_values;	//!< 各成分の値
     std::map<size_t,
 	     element_type>	_rowmap;	//!< 1行中の列番号と値の対応表
@@ -432,26 +515,125 @@ SparseMatrix<T, SYM>::operator -(const SparseMatrix& A) const
 template <class T, bool SYM> template <class S, size_t D> Vector<T>
 SparseMatrix<T, SYM>::operator *(const Vector<S, D>& v) const
 {
-    v.check_size(ncol());
-    
-    Vector<T>	a(nrow());
-    for (size_t i = 0; i < nrow(); ++i)
+    const Vector<T>	x(v);
+    Vector<T>		a;
+    multiply(x, a);
+
+    return a;
+}
+
+//! 疎行列とベクトルの積を与えられたベクトルに書き込む．
+/*!
+  \param x	ベクトル
+  \param y	結果のベクトル
+*/
+template <class T, bool SYM> inline void
+SparseMatrix<T, SYM>::multiply(const Vector<T>& x, Vector<T>& y) const
+{
+    workspace_type	ws;
+    multiply(x, y, ws);
+}
+
+//! 与えられた作業領域を用いて疎行列とベクトルの積をベクトルに書き込む．
+/*!
+  USE_TBB が定義されていれば行を分割して並列に計算する．対称行列の場合は
+  上三角部分の各成分を2度(転置側にも)用いるので，スレッド毎に積を累積して
+  最後に足し合わせる．同じ作業領域を繰り返し与えれば，スレッド毎の
+  ベクトルは呼び出し毎に確保されない．
+  \param x	ベクトル
+  \param y	結果のベクトル
+  \param ws	作業領域
+*/
+template <class T, bool SYM> void
+SparseMatrix<T, SYM>::multiply(const Vector<T>& x, Vector<T>& y,
+			       workspace_type& ws) const
+{
+    if (x.size() != ncol())
+	throw std::invalid_argument("TU::SparseMatrix<T, SYM>::multiply(): mismatched size!");
+
+    y.resize(nrow());
+    y = 0;
+#if defined(USE_TBB)
+    if (SYM)
     {
-	if (SYM)
+	for (auto& yl : ws)
 	{
-	    for (size_t j = 0; j < i; ++j)
-	    {
-		const int	n = index(i, j);
-		if (n >= 0)
-		    a[i] += _values[n] * v[j];
-	    }
+	    yl.resize(nrow());
+	    yl = 0;
 	}
-	
-	for (size_t n = _rowIndex[i]; n < _rowIndex[i+1]; ++n)
-	    a[i] += _values[n] * v[_columns[n]];
+	tbb::parallel_for(tbb::blocked_range<size_t>(0, nrow()),
+			  [&](const tbb::blocked_range<size_t>& r)
+			  {
+			      multiply(x, local(ws, nrow()),
+				       r.begin(), r.end());
+			  });
+	for (const auto& yl : ws)
+	    y += yl;
     }
+    else
+	tbb::parallel_for(tbb::blocked_range<size_t>(0, nrow()),
+			  [&](const tbb::blocked_range<size_t>& r)
+			  {
+			      multiply(x, y, r.begin(), r.end());
+			  });
+#else
+    multiply(x, y, 0, nrow());
+#endif
+}
 
-    return a;
+//! 疎行列の転置とベクトルの積を与えられたベクトルに書き込む．
+/*!
+  \param x	ベクトル
+  \param y	結果のベクトル
+*/
+template <class T, bool SYM> inline void
+SparseMatrix<T, SYM>::multiplyTransposed(const Vector<T>& x,
+					 Vector<T>& y) const
+{
+    workspace_type	ws;
+    multiplyTransposed(x, y, ws);
+}
+
+//! 与えられた作業領域を用いて疎行列の転置とベクトルの積をベクトルに書き込む．
+/*!
+  USE_TBB が定義されていれば行を分割して並列に計算し，スレッド毎に累積した
+  積を最後に足し合わせる．
+  \param x	ベクトル
+  \param y	結果のベクトル
+  \param ws	作業領域
+*/
+template <class T, bool SYM> void
+SparseMatrix<T, SYM>::multiplyTransposed(const Vector<T>& x, Vector<T>& y,
+					 workspace_type& ws) const
+{
+    if (SYM)
+    {
+	multiply(x, y, ws);
+	return;
+    }
+
+    if (x.size() != nrow())
+	throw std::invalid_argument("TU::SparseMatrix<T, SYM>::multiplyTransposed(): mismatched size!");
+
+    y.resize(ncol());
+    y = 0;
+#if defined(USE_TBB)
+    for (auto& yl : ws)
+    {
+	yl.resize(ncol());
+	yl = 0;
+    }
+    tbb::parallel_for(tbb::blocked_range<size_t>(0, nrow()),
+		      [&](const tbb::blocked_range<size_t>& r)
+		      {
+			  multiplyTransposed(x, local(ws, ncol()),
+					     r.begin(), r.end());
+		      });
+    for (const auto& yl : ws)
+	y += yl;
+#else
+    multiplyTransposed(x, y, 0, nrow());
+#endif
 }
 
 //! この疎行列に右から自身の転置を掛けた行列を返す．
@@ -461,23 +643,9 @@ SparseMatrix<T, SYM>::operator *(const Vector<S, D>& v) const
 template <class T, bool SYM> SparseMatrix<T, true>
 SparseMatrix<T, SYM>::compose() const
 {
-    SparseMatrix<T, true>	AAt;	// 結果を格納する疎対称行列
-
-    AAt.beginInit();
-    for (size_t i = 0; i < nrow(); ++i)
-    {
-	AAt.setRow();
-	
-	for (size_t j = i; j < nrow(); ++j)
-	{
-	    T	val;
-	    if (inner_product(*this, i, j, val))
-		AAt.setCol(j, val);
-	}
-    }
-    AAt.endInit();
-    
-    return AAt;
+    const auto	A = rows();
+    return from_rows<true>(SYM ? product(A, A, true)
+			       : product(A, transposed_rows(), true));
 }
     
 //! この疎行列に右から与えられた疎対称行列と自身の転置を掛けた行列を返す．
@@ -493,39 +661,8 @@ SparseMatrix<T, SYM>::compose(const SparseMatrix<T, true>& W) const
     if (ncol() != W.nrow())
 	throw std::invalid_argument("TU::SparseMatrix<T, SYM>::compose(): mismatched dimension!");
 
-    SparseMatrix<T, false>	AW;
-    AW.beginInit();
-    for (size_t i = 0; i < nrow(); ++i)
-    {
-	std::cerr << i << '/' << nrow() << std::endl;
-	
-	AW.setRow();
-
-	for (size_t j = 0; j < W.nrow(); ++j)
-	{
-	    T	val;
-	    if (inner_product(W, i, j, val))
-		AW.setCol(j, val);
-	}
-    }
-    AW.endInit();
-
-    SparseMatrix<T, true>	AWAt;
-    AWAt.beginInit();
-    for (size_t i = 0; i < AW.nrow(); ++i)
-    {
-	AWAt.setRow();
-
-	for (size_t j = i; j < nrow(); ++j)
-	{
-	    T	val;
-	    if (AW.inner_product(*this, i, j, val))
-		AWAt.setCol(j, val);
-	}
-    }
-    AWAt.endInit();
-
-    return AWAt;
+    const auto	AW = product(rows(), W.rows(), false);
+    return from_rows<true>(product(AW, transposed_rows(), true));
 }
 
 /*
@@ -696,22 +833,28 @@ SparseMatrix<T, SYM>::apply(size_t i, size_t j, OP op, const Matrix<S, R, C>& M)
  */
 //! この行列を係数とする連立一次方程式を解く．
 /*!
-  MKL direct sparse solverによって
-  \f$\TUvec{A}{}\TUvec{x}{} = \TUvec{b}{}\f$を解く．
+  USE_MKL が定義されていれば MKL direct sparse solverによって，そうでなければ
+  SparseLDL によって\f$\TUvec{A}{}\TUvec{x}{} = \TUvec{b}{}\f$を解く．
+  呼び出し毎に行列の解析からやり直すので，同じ構造の行列について繰り返し
+  解く場合は SparseLDL を直接用いる方が良い．
   \param b			ベクトル
   \return			解ベクトル
-  \throw std::logic_error	この疎行列が正方でない場合に送出
+  \throw std::logic_error	この疎行列が正方でない場合，または USE_MKL が
+				定義されずにこの疎行列が対称でない場合に送出
   \throw std::runtime_error	MKL direct sparse solver がエラーを返した
-				場合に送出
+				場合，または分解に失敗した場合に送出
 */
 template <class T, bool SYM> Vector<T>
 SparseMatrix<T, SYM>::solve(const Vector<T>& b) const
 {
-    b.check_size(ncol());
+    if (b.size() != ncol())
+	throw std::invalid_argument("TU::SparseMatrix<T, SYM>::solve(): mismatched size!");
     
     if (nrow() != ncol())
 	throw std::logic_error("TU::SparseMatrix<T, SYM>::solve(): not a square matrix!");
 
+#if defined(USE_MKL)
+
   // pardiso の各種パラメータを設定する．
     _MKL_DSS_HANDLE_t	pt[64];		// pardisoの内部メモリへのポインタ
     for (int i = 0; i < 64; ++i)
@@ -759,8 +902,29 @@ SparseMatrix<T, SYM>::solve(const Vector<T>& b) const
 	throw std::runtime_error("TU::SparseMatrix<T, SYM>::solve(): PARDISO failed to release memory!");
 
     return x;
+#else
+    return solve(b, std::integral_constant<bool, SYM>());
+#endif
 }
 
+#if !defined(USE_MKL)
+template <class T, bool SYM> Vector<T>
+SparseMatrix<T, SYM>::solve(const Vector<T>& b, std::true_type) const
+{
+    SparseLDL<T>	ldl;
+    ldl.analyze(*this);
+    ldl.factorize(*this);
+    Vector<T>		x(b);
+    return ldl.substitute(x);
+}
+
+template <class T, bool SYM> Vector<T>
+SparseMatrix<T, SYM>::solve(const Vector<T>&, std::false_type) const
+{
+    throw std::logic_error("TU::SparseMatrix<T, SYM>::solve(): non-symmetric matrices require MKL!");
+}
+#endif
+
 /*
  * ----------------------- 有限性のチェック -----------------------------
  */
@@ -868,87 +1032,326 @@ SparseMatrix<T, SYM>::binary_op(const SparseMatrix& B, OP op) const
     if ((nrow() != B.nrow()) || (ncol() != B.ncol()))
 	throw std::invalid_argument("SparseMatrix<T, SYM>::binary_op(): two matrices must have equal sizes!");
 
+  // 第i行について，2つの行列の成分を列番号順に併合して f(列番号, 値) を
+  // 呼び出し，併合された成分数を返す．
+    const auto	merge = [this, &B, op](size_t i, auto f)
+			{
+			    size_t	len = 0;
+			    for (size_t m = _rowIndex[i], n = B._rowIndex[i];
+				 m < _rowIndex[i+1] || n < B._rowIndex[i+1];
+				 ++len)
+			    {
+				const size_t
+				    j = (m <   _rowIndex[i+1] ?
+					   _columns[m] :   ncol()),
+				    k = (n < B._rowIndex[i+1] ?
+					 B._columns[n] : B.ncol());
+				if (j == k)	// 両方が(i, j)成分を持つ
+				    f(j, op(_values[m++], B._values[n++]));
+				else if (j < k)	// この行列のみが持つ
+				    f(j, op(_values[m++], T(0)));
+				else		// B のみが持つ
+				    f(k, op(T(0), B._values[n++]));
+			    }
+			    return len;
+			};
+
+  // 各行の成分数を数えて結果の各行の先頭位置を決める．
     SparseMatrix	S;
+    S._ncol = ncol();
+    S._rowIndex.resize(_rowIndex.size());
+    S._rowIndex[0] = 0;
+    const auto	count = [&](size_t ib, size_t ie)
+			{
+			    for (size_t i = ib; i < ie; ++i)
+				S._rowIndex[i+1]
+				    = merge(i, [](size_t, const T&){});
+			};
+    const auto	fill  = [&](size_t ib, size_t ie)
+			{
+			    for (size_t i = ib; i < ie; ++i)
+			    {
+				auto	n = S._rowIndex[i];
+				merge(i, [&S, &n](size_t j, const T& val)
+					 {
+					     S._columns[n] = j;
+					     S._values[n]  = val;
+					     ++n;
+					 });
+			    }
+			};
+#if defined(USE_TBB)
+    tbb::parallel_for(tbb::blocked_range<size_t>(0, nrow()),
+		      [&count](const tbb::blocked_range<size_t>& r)
+		      { count(r.begin(), r.end()); });
+#else
+    count(0, nrow());
+#endif
+    for (size_t i = 0; i < nrow(); ++i)
+	S._rowIndex[i+1] += S._rowIndex[i];
+
+  // 各行の成分を求める．
+    S._columns.resize(S._rowIndex[nrow()]);
+    S._values.resize(S._rowIndex[nrow()]);
+#if defined(USE_TBB)
+    tbb::parallel_for(tbb::blocked_range<size_t>(0, nrow()),
+		      [&fill](const tbb::blocked_range<size_t>& r)
+		      { fill(r.begin(), r.end()); });
+#else
+    fill(0, nrow());
+#endif
+
+    return S;
+}
+
+//! この疎行列の各行の全成分を返す．
+/*!
+  対称行列の場合は，下三角部分の成分も含める．
+  \return	各行の全成分
+*/
+template <class T, bool SYM> typename SparseMatrix<T, SYM>::Rows
+SparseMatrix<T, SYM>::rows() const
+{
+    if (!SYM)
+	return {ncol(), _rowIndex, _columns, _values};
 
-    S.beginInit();
+  // 対称行列の場合は，上三角部分の転置(の対角成分以外)と上三角部分を併合する．
+    const auto	L = transposed_stored_rows();
+    Rows	R;
+    R.ncol = ncol();
+    R.rowIndex.resize(_rowIndex.size());
+    R.rowIndex[0] = 0;
+    for (size_t i = 0; i < nrow(); ++i)
+	R.rowIndex[i+1] = R.rowIndex[i]
+			+ (L.rowIndex[i+1] - L.rowIndex[i])
+			+ (_rowIndex[i+1] - _rowIndex[i]);
+    R.columns.reserve(R.rowIndex[nrow()]);
+    R.values.reserve(R.rowIndex[nrow()]);
     for (size_t i = 0; i < nrow(); ++i)
     {
-	S.setRow();		// 第i行の先頭成分の通し番号をセット
-	for (size_t m = _rowIndex[i], n = B._rowIndex[i]; ; )
-	{
-	    const size_t	j = (m <   _rowIndex[i+1] ?   _columns[m] :   ncol());
-	    const size_t	k = (n < B._rowIndex[i+1] ? B._columns[n] : B.ncol());
-	    if (j == k)		// 両方の行列が(i, j(=k))成分を持つ？
-	    {
-		if (j == ncol())	// 両方の行列について調べ終えていれば...
-		    break;		// 脱出して次の行を処理
-		S.setCol(j, op(_values[m], B._values[n]));
-		++m;
-		++n;
-	    }
-	    else if (j < k)	// この行列は(i, j)成分を持つが，Bは持たない？
-	    {
-		S.setCol(j, op(_values[m], T(0)));
-		++m;
-	    }
-	    else		// Bは(i, k)成分を持つが，この行列は持たない
+	R.columns.insert(R.columns.end(),
+			 L.columns.begin() + L.rowIndex[i],
+			 L.columns.begin() + L.rowIndex[i+1]);
+	R.values.insert(R.values.end(),
+			L.values.begin() + L.rowIndex[i],
+			L.values.begin() + L.rowIndex[i+1]);
+	R.columns.insert(R.columns.end(),
+			 _columns.begin() + _rowIndex[i],
+			 _columns.begin() + _rowIndex[i+1]);
+	R.values.insert(R.values.end(),
+			_values.begin() + _rowIndex[i],
+			_values.begin() + _rowIndex[i+1]);
+    }
+
+    return R;
+}
+
+//! この疎行列の転置の各行の全成分を返す．
+/*!
+  \return	転置の各行の全成分
+*/
+template <class T, bool SYM> inline typename SparseMatrix<T, SYM>::Rows
+SparseMatrix<T, SYM>::transposed_rows() const
+{
+    return (SYM ? rows() : transposed_stored_rows());
+}
+
+//! この疎行列に保持されている成分の転置の各行を返す．
+/*!
+  対称行列の場合は，上三角部分の転置の対角成分以外，すなわち狭義下三角
+  部分を返す．rows() はこれを用いて全成分を得る．
+  \return	転置の各行の成分
+*/
+template <class T, bool SYM> typename SparseMatrix<T, SYM>::Rows
+SparseMatrix<T, SYM>::transposed_stored_rows() const
+{
+    Rows	R;
+    R.ncol = nrow();
+    R.rowIndex.assign(ncol() + 1, 0);
+    for (size_t i = 0; i < nrow(); ++i)
+	for (size_t n = _rowIndex[i]; n < _rowIndex[i+1]; ++n)
+	    if (!SYM || _columns[n] != index_type(i))
+		++R.rowIndex[_columns[n] + 1];
+    for (size_t j = 0; j < ncol(); ++j)
+	R.rowIndex[j+1] += R.rowIndex[j];
+
+    R.columns.resize(R.rowIndex[ncol()]);
+    R.values.resize(R.rowIndex[ncol()]);
+    std::vector<index_type>	next(R.rowIndex.begin(), R.rowIndex.end() - 1);
+    for (size_t i = 0; i < nrow(); ++i)
+	for (size_t n = _rowIndex[i]; n < _rowIndex[i+1]; ++n)
+	    if (!SYM || _columns[n] != index_type(i))
 	    {
-		S.setCol(k, op(T(0), B._values[n]));
-		++n;
+		const auto	m = next[_columns[n]]++;
+		R.columns[m] = i;
+		R.values[m]  = _values[n];
 	    }
-	}
+
+    return R;
+}
+
+//! 2つの疎行列の積を求める．
+/*!
+  結果の各行は互いに独立に求められるので，USE_TBB が定義されていれば
+  行を分割して並列に計算する．
+  \param A	左側の疎行列の各行の全成分
+  \param B	右側の疎行列の各行の全成分
+  \param upper	trueならば結果の上三角部分のみを求める
+  \return	積の各行の成分
+*/
+template <class T, bool SYM> typename SparseMatrix<T, SYM>::Rows
+SparseMatrix<T, SYM>::product(const Rows& A, const Rows& B, bool upper)
+{
+    const size_t		nrow = A.rowIndex.size() - 1;
+    std::vector<std::vector<index_type> >	columns(nrow);
+    std::vector<std::vector<T> >		values(nrow);
+
+  // 行 ib から ie までの積を，累積用の密なベクトルを用いて求める．
+    const auto	multiply = [&](size_t ib, size_t ie)
+			   {
+			       std::vector<T>		acc(B.ncol, T(0));
+			       std::vector<bool>	used(B.ncol, false);
+			       for (size_t i = ib; i < ie; ++i)
+			       {
+				   auto&	cols = columns[i];
+				   for (auto m = A.rowIndex[i];
+					m < A.rowIndex[i+1]; ++m)
+				   {
+				       const auto	k = A.columns[m];
+				       const auto	a = A.values[m];
+				       for (auto n = B.rowIndex[k];
+					    n < B.rowIndex[k+1]; ++n)
+				       {
+					   const size_t	j = B.columns[n];
+					   if (upper && j < i)
+					       continue;
+					   if (!used[j])
+					   {
+					       used[j] = true;
+					       cols.push_back(j);
+					   }
+					   acc[j] += a * B.values[n];
+				       }
+				   }
+
+				   std::sort(cols.begin(), cols.end());
+				   auto&	vals = values[i];
+				   vals.resize(cols.size());
+				   for (size_t n = 0; n < cols.size(); ++n)
+				   {
+				       const auto	j = cols[n];
+				       vals[n]	= acc[j];
+				       acc[j]	= 0;
+				       used[j]	= false;
+				   }
+			       }
+			   };
+#if defined(USE_TBB)
+    tbb::parallel_for(tbb::blocked_range<size_t>(0, nrow),
+		      [&multiply](const tbb::blocked_range<size_t>& r)
+		      { multiply(r.begin(), r.end()); });
+#else
+    multiply(0, nrow);
+#endif
+
+  // 各行の成分を連結する．
+    Rows	C;
+    C.ncol = B.ncol;
+    C.rowIndex.resize(nrow + 1);
+    C.rowIndex[0] = 0;
+    for (size_t i = 0; i < nrow; ++i)
+	C.rowIndex[i+1] = C.rowIndex[i] + columns[i].size();
+    C.columns.reserve(C.rowIndex[nrow]);
+    C.values.reserve(C.rowIndex[nrow]);
+    for (size_t i = 0; i < nrow; ++i)
+    {
+	C.columns.insert(C.columns.end(), columns[i].begin(), columns[i].end());
+	C.values.insert(C.values.end(), values[i].begin(), values[i].end());
     }
-    S.endInit();
+
+    return C;
+}
+
+//! 各行の成分から疎行列を生成する．
+/*!
+  \param R	各行の成分．SYM2 がtrueならば上三角部分のみを含むこと．
+  \return	疎行列
+*/
+template <class T, bool SYM> template <bool SYM2> SparseMatrix<T, SYM2>
+SparseMatrix<T, SYM>::from_rows(Rows&& R)
+{
+    SparseMatrix<T, SYM2>	S;
+    S._ncol	= R.ncol;
+    S._rowIndex = std::move(R.rowIndex);
+    S._columns  = std::move(R.columns);
+    S._values   = std::move(R.values);
 
     return S;
 }
-    
-//! この疎行列と与えられた疎行列からそれぞれ1行ずつ取り出し，それらの内積を求める．
-/*!
-  \param B			もう1つの疎行列
-  \param i			この疎行列の行番号
-  \param j			B の行番号
-  \param val			この疎行列の第i行と B の第j行の内積の値が
-				返される
-  \return			この疎行列の第i行と B の第j行が列番号を
-				少なくとも1つ共有すればtrue,
-				そうでなければ false
-  \throw std::invalid_argument	この疎行列と B の列数が一致しない場合に送出
-*/
-template <class T, bool SYM> template <bool SYM2> bool
-SparseMatrix<T, SYM>::inner_product(const SparseMatrix<T, SYM2>& B,
-				    size_t i, size_t j, T& val) const
-{
-    if (ncol() != B.ncol())
-	throw std::invalid_argument("inner_product(): mismatched dimension!");
-    
-    bool	exist = false;
-    val = T(0);
 
-    if (SYM)
+//! 指定された範囲の行について疎行列とベクトルの積を累積する．
+/*!
+  対称行列の場合は，上三角部分の各成分による転置側の寄与も累積する．
+  \param x	ベクトル
+  \param y	積を累積するベクトル
+  \param ib	最初の行
+  \param ie	最後の行の次
+*/
+template <class T, bool SYM> inline void
+SparseMatrix<T, SYM>::multiply(const Vector<T>& x, Vector<T>& y,
+			       size_t ib, size_t ie) const
+{
+    for (size_t i = ib; i < ie; ++i)
     {
-	for (size_t col = 0; col < i; ++col)
+	T	yi = 0;
+	for (size_t n = _rowIndex[i]; n < _rowIndex[i+1]; ++n)
 	{
-	    int	m, n;
-	    if ((m = index(i, col)) >= 0 && (n = B.index(j, col)) >= 0)
-	    {
-		exist = true;
-		val += _values[m] * B._values[n];
-	    }
+	    const size_t	j = _columns[n];
+	    yi += _values[n] * x[j];
+	    if (SYM && j != i)
+		y[j] += _values[n] * x[i];
 	}
+	y[i] += yi;
     }
-    for (size_t m = _rowIndex[i]; m < _rowIndex[i+1]; ++m)
+}
+
+//! 指定された範囲の行について疎行列の転置とベクトルの積を累積する．
+/*!
+  \param x	ベクトル
+  \param y	積を累積するベクトル
+  \param ib	最初の行
+  \param ie	最後の行の次
+*/
+template <class T, bool SYM> inline void
+SparseMatrix<T, SYM>::multiplyTransposed(const Vector<T>& x, Vector<T>& y,
+					 size_t ib, size_t ie) const
+{
+    for (size_t i = ib; i < ie; ++i)
+	for (size_t n = _rowIndex[i]; n < _rowIndex[i+1]; ++n)
+	    y[_columns[n]] += _values[n] * x[i];
+}
+
+#if defined(USE_TBB)
+//! 作業領域から呼び出したスレッドのベクトルを取り出す．
+/*!
+  初めて用いるスレッドのベクトルは大きさを n として0に初期化する．
+  \param ws	作業領域
+  \param n	ベクトルの次元
+  \return	スレッドのベクトル
+*/
+template <class T, bool SYM> inline Vector<T>&
+SparseMatrix<T, SYM>::local(workspace_type& ws, size_t n)
+{
+    bool	exists;
+    auto&	yl = ws.local(exists);
+    if (!exists)
     {
-	const int	n = B.index(j, _columns[m]);
-	if (n >= 0)
-	{
-	    exist = true;
-	    val += _values[m] * B._values[n];
-	}
+	yl.resize(n);
+	yl = 0;
     }
-
-    return exist;
+    return yl;
 }
+#endif
 
 //! 指定された行と列における成分の通し番号を返す．
 /*!
@@ -988,6 +1391,7 @@ SparseMatrix<T, SYM>::index(size_t i, size_t j, bool throwExcept) const
     return -1;
 }
 
+#if defined(USE_MKL)
 template<> inline int
 SparseMatrix<float,  false>::pardiso_precision()	{return 1;}
 template<> inline int
@@ -996,6 +1400,7 @@ template<> inline int
 SparseMatrix<double, false>::pardiso_precision()	{return 0;}
 template<> inline int
 SparseMatrix<double, true> ::pardiso_precision()	{return 0;}
+#endif
 
 //! 非空白文字または改行に達するまでストリームを読み進める．
 /*!
@@ -1014,6 +1419,735 @@ SparseMatrix<T, SYM>::skipws(std::istream& in)
     return '\n';		// ファイル終端ならば改行を返す．
 }
 
+/************************************************************************
+*  class SparseLDL<T>							*
+************************************************************************/
+//! 疎対称行列の \f$\TUvec{L}{}\TUvec{D}{}\TUtvec{L}{}\f$ 分解を表すクラス
+/*!
+  行列の非零成分の配置にのみ依存する記号的分解(最小次数順序付けによる
+  行と列の並べ替え，消去木および \f$\TUvec{L}{}\f$ の各列の非零成分数の計算)
+  を analyze() で，成分の値に依存する数値的分解を factorize() で行う．
+  非零成分の配置が同じ行列について繰り返し解く場合は，analyze() を1度だけ
+  呼べば良い．ピボット選択は行わないので，正定値でない行列については
+  分解に失敗することがある．
+  \param T	成分の型
+*/
+template <class T>
+class SparseLDL
+{
+  public:
+    using element_type	= T;		//!< 成分の型
+    using index_type	= typename SparseMatrix<T, true>::index_type;
+
+  //! 行と列の並べ替えの方法
+    enum Ordering
+    {
+	NATURAL,		//!< 並べ替えない
+	MINIMUM_DEGREE		//!< 最小次数順序付け
+    };
+
+  public:
+    SparseLDL()	:_n(0)							{}
+
+    void	analyze(const SparseMatrix<T, true>& A,
+			Ordering ordering=MINIMUM_DEGREE)		;
+    void	factorize(const SparseMatrix<T, true>& A)		;
+    template <class E_> std::enable_if_t<rank<E_>() == 1, E_&>
+		substitute(E_&& b)				const	;
+    template <class E_> std::enable_if_t<rank<E_>() == 2, E_&>
+		substitute(E_&& B)				const	;
+
+  //! 行列の次元を返す．
+  /*!
+    \return	行列の次元
+  */
+    size_t	size()					const	{ return _n; }
+
+  //! \f$\TUvec{L}{}\f$ の狭義下三角部分の非零成分数を返す．
+  /*!
+    \return	\f$\TUvec{L}{}\f$ の狭義下三角部分の非零成分数
+  */
+    size_t	nelements()			const	{ return _Lp[_n]; }
+
+  private:
+    void	minimumDegree(const SparseMatrix<T, true>& A)		;
+
+  private:
+    constexpr static size_t	NONE = ~size_t(0);
+
+    size_t			_n;		//!< 行列の次元
+  // 解析した行列の非零成分の配置
+    std::vector<index_type>	_rowIndex;	//!< 各行の先頭成分の通し番号
+    std::vector<index_type>	_columns;	//!< 各成分の列番号
+    std::vector<size_t>		_P;		//!< k番目に消去する行
+    std::vector<size_t>		_Pinv;		//!< 各行を消去する順番
+  // 並べ替えた行列の上三角部分の列毎の表現
+    std::vector<size_t>		_Cp;		//!< 各列の先頭成分の通し番号
+    std::vector<size_t>		_Ci;		//!< 各成分の行番号
+    std::vector<size_t>		_Cmap;		//!< 各成分の元の行列での通し番号
+  // 消去木と L
+    std::vector<size_t>		_parent;	//!< 消去木における親
+    std::vector<size_t>		_Lp;		//!< Lの各列の先頭成分の通し番号
+    std::vector<size_t>		_Li;		//!< Lの各成分の行番号
+    std::vector<element_type>	_Lx;		//!< Lの各成分の値
+    std::vector<element_type>	_D;		//!< Dの対角成分
+};
+
+//! 疎対称行列の記号的分解を行う．
+/*!
+  \param A			疎対称行列
+  \param ordering		行と列の並べ替えの方法
+*/
+template <class T> void
+SparseLDL<T>::analyze(const SparseMatrix<T, true>& A, Ordering ordering)
+{
+    _n	      = A.nrow();
+    _rowIndex = A._rowIndex;
+    _columns  = A._columns;
+
+  // 行と列の並べ替えを決める．
+    _P.resize(_n);
+    _Pinv.resize(_n);
+    if (ordering == MINIMUM_DEGREE)
+	minimumDegree(A);
+    else
+	for (size_t k = 0; k < _n; ++k)
+	    _P[k] = k;
+    for (size_t k = 0; k < _n; ++k)
+	_Pinv[_P[k]] = k;
+
+  // 並べ替えた行列の上三角部分を列毎に並べる．
+    _Cp.assign(_n + 1, 0);
+    for (size_t i = 0; i < _n; ++i)
+	for (auto m = A._rowIndex[i]; m < A._rowIndex[i+1]; ++m)
+	    ++_Cp[std::max(_Pinv[i], _Pinv[A._columns[m]]) + 1];
+    for (size_t k = 0; k < _n; ++k)
+	_Cp[k+1] += _Cp[k];
+    _Ci.resize(_columns.size());
+    _Cmap.resize(_columns.size());
+    std::vector<size_t>	next(_Cp.begin(), _Cp.end() - 1);
+    for (size_t i = 0; i < _n; ++i)
+	for (auto m = A._rowIndex[i]; m < A._rowIndex[i+1]; ++m)
+	{
+	    const auto	pi = _Pinv[i];
+	    const auto	pj = _Pinv[A._columns[m]];
+	    const auto	n  = next[std::max(pi, pj)]++;
+	    _Ci[n]   = std::min(pi, pj);
+	    _Cmap[n] = m;
+	}
+
+  // 消去木と L の各列の非零成分数を求める．
+    _parent.resize(_n);
+    _Lp.assign(_n + 1, 0);
+    std::vector<size_t>	flag(_n);
+    for (size_t k = 0; k < _n; ++k)
+    {
+	_parent[k] = NONE;
+	flag[k]	   = k;
+	for (size_t n = _Cp[k]; n < _Cp[k+1]; ++n)
+	    for (auto i = _Ci[n]; flag[i] != k; i = _parent[i])
+	    {
+		if (_parent[i] == NONE)
+		    _parent[i] = k;
+		++_Lp[i+1];
+		flag[i] = k;
+	    }
+    }
+    for (size_t k = 0; k < _n; ++k)
+	_Lp[k+1] += _Lp[k];
+
+    _Li.resize(_Lp[_n]);
+    _Lx.resize(_Lp[_n]);
+    _D.resize(_n);
+}
+
+//! 疎対称行列の数値的分解を行う．
+/*!
+  \param A			analyze() に与えたものと同じ非零成分の配置を
+				持つ疎対称行列
+  \throw std::invalid_argument	A の非零成分の配置が analyze() に与えた
+				ものと異なる場合に送出
+  \throw std::runtime_error	ピボットが0になった場合に送出
+*/
+template <class T> void
+SparseLDL<T>::factorize(const SparseMatrix<T, true>& A)
+{
+    if (A._rowIndex != _rowIndex || A._columns != _columns)
+	throw std::invalid_argument("TU::SparseLDL<T>::factorize(): structure of the matrix differs from the analyzed one!");
+
+    std::vector<element_type>	y(_n, 0);
+    std::vector<size_t>		flag(_n), pattern(_n), nz(_n, 0);
+
+    for (size_t k = 0; k < _n; ++k)
+    {
+      // 第k列の非零成分を y に展開し，L の第k行の非零パターンを消去木を
+      // 辿って求める．
+	auto	top = _n;
+	flag[k] = k;
+	for (size_t n = _Cp[k]; n < _Cp[k+1]; ++n)
+	{
+	    auto	i = _Ci[n];
+	    y[i] += A._values[_Cmap[n]];
+
+	    size_t	len = 0;
+	    for (; flag[i] != k; i = _parent[i])
+	    {
+		pattern[len++] = i;
+		flag[i]	       = k;
+	    }
+	    while (len > 0)
+		pattern[--top] = pattern[--len];
+	}
+
+      // L の第k行と D の第k成分を求める．
+	_D[k] = y[k];
+	y[k]  = 0;
+	for (; top < _n; ++top)
+	{
+	    const auto	i  = pattern[top];
+	    const auto	yi = y[i];
+	    y[i] = 0;
+
+	    const auto	ne = _Lp[i] + nz[i];
+	    for (auto n = _Lp[i]; n < ne; ++n)
+		y[_Li[n]] -= _Lx[n] * yi;
+
+	    const auto	lki = yi / _D[i];
+	    _D[k]  -= lki * yi;
+	    _Li[ne] = k;
+	    _Lx[ne] = lki;
+	    ++nz[i];
+	}
+
+	if (_D[k] == element_type(0))
+	    throw std::runtime_error("TU::SparseLDL<T>::factorize(): zero pivot!");
+    }
+}
+
+//! 分解された行列を係数とする連立一次方程式を解く．
+/*!
+  \param b	右辺のベクトル．解ベクトルに置き換えられる．
+  \return	\f$\TUvec{A}{}\TUvec{x}{} = \TUvec{b}{}\f$ の解ベクトル
+*/
+template <class T> template <class E_>
+std::enable_if_t<rank<E_>() == 1, E_&>
+SparseLDL<T>::substitute(E_&& b) const
+{
+    if (b.size() != _n)
+	throw std::invalid_argument("TU::SparseLDL<T>::substitute(): mismatched size!");
+
+    std::vector<element_type>	x(_n);
+    for (size_t k = 0; k < _n; ++k)
+	x[k] = b[_P[k]];
+
+    for (size_t j = 0; j < _n; ++j)		// L によるforward substitution
+	for (auto n = _Lp[j]; n < _Lp[j+1]; ++n)
+	    x[_Li[n]] -= _Lx[n] * x[j];
+    for (size_t j = 0; j < _n; ++j)
+	x[j] /= _D[j];
+    for (size_t j = _n; j-- > 0; )		// Lt によるbackward substitution
+	for (auto n = _Lp[j]; n < _Lp[j+1]; ++n)
+	    x[j] -= _Lx[n] * x[_Li[n]];
+
+    for (size_t k = 0; k < _n; ++k)
+	b[_P[k]] = x[k];
+
+    return b;
+}
+
+//! 分解された行列を係数とする複数の連立一次方程式を解く．
+/*!
+  \param B	各行を右辺のベクトルとする行列．各行が解ベクトルに
+		置き換えられる．
+  \return	各行を\f$\TUvec{A}{}\TUvec{x}{} = \TUvec{b}{}\f$ の解
+		ベクトルとする行列
+*/
+template <class T> template <class E_>
+std::enable_if_t<rank<E_>() == 2, E_&>
+SparseLDL<T>::substitute(E_&& B) const
+{
+    for (auto&& b : B)
+	substitute(b);
+
+    return B;
+}
+
+//! 最小次数順序付けによって行と列の並べ替えを決める．
+/*!
+  消去グラフを陽に作らず，未消去の節点(変数)と消去済みの節点(要素)から
+  成る商グラフ上で消去を進める(AMD法)．消去した変数はそれに隣接する
+  要素を吸収して新たな要素となるので，記憶量は元の行列の非零成分数の
+  程度に抑えられる．各変数の次数は要素間の重なりから求めた上界(近似外部次数)で
+  代用し，次数毎の連結リストから次数最小の変数を取り出す．
+  \param A	疎対称行列
+*/
+template <class T> void
+SparseLDL<T>::minimumDegree(const SparseMatrix<T, true>& A)
+{
+    std::vector<std::vector<size_t> >	vars(_n);  // 各変数に隣接する変数
+    std::vector<std::vector<size_t> >	elems(_n); // 各変数に隣接する要素
+    std::vector<std::vector<size_t> >	Le(_n);	   // 各要素に隣接する変数
+    for (size_t i = 0; i < _n; ++i)
+	for (auto m = A._rowIndex[i]; m < A._rowIndex[i+1]; ++m)
+	{
+	    const size_t	j = A._columns[m];
+	    if (j != i)
+	    {
+		vars[i].push_back(j);
+		vars[j].push_back(i);
+	    }
+	}
+
+  // 次数毎の双方向連結リスト
+    std::vector<size_t>	degree(_n), head(_n, NONE), next(_n), prev(_n);
+    const auto		insert = [&](size_t i)
+			{
+			    const auto	d = degree[i];
+			    prev[i] = NONE;
+			    next[i] = head[d];
+			    if (next[i] != NONE)
+				prev[next[i]] = i;
+			    head[d] = i;
+			};
+    const auto		remove = [&](size_t i)
+			{
+			    if (prev[i] != NONE)
+				next[prev[i]] = next[i];
+			    else
+				head[degree[i]] = next[i];
+			    if (next[i] != NONE)
+				prev[next[i]] = prev[i];
+			};
+
+    for (size_t i = 0; i < _n; ++i)
+    {
+	std::sort(vars[i].begin(), vars[i].end());
+	vars[i].erase(std::unique(vars[i].begin(), vars[i].end()),
+		      vars[i].end());
+	degree[i] = vars[i].size();
+	insert(i);
+    }
+
+    enum {VARIABLE, ELEMENT, ABSORBED};
+    std::vector<char>	status(_n, VARIABLE);
+    std::vector<size_t>	mark(_n, NONE);	// Lp に属する変数の印
+    std::vector<size_t>	wmark(_n, NONE), w(_n);	// |Le \ Lp|
+    size_t		mindeg = 0;
+    for (size_t k = 0; k < _n; ++k)
+    {
+      // 次数最小の変数 p を取り出す．
+	while (head[mindeg] == NONE)
+	    ++mindeg;
+	const auto	p = head[mindeg];
+	remove(p);
+	_P[k] = p;
+
+      // p に隣接する変数と p に隣接する要素の変数を集めて Lp を作り，
+      // それらの要素を p に吸収する．
+	auto&	Lp = Le[p];
+	mark[p] = k;
+	for (const auto j : vars[p])
+	    if (status[j] == VARIABLE && mark[j] != k)
+	    {
+		mark[j] = k;
+		Lp.push_back(j);
+	    }
+	for (const auto e : elems[p])
+	    if (status[e] == ELEMENT)
+	    {
+		for (const auto j : Le[e])
+		    if (mark[j] != k)
+		    {
+			mark[j] = k;
+			Lp.push_back(j);
+		    }
+		status[e] = ABSORBED;
+		std::vector<size_t>().swap(Le[e]);
+	    }
+	status[p] = ELEMENT;
+	std::vector<size_t>().swap(vars[p]);
+	std::vector<size_t>().swap(elems[p]);
+
+      // Lp 以外の要素について Lp に含まれない変数の数を数える．
+	for (const auto i : Lp)
+	    for (const auto e : elems[i])
+		if (status[e] == ELEMENT)
+		{
+		    if (wmark[e] != k)
+		    {
+			wmark[e] = k;
+			w[e]	 = Le[e].size();
+		    }
+		    --w[e];
+		}
+
+      // Lp の各変数の隣接関係を刈り込み，次数を更新する．
+	const auto	nLp = Lp.size();
+	for (const auto i : Lp)
+	{
+	    remove(i);
+
+	    size_t	d = nLp - 1;
+	    size_t	n = 0;
+	    for (const auto e : elems[i])
+		if (status[e] == ELEMENT)
+		{
+		    if (w[e] == 0)		// Le が Lp に含まれるならば
+		    {
+			status[e] = ABSORBED;	// p に吸収する．
+			std::vector<size_t>().swap(Le[e]);
+		    }
+		    else
+		    {
+			d += w[e];
+			elems[i][n++] = e;
+		    }
+		}
+	    elems[i].resize(n);
+	    elems[i].push_back(p);
+
+	    n = 0;
+	    for (const auto j : vars[i])
+		if (status[j] == VARIABLE && mark[j] != k)
+		{
+		    ++d;
+		    vars[i][n++] = j;
+		}
+	    vars[i].resize(n);
+
+	    degree[i] = std::min({d, degree[i] + nLp - 1, _n - k - 2});
+	    insert(i);
+	    mindeg = std::min(mindeg, degree[i]);
+	}
+    }
+}
+
+/************************************************************************
+*  class JacobiPreconditioner<T>					*
+************************************************************************/
+//! 疎対称行列の対角成分による前処理を表すクラス
+/*!
+  solveCG() に与える前処理であり，残差を対角成分で割る．
+  \param T	成分の型
+*/
+template <class T>
+class JacobiPreconditioner
+{
+  public:
+    using element_type	= T;		//!< 成分の型
+
+  public:
+    JacobiPreconditioner(const SparseMatrix<T, true>& A)		;
+
+    void	operator ()(const Vector<T>& r, Vector<T>& z)	const	;
+
+  private:
+    Vector<T>	_dinv;		//!< 対角成分の逆数
+};
+
+//! 疎対称行列の対角成分から前処理を生成する．
+/*!
+  \param A			疎対称行列
+  \throw std::invalid_argument	対角成分に0があれば送出
+*/
+template <class T>
+JacobiPreconditioner<T>::JacobiPreconditioner(const SparseMatrix<T, true>& A)
+    :_dinv(A.nrow())
+{
+    for (size_t i = 0; i < _dinv.size(); ++i)
+    {
+	const auto	d = A(i, i);
+	if (d == T(0))
+	    throw std::invalid_argument("TU::JacobiPreconditioner<T>::JacobiPreconditioner(): zero diagonal element!");
+	_dinv[i] = T(1) / d;
+    }
+}
+
+//! 残差に前処理を施す．
+/*!
+  \param r	残差
+  \param z	前処理を施した残差
+*/
+template <class T> inline void
+JacobiPreconditioner<T>::operator ()(const Vector<T>& r, Vector<T>& z) const
+{
+    z.resize(r.size());
+    for (size_t i = 0; i < z.size(); ++i)
+	z[i] = _dinv[i] * r[i];
+}
+
+/************************************************************************
+*  class BlockJacobiPreconditioner<T>					*
+************************************************************************/
+//! 疎対称行列の対角ブロックによる前処理を表すクラス
+/*!
+  solveCG() に与える前処理であり，残差に対角ブロックの逆行列を掛ける．
+  バンドル調整におけるカメラや3次元点のように，未知数が小さなブロックに
+  分かれている場合に有効である．
+  \param T	成分の型
+*/
+template <class T>
+class BlockJacobiPreconditioner
+{
+  public:
+    using element_type	= T;		//!< 成分の型
+
+  public:
+    BlockJacobiPreconditioner(const SparseMatrix<T, true>& A,
+			      const Array<size_t>& dims)		;
+
+    void	operator ()(const Vector<T>& r, Vector<T>& z)	const	;
+
+  private:
+    BlockDiagonalMatrix<T>	_Binv;	//!< 対角ブロックの逆行列
+};
+
+//! 疎対称行列の対角ブロックから前処理を生成する．
+/*!
+  \param A			疎対称行列
+  \param dims			各対角ブロックの次元を順に収めた配列
+  \throw std::invalid_argument	dims の要素の総和が A の次元と一致しなければ
+				送出
+*/
+template <class T>
+BlockJacobiPreconditioner<T>::BlockJacobiPreconditioner(
+    const SparseMatrix<T, true>& A, const Array<size_t>& dims)
+    :_Binv(dims, dims)
+{
+    if (_Binv.nrow() != A.nrow())
+	throw std::invalid_argument("TU::BlockJacobiPreconditioner<T>::BlockJacobiPreconditioner(): mismatched dimension!");
+
+    for (size_t k = 0, b = 0; b < _Binv.size(); ++b)
+    {
+	auto&	B = _Binv[b];
+	for (size_t i = 0; i < B.nrow(); ++i)
+	    for (size_t j = 0; j < B.ncol(); ++j)
+		B[i][j] = A(k + i, k + j);
+	B  = inverse(B);
+	k += B.nrow();
+    }
+}
+
+//! 残差に前処理を施す．
+/*!
+  \param r	残差
+  \param z	前処理を施した残差
+*/
+template <class T> void
+BlockJacobiPreconditioner<T>::operator ()(const Vector<T>& r,
+					  Vector<T>& z) const
+{
+    z.resize(r.size());
+    for (size_t k = 0, b = 0; b < _Binv.size(); ++b)
+    {
+	const auto&	B = _Binv[b];
+	z(k, B.nrow()) = B * r(k, B.ncol());
+	k += B.nrow();
+    }
+}
+
+/************************************************************************
+*  class IncompleteCholeskyPreconditioner<T>				*
+************************************************************************/
+//! 疎対称行列の不完全Cholesky分解による前処理を表すクラス
+/*!
+  solveCG() に与える前処理であり，もとの行列と同じ非零成分の配置を持つ
+  上三角行列 \f$\TUvec{U}{}\f$ を用いて \f$\TUtvec{U}{}\TUvec{U}{}\f$ に
+  関する連立一次方程式を解く(IC(0))．分解が破綻した場合は，対角成分を
+  少しずつ大きくして分解をやり直す．
+  \param T	成分の型
+*/
+template <class T>
+class IncompleteCholeskyPreconditioner
+{
+  public:
+    using element_type	= T;		//!< 成分の型
+
+  public:
+    IncompleteCholeskyPreconditioner(const SparseMatrix<T, true>& A)	;
+
+    void	operator ()(const Vector<T>& r, Vector<T>& z)	const	;
+
+  //! 分解の破綻を避けるために対角成分に掛けた倍率から1を引いた値を返す．
+  /*!
+    \return	対角成分に掛けた倍率から1を引いた値
+  */
+    T		shift()					const	{ return _shift; }
+
+  private:
+    constexpr static size_t	NSHIFTS_MAX = 30;	//!< 分解の最大やり直し回数
+
+    bool	factorize(const SparseMatrix<T, true>& A)		;
+
+  private:
+    SparseMatrix<T, true>	_U;	//!< 不完全Cholesky因子
+    T				_shift;	//!< 対角成分に掛けた倍率 - 1
+};
+
+//! 疎対称行列の不完全Cholesky分解から前処理を生成する．
+/*!
+  分解が破綻すれば対角成分の倍率を1.001から始めて1を引いた値を倍々に
+  大きくしながら最大 NSHIFTS_MAX 回まで分解をやり直す．
+  \param A			疎対称行列．各行の先頭成分は対角成分で
+				なければならない．
+  \throw std::runtime_error	A が非有限な成分を含むなどして分解が
+				成功しなければ送出
+*/
+template <class T>
+IncompleteCholeskyPreconditioner<T>::IncompleteCholeskyPreconditioner(
+    const SparseMatrix<T, true>& A)
+    :_U(A), _shift(0)
+{
+    for (size_t n = 0; !factorize(A); ++n)
+    {
+	if (n == NSHIFTS_MAX)
+	    throw std::runtime_error("TU::IncompleteCholeskyPreconditioner<T>::IncompleteCholeskyPreconditioner(): failed to factorize!");
+	_shift = (_shift == T(0) ? T(1.0e-3) : 2 * _shift);
+    }
+}
+
+//! 残差に前処理を施す．
+/*!
+  \param r	残差
+  \param z	前処理を施した残差
+*/
+template <class T> void
+IncompleteCholeskyPreconditioner<T>::operator ()(const Vector<T>& r,
+						 Vector<T>& z) const
+{
+    const auto&	rowIndex = _U._rowIndex;
+    const auto&	columns  = _U._columns;
+    const auto&	values   = _U._values;
+    const auto	n	 = _U.nrow();
+
+  // Ut によるforward substitution
+    z = r;
+    for (size_t i = 0; i < n; ++i)
+    {
+	const auto	zi = (z[i] /= values[rowIndex[i]]);
+	for (size_t m = rowIndex[i] + 1; m < rowIndex[i+1]; ++m)
+	    z[columns[m]] -= values[m] * zi;
+    }
+
+  // U によるbackward substitution
+    for (size_t i = n; i-- > 0; )
+    {
+	T	zi = z[i];
+	for (size_t m = rowIndex[i] + 1; m < rowIndex[i+1]; ++m)
+	    zi -= values[m] * z[columns[m]];
+	z[i] = zi / values[rowIndex[i]];
+    }
+}
+
+//! 対角成分に現在の倍率を掛けて不完全Cholesky分解を行う．
+/*!
+  \param A	疎対称行列
+  \return	分解に成功すればtrue, 破綻すればfalse
+*/
+template <class T> bool
+IncompleteCholeskyPreconditioner<T>::factorize(const SparseMatrix<T, true>& A)
+{
+    const auto&	rowIndex = _U._rowIndex;
+    const auto&	columns  = _U._columns;
+    auto&	values   = _U._values;
+
+    values = A._values;
+    for (size_t i = 0; i < _U.nrow(); ++i)
+	values[rowIndex[i]] *= (1 + _shift);
+
+    for (size_t i = 0; i < _U.nrow(); ++i)
+    {
+	const auto	d = values[rowIndex[i]];
+	if (!(d > T(0)))
+	    return false;
+
+	const auto	sqrtd = std::sqrt(d);
+	values[rowIndex[i]] = sqrtd;
+	for (size_t m = rowIndex[i] + 1; m < rowIndex[i+1]; ++m)
+	    values[m] /= sqrtd;
+
+      // 第i行の非対角成分の外積を，非零成分の配置の範囲で後続の行から引く．
+	for (size_t m = rowIndex[i] + 1; m < rowIndex[i+1]; ++m)
+	{
+	    const size_t	j = columns[m];
+	    for (size_t l = m; l < rowIndex[i+1]; ++l)
+	    {
+		const int	n = _U.index(j, columns[l]);
+		if (n >= 0)
+		    values[n] -= values[m] * values[l];
+	    }
+	}
+    }
+
+    return true;
+}
+
+/************************************************************************
+*  function solveCG							*
+************************************************************************/
+//! 前処理付き共役勾配法によって疎対称行列を係数とする連立一次方程式を解く．
+/*!
+  係数行列は正定値でなければならない．作業領域は数本のベクトルのみで
+  あるので，直接法では分解の非零成分が多すぎて解けない大規模な問題にも
+  適用できる．
+  \param A			正定値な疎対称行列
+  \param b			右辺のベクトル
+  \param x			解の初期値を与えると解ベクトルが返される．
+				サイズが A の次元と異なれば0ベクトルから始める．
+  \param precond		前処理．残差 r を与えると前処理を施した残差
+				z を返す precond(r, z) なる呼び出しが
+				できること．
+  \param tol			収束判定条件を表す閾値(残差のノルムが b の
+				ノルムのこの値倍以下になれば収束と見なす)
+  \param niter_max		最大繰り返し回数(0ならば A の次元)
+  \return			繰り返し回数
+  \throw std::runtime_error	最大繰り返し回数以内に収束しなければ送出
+*/
+template <class T, class PRECOND> size_t
+solveCG(const SparseMatrix<T, true>& A, const Vector<T>& b, Vector<T>& x,
+	const PRECOND& precond, T tol=1.0e-8, size_t niter_max=0)
+{
+    const auto	n = A.nrow();
+    if (b.size() != n)
+	throw std::invalid_argument("TU::solveCG(): mismatched size!");
+    if (x.size() != n)
+    {
+	x.resize(n);
+	x = 0;
+    }
+    if (niter_max == 0)
+	niter_max = n;
+
+    Vector<T>	r, z, q;
+    typename SparseMatrix<T, true>::workspace_type	ws;
+    A.multiply(x, q, ws);
+    r = b - q;
+    precond(r, z);
+    Vector<T>	p(z);
+    T		rz   = r * z;
+    const T	bmax = tol * length(b);
+
+    for (size_t niter = 0; niter < niter_max; ++niter)
+    {
+	if (length(r) <= bmax)
+	    return niter;
+
+	A.multiply(p, q, ws);
+	const T	alpha = rz / (p * q);
+	x += alpha * p;
+	r -= alpha * q;
+
+	precond(r, z);
+	const T	rz_new = r * z;
+	p  = z + (rz_new / rz) * p;
+	rz = rz_new;
+    }
+
+    if (length(r) <= bmax)
+	return niter_max;
+    throw std::runtime_error("TU::solveCG(): maximum iteration limit exceeded!");
+}
+
 /************************************************************************
 *  global functions							*
 ************************************************************************/
@@ -1026,25 +2160,11 @@ SparseMatrix<T, SYM>::skipws(std::istream& in)
 template <class S, size_t D, class T2, bool SYM2> Vector<S>
 operator *(const Vector<S, D>& v, const SparseMatrix<T2, SYM2>& A)
 {
-    v.check_size(A.nrow());
-    
-    Vector<S>	a(A.ncol());
-    for (size_t j = 0; j < A.ncol(); ++j)
-    {
-	for (size_t i = 0; i < (SYM2 ? j : A.nrow()); ++i)
-	{
-	    const int	n = A.index(i, j);
-	    if (n >= 0)
-		a[j] += v[i] * A._values[n];
-	}
-	if (SYM2)
-	{
-	    for (size_t n = A._rowIndex[j]; n < A._rowIndex[j+1]; ++n)
-		a[j] += v[A._columns[n]] * A._values[n];
-	}
-    }
+    const Vector<T2>	x(v);
+    Vector<T2>		a;
+    A.multiplyTransposed(x, a);
 
-    return a;
+    return Vector<S>(a);
 }
 
 //! 入力ストリームから疎行列を読み込む(ASCII)．
@@ -7,16 +7,16 @@
 #define TU_STEREOBASE_H
 
 #include <limits>		// Use std::numeric_limits<T>.
-#include <stack>
+#include <vector>
 #include <tbb/blocked_range.h>
 #if defined(USE_TBB)
 #  include <tbb/parallel_for.h>
-#  include <tbb/spin_mutex.h>
 #  include <tbb/scalable_allocator.h>
 #endif
 
 #include "TU/simd/Array++.h"
 #include "TU/Profiler.h"
+#include "TU/Pool.h"
 
 #if defined(PROFILE) && !defined(USE_TBB)
 #  define ENABLE_PROFILER
@@ -479,13 +479,22 @@ template <class STEREO>
 class StereoBase : public Profiler<ENABLE_PROFILER>
 {
   public:
+  //! サブピクセル精度の視差を求めるための評価値の当てはめ方法
+    enum SubpixelFitting
+    {
+	NO_FITTING,		//!< 当てはめない(整数視差)
+	EQUIANGULAR,		//!< 等角直線当てはめ
+	PARABOLA		//!< 放物線当てはめ
+    };
+
   //! ステレオ対応探索の各種パラメータを収めるクラス．
     struct Parameters
     {
 	Parameters()
 	    :doHorizontalBackMatch(true), doVerticalBackMatch(true),
 	     disparitySearchWidth(64), disparityMax(64),
-	     disparityInconsistency(2), grainSize(100)			{}
+	     disparityInconsistency(2), grainSize(100),
+	     subpixelFitting(EQUIANGULAR)				{}
 
       //! 視差の最小値を返す．
 	size_t		disparityMin() const
@@ -521,47 +530,8 @@ class StereoBase : public Profiler<ENABLE_PROFILER>
 	size_t	disparityMax;		//!< 視差の最大値
 	size_t	disparityInconsistency;	//!< 最適視差の不一致の許容値
 	size_t	grainSize;		//!< 並列処理の粒度
-    };
-
-  protected:
-    template <class T>
-    class Pool
-    {
-      public:
-		~Pool()
-		{
-		    while (!_values.empty())
-		    {
-			T*	value = _values.top();
-			_values.pop();
-			delete value;
-		    }
-		}
-    
-	T*	get()
-		{
-#if defined(USE_TBB)
-		    tbb::spin_mutex::scoped_lock	lock(_mutex);
-#endif
-		    if (_values.empty())
-			_values.push(new T);
-		    T*	value = _values.top();
-		    _values.pop();
-		    return value;
-		}
-	void	put(T* value)
-		{
-#if defined(USE_TBB)
-		    tbb::spin_mutex::scoped_lock	lock(_mutex);
-#endif
-		    _values.push(value);
-		}
-    
-      private:
-	std::stack<T*>	_values;
-#if defined(USE_TBB)
-	tbb::spin_mutex	_mutex;
-#endif
+	SubpixelFitting
+		subpixelFitting;	//!< 視差が実数の場合の当てはめ方法
     };
 
   private:
@@ -670,10 +640,24 @@ class StereoBase : public Profiler<ENABLE_PROFILER>
     template <class DMIN, class DELTA, class COL_D>
     void	selectDisparities(DMIN dminL, DMIN dminLe, DMIN dminR,
 				  DELTA delta, COL_D colD)	const	;
+    template <class DMIN, class COL_D>
+    void	selectDisparities(DMIN dminL, DMIN dminLe, DMIN dminR,
+				  const float* dRprev, const float* dRnext,
+				  float* delta, COL_D colD)	const	;
+    template <class ITER>
+    static void	setScoreIncrements(ITER R, size_t dL, size_t D,
+				   float& dRprev, float& dRnext)	;
     template <class DMINV, class COL_D>
     void	pruneDisparities(DMINV dminV,
 				 DMINV dminVe, COL_D colD)	const	;
 
+  private:
+    void	fitSubpixel(const float* dRprev, const float* dRnext,
+			    float* delta, size_t n,
+			    std::true_type)			const	;
+    void	fitSubpixel(const float*, const float*,
+			    float*, size_t, std::false_type)	const	{}
+
   private:
     STEREO&	_stereo;
 };
@@ -730,6 +714,108 @@ StereoBase<STEREO>::selectDisparities(DMIN dminL, DMIN dminLe, DMIN dminR,
 			   params.disparityMax, params.disparityInconsistency));
 }
 
+//! 評価値の当てはめによるサブピクセル補間と右画像からの逆方向視差探索を行う
+/*!
+  視差が実数型であれば，左画像から見た最適視差 dL の前後の視差における
+  評価値の増分 dRprev, dRnext から補正量 delta をSIMD命令によって一括して
+  求める．視差が整数型であれば delta は使われない．
+  \param dminL		左画像から見た各画素の最適視差の先頭
+  \param dminLe		左画像から見た各画素の最適視差の末尾の次
+  \param dminR		右画像から見た各画素の最適視差の先頭
+  \param dRprev		視差 dL - 1 における評価値の増分
+  \param dRnext		視差 dL + 1 における評価値の増分
+  \param delta		視差の補正量を書き込む作業領域
+  \param colD		視差の出力先
+*/
+template <class STEREO> template <class DMIN, class COL_D> inline void
+StereoBase<STEREO>::selectDisparities(DMIN dminL, DMIN dminLe, DMIN dminR,
+				      const float* dRprev, const float* dRnext,
+				      float* delta, COL_D colD) const
+{
+    using DISP	= typename std::iterator_traits<COL_D>::value_type;
+
+    fitSubpixel(dRprev, dRnext, delta, std::distance(dminL, dminLe),
+		std::is_floating_point<DISP>());
+    selectDisparities(dminL, dminLe, dminR, delta, colD);
+}
+
+//! 最適視差 dL の前後の視差における評価値の増分を求める．
+/*!
+  dL が探索範囲の端にある場合は共に0とし，補正を行わない．
+  \param R		各視差における評価値
+  \param dL		最小評価値を与える視差
+  \param D		視差の探索幅
+  \param dRprev		R[dL-1] - R[dL] を返す
+  \param dRnext		R[dL+1] - R[dL] を返す
+*/
+template <class STEREO> template <class ITER> inline void
+StereoBase<STEREO>::setScoreIncrements(ITER R, size_t dL, size_t D,
+				       float& dRprev, float& dRnext)
+{
+    if (dL == 0 || dL == D - 1)
+	dRprev = dRnext = 0;
+    else
+    {
+	dRprev = float(R[dL-1] - R[dL]);
+	dRnext = float(R[dL+1] - R[dL]);
+    }
+}
+
+//! 評価値の増分から視差の補正量を求める．
+/*!
+  等角直線当てはめでは 0.5*(dRprev - dRnext)/(max(dRprev, dRnext) + 1) を，
+  放物線当てはめでは 0.5*(dRprev - dRnext)/(dRprev + dRnext) を求める．
+*/
+template <class STEREO> void
+StereoBase<STEREO>::fitSubpixel(const float* dRprev, const float* dRnext,
+				float* delta, size_t n, std::true_type) const
+{
+    const auto	fitting = _stereo.getParameters().subpixelFitting;
+    size_t	i = 0;
+
+    if (fitting == NO_FITTING)
+    {
+	std::fill_n(delta, n, 0.0f);
+	return;
+    }
+#if defined(SIMD)
+    using fvec_t	= simd::vec<float>;
+
+    const fvec_t	half(0.5f);
+    if (fitting == PARABOLA)
+    {
+	const fvec_t	eps(std::numeric_limits<float>::min());
+	for (; i + fvec_t::size <= n; i += fvec_t::size)
+	{
+	    const auto	p = simd::load<false>(dRprev + i);
+	    const auto	q = simd::load<false>(dRnext + i);
+	    simd::store<false>(delta + i,
+			       half * (p - q) / simd::max(p + q, eps));
+	}
+    }
+    else
+    {
+	const fvec_t	one(1.0f);
+	for (; i + fvec_t::size <= n; i += fvec_t::size)
+	{
+	    const auto	p = simd::load<false>(dRprev + i);
+	    const auto	q = simd::load<false>(dRnext + i);
+	    simd::store<false>(delta + i,
+			       half * (p - q) / (simd::max(p, q) + one));
+	}
+    }
+#endif
+    if (fitting == PARABOLA)
+	for (; i < n; ++i)
+	    delta[i] = 0.5f * (dRprev[i] - dRnext[i])
+		     / std::max(dRprev[i] + dRnext[i],
+				std::numeric_limits<float>::min());
+    else
+	for (; i < n; ++i)
+	    delta[i] = 0.5f * (dRprev[i] - dRnext[i])
+		     / (std::max(dRprev[i], dRnext[i]) + 1.0f);
+}
+
 //! 上画像からの逆方向視差探索を行う
 template <class STEREO> template <class DMINV, class COL_D> void
 StereoBase<STEREO>::pruneDisparities(DMINV dminV,
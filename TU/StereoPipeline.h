@@ -0,0 +1,200 @@
+/*!
+  \file		StereoPipeline.h
+  \author	Toshio UESHIBA
+  \brief	クラス TU::StereoPipeline の定義と実装
+*/
+#ifndef TU_STEREOPIPELINE_H
+#define TU_STEREOPIPELINE_H
+
+#include <utility>		// Use std::as_const().
+#include <vector>
+#include "TU/Rectify.h"
+#include "TU/StereoBase.h"
+#if defined(USE_TBB)
+#  include <tbb/parallel_pipeline.h>
+#endif
+
+namespace TU
+{
+/************************************************************************
+*  class StereoPipeline<STEREO, T, DISP>				*
+************************************************************************/
+//! 平行化，ステレオマッチング，視差の後処理をフレーム単位でパイプライン化するクラス
+/*!
+  連続して入力されるフレームに対し，あるフレームのマッチングと後続フレームの
+  平行化や先行フレームの後処理を並行して実行する．ステージ間で受け渡される
+  フレームは，予め確保された高々 nframes() 個の作業領域を循環的に再利用する
+  ので，処理中に画像領域が新たに確保されることはない．USE_TBB が定義されて
+  いなければ，各フレームを逐次的に処理する．
+  \param STEREO	ステレオマッチングクラス(SADStereo, GFStereo)
+  \param T	入力画像の画素の型
+  \param DISP	視差画像の画素の型
+*/
+template <class STEREO, class T, class DISP=float>
+class StereoPipeline
+{
+  public:
+    using stereo_type	 = STEREO;
+    using image_type	 = Image<T>;
+    using disparity_type = Image<DISP>;
+
+  private:
+    struct Frame
+    {
+	image_type	images[3];		// 入力画像
+	image_type	rectifiedImages[3];	// 平行化された画像
+	disparity_type	disparityMap;		// 視差画像
+    };
+
+    struct NoPostProcess
+    {
+	void	operator ()(disparity_type&)		const	{}
+    };
+
+  public:
+  //! パイプラインを生成する．
+  /*!
+    \param rectify	初期化済みの平行化オブジェクト
+    \param stereo	ステレオマッチングオブジェクト
+    \param binocular	trueならば2眼，falseならば3眼ステレオ
+    \param nframes	同時に処理されるフレーム数の上限(ステージ間キューの長さ)
+  */
+		StereoPipeline(const Rectify& rectify, stereo_type& stereo,
+			       bool binocular, size_t nframes=4)
+		    :_rectify(rectify), _stereo(stereo),
+		     _binocular(binocular),
+		     _frames(std::max(nframes, size_t(1)))
+		{
+		    for (auto& frame : _frames)
+		    {
+			frame.disparityMap.resize(_rectify.height(0),
+						  _rectify.width(0));
+			frame.disparityMap = 0;
+		    }
+		}
+
+  //! 同時に処理されるフレーム数の上限を返す．
+    size_t	nframes()			const	{ return _frames.size(); }
+
+  //! 入力が尽きるまでフレームを読み込み，視差画像を出力する．
+  /*!
+    \param in	入力関数．bool in(image_type& imageL, image_type& imageR,
+		image_type& imageV) なる形式で呼ばれ，フレームを読み込めなけ
+		ればfalseを返す．2眼の場合は imageV を無視してよい
+    \param out	出力関数．out(const image_type& rectifiedImageL,
+		const disparity_type& disparityMap) なる形式で入力と同じ
+		順序で呼ばれる
+    \return	処理したフレーム数
+  */
+    template <class IN, class OUT>
+    size_t	operator ()(IN&& in, OUT&& out)
+		{
+		    return (*this)(in, out, NoPostProcess());
+		}
+    template <class IN, class OUT, class POST>
+    size_t	operator ()(IN&& in, OUT&& out, POST&& post)		;
+
+  private:
+    void	rectify(Frame& frame)				const	;
+    void	match(Frame& frame)					;
+
+  private:
+    const Rectify&	_rectify;
+    stereo_type&	_stereo;
+    const bool		_binocular;
+    std::vector<Frame>	_frames;
+};
+
+//! 入力が尽きるまでフレームを読み込み，視差画像を出力する．
+/*!
+  \param in	入力関数
+  \param out	出力関数
+  \param post	後処理関数．post(disparity_type& disparityMap) なる形式で
+		呼ばれる．USE_TBB 定義時には異なるフレームに対して並行して
+		呼ばれることがある
+  \return	処理したフレーム数
+*/
+template <class STEREO, class T, class DISP>
+template <class IN, class OUT, class POST> size_t
+StereoPipeline<STEREO, T, DISP>::operator ()(IN&& in, OUT&& out, POST&& post)
+{
+    size_t	n = 0;
+
+#if defined(USE_TBB)
+  // 同時に処理されるフレームは高々 nframes() 個であり，かつ出力ステージは
+  // 入力順に逐次実行されるので，次に使う作業領域のフレームは出力済みである．
+    tbb::parallel_pipeline(
+	nframes(),
+	tbb::make_filter<void, Frame*>(
+	    tbb::filter_mode::serial_in_order,
+	    [&](tbb::flow_control& fc) -> Frame*
+	    {
+		auto&	frame = _frames[n % nframes()];
+		if (!in(frame.images[0], frame.images[1], frame.images[2]))
+		{
+		    fc.stop();
+		    return nullptr;
+		}
+		++n;
+		return &frame;
+	    }) &
+	tbb::make_filter<Frame*, Frame*>(
+	    tbb::filter_mode::parallel,
+	    [this](Frame* frame){ rectify(*frame); return frame; }) &
+	tbb::make_filter<Frame*, Frame*>(
+	    tbb::filter_mode::serial_in_order,
+	    [this](Frame* frame){ match(*frame); return frame; }) &
+	tbb::make_filter<Frame*, Frame*>(
+	    tbb::filter_mode::parallel,
+	    [&](Frame* frame){ post(frame->disparityMap); return frame; }) &
+	tbb::make_filter<Frame*, void>(
+	    tbb::filter_mode::serial_in_order,
+	    [&](Frame* frame)
+	    {
+		out(std::as_const(frame->rectifiedImages[0]),
+		    std::as_const(frame->disparityMap));
+	    }));
+#else
+    for (auto& frame = _frames[0];
+	 in(frame.images[0], frame.images[1], frame.images[2]); ++n)
+    {
+	rectify(frame);
+	match(frame);
+	post(frame.disparityMap);
+	out(std::as_const(frame.rectifiedImages[0]),
+	    std::as_const(frame.disparityMap));
+    }
+#endif
+    return n;
+}
+
+template <class STEREO, class T, class DISP> inline void
+StereoPipeline<STEREO, T, DISP>::rectify(Frame& frame) const
+{
+    if (_binocular)
+	_rectify(frame.images[0], frame.images[1],
+		 frame.rectifiedImages[0], frame.rectifiedImages[1]);
+    else
+	_rectify(frame.images[0], frame.images[1], frame.images[2],
+		 frame.rectifiedImages[0], frame.rectifiedImages[1],
+		 frame.rectifiedImages[2]);
+}
+
+template <class STEREO, class T, class DISP> inline void
+StereoPipeline<STEREO, T, DISP>::match(Frame& frame)
+{
+    const auto&	imageL = frame.rectifiedImages[0];
+
+    if (_binocular)
+	_stereo(imageL.cbegin(), imageL.cend(),
+		frame.rectifiedImages[1].cbegin(),
+		frame.disparityMap.begin());
+    else
+	_stereo(imageL.cbegin(), imageL.cend(), imageL.cend(),
+		frame.rectifiedImages[1].cbegin(),
+		frame.rectifiedImages[2].cbegin(),
+		frame.disparityMap.begin());
+}
+
+}
+#endif	// !TU_STEREOPIPELINE_H
@@ -7,8 +7,14 @@
 #define TU_STEREOUTILITY_H
 
 #include <limits>
+#include <vector>
+#include <algorithm>
+#include <stdexcept>
 #include "TU/Image++.h"
 #include "TU/StereoBase.h"
+#if defined(USE_TBB)
+#  include <tbb/parallel_pipeline.h>
+#endif
 
 namespace TU
 {
@@ -327,5 +333,378 @@ make_matching_iterator(OUT out, size_t dsw, size_t disparityMax,
     return {out, dsw, disparityMax, thresh, doHorizontalBackMatch};
 }
     
+/************************************************************************
+*  class Reprojector<T>							*
+************************************************************************/
+//! 視差画像を3次元点群に変換するクラス
+/*!
+  画素 (u, v) の視差 d から4x4行列 Q によって
+  \f$[X, Y, Z, W]^\top = Q[u, v, 1, d]^\top\f$ を計算し，その非同次座標を
+  3次元点とする．各行の座標はSIMD命令によって一括して計算され，正の有限値で
+  ない視差を持つ画素は出力されない．画像は nrowsPerBand() 行ずつの行帯に
+  分けて処理され，変換された点は行帯毎に上から順に出力関数に渡されるので，
+  後段の処理はフレーム全体の変換を待たずに開始できる．USE_TBB が定義されて
+  いれば，高々 nbands() 個の行帯を並列に変換する．各行帯の作業領域は循環的に
+  再利用され，出力点の領域は有効な画素の数に応じて拡げられるだけで縮められる
+  ことはないので，同程度の視差画像が続けば領域が新たに確保されることはない．
+  \param T	座標の型(float または double)
+*/
+template <class T=float>
+class Reprojector
+{
+  public:
+    using element_type	= T;
+    using matrix_type	= Matrix<T, 4, 4>;
+
+  //! 3次元点
+    struct PointXYZ
+    {
+	T	x, y, z;
+    };
+
+  //! 色付きの3次元点
+    struct PointXYZRGB
+    {
+	T	x, y, z;
+	RGB	rgb;
+    };
+
+  private:
+    using batch		= detail::point_batch<T>;
+    using vec_type	= typename batch::vec_type;
+
+  public:
+  //! 4x4行列を与えて変換オブジェクトを生成する．
+  /*!
+    \param Q		[u, v, 1, d] を3次元点の同次座標に写す4x4行列
+    \param nrowsPerBand	行帯の行数
+    \param nbands	同時に処理される行帯数の上限
+  */
+    explicit	Reprojector(const Matrix44d& Q,
+			    size_t nrowsPerBand=8, size_t nbands=8)
+		    :_nrowsPerBand(std::max(nrowsPerBand, size_t(1))),
+		     _bufs(std::max(nbands, size_t(1))), _cols(_bufs.size()),
+		     _xyz(_bufs.size()), _xyzrgb(_bufs.size())
+		{
+		    setQ(Q);
+		}
+
+  //! 平行化されたステレオカメラの投影行列を与えて変換オブジェクトを生成する．
+  /*!
+    視差 d は左画像の画素 (u, v) と右画像の画素 (u - d, v) の対応を表す
+    ものとし，3次元点は左カメラの投影行列が定める座標系で表される．
+    \param Pl		平行化された左カメラの3x4投影行列
+    \param Pr		平行化された右カメラの3x4投影行列
+    \param nrowsPerBand	行帯の行数
+    \param nbands	同時に処理される行帯数の上限
+  */
+		Reprojector(const Matrix34d& Pl, const Matrix34d& Pr,
+			    size_t nrowsPerBand=8, size_t nbands=8)
+		    :_nrowsPerBand(std::max(nrowsPerBand, size_t(1))),
+		     _bufs(std::max(nbands, size_t(1))), _cols(_bufs.size()),
+		     _xyz(_bufs.size()), _xyzrgb(_bufs.size())
+		{
+		  // 右カメラの投影中心を求める．
+		    Vector4d	tR;
+		    tR[0] = -Pr[0][3];
+		    tR[1] = -Pr[1][3];
+		    tR[2] = -Pr[2][3];
+		    tR[3] = 1.0;
+		    solve(transpose(slice(Pr, 0, 3, 0, 3)), slice(tR, 0, 3));
+
+		  // 3次元点を [u, v, 1, d] に写す行列の逆行列を求める．
+		    Matrix44d	Qinv;
+		    slice(Qinv, 0, 3, 0, 4) = Pl;
+		    Qinv[3][3] = Pl[0] * tR;
+		    setQ(inverse(Qinv));
+		}
+
+  //! [u, v, 1, d] を3次元点の同次座標に写す4x4行列を返す．
+    const matrix_type&	Q()			const	{ return _Q; }
+
+  //! 行帯の行数を返す．
+    size_t	nrowsPerBand()			const	{ return _nrowsPerBand; }
+
+  //! 同時に処理される行帯数の上限を返す．
+    size_t	nbands()			const	{ return _bufs.size(); }
+
+  //! 視差画像を3次元点群に変換し，行帯毎に出力関数に渡す．
+  /*!
+    \param disparityMap	視差画像
+    \param out		出力関数．out(size_t vb, size_t ve,
+			const PointXYZ* begin, const PointXYZ* end) なる形式で
+			第 vb 行から第 ve-1 行までの点を渡され，vb の昇順に
+			逐次的に呼ばれる
+    \return		出力された点の数
+  */
+    template <class DISP, class ALLOC, class OUT>
+    size_t	operator ()(const Image<DISP, ALLOC>& disparityMap,
+			    OUT&& out)
+		{
+		    return reproject(disparityMap, _xyz,
+				     [](size_t, size_t u,
+					const T* x, const T* y, const T* z)
+				     {
+					 return PointXYZ{x[u], y[u], z[u]};
+				     },
+				     out);
+		}
+
+  //! 視差画像を色付きの3次元点群に変換し，行帯毎に出力関数に渡す．
+  /*!
+    \param disparityMap	視差画像
+    \param image	disparityMap と同じ大きさのカラー画像
+    \param out		出力関数．out(size_t vb, size_t ve,
+			const PointXYZRGB* begin, const PointXYZRGB* end)
+			なる形式で第 vb 行から第 ve-1 行までの点を渡され，
+			vb の昇順に逐次的に呼ばれる
+    \return		出力された点の数
+  */
+    template <class DISP, class ALLOC, class S, class ALLOC_, class OUT>
+    size_t	operator ()(const Image<DISP, ALLOC>& disparityMap,
+			    const Image<S, ALLOC_>& image, OUT&& out)
+		{
+		    if (image.height() != disparityMap.height() ||
+			image.width()  != disparityMap.width())
+			throw std::invalid_argument("TU::Reprojector<T>::operator (): mismatched image sizes!!");
+
+		    return reproject(disparityMap, _xyzrgb,
+				     [&image](size_t v, size_t u,
+					      const T* x, const T* y, const T* z)
+				     {
+					 return PointXYZRGB{x[u], y[u], z[u],
+							    RGB(image[v][u])};
+				     },
+				     out);
+		}
+
+  //! 視差画像を3次元点群に変換し，その全ての点を返す．
+  /*!
+    \param disparityMap	視差画像
+    \param points	3次元点群．既存の点は破棄される
+  */
+    template <class DISP, class ALLOC>
+    void	operator ()(const Image<DISP, ALLOC>& disparityMap,
+			    std::vector<PointXYZ>& points)
+		{
+		    points.clear();
+		    (*this)(disparityMap,
+			    [&points](size_t, size_t,
+				      const PointXYZ* p, const PointXYZ* q)
+			    {
+				points.insert(points.end(), p, q);
+			    });
+		}
+
+  //! 視差画像を色付きの3次元点群に変換し，その全ての点を返す．
+  /*!
+    \param disparityMap	視差画像
+    \param image	disparityMap と同じ大きさのカラー画像
+    \param points	色付きの3次元点群．既存の点は破棄される
+  */
+    template <class DISP, class ALLOC, class S, class ALLOC_>
+    void	operator ()(const Image<DISP, ALLOC>& disparityMap,
+			    const Image<S, ALLOC_>& image,
+			    std::vector<PointXYZRGB>& points)
+		{
+		    points.clear();
+		    (*this)(disparityMap, image,
+			    [&points](size_t, size_t,
+				      const PointXYZRGB* p, const PointXYZRGB* q)
+			    {
+				points.insert(points.end(), p, q);
+			    });
+		}
+
+  private:
+    void	setQ(const Matrix44d& Q)
+		{
+		    for (size_t i = 0; i < 4; ++i)
+			for (size_t j = 0; j < 4; ++j)
+			    _Q[i][j] = Q[i][j];
+		}
+    static bool	valid(T d)
+		{
+		    return (d > 0 && d <= std::numeric_limits<T>::max());
+		}
+    template <class DISP, class ALLOC>
+    void	reprojectRow(const Image<DISP, ALLOC>& disparityMap,
+			     size_t v, PointBatch<T>& buf)		const	;
+    template <class DISP, class ALLOC, class POINT, class MAKE, class OUT>
+    size_t	reproject(const Image<DISP, ALLOC>& disparityMap,
+			  std::vector<std::vector<POINT> >& pointsBuf,
+			  MAKE make, OUT& out)				;
+
+  private:
+    matrix_type				_Q;
+    const size_t			_nrowsPerBand;
+    std::vector<PointBatch<T> >		_bufs;		// 行帯毎の作業領域
+    std::vector<std::vector<size_t> >	_cols;		// 行帯毎の有効画素の列
+    std::vector<std::vector<PointXYZ> >	_xyz;		// 行帯毎の出力点
+    std::vector<std::vector<PointXYZRGB> > _xyzrgb;	// 同上
+};
+
+//! 視差画像の第 v 行の画素の3次元座標をSIMD命令によって一括して求める．
+/*!
+  作業領域 buf の第0,1,2行に X, Y, Z 座標を，第3行に視差を，第4行に
+  画素の横座標を格納する．
+*/
+template <class T> template <class DISP, class ALLOC> void
+Reprojector<T>::reprojectRow(const Image<DISP, ALLOC>& disparityMap,
+			     size_t v, PointBatch<T>& buf) const
+{
+    const auto	width = disparityMap.width();
+
+    if (buf.nrow() != 5 || buf.ncol() != width)
+    {
+	buf.resize(5, width);
+	auto	d = batch::row(buf, 3);
+	auto	u = batch::row(buf, 4);
+	for (size_t i = 0; i < size_t(buf.stride()); ++i)
+	{
+	    d[i] = 0;
+	    u[i] = i;
+	}
+    }
+
+    const auto	d = batch::row(buf, 3);
+    const auto	u = batch::row(buf, 4);
+    T*		x[3];
+    for (size_t i = 0; i < 3; ++i)
+	x[i] = batch::row(buf, i);
+    std::copy_n(disparityMap[v].begin(), width, d);
+
+  // 第 i 成分を a[i][0]*u + a[i][1]*d + a[i][2] として求める．
+    vec_type	a[4][3];
+    for (size_t i = 0; i < 4; ++i)
+    {
+	a[i][0] = vec_type(_Q[i][0]);
+	a[i][1] = vec_type(_Q[i][3]);
+	a[i][2] = vec_type(_Q[i][1]*v + _Q[i][2]);
+    }
+
+    for (size_t k = 0; k < width; k += batch::Size)
+    {
+	const auto	uk = batch::load(u + k);
+	const auto	dk = batch::load(d + k);
+
+	vec_type	val[4];
+	for (size_t i = 0; i < 4; ++i)
+	    val[i] = batch::fma(a[i][0], uk, batch::fma(a[i][1], dk, a[i][2]));
+
+	const auto	w = vec_type(1) / val[3];
+	for (size_t i = 0; i < 3; ++i)
+	    batch::store(x[i] + k, val[i] * w);
+    }
+}
+
+//! 視差画像を行帯に分けて3次元点群に変換し，行帯毎に出力関数に渡す．
+/*!
+  \param disparityMap	視差画像
+  \param pointsBuf	行帯毎の出力点の作業領域
+  \param make		make(v, u, x, y, z) なる形式で呼ばれ，第 v 行第 u 列の
+			画素の点を返す関数
+  \param out		出力関数
+  \return		出力された点の数
+*/
+template <class T>
+template <class DISP, class ALLOC, class POINT, class MAKE, class OUT> size_t
+Reprojector<T>::reproject(const Image<DISP, ALLOC>& disparityMap,
+			  std::vector<std::vector<POINT> >& pointsBuf,
+			  MAKE make, OUT& out)
+{
+    const auto	height = disparityMap.height();
+    const auto	width  = disparityMap.width();
+    std::vector<size_t>	npointsBuf(nbands());	// 行帯毎の出力点の数
+    const auto	band = [&](size_t vb, size_t n)
+		       {
+			   auto&	buf    = _bufs[n];
+			   auto&	cols   = _cols[n];
+			   auto&	points = pointsBuf[n];
+			   const auto	ve = std::min(vb + _nrowsPerBand,
+						      height);
+			   if (cols.size() < width)
+			       cols.resize(width);
+
+			   size_t	npoints = 0;
+			   for (auto v = vb; v < ve; ++v)
+			   {
+			     // 有効な視差を持つ画素の列番号を分岐せずに詰める．
+			       const auto	row = disparityMap[v].begin();
+			       size_t		ncols = 0;
+			       for (size_t u = 0; u < width; ++u)
+			       {
+				   cols[ncols] = u;
+				   ncols += valid(T(row[u]));
+			       }
+			       if (ncols == 0)
+				   continue;
+
+			     // 点の領域は有効な画素の数に応じて拡げる．
+			       reprojectRow(disparityMap, v, buf);
+			       if (points.size() < npoints + ncols)
+				   points.resize(npoints + ncols);
+
+			       const T*	x = batch::row(buf, 0);
+			       const T*	y = batch::row(buf, 1);
+			       const T*	z = batch::row(buf, 2);
+			       const auto	p = points.data() + npoints;
+			       for (size_t i = 0; i < ncols; ++i)
+				   p[i] = make(v, cols[i], x, y, z);
+			       npoints += ncols;
+			   }
+			   npointsBuf[n] = npoints;
+		       };
+    const auto	output = [&](size_t vb, size_t n)
+			 {
+			     const auto	p = pointsBuf[n].data();
+			     out(vb, std::min(vb + _nrowsPerBand, height),
+				 p, p + npointsBuf[n]);
+			     return npointsBuf[n];
+			 };
+
+    size_t	npoints = 0;
+#if defined(USE_TBB)
+  // 同時に処理される行帯は高々 nbands() 個であり，かつ出力ステージは
+  // 入力順に逐次実行されるので，次に使う作業領域の行帯は出力済みである．
+    size_t	vb = 0;
+    tbb::parallel_pipeline(
+	nbands(),
+	tbb::make_filter<void, size_t>(
+	    tbb::filter_mode::serial_in_order,
+	    [&](tbb::flow_control& fc) -> size_t
+	    {
+		if (vb >= height)
+		{
+		    fc.stop();
+		    return 0;
+		}
+		const auto	v = vb;
+		vb += _nrowsPerBand;
+		return v;
+	    }) &
+	tbb::make_filter<size_t, size_t>(
+	    tbb::filter_mode::parallel,
+	    [&](size_t v)
+	    {
+		band(v, (v/_nrowsPerBand) % nbands());
+		return v;
+	    }) &
+	tbb::make_filter<size_t, void>(
+	    tbb::filter_mode::serial_in_order,
+	    [&](size_t v)
+	    {
+		npoints += output(v, (v/_nrowsPerBand) % nbands());
+	    }));
+#else
+    for (size_t vb = 0; vb < height; vb += _nrowsPerBand)
+    {
+	band(vb, 0);
+	npoints += output(vb, 0);
+    }
+#endif
+    return npoints;
+}
+
 }
 #endif	// !TU_STEREOUTILITY_H
@@ -6,282 +6,132 @@
 #ifndef TU_TREEFILTER_H
 #define TU_TREEFILTER_H
 
+#include <algorithm>
 #include <iostream>
 #include <cmath>
-#include <boost/graph/adjacency_list.hpp>
-#include <boost/graph/filtered_graph.hpp>
-#include <boost/graph/prim_minimum_spanning_tree.hpp>
-#include <boost/graph/depth_first_search.hpp>
-#include <boost/graph/graphviz.hpp>
-#include <boost/foreach.hpp>
+#include <cstdint>
+#include <cstring>
+#include <type_traits>
+#include <vector>
 #include "TU/Profiler.h"
+#if defined(USE_TBB)
+#  include <atomic>
+#  include <functional>
+#  include <tbb/parallel_for.h>
+#  include <tbb/parallel_scan.h>
+#  include <tbb/blocked_range.h>
+#  include <tbb/task_arena.h>
+#endif
+
+namespace TU
+{
+namespace detail
+{
+//! 大小関係が与えられた型の値と一致する符号なし整数の型
+template <class S, bool=std::is_integral<S>::value>
+struct sort_key_type
+{
+    using type	= std::make_unsigned_t<S>;
+};
+template <class S>
+struct sort_key_type<S, false>
+{
+    using type	= std::conditional_t<sizeof(S) == 4, uint32_t, uint64_t>;
+};
 
-namespace boost
+//! 大小関係が与えられた値と一致する符号なし整数を返す
+template <class S> inline typename sort_key_type<S>::type
+sort_key(S x, std::true_type)
 {
-enum vertex_weight_t		{vertex_weight};
-enum vertex_tree_val_t		{vertex_tree_val};
-enum vertex_aggr_val_t		{vertex_aggr_val};
-enum vertex_tree_weight_t	{vertex_tree_weight};
-enum vertex_aggr_weight_t	{vertex_aggr_weight};
-enum vertex_upward_edge_t	{vertex_upward_edge};
-enum edge_tree_t		{edge_tree};
-BOOST_INSTALL_PROPERTY(vertex, weight);
-BOOST_INSTALL_PROPERTY(vertex, tree_val);
-BOOST_INSTALL_PROPERTY(vertex, aggr_val);
-BOOST_INSTALL_PROPERTY(vertex, tree_weight);
-BOOST_INSTALL_PROPERTY(vertex, aggr_weight);
-BOOST_INSTALL_PROPERTY(vertex, upward_edge);
-BOOST_INSTALL_PROPERTY(edge,   tree);
-    
+    using key_type = typename sort_key_type<S>::type;
+
+    return key_type(x) ^ (std::is_signed<S>::value ?
+			  key_type(1) << (8*sizeof(S) - 1) : key_type(0));
+}
+
+template <class S> inline typename sort_key_type<S>::type
+sort_key(S x, std::false_type)
+{
+    using key_type = typename sort_key_type<S>::type;
+    constexpr key_type	Msb = key_type(1) << (8*sizeof(S) - 1);
+
+    key_type	u;
+    std::memcpy(&u, &x, sizeof(u));
+    return (u & Msb ? ~u : u | Msb);
+}
+
+template <class S> inline typename sort_key_type<S>::type
+sort_key(S x)
+{
+    return sort_key(x, std::is_integral<S>());
+}
+}	// namespace detail
+
 /************************************************************************
 *  class TreeFilter<T, W, CLOCK>					*
 ************************************************************************/
+//! 4近傍グリッド上の最小全域木に沿って値を集約するフィルタ
+/*!
+  ガイド画像の隣接画素間の重みを辺とする4近傍グリッドの最小全域木を
+  求め，入力画像の値を木に沿って集約する．グリッドや木はすべて画素を
+  添字とする平坦な配列で表され，最小全域木は辺の重みの基数ソートと
+  union-findによるKruskal法で，集約は根からの幅優先順序に沿った2回の
+  線形走査で求められる．重みが等しい辺は添字の小さいものが優先される
+  ので，木は一意に定まる．
+
+  USE_TBB が定義されていれば，最小全域木はBorůvka法によって並列に
+  求められ(辺の重みが32bit以下の場合)，木の探索と集約は幅優先探索の
+  レベルごとに並列に行われる．木も出力も逐次処理の場合と完全に一致する．
+  \param T	入力画像の画素の型
+  \param W	ガイド画像の2画素から辺の重みを求める関数オブジェクトの型
+  \param CLOCK	各段階の所要時間を測るプロファイラのクロック
+*/
 template <class T, class W, class CLOCK=void>
-class TreeFilter : public TU::Profiler<CLOCK>
+class TreeFilter : public Profiler<CLOCK>
 {
   public:
     typedef T							value_type;
     typedef typename W::argument_type				guide_type;
     typedef typename W::result_type				weight_type;
-    
-  private:
-    typedef TU::Profiler<CLOCK>					pf_type;
-    typedef adjacency_list_traits<vecS, vecS, undirectedS>	traits_t;
-    typedef traits_t::vertex_descriptor				vertex_t;
-    typedef traits_t::edge_descriptor				edge_t;
-    typedef property<vertex_predecessor_t, vertex_t,
-	    property<vertex_weight_t,	   weight_type,
-	    property<vertex_tree_val_t,	   value_type,
-	    property<vertex_aggr_val_t,	   value_type,
-	    property<vertex_tree_weight_t, weight_type,
-	    property<vertex_aggr_weight_t, weight_type> > > > > >
-								VertexProps;
-    typedef property<edge_weight_t,	   weight_type,
-	    property<edge_tree_t,	   bool> >		EdgeProps;
-    typedef adjacency_list<vecS, vecS, undirectedS,
-			   VertexProps, EdgeProps>		grid_t;
-
-    struct IsTreeEdge
-    {
-	typedef typename property_map<grid_t, edge_tree_t>::type TreeEdgeMap;
-
-		IsTreeEdge()					{}
-		IsTreeEdge(TreeEdgeMap treeEdgeMap)
-		    :_treeEdgeMap(treeEdgeMap)			{}
-	
-	bool	operator ()(edge_t e)	const	{return get(_treeEdgeMap, e);}
-
-      private:
-	TreeEdgeMap	_treeEdgeMap;
-    };
+    typedef uint32_t						vertex_type;
+    typedef uint32_t						edge_type;
 
-    typedef filtered_graph<grid_t, IsTreeEdge>			tree_t;
-
-    struct TreeExtractor : public default_dijkstra_visitor
-    {
-		TreeExtractor(weight_type sigma) :_nrsigma(-1/sigma)	{}
-#  ifdef PRINT
-	void	examine_vertex(vertex_t v, const grid_t& g) const
-		{
-		    std::cerr << "TreeExtractor::examine_vertex:\t"
-			      << v << std::endl;
-		}
-	void	edge_relaxed(edge_t e, const grid_t& g) const
-		{
-		    std::cerr << "TreeExtractor::edge_relaxed:\t";
-		    printEdge(std::cerr, g, e) << std::endl;
-		}
-#  endif
-	void	finish_vertex(vertex_t v, const grid_t& g) const
-		{
-		    auto	u = get(vertex_predecessor, g, v);
-
-		    if (u != v)
-		    {
-			auto	e = edge(u, v, g).first;
-			put(edge_tree,	   const_cast<grid_t&>(g), e, true);
-			put(vertex_weight, const_cast<grid_t&>(g), v,
-			    std::exp(get(edge_weight, g, e) * _nrsigma));
-		    }
-#  ifdef PRINT
-		    std::cerr << "TreeExtractor::finish_vertex:\t"
-			      << v << std::endl;
-#  endif
-		}
+  private:
+    typedef Profiler<CLOCK>					pf_type;
 
-      private:
-	const weight_type	_nrsigma;
-    };
+    typedef typename detail::sort_key_type<weight_type>::type	key_type;
 
-    struct TreeInitializer : public default_dfs_visitor
+  // 頂点から隣接頂点への向き
+    enum
     {
-#  ifdef PRINT
-	void	discover_vertex(vertex_t v, const tree_t& g) const
-		{
-		    std::cerr << "TreeInitializer::discover_vertex: ";
-		    printVertex(std::cerr , g, v) << std::endl;
-		}
-	void	tree_edge(edge_t e, const tree_t& g) const
-		{
-		    std::cerr << "TreeInitializer::tree_edge:\t  ";
-		    printEdge(std::cerr, g, e) << std::endl;
-		}
-#  endif
-	void	finish_vertex(vertex_t v, const tree_t& g) const
-		{
-		    const auto	u = get(vertex_predecessor, g, v);
-
-		    if (u != v)
-		    {
-			auto	w = get(vertex_weight, g, v);
-			auto	tree_vals = get(vertex_tree_val,
-						const_cast<tree_t&>(g));
-			tree_vals[u] += w * tree_vals[v];
-		    }
-#  ifdef PRINT
-		    std::cerr << "TreeInitializer::finish_vertex:\t  ";
-		    printVertex(std::cerr, g, v) << "\t=> ";
-		    if (u != v)
-			printVertex(std::cerr, g, u) << std::endl;
-		    else
-			std::cerr << "root" << std::endl;
-#  endif
-		}
+	Right = 0x1, Down = 0x2, Left = 0x4, Up = 0x8
     };
 
-    struct TreeInitializerWithNormalization : public default_dfs_visitor
+#if defined(USE_TBB)
+  // Borůvka法において縮約されたグラフの辺
+    struct Arc
     {
-	void	finish_vertex(vertex_t v, const tree_t& g) const
-		{
-		    const auto	u = get(vertex_predecessor, g, v);
-
-		    if (u != v)
-		    {
-			auto	w = get(vertex_weight, g, v);
-			auto	tree_vals = get(vertex_tree_val,
-						const_cast<tree_t&>(g));
-			auto	tree_weights = get(vertex_tree_weight,
-						   const_cast<tree_t&>(g));
-			tree_vals[u] += w * tree_vals[v];
-			tree_weights[u] += w * tree_weights[v];
-		    }
-		}
+	vertex_type	u;	//!< 一方の端点を含む成分の代表頂点
+	vertex_type	v;	//!< 他方の端点を含む成分の代表頂点
+	edge_type	e;	//!< 元のグリッドの辺
     };
     
-    struct TreeAggregator : public default_dfs_visitor
-    {
-	void	start_vertex(vertex_t v, const tree_t& g) const
-		{
-		    put(vertex_aggr_val, g, v, get(vertex_tree_val, g, v));
-#  ifdef PRINT
-		    std::cerr << "TreeAggregator::start_vertex:\t";
-		    printVertex(std::cerr, g, v) << std::endl;
-#  endif
-		}
-	void	tree_edge(edge_t e, const tree_t& g) const
-		{
-		    auto	u = source(e, g);
-		    auto	v = target(e, g);
-		    if (get(vertex_predecessor, g, v) != u)
-			std::swap(u, v);
-
-		    auto	w = get(vertex_weight, g, v);
-		    auto	tree_vals = get(vertex_tree_val,
-						const_cast<tree_t&>(g));
-		    auto	aggr_vals = get(vertex_aggr_val,
-						const_cast<tree_t&>(g));
-		    tree_vals[u] = aggr_vals[u] - w * tree_vals[v];
-		    aggr_vals[v] = tree_vals[v] + w * tree_vals[u];
-#  ifdef PRINT
-		    std::cerr << "TreeAggregator::tree_edge:\t";
-		    printVertex(std::cerr, g, u) << "\t<= ";
-		    printVertex(std::cerr, g, v) << std::endl;
-#  endif
-		}
-	void	finish_vertex(vertex_t v, const tree_t& g) const
-		{
-		    const auto	u = get(vertex_predecessor, g, v);
-
-		    if (u != v)
-		    {
-			auto	w = get(vertex_weight, g, v);
-			auto	tree_vals = get(vertex_tree_val,
-						const_cast<tree_t&>(g));
-			auto	aggr_vals = get(vertex_aggr_val,
-						const_cast<tree_t&>(g));
-			tree_vals[v] = aggr_vals[v] - w * tree_vals[u];
-		      //aggr_vals[u] = tree_vals[u] + w * tree_vals[v];
-		    }
-#  ifdef PRINT
-		    std::cerr << "TreeAggregator::finish_vertex:\t";
-		    printVertex(std::cerr, g, v) << "\t=> ";
-		    if (u != v)
-			printVertex(std::cerr, g, u) << std::endl;
-		    else
-			std::cerr << "root" << std::endl;
-#  endif
-		}
-    };
+    typedef std::integral_constant<bool, sizeof(key_type) <= 4>	boruvka;
+#else
+    typedef std::false_type					boruvka;
+#endif
 
-    struct TreeAggregatorWithNormalization : public default_dfs_visitor
-    {
-	void	start_vertex(vertex_t v, const tree_t& g) const
-		{
-		    put(vertex_aggr_val,    g, v, get(vertex_tree_val, g, v));
-		    put(vertex_aggr_weight, g, v, get(vertex_tree_weight,
-						      g, v));
-		}
-	void	tree_edge(edge_t e, const tree_t& g) const
-		{
-		    auto	u = source(e, g);
-		    auto	v = target(e, g);
-		    if (get(vertex_predecessor, g, v) != u)
-			std::swap(u, v);
-
-		    const auto	w = get(vertex_weight, g, v);
-		    auto	tree_vals = get(vertex_tree_val,
-						const_cast<tree_t&>(g));
-		    auto	aggr_vals = get(vertex_aggr_val,
-						const_cast<tree_t&>(g));
-		    tree_vals[u] = aggr_vals[u] - w * tree_vals[v];
-		    aggr_vals[v] = tree_vals[v] + w * tree_vals[u];
-		    auto	tree_weights = get(vertex_tree_weight,
-						   const_cast<tree_t&>(g));
-		    auto	aggr_weights = get(vertex_aggr_weight,
-						   const_cast<tree_t&>(g));
-		    tree_weights[u] = aggr_weights[u] - w * tree_weights[v];
-		    aggr_weights[v] = tree_weights[v] + w * tree_weights[u];
-		}
-	void	finish_vertex(vertex_t v, const tree_t& g) const
-		{
-		    const auto	u = get(vertex_predecessor, g, v);
-
-		    if (u != v)
-		    {
-			auto	w = get(vertex_weight, g, v);
-			auto	tree_vals = get(vertex_tree_val,
-						const_cast<tree_t&>(g));
-			auto	aggr_vals = get(vertex_aggr_val,
-						const_cast<tree_t&>(g));
-			tree_vals[v] = aggr_vals[v] - w * tree_vals[u];
-			auto	tree_weights = get(vertex_tree_weight,
-						   const_cast<tree_t&>(g));
-			auto	aggr_weights = get(vertex_aggr_weight,
-						   const_cast<tree_t&>(g));
-			tree_weights[v] = aggr_weights[v] - w * tree_weights[u];
-		    }
-		}
-    };
-    
   public:
 		TreeFilter(const W& wfunc, weight_type sigma)
 		    :pf_type(6), _wfunc(wfunc),
-		     _sigma(sigma), _nrow(0), _ncol(0)	{}
+		     _sigma(sigma), _nrow(0), _ncol(0), _grainSize(1024)	{}
 
     size_t	nrow()				const	{ return _nrow; }
     size_t	ncol()				const	{ return _ncol; }
     weight_type	sigma()				const	{ return _sigma; }
     void	setSigma(weight_type sigma)		{ _sigma = sigma; }
+    size_t	grainSize()			const	{ return _grainSize; }
+    void	setGrainSize(size_t gs)			{ _grainSize = gs; }
     template <class ROW_I, class ROW_G, class ROW_O>
     void	convolve(ROW_I rowI, ROW_I rowIe, ROW_G rowG, ROW_G rowGe,
 			 ROW_O rowO, bool normalize=false)		;
@@ -293,51 +143,98 @@ class TreeFilter : public TU::Profiler<CLOCK>
   private:
     void	resize(size_t nrows, size_t ncols)			;
     template <class ROW_I>
-    void	initializeVertices(ROW_I rowI, ROW_I rowIe)		;
+    void	initializeVertices(ROW_I rowI, ROW_I rowIe,
+				   bool normalize)			;
     template <class ROW_G>
     void	initializeEdges(ROW_G rowG, ROW_G rowGe)		;
+    void	sortEdges()						;
+    void	buildTree(std::false_type)				;
+#if defined(USE_TBB)
+    void	buildTree(std::true_type)				;
+    template <class OP_>
+    size_t	compact(size_t n, OP_ op)			const	;
+#endif
+    void	traverseTree()						;
+    template <class OP_>
+    void	forEachChild(vertex_type u, OP_ op)		const	;
+    template <class OP_>
+    void	forEachInLevel(size_t k, OP_ op)		const	;
+    void	aggregateUpward(bool normalize)				;
+    void	aggregateDownward(bool normalize)			;
     template <class ROW_O>
     void	outputResults(ROW_O rowO)			const	;
     template <class ROW_O>
     void	outputNormalizedResults(ROW_O rowO)		const	;
-    void	initializeVertex(vertex_t v, const value_type& val)
+    vertex_type	vidx(size_t r, size_t c) const
+		{
+		    return r*_ncol + c;
+		}
+    edge_type	eidx(vertex_type v, bool down) const
 		{
-		    put(vertex_tree_val,    _grid, v, val);
-		    put(vertex_aggr_val,    _grid, v, 0);
-		    put(vertex_tree_weight, _grid, v, 1);
-		    put(vertex_aggr_weight, _grid, v, 0);
+		    return 2*v + (down ? 1 : 0);
 		}
-    void	initializeEdge(edge_t e, weight_type val)
+    vertex_type	source(edge_type e) const
 		{
-		    put(edge_weight, _grid, e, val);
-		    put(edge_tree,   _grid, e, false);
+		    return e >> 1;
 		}
-    vertex_t	vidx(size_t r, size_t c) const
+    vertex_type	target(edge_type e) const
 		{
-		    return r*_ncol + c;
+		    return source(e) + (e & 0x1 ? _ncol : 1);
+		}
+    static uint64_t
+		pack(key_type key, edge_type e)
+		{
+		    return (uint64_t(key) << 32) | e;
+		}
+    vertex_type	root(vertex_type v)
+		{
+		    while (_roots[v] != v)
+			v = _roots[v] = _roots[_roots[v]];  // path halving
+		    return v;
 		}
-    template <class G> static std::ostream&
-		printVertex(std::ostream& out, const G& g, vertex_t v)
+    std::ostream&
+		printVertex(std::ostream& out, vertex_type v) const
 		{
-		    return out << v << ":("
-		      //<< get(vertex_predecessor, g, v) << ", "
-			       << get(vertex_tree_val, g, v) << ", "
-			       << get(vertex_aggr_val, g, v) << ')';
+		    return out << v << ":(" << _vals[v] << ')';
 		}
-    template <class G> static std::ostream&
-		printEdge(std::ostream& out, const G& g, edge_t e)
+    std::ostream&
+		printEdge(std::ostream& out, edge_type e) const
 		{
-		    return out << source(e, g) << "-("
-			       << get(edge_weight, g, e) << ")-"
-			       << target(e, g);
+		    return out << source(e) << "-(" << _edgeWeights[e] << ")-"
+			       << target(e);
 		}
 
   private:
-    const W&	_wfunc;
-    weight_type	_sigma;
-    size_t	_nrow;
-    size_t	_ncol;
-    grid_t	_grid;
+    const W				_wfunc;
+    weight_type				_sigma;
+    size_t				_nrow;
+    size_t				_ncol;
+    size_t				_grainSize;
+
+    std::vector<weight_type>		_edgeWeights;	//!< 辺の重み
+    std::vector<edge_type>		_edges;		//!< 重み順の辺
+    std::vector<edge_type>		_edgesTmp;
+    std::vector<key_type>		_keys;		//!< 辺の重みのキー
+    std::vector<key_type>		_keysTmp;
+    std::vector<vertex_type>		_roots;		//!< union-find
+    std::vector<uint8_t>		_ranks;
+    std::vector<uint8_t>		_links;		//!< 木の隣接頂点
+    std::vector<vertex_type>		_order;		//!< 幅優先順序
+    std::vector<size_t>			_levels;	//!< 各レベルの先頭
+    std::vector<vertex_type>		_parents;	//!< 親頂点
+    std::vector<weight_type>		_weights;	//!< 親頂点への係数
+    std::vector<value_type>		_vals;		//!< 頂点の値
+    std::vector<weight_type>		_normals;	//!< 正規化係数
+#if defined(USE_TBB)
+    std::vector<Arc>			_arcs;		//!< 縮約グラフの辺
+    std::vector<Arc>			_arcsTmp;
+    std::vector<vertex_type>		_comps;		//!< 成分の代表頂点
+    std::vector<vertex_type>		_compsTmp;
+    std::vector<vertex_type>		_nexts;		//!< 併合先の成分
+    std::vector<vertex_type>		_nextsTmp;
+    std::vector<std::atomic<uint64_t> >	_bests;		//!< 成分から出る最小の辺
+    std::vector<uint8_t>		_treeEdges;	//!< 木の辺ならば1
+#endif
 };
 
 template <class T, class W, class CLOCK>
@@ -355,36 +252,24 @@ TreeFilter<T, W, CLOCK>::convolve(ROW_I rowI, ROW_I rowIe, ROW_G rowG,
     resize(nrows, ncols);
 
     pf_type::start(1);
-    initializeVertices(rowI, rowIe);
+    initializeVertices(rowI, rowIe, normalize);
     initializeEdges(rowG, rowGe);
 
     pf_type::start(2);
-    prim_minimum_spanning_tree(_grid, get(vertex_predecessor, _grid),
-			       visitor(TreeExtractor(_sigma)));
-    tree_t	tree(_grid, IsTreeEdge(get(edge_tree, _grid)));
+    buildTree(boruvka());
+    traverseTree();
 
-    if (normalize)
-    {
-	pf_type::start(3);
-	depth_first_search(tree, visitor(TreeInitializerWithNormalization()));
+    pf_type::start(3);
+    aggregateUpward(normalize);
 
-	pf_type::start(4);
-	depth_first_search(tree, visitor(TreeAggregatorWithNormalization()));
-	
-	pf_type::start(5);
+    pf_type::start(4);
+    aggregateDownward(normalize);
+
+    pf_type::start(5);
+    if (normalize)
 	outputNormalizedResults(rowO);
-    }
     else
-    {
-	pf_type::start(3);
-	depth_first_search(tree, visitor(TreeInitializer()));
-
-	pf_type::start(4);
-	depth_first_search(tree, visitor(TreeAggregator()));
-	
-	pf_type::start(5);
 	outputResults(rowO);
-    }
 
     pf_type::nextFrame();
 }
@@ -394,112 +279,620 @@ TreeFilter<T, W, CLOCK>::resize(size_t nrows, size_t ncols)
 {
     if (nrows == _nrow && ncols == _ncol)
 	return;
-    
+
     _nrow = nrows;
     _ncol = ncols;
-    _grid.clear();
 
-    for (size_t n = _nrow * _ncol; n > 0; --n)
-	add_vertex(_grid);
+    const size_t	nvertices = _nrow*_ncol;
+    const size_t	nedges	  = (_nrow - 1)*_ncol + _nrow*(_ncol - 1);
+
+    _edgeWeights.resize(2*nvertices);
+    _edges.resize(nedges);
+    _edgesTmp.resize(nedges);
+    _keys.resize(nedges);
+    _keysTmp.resize(nedges);
+    _roots.resize(nvertices);
+    _ranks.resize(nvertices);
+    _links.resize(nvertices);
+    _order.resize(nvertices);
+    _parents.resize(nvertices);
+    _weights.resize(nvertices);
+    _vals.resize(nvertices);
+    _normals.resize(nvertices);
+#if defined(USE_TBB)
+    _arcs.resize(nedges);
+    _arcsTmp.resize(nedges);
+    _comps.resize(nvertices);
+    _compsTmp.resize(nvertices);
+    _nexts.resize(nvertices);
+    _nextsTmp.resize(nvertices);
+    if (_bests.size() != nvertices)
+	std::vector<std::atomic<uint64_t> >(nvertices).swap(_bests);
+    _treeEdges.resize(2*nvertices);
+#endif
+}
+
+template <class T, class W, class CLOCK> template <class ROW_I> void
+TreeFilter<T, W, CLOCK>::initializeVertices(ROW_I rowI, ROW_I rowIe,
+					    bool normalize)
+{
+    auto	val = _vals.begin();
+
+    for (; rowI != rowIe; ++rowI)
+	for (auto colI = rowI->begin(); colI != rowI->end(); ++colI, ++val)
+	    *val = *colI;
+
+    if (normalize)
+	std::fill(_normals.begin(), _normals.end(), weight_type(1));
+}
 
-    for (size_t c = 1; c < ncol(); ++c)
-	add_edge(c-1, c, _grid);
+//! ガイド画像から辺の重みを求め，辺を添字順に並べる
+template <class T, class W, class CLOCK> template <class ROW_G> void
+TreeFilter<T, W, CLOCK>::initializeEdges(ROW_G rowG, ROW_G rowGe)
+{
+    auto	e = _edges.begin();
+    auto	k = _keys.begin();
 
-    for (size_t r = 1; r < nrow(); ++r)
+    for (vertex_type v = 0; rowG != rowGe; ++rowG)
     {
-	add_edge(vidx(r-1, 0), vidx(r, 0), _grid);
-	
-	for (size_t c = 1; c < ncol(); ++c)
+	auto	rowL = rowG;
+	++rowL;
+
+	auto	colG = rowG->begin();
+	auto	colL = (rowL != rowGe ? rowL->begin() : colG);
+
+	for (size_t c = 0; c < _ncol; ++c, ++v)
 	{
-	    add_edge(vidx(r-1, c), vidx(r, c), _grid);
-	    add_edge(vidx(r, c-1), vidx(r, c), _grid);
+	    auto	colR = colG;
+	    ++colR;
+
+	    if (c + 1 < _ncol)
+	    {
+		const auto	w = _wfunc(*colG, *colR);
+		_edgeWeights[*e++ = eidx(v, false)] = w;
+		*k++ = detail::sort_key(w);
+	    }
+	    if (rowL != rowGe)
+	    {
+		const auto	w = _wfunc(*colG, *colL);
+		_edgeWeights[*e++ = eidx(v, true)] = w;
+		*k++ = detail::sort_key(w);
+		++colL;
+	    }
+	    colG = colR;
 	}
     }
 }
+
+//! 辺を重みの昇順に並べる
+/*!
+  11bitずつのLSD基数ソートによる．ソートは安定なので，重みが等しい辺は
+  添字順に並ぶ．
+*/
+template <class T, class W, class CLOCK> void
+TreeFilter<T, W, CLOCK>::sortEdges()
+{
+    constexpr size_t	NBits	= 11;
+    constexpr size_t	NBins	= size_t(1) << NBits;
+
+    if (_keys.empty())
+	return;
     
-template <class T, class W, class CLOCK> template <class ROW_I> void
-TreeFilter<T, W, CLOCK>::initializeVertices(ROW_I rowI, ROW_I rowIe)
+    std::vector<size_t>	offsets(NBins);
+
+    for (size_t shift = 0; shift < 8*sizeof(key_type); shift += NBits)
+    {
+	std::fill(offsets.begin(), offsets.end(), 0);
+	for (const auto key : _keys)
+	    ++offsets[(key >> shift) & (NBins - 1)];
+
+	if (offsets[(_keys[0] >> shift) & (NBins - 1)] == _keys.size())
+	    continue;			// 全辺のこの桁が等しい
+
+	size_t	sum = 0;
+	for (auto& offset : offsets)
+	{
+	    const auto	count = offset;
+	    offset = sum;
+	    sum += count;
+	}
+
+	for (size_t i = 0; i < _keys.size(); ++i)
+	{
+	    const auto	j = offsets[(_keys[i] >> shift) & (NBins - 1)]++;
+	    _keysTmp[j]  = _keys[i];
+	    _edgesTmp[j] = _edges[i];
+	}
+	_keys.swap(_keysTmp);
+	_edges.swap(_edgesTmp);
+    }
+}
+
+//! 辺を重み順に並べ，Kruskal法によって最小全域木を求める
+template <class T, class W, class CLOCK> void
+TreeFilter<T, W, CLOCK>::buildTree(std::false_type)
 {
-    auto	v = vertices(_grid).first;
+    sortEdges();
 
-    for (; rowI != rowIe; ++rowI)
-	for (auto colI = rowI->begin(); colI != rowI->end(); ++colI, ++v)
-	    initializeVertex(*v, *colI);
+    for (vertex_type v = 0; v < _roots.size(); ++v)
+	_roots[v] = v;
+    std::fill(_ranks.begin(), _ranks.end(), 0);
+    std::fill(_links.begin(), _links.end(), 0);
+
+    size_t	n = _roots.size() - 1;	// 木の辺の数
+    for (auto e = _edges.cbegin(); n > 0; ++e)
+    {
+	const auto	u  = source(*e);
+	const auto	v  = target(*e);
+	auto		ru = root(u);
+	auto		rv = root(v);
+
+	if (ru == rv)
+	    continue;
+
+	if (_ranks[ru] < _ranks[rv])
+	    std::swap(ru, rv);
+	else if (_ranks[ru] == _ranks[rv])
+	    ++_ranks[ru];
+	_roots[rv] = ru;
+
+	if (*e & 0x1)
+	{
+	    _links[u] |= Down;
+	    _links[v] |= Up;
+	}
+	else
+	{
+	    _links[u] |= Right;
+	    _links[v] |= Left;
+	}
+	--n;
+    }
 }
-    
-template <class T, class W, class CLOCK> template <class ROW_G> void
-TreeFilter<T, W, CLOCK>::initializeEdges(ROW_G rowG, ROW_G rowGe)
+
+#if defined(USE_TBB)
+//! Borůvka法によって最小全域木を並列に求める
+/*!
+  各ラウンドでは，各成分から出る辺のうち(重み, 添字)の辞書式順序で最小の
+  ものを選び，その辺で成分を併合する．この順序は辺の全順序であるから，
+  最小全域木は一意であり，Kruskal法によるものと一致する．並列に実行
+  できるスレッドが1つしかなければ，Kruskal法を用いる．
+*/
+template <class T, class W, class CLOCK> void
+TreeFilter<T, W, CLOCK>::buildTree(std::true_type)
 {
-    auto	e = edges(_grid).first;
-    auto	colG = rowG->begin();
+    if (tbb::this_task_arena::max_concurrency() < 2)
+    {
+	buildTree(std::false_type());
+	return;
+    }
+
+    using range_t	= tbb::blocked_range<size_t>;
+
+    constexpr uint64_t	None = ~uint64_t(0);
+    const size_t	nvertices = _comps.size();
+    size_t		narcs	  = _edges.size();
+    size_t		ncomps	  = nvertices;
+
+    tbb::parallel_for(range_t(0, nvertices, _grainSize),
+		      [this](const range_t& r)
+		      {
+			  for (auto v = r.begin(); v != r.end(); ++v)
+			  {
+			      _comps[v] = v;
+			      _treeEdges[2*v] = _treeEdges[2*v + 1] = 0;
+			  }
+		      });
+    tbb::parallel_for(range_t(0, narcs, _grainSize),
+		      [this](const range_t& r)
+		      {
+			  for (auto i = r.begin(); i != r.end(); ++i)
+			  {
+			      const auto	e = _edges[i];
+			      _arcs[i] = {source(e), target(e), e};
+			  }
+		      });
+
+    while (narcs > 0)
+    {
+      // 各成分から出る最小の辺を求める．
+	tbb::parallel_for(range_t(0, ncomps, _grainSize),
+			  [this](const range_t& r)
+			  {
+			      for (auto i = r.begin(); i != r.end(); ++i)
+			      {
+				  const auto	c = _comps[i];
+				  _bests[c].store(None,
+						  std::memory_order_relaxed);
+				  _nexts[c] = c;
+			      }
+			  });
+	tbb::parallel_for(range_t(0, narcs, _grainSize),
+			  [this](const range_t& r)
+			  {
+			      auto	update = [](std::atomic<uint64_t>& best,
+						    uint64_t x)
+					 {
+					     auto y = best.load(
+						 std::memory_order_relaxed);
+					     while (x < y &&
+						    !best.compare_exchange_weak(
+							y, x,
+							std::memory_order_relaxed))
+						 ;
+					 };
+
+			      for (auto i = r.begin(); i != r.end(); ++i)
+			      {
+				  const auto&	arc = _arcs[i];
+				  const auto	x = pack(detail::sort_key(
+							     _edgeWeights[arc.e]),
+							 arc.e);
+				  update(_bests[arc.u], x);
+				  update(_bests[arc.v], x);
+			      }
+			  });
+
+      // 各成分を最小の辺の他端の成分に併合する．互いに同じ辺を選んだ
+      // 2成分は，代表頂点の添字が小さい方に併合する．
+	tbb::parallel_for(range_t(0, narcs, _grainSize),
+			  [this](const range_t& r)
+			  {
+			      auto	hook = [this](vertex_type c, vertex_type o,
+						  uint64_t x, edge_type e)
+					 {
+					     const auto	y = _bests[o].load(
+						 std::memory_order_relaxed);
+					     if (y != x || o < c)
+					     {
+						 _nexts[c]     = o;
+						 _treeEdges[e] = 1;
+					     }
+					 };
+
+			      for (auto i = r.begin(); i != r.end(); ++i)
+			      {
+				  const auto&	arc = _arcs[i];
+				  const auto	x = pack(detail::sort_key(
+							     _edgeWeights[arc.e]),
+							 arc.e);
+				  if (_bests[arc.u].load(
+					  std::memory_order_relaxed) == x)
+				      hook(arc.u, arc.v, x, arc.e);
+				  if (_bests[arc.v].load(
+					  std::memory_order_relaxed) == x)
+				      hook(arc.v, arc.u, x, arc.e);
+			      }
+			  });
+
+      // pointer jumping により各成分の併合先を新たな代表頂点にする．
+	for (bool changed = true; changed; )
+	{
+	    std::atomic<bool>	updated(false);
+	    
+	    tbb::parallel_for(range_t(0, ncomps, _grainSize),
+			      [this, &updated](const range_t& r)
+			      {
+				  bool	u = false;
+				  for (auto i = r.begin(); i != r.end(); ++i)
+				  {
+				      const auto	c = _comps[i];
+				      const auto	n = _nexts[_nexts[c]];
+				      _nextsTmp[c] = n;
+				      u |= (n != _nexts[c]);
+				  }
+				  if (u)
+				      updated.store(true,
+						    std::memory_order_relaxed);
+			      });
+	    _nexts.swap(_nextsTmp);
+	    changed = updated.load();
+	}
+
+      // 成分の内部に入った辺を除き，残った成分だけを次のラウンドに残す．
+	tbb::parallel_for(range_t(0, narcs, _grainSize),
+			  [this](const range_t& r)
+			  {
+			      for (auto i = r.begin(); i != r.end(); ++i)
+			      {
+				  auto&	arc = _arcs[i];
+				  arc.u = _nexts[arc.u];
+				  arc.v = _nexts[arc.v];
+			      }
+			  });
+	narcs = compact(narcs,
+			[this](size_t i, size_t j, bool final)
+			{
+			    if (_arcs[i].u == _arcs[i].v)
+				return false;
+			    if (final)
+				_arcsTmp[j] = _arcs[i];
+			    return true;
+			});
+	_arcs.swap(_arcsTmp);
+	ncomps = compact(ncomps,
+			 [this](size_t i, size_t j, bool final)
+			 {
+			     const auto	c = _comps[i];
+			     if (_nexts[c] != c)
+				 return false;
+			     if (final)
+				 _compsTmp[j] = c;
+			     return true;
+			 });
+	_comps.swap(_compsTmp);
+    }
 
-    for (auto colL = colG; ++colG != rowG->end(); colL = colG)
-	initializeEdge(*e++, _wfunc(*colL, *colG));
+    tbb::parallel_for(range_t(0, nvertices, _grainSize),
+		      [this](const range_t& r)
+		      {
+			  for (auto v = r.begin(); v != r.end(); ++v)
+			  {
+			      uint8_t	links = 0;
+			      if (_treeEdges[2*v])
+				  links |= Right;
+			      if (_treeEdges[2*v + 1])
+				  links |= Down;
+			      if (v % _ncol != 0 && _treeEdges[2*(v - 1)])
+				  links |= Left;
+			      if (v >= _ncol && _treeEdges[2*(v - _ncol) + 1])
+				  links |= Up;
+			      _links[v] = links;
+			  }
+		      });
+}
 
-    for (auto rowU = rowG; ++rowG != rowGe; rowU = rowG)
+//! 条件を満たす要素を順序を保ったまま並列に詰める
+/*!
+  \param n	要素数
+  \param op	bool op(size_t i, size_t j, bool final) なる形式で呼ばれ，
+		i番目の要素を残すならtrueを返す．finalがtrueならば，その
+		要素をj番目に書き込む
+  \return	残った要素の数
+*/
+template <class T, class W, class CLOCK> template <class OP_> size_t
+TreeFilter<T, W, CLOCK>::compact(size_t n, OP_ op) const
+{
+    using range_t	= tbb::blocked_range<size_t>;
+
+    return tbb::parallel_scan(range_t(0, n, _grainSize), size_t(0),
+			      [&op](const range_t& r, size_t j, bool final)
+			      {
+				  for (auto i = r.begin(); i != r.end(); ++i)
+				      if (op(i, j, final))
+					  ++j;
+				  return j;
+			      },
+			      std::plus<size_t>());
+}
+#endif
+
+//! 左上の頂点を根として木を幅優先でたどり，各頂点の親と係数を求める
+/*!
+  頂点はレベルごとに _order に並べられ，各レベルの先頭の位置が _levels
+  に記録される．
+*/
+template <class T, class W, class CLOCK> void
+TreeFilter<T, W, CLOCK>::traverseTree()
+{
+    const weight_type	nrsigma = -1/_sigma;
+    auto		visit = [this, nrsigma](vertex_type u, vertex_type v,
+						edge_type e, size_t i)
+			{
+			    _parents[v] = u;
+			    _weights[v] = std::exp(_edgeWeights[e] * nrsigma);
+			    _order[i]	= v;
+			};
+
+    _order[0]	= 0;
+    _parents[0] = 0;
+    _weights[0] = 0;
+    _levels.assign({0, 1});
+
+    for (size_t b = 0, e = 1; b != e; b = e, e = _levels.back())
     {
-	auto	colU = rowU->begin();
-	auto	colG = rowG->begin();
-	
-	initializeEdge(*e++, _wfunc(*colU, *colG));
-	
-	for (auto colL = colG; ++colG != rowG->end(); colL = colG)
+	size_t	tail = e;
+#if defined(USE_TBB)
+	using range_t	= tbb::blocked_range<size_t>;
+
+	if (e - b > _grainSize)
+	    tail += tbb::parallel_scan(
+			range_t(b, e, _grainSize), size_t(0),
+			[this, &visit, e](const range_t& r, size_t n, bool final)
+			{
+			    for (auto i = r.begin(); i != r.end(); ++i)
+			    {
+				const auto	u = _order[i];
+				forEachChild(u, [&](vertex_type v, edge_type f)
+						{
+						    if (final)
+							visit(u, v, f, e + n);
+						    ++n;
+						});
+			    }
+			    return n;
+			},
+			std::plus<size_t>());
+	else
+#endif
+	for (auto i = b; i != e; ++i)
 	{
-	    initializeEdge(*e++, _wfunc(*++colU, *colG));
-	    initializeEdge(*e++, _wfunc(*colL, *colG));
+	    const auto	u = _order[i];
+	    forEachChild(u, [&](vertex_type v, edge_type f)
+			    { visit(u, v, f, tail++); });
 	}
+
+	_levels.push_back(tail);
+    }
+}
+
+//! 頂点の子を右，下，左，上の順に列挙する
+/*!
+  \param u	頂点
+  \param op	op(vertex_type v, edge_type e) なる形式で子 v と u から v
+		への辺 e について呼ばれる
+*/
+template <class T, class W, class CLOCK> template <class OP_> inline void
+TreeFilter<T, W, CLOCK>::forEachChild(vertex_type u, OP_ op) const
+{
+    const auto	links  = _links[u];
+    const auto	parent = _parents[u];
+
+    if ((links & Right) && u + 1 != parent)
+	op(u + 1,     eidx(u,	      false));
+    if ((links & Down)  && u + _ncol != parent)
+	op(u + _ncol, eidx(u,	      true));
+    if ((links & Left)  && u - 1 != parent)
+	op(u - 1,     eidx(u - 1,     false));
+    if ((links & Up)    && u - _ncol != parent)
+	op(u - _ncol, eidx(u - _ncol, true));
+}
+
+//! 幅優先探索の指定されたレベルの各頂点に演算を施す
+/*!
+  USE_TBB が定義されていれば，レベルの頂点数が grainSize() を越える
+  場合に並列に処理する．
+  \param k	レベル
+  \param op	op(vertex_type v) なる形式で各頂点 v について呼ばれる
+*/
+template <class T, class W, class CLOCK> template <class OP_> inline void
+TreeFilter<T, W, CLOCK>::forEachInLevel(size_t k, OP_ op) const
+{
+    const auto	b = _levels[k];
+    const auto	e = _levels[k + 1];
+
+#if defined(USE_TBB)
+    using range_t	= tbb::blocked_range<size_t>;
+
+    if (e - b > _grainSize)
+    {
+	tbb::parallel_for(range_t(b, e, _grainSize),
+			  [this, &op](const range_t& r)
+			  {
+			      for (auto i = r.begin(); i != r.end(); ++i)
+				  op(_order[i]);
+			  });
+	return;
     }
+#endif
+    for (auto i = b; i != e; ++i)
+	op(_order[i]);
+}
+
+//! 葉から根に向かって値を集約する
+template <class T, class W, class CLOCK> void
+TreeFilter<T, W, CLOCK>::aggregateUpward(bool normalize)
+{
+    for (auto k = _levels.size() - 2; k-- > 0; )
+	forEachInLevel(k, [this, normalize](vertex_type u)
+			  {
+			      forEachChild(u, [&](vertex_type v, edge_type)
+					      {
+						  const auto	w = _weights[v];
+						  _vals[u] += w * _vals[v];
+						  if (normalize)
+						      _normals[u]
+							  += w * _normals[v];
+					      });
+			  });
+}
+
+//! 根から葉に向かって値を集約する
+/*!
+  親頂点 u の集約値が求まっていれば，頂点 v の集約値は v を根とする
+  部分木の値 t(v) から t(v) + w*(aggr(u) - w*t(v)) として求まる．
+*/
+template <class T, class W, class CLOCK> void
+TreeFilter<T, W, CLOCK>::aggregateDownward(bool normalize)
+{
+    for (size_t k = 1; k < _levels.size() - 1; ++k)
+	forEachInLevel(k, [this, normalize](vertex_type v)
+			  {
+			      const auto	u = _parents[v];
+			      const auto	w = _weights[v];
+
+			      _vals[v] += w * (_vals[u] - w * _vals[v]);
+			      if (normalize)
+				  _normals[v] += w * (_normals[u]
+						      - w * _normals[v]);
+			  });
 }
 
 template <class T, class W, class CLOCK> template <class ROW_O> void
 TreeFilter<T, W, CLOCK>::outputResults(ROW_O rowO) const
 {
-    auto	v = vertices(_grid).first;
-    auto	vals = get(vertex_aggr_val, _grid);
-    
+    auto	val = _vals.cbegin();
+
     for (auto r = nrow(); r > 0; --r, ++rowO)
     {
 	auto	colO = rowO->begin();
 
-	for (auto c = ncol(); c > 0; --c, ++colO, ++v)
-	    *colO = vals[*v];
+	for (auto c = ncol(); c > 0; --c, ++colO, ++val)
+	    *colO = *val;
     }
 }
-    
+
 template <class T, class W, class CLOCK> template <class ROW_O> void
 TreeFilter<T, W, CLOCK>::outputNormalizedResults(ROW_O rowO) const
 {
-    auto	v	= vertices(_grid).first;
-    auto	vals	= get(vertex_aggr_val,    _grid);
-    auto	weights = get(vertex_aggr_weight, _grid);
-    
+    auto	val    = _vals.cbegin();
+    auto	normal = _normals.cbegin();
+
     for (auto r = nrow(); r > 0; --r, ++rowO)
     {
 	auto	colO = rowO->begin();
 
-	for (auto c = ncol(); c > 0; --c, ++colO, ++v)
-	    *colO = vals[*v] / weights[*v];
+	for (auto c = ncol(); c > 0; --c, ++colO, ++val, ++normal)
+	    *colO = *val / *normal;
     }
 }
-    
+
 template <class T, class W, class CLOCK> void
 TreeFilter<T, W, CLOCK>::printVertices(std::ostream& out) const
 {
-    BOOST_FOREACH (vertex_t v, vertices(_grid))
-	printVertex(out, _grid, v) << std::endl;
+    for (vertex_type v = 0; v < _vals.size(); ++v)
+	printVertex(out, v) << std::endl;
 }
 
 template <class T, class W, class CLOCK> void
 TreeFilter<T, W, CLOCK>::printEdges(std::ostream& out) const
 {
-    BOOST_FOREACH (edge_t e, edges(_grid))
-	printEdge(out, _grid, e) << std::endl;
+    for (vertex_type v = 0; v < _vals.size(); ++v)
+    {
+	if ((v + 1) % _ncol != 0)
+	    printEdge(out, eidx(v, false)) << std::endl;
+	if (v + _ncol < _vals.size())
+	    printEdge(out, eidx(v, true)) << std::endl;
+    }
 }
 
+//! グリッドをgraphviz形式で出力する
 template <class T, class W, class CLOCK> void
 TreeFilter<T, W, CLOCK>::saveGrid(std::ostream& out) const
 {
-    write_graphviz(out, _grid);
+    out << "graph G {" << std::endl;
+    for (vertex_type v = 0; v < _vals.size(); ++v)
+	out << v << ';' << std::endl;
+    for (vertex_type v = 0; v < _vals.size(); ++v)
+    {
+	if ((v + 1) % _ncol != 0)
+	    out << v << "--" << v + 1 << " ;" << std::endl;
+	if (v + _ncol < _vals.size())
+	    out << v << "--" << v + _ncol << " ;" << std::endl;
+    }
+    out << '}' << std::endl;
+}
+
+//! 最小全域木をgraphviz形式で出力する
+template <class T, class W, class CLOCK> void
+TreeFilter<T, W, CLOCK>::saveTree(std::ostream& out) const
+{
+    out << "graph G {" << std::endl;
+    for (vertex_type v = 0; v < _vals.size(); ++v)
+	out << v << ';' << std::endl;
+    for (auto v = _order.cbegin() + 1; v != _order.cend(); ++v)
+	out << _parents[*v] << "--" << *v << " ;" << std::endl;
+    out << '}' << std::endl;
 }
 
 }
@@ -6,7 +6,7 @@
 #ifndef TU_VECTORPP_H
 #define TU_VECTORPP_H
 
-#include "TU/Array++.h"
+#include "TU/simd/Array++.h"	// 大きな行列の積を gemm() で計算するため
 
 namespace TU
 {
@@ -9,6 +9,9 @@
 #include "TU/simd/Array++.h"
 #include "TU/Image++.h"
 #include "TU/Camera++.h"
+#if defined(TU_SIMD_DISPATCH)
+#  include "TU/simd/dispatch.h"
+#endif
 #if defined(USE_TBB)
 #  include <tbb/parallel_for.h>
 #  include <tbb/blocked_range.h>
@@ -211,9 +214,17 @@ class Warp
     void	operator ()(IN in, OUT out)			const	;
     Vector2f	operator ()(size_t u, size_t v)			const	;
 
+    template <class IN, class OUT, class S, class T>
+    static void	warpLine(IN in, OUT out,
+			 S u, S ue, S v, T du, T dv)			;
+
   private:
     template <class IN, class OUT>
     void	warpLine(IN in, OUT out, const FracArray& frac)	const	;
+#if defined(TU_SIMD_DISPATCH)
+    void	warpLine(range_iterator<const u_char*, 0, 0> in,
+			 u_char* out, const FracArray& frac)	const	;
+#endif
     
   private:
     Array<FracArray>	_fracs;
@@ -399,27 +410,33 @@ Warp::operator ()(size_t u, size_t v) const
 	    float(fracs.vs[u]) + float(fracs.dv[u]) / 128.0f};
 }
 
-template <class IN, class OUT> void
-Warp::warpLine(IN in, OUT out, const FracArray& frac) const
+//! 入力画像を変形して出力画像の1行を生成する．
+/*!
+  \param in	入力画像の最初の行を指す反復子
+  \param out	出力画像の行中の最初の出力画素を指す反復子
+  \param u	出力画素にマップされる入力画像点の横座標の整数部の列の先頭
+  \param ue	出力画素にマップされる入力画像点の横座標の整数部の列の末尾
+  \param v	出力画素にマップされる入力画像点の縦座標の整数部の列の先頭
+  \param du	出力画素にマップされる入力画像点の横座標の小数部(7bit固定小数点)
+		の列の先頭
+  \param dv	出力画素にマップされる入力画像点の縦座標の小数部(7bit固定小数点)
+		の列の先頭
+*/
+template <class IN, class OUT, class S, class T> void
+Warp::warpLine(IN in, OUT out, S u, S ue, S v, T du, T dv)
 {
     Interpolate<IN>	interpolate(in);
     
-    auto	u  = frac.us.cbegin();
-    auto	ue = frac.us.cend();
-    auto	v  = frac.vs.cbegin();
-    auto	du = frac.du.cbegin();
-    auto	dv = frac.dv.cbegin();
-    out += frac.lmost;
 #if defined(SIMD)
     using	value_type = typename Interpolate<IN>::value_type;
-    using	T = std::conditional_t<(sizeof(value_type) > sizeof(int16_t)),
+    using	V = std::conditional_t<(sizeof(value_type) > sizeof(int16_t)),
 				       int32_t, int16_t>;
     using	O = std::conditional_t<(sizeof(value_type) > sizeof(int16_t)),
 				       int32_t, iterator_value<OUT> >;
 	
     const auto	n = simd::vec<u_char>::floor(std::distance(u, ue));
 
-    simd::transform<T>(interpolate,
+    simd::transform<V>(interpolate,
 		       simd::make_accessor(ptr<O*>(out)),
 		       simd::make_accessor(u),
 		       simd::make_accessor(u + n),
@@ -438,5 +455,28 @@ Warp::warpLine(IN in, OUT out, const FracArray& frac) const
 	*out++ = interpolate(*u++, *v++, *du++, *dv++);
 }
 
+template <class IN, class OUT> inline void
+Warp::warpLine(IN in, OUT out, const FracArray& frac) const
+{
+    out += frac.lmost;
+    warpLine(in, out, frac.us.cbegin(), frac.us.cend(),
+	     frac.vs.cbegin(), frac.du.cbegin(), frac.dv.cbegin());
+}
+
+#if defined(TU_SIMD_DISPATCH)
+inline void
+Warp::warpLine(range_iterator<const u_char*, 0, 0> in,
+	       u_char* out, const FracArray& frac) const
+{
+    simd::dispatched_kernels().warp_line(std::cbegin(*in), in.stride(),
+					 (*in).size(),
+					 ptr<const short*>(frac.us.data()),
+					 ptr<const short*>(frac.vs.data()),
+					 ptr<const u_char*>(frac.du.data()),
+					 ptr<const u_char*>(frac.dv.data()),
+					 frac.width(), out + frac.lmost);
+}
+#endif
+
 }	// namespace TU
 #endif	// !TU_WARP_H
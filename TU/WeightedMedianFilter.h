@@ -6,13 +6,13 @@
 #ifndef TU_WEIGHTEDMEDIANFILTER_H
 #define TU_WEIGHTEDMEDIANFILTER_H
 
-#include <boost/intrusive/list.hpp>
+#include <limits>
 #include <boost/iterator/counting_iterator.hpp>
 #include "TU/Quantizer.h"
 #include "TU/algorithm.h"	// diff(const T&, const T&)
 #if defined(USE_TBB)
 #  include <tbb/parallel_for.h>
-#  include <tbb/blocked_range.h>
+#  include <tbb/blocked_range2d.h>
 #endif
 #include "TU/Profiler.h"
 
@@ -86,30 +86,12 @@ class WeightedMedianFilterBase
     using warray_type	= decltype(*std::declval<warray2_type>().cbegin());
 
   protected:
-  //! 入力信号の各量子化レベルに対して，対応するガイド信号の各量子化レベル毎の頻度
-    class Histogram : public Array<size_t>
-    {
-      public:
-	void	resize(size_t nbinsG)
-		{
-		    Array<size_t>::resize(nbinsG);
-		    Array<size_t>::operator =(0);
-		    _n = 0;
-		}
-	void	add(size_t idxG)		{ ++(*this)[idxG]; ++_n; }
-	void	remove(size_t idxG)		{ --(*this)[idxG]; --_n; }
-	auto	npoints()		const	{ return _n; }
-	    
-      private:
-	size_t	_n = 0;		// ヒストグラムに登録されている点の総数
-    };
-
   //! ガイド信号の各量子化レベルに対して，cut point前後の入力信号量子化レベルの頻度の差
-    class BalanceCountingBox : public boost::intrusive::list_base_hook<>
+    class BalanceCountingBox
     {
       public:
 	void	clear()				{ _diff = 0; _n = 0; }
-		operator ptrdiff_t()	const	{ return _diff; }
+		operator int()		const	{ return _diff; }
 	auto	add(bool low)
 		{
 		    if (low)
@@ -126,58 +108,82 @@ class WeightedMedianFilterBase
 			++_diff;
 		    return --_n;
 		}
-	auto	operator +=(ptrdiff_t m)	{ return _diff += m; }
-	auto	operator -=(ptrdiff_t m)	{ return _diff -= m; }
-	    
+	auto	operator +=(int m)		{ return _diff += m; }
+	auto	operator -=(int m)		{ return _diff -= m; }
+
       private:
-	ptrdiff_t	_diff = 0;	// cut point前後の点の数の差
-	size_t		_n    = 0;	// この box 中の点の数
+	int	_diff = 0;	// cut point前後の点の数の差
+	u_short	_n    = 0;	// この box 中の点の数
+    };
+
+  //! 空でない BalanceCountingBox を番号で連結する循環双方向リストの節点
+    struct NecklaceLink
+    {
+	u_int	prev;		// 前の box の番号
+	u_int	next;		// 次の box の番号
     };
 
   //! 重み付けメディアン値を与えるcut pointの探索器
+  /*!
+    入力信号とガイド信号の量子化レベルの組毎の頻度を16bitカウンタによる
+    1枚の結合ヒストグラムに保持する．256x256レベルでも作業領域は約130KBで
+    あり，並列処理の各タスクが1つずつ持ってもL2キャッシュに収まる．
+    空でない box は necklace table，すなわち box の番号で互いを指す
+    循環双方向リストによって連結される．
+    ウィンドウ内の点の数は maxPoints() を越えてはならない．
+  */
     class MedianTracker
     {
       private:
-	using	nonzero_boxes_t	= boost::intrusive::list<BalanceCountingBox>;
+	using count_type	= u_short;	// 頻度の型
 	
       public:
-		MedianTracker()	:_median(0)				{}
+		MedianTracker()	:_nbinsG(0), _median(0)			{}
 		MedianTracker(size_t nbinsI, size_t nbinsG)
-		    :_histograms(nbinsI), _boxes(nbinsG), _median(0)
 		{
-		    for (auto& hist : _histograms)
-			hist.resize(nbinsG);
+		    initialize(nbinsI, nbinsG);
+		}
+
+	static size_t
+		maxPoints()
+		{
+		    return std::numeric_limits<count_type>::max();
 		}
 	
 	void	initialize(size_t nbinsI, size_t nbinsG)
 		{
-		    _histograms.resize(nbinsI);
-		    for (auto& hist : _histograms)
-			hist.resize(nbinsG);
+		    _nbinsG = nbinsG;
+		    _histogram.resize(nbinsI*nbinsG);
+		    _histogram = 0;
+		    _npoints.resize(nbinsI);
+		    _npoints = 0;
 
 		    _boxes.resize(nbinsG);
 		    for (auto& box : _boxes)
 			box.clear();
-		    _nonzero_boxes.clear();
+
+		  // 最後の節点は necklace の番兵
+		    _necklace.resize(nbinsG + 1);
+		    _necklace[nbinsG] = {u_int(nbinsG), u_int(nbinsG)};
 		    _median = 0;
 		}
 
 	void	add(size_t idxI, size_t idxG)
 		{
-		    _histograms[idxI].add(idxG);
+		    ++_histogram[idxI*_nbinsG + idxG];
+		    ++_npoints[idxI];
 		    
-		    auto&	box = _boxes[idxG];
-		    if (box.add(idxI < _median) == 1)
-			_nonzero_boxes.push_back(box);
+		    if (_boxes[idxG].add(idxI < _median) == 1)
+			link(idxG);
 		}
 
 	void	remove(size_t idxI, size_t idxG)
 		{
-		    _histograms[idxI].remove(idxG);
+		    --_histogram[idxI*_nbinsG + idxG];
+		    --_npoints[idxI];
 
-		    auto&	box = _boxes[idxG];
-		    if (box.remove(idxI < _median) == 0)
-			_nonzero_boxes.erase(_nonzero_boxes.iterator_to(box));
+		    if (_boxes[idxG].remove(idxI < _median) == 0)
+			unlink(idxG);
 		}
 
 	template <class IDX_I, class IDX_G>
@@ -200,8 +206,9 @@ class WeightedMedianFilterBase
 		{
 		  // 現在の balance 値を計算する．
 		    weight_type	balance = 0;
-		    for (const auto& box : _nonzero_boxes)
-			balance += box * weights[idx(box)];
+		    for (auto idxG = _necklace[_nbinsG].next; idxG != _nbinsG;
+			 idxG = _necklace[idxG].next)
+			balance += _boxes[idxG] * weights[idxG];
 
 		    if (balance >= 0)	// balance >= 0 ならば...
 		    {			// balance < 0 となるまで
@@ -209,17 +216,18 @@ class WeightedMedianFilterBase
 			{
 			  // 空でないヒストグラムに遭遇するまで
 			  // cut point を左にシフト
-			    while (_histograms[--_median].npoints() == 0)
+			    while (_npoints[--_median] == 0)
 				;
 
 			  // 最右の空でないヒストグラム
-			    const auto&	hist = _histograms[_median];
+			    const auto	hist = histogram(_median);
 
 			  // 新たな cut point における balance を再計算
 			    balance = 0;
-			    for (auto& box : _nonzero_boxes)
+			    for (auto idxG = _necklace[_nbinsG].next;
+				 idxG != _nbinsG; idxG = _necklace[idxG].next)
 			    {
-				const auto	idxG = idx(box);
+				auto&	box = _boxes[idxG];
 				box	-= 2*hist[idxG];
 				balance += box * weights[idxG];
 			    }
@@ -233,18 +241,19 @@ class WeightedMedianFilterBase
 			{
 			  // 空でないヒストグラムに遭遇するまで
 			  // cut point を右にシフト
-			    while (_histograms[_median].npoints() == 0)
+			    while (_npoints[_median] == 0)
 				++_median;
 
 			  // 最左の空でないヒストグラム
-			    const auto&	hist = _histograms[_median];
+			    const auto	hist = histogram(_median);
 			    ++_median;
 			    
 			  // 新たな cut point における balance を再計算
 			    balance = 0;
-			    for (auto& box : _nonzero_boxes)
+			    for (auto idxG = _necklace[_nbinsG].next;
+				 idxG != _nbinsG; idxG = _necklace[idxG].next)
 			    {
-				const auto	idxG = idx(box);
+				auto&	box = _boxes[idxG];
 				box	+= 2*hist[idxG];
 				balance += box * weights[idxG];
 			    }
@@ -255,15 +264,31 @@ class WeightedMedianFilterBase
 		}
 	
       private:
-	auto	idx(const BalanceCountingBox& box) const
+	const count_type*
+		histogram(size_t idxI) const
 		{
-		    return &box - _boxes.data();
+		    return _histogram.data() + idxI*_nbinsG;
+		}
+	void	link(u_int idxG)
+		{
+		    auto&	head = _necklace[_nbinsG];
+		    _necklace[idxG] = {head.prev, _nbinsG};
+		    _necklace[head.prev].next = idxG;
+		    head.prev = idxG;
+		}
+	void	unlink(u_int idxG)
+		{
+		    const auto&	link = _necklace[idxG];
+		    _necklace[link.prev].next = link.next;
+		    _necklace[link.next].prev = link.prev;
 		}
 	
       private:
-	Array<Histogram>		_histograms;
+	u_int				_nbinsG;
+	Array<count_type>		_histogram;	// 結合ヒストグラム
+	Array<count_type>		_npoints;	// 入力レベル毎の点の数
 	Array<BalanceCountingBox>	_boxes;
-	nonzero_boxes_t			_nonzero_boxes;
+	Array<NecklaceLink>		_necklace;	// necklace table
 	size_t				_median;
     };
 
@@ -366,6 +391,8 @@ WeightedMedianFilter<T, W>::convolve(IN ib, IN ie, GUIDE gb, GUIDE ge,
 {
     if (std::distance(ib, ie) < winSize())
 	return;
+    if (winSize() > MedianTracker::maxPoints())
+	throw std::invalid_argument("TU::WeightedMedianFilter<T, W>::convolve(): too large window size!!");
 
     const auto&	indicesI = _quantizerI(ib, ie, nbinsI());  // 入力を量子化
     const auto&	indicesG = _quantizerG(gb, ge, nbinsG());  // ガイドを量子化
@@ -406,6 +433,9 @@ WeightedMedianFilter<T, W>::convolve(IN ib, IN ie, GUIDE gb, GUIDE ge,
 ************************************************************************/
 //! 2次元重み付けメディアンフィルタを表すクラス
 /*!
+  出力は幅 stripWidth() の列方向ストリップに分割され，各ストリップは
+  独自の探索器を持って蛇行走査される．TBB が使える場合は
+  grainSize() 行 x stripWidth() 列のブロック毎に並列処理される．
   \param T	出力信号の要素型
   \param W	重み付け関数オブジェクトの型
 */
@@ -429,10 +459,12 @@ class WeightedMedianFilter2 : public detail::WeightedMedianFilterBase<W>,
 	    :_wmf(wmf),
 	     _rowI(rowI), _rowG(rowG), _rowO(rowO), _shift(shift)	{}
 	    
-	void	operator ()(const tbb::blocked_range<size_t>& r) const
+	void	operator ()(const tbb::blocked_range2d<size_t>& r) const
 		{
-		    _wmf.filter(_rowI + r.begin(), _rowI + r.end(),
-				_rowG + r.begin(), _rowO + r.begin(), _shift);
+		    _wmf.filter(_rowI + r.rows().begin(),
+				_rowI + r.rows().end(),
+				_rowG + r.rows().begin(), _rowO + r.rows().begin(),
+				r.cols().begin(), r.cols().end(), _shift);
 		}
 
       private:
@@ -504,7 +536,7 @@ class WeightedMedianFilter2 : public detail::WeightedMedianFilterBase<W>,
     WeightedMedianFilter2(const W& wfunc=W(), size_t winSize=3,
 			  size_t nbinsI=256, size_t nbinsG=256)
 	:super(wfunc, winSize, nbinsI, nbinsG), pf_type(4),
-	 _grainSize(100)						{}
+	 _grainSize(100), _stripWidth(256)				{}
 
     using	super::winSize;
     using	super::outSize;
@@ -524,18 +556,26 @@ class WeightedMedianFilter2 : public detail::WeightedMedianFilterBase<W>,
 			 OUT out, bool shift=false)	;
     size_t	grainSize()			const	{return _grainSize;}
     void	setGrainSize(size_t gs)			{_grainSize = gs;}
+    size_t	stripWidth()			const	{return _stripWidth;}
+    void	setStripWidth(size_t sw)		{_stripWidth = sw;}
+    void	setPersistentPalettes(bool on)
+		{
+		    _quantizerI.setPersistent(on);
+		    _quantizerG.setPersistent(on);
+		}
     
   private:
     template <class ROW_I, class ROW_G, class ROW_O>
-    void	filter(ROW_I rowI, ROW_I rowIe,
-		       ROW_G rowG, ROW_O out, bool shift)	const	;
+    void	filter(ROW_I rowI, ROW_I rowIe, ROW_G rowG, ROW_O out,
+		       size_t cb, size_t ce, bool shift)	const	;
     template <class ROW_I, class ROW_G, class COL_C, class COL_G, class COL_O>
     void	filterRow(MedianTracker& tracker,
-			  ROW_I rowI, ROW_G rowG, COL_C c,
+			  ROW_I rowI, ROW_G rowG, COL_C c, size_t ncol,
 			  COL_G colG, COL_O colO)		const	;
     
   private:
     size_t			_grainSize;
+    size_t			_stripWidth;	// 列方向ストリップの出力幅
     Quantizer2<value_type>	_quantizerI;
     Quantizer2<guide_type>	_quantizerG;
 };
@@ -547,6 +587,8 @@ WeightedMedianFilter2<T, W>::convolve(IN ib, IN ie, GUIDE gb, GUIDE ge,
 {
     if (std::distance(ib, ie) < winSize() || ib->size() < winSize())
 	return;
+    if (winSize()*winSize() > MedianTracker::maxPoints())
+	throw std::invalid_argument("TU::WeightedMedianFilter2<T, W>::convolve(): too large window size!!");
 
     pf_type::start(0);
     const auto&	indicesI = _quantizerI(ib, ie, nbinsI());  // 入力を量子化
@@ -555,13 +597,19 @@ WeightedMedianFilter2<T, W>::convolve(IN ib, IN ie, GUIDE gb, GUIDE ge,
     pf_type::start(1);
     super::setWeights(_quantizerG);	// 重みの2次元lookup tableをセット
 
+  // 出力を幅 _stripWidth の列方向ストリップに分割し，それぞれ独自の
+  // 探索器を用いて処理する．
+    const size_t	nrow = outSize(indicesI.size());
+    const size_t	ncol = outSize(indicesI.begin()->size());
+    const size_t	sw   = (_stripWidth != 0 ? _stripWidth : ncol);
 #if defined(USE_TBB)
-    tbb::parallel_for(tbb::blocked_range<size_t>(
-			  0, indicesI.size() + 1 - winSize(), _grainSize),
+    tbb::parallel_for(tbb::blocked_range2d<size_t>(0, nrow, _grainSize,
+						   0, ncol, sw),
 		      makeFilter(indicesI.begin(), indicesG.begin(), out, shift));
 #else
-    filter(indicesI.begin(), indicesI.end() + 1 - winSize(),
-	   indicesG.begin(), out, shift);
+    for (size_t cb = 0; cb < ncol; cb += sw)
+	filter(indicesI.begin(), indicesI.begin() + nrow, indicesG.begin(),
+	       out, cb, std::min(cb + sw, ncol), shift);
 #endif
     pf_type::nextFrame();
 }
@@ -569,7 +617,8 @@ WeightedMedianFilter2<T, W>::convolve(IN ib, IN ie, GUIDE gb, GUIDE ge,
 template <class T, class W>
 template <class ROW_I, class ROW_G, class ROW_O> void
 WeightedMedianFilter2<T, W>::filter(ROW_I rowI, ROW_I rowIe,
-				    ROW_G rowG, ROW_O rowO, bool shift) const
+				    ROW_G rowG, ROW_O rowO,
+				    size_t cb, size_t ce, bool shift) const
 {
     using col_iterator	= boost::counting_iterator<size_t>;
     using rcol_iterator	= reverse_iterator<col_iterator>;
@@ -578,11 +627,14 @@ WeightedMedianFilter2<T, W>::filter(ROW_I rowI, ROW_I rowIe,
     auto	endI = rowI;
     std::advance(endI, winSize() - 1);	// ウィンドウの最下行
     auto	midG = rowG;
+    const auto	ncol = ce + winSize() - 1 - cb;	// ストリップの入力幅
+    const auto	rcb  = rowI->size() - (cb + ncol);	// 右端からの開始列
 
   // ウィンドウ初期位置におけるヒストグラムをセット
     MedianTracker	tracker(_quantizerI.size(), _quantizerG.size());
     for (auto row = rowI; row != endI; ++row, ++midG)
-	tracker.add(row->begin(), row->begin() + winSize() - 1, midG->begin());
+	tracker.add(row->begin() + cb, row->begin() + cb + winSize() - 1,
+		    midG->begin() + cb);
     
     pf_type::start(3);
     const auto	mid   = offset();
@@ -599,15 +651,16 @@ WeightedMedianFilter2<T, W>::filter(ROW_I rowI, ROW_I rowIe,
     {
 	if (!reverse)
 	{
-	    filterRow(tracker, rowI, rowG, col_iterator(0),
-		      midG->begin() + mid, rowO->begin() + midO);
+	    filterRow(tracker, rowI, rowG, col_iterator(cb), ncol,
+		      midG->begin() + cb + mid, rowO->begin() + cb + midO);
 	    reverse = true;
 	}
 	else
 	{
 	    filterRow(tracker, rowI, rowG,
-		      rcol_iterator(col_iterator(rowI->size())),
-		      midG->rbegin() + rmid, rowO->rbegin() + rmidO);
+		      rcol_iterator(col_iterator(cb + ncol)), ncol,
+		      midG->rbegin() + rcb + rmid,
+		      rowO->rbegin() + rcb + rmidO);
 	    reverse = false;
 	}
 
@@ -621,7 +674,7 @@ template <class T, class W>
 template <class ROW_I, class ROW_G, class COL_C, class COL_G, class COL_O> void
 WeightedMedianFilter2<T, W>::filterRow(MedianTracker& tracker,
 				       ROW_I rowI, ROW_G rowG,
-				       COL_C head,
+				       COL_C head, size_t ncol,
 				       COL_G colG, COL_O colO) const
 {
     auto	endI = rowI;
@@ -636,7 +689,7 @@ WeightedMedianFilter2<T, W>::filterRow(MedianTracker& tracker,
 	tracker.add(*(endI->begin() + *tail), *(endG->begin() + *tail));
     
     ++endI;					// 最下行の次
-    end = head + rowI->size();			// 列の右端／左端
+    end = head + ncol;				// ストリップの右端／左端
     
     for (; tail != end; ++head, ++tail)
     {
@@ -138,7 +138,7 @@
   - #TU::FIRFilter
   - #TU::FIRGaussianConvolver
   - #TU::WeightedMedianFilter
-  - #boost::TreeFilter
+  - #TU::TreeFilter
 
   <b>特殊データ構造</b>
   - #TU::List
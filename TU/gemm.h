@@ -0,0 +1,288 @@
+/*!
+  \file		gemm.h
+  \author	Toshio UESHIBA
+  \brief	キャッシュブロッキングとSIMD命令による密行列積の実装
+*/
+#ifndef TU_GEMM_H
+#define TU_GEMM_H
+
+#include <cstddef>
+#include <algorithm>
+#include <vector>
+#include "TU/simd/simd.h"
+#if defined(USE_TBB)
+#  include <tbb/parallel_for.h>
+#  include <tbb/blocked_range.h>
+#endif
+
+namespace TU
+{
+namespace detail
+{
+/************************************************************************
+*  struct gemm_kernel<T>						*
+************************************************************************/
+//! 密行列積 C = A*B を計算するブロッキング済みカーネル
+/*!
+  BLIS と同様に，B を KC x NC のパネルに，A を MC x KC のブロックに
+  詰め直した上で，MR x NR の C の小行列をレジスタに保持したまま積和を
+  計算する．NR は SIMD ベクトルの要素数の2倍である．
+  \param T	成分の型(float または double)
+*/
+template <class T>
+struct gemm_kernel
+{
+#if defined(SIMD)
+    using vec_type	= simd::vec<T>;
+    constexpr static size_t	V  = vec_type::size;	//!< ベクトルの要素数
+#  if defined(AVX)
+    constexpr static size_t	MR = 6;			//!< 小行列の行数
+#  else
+    constexpr static size_t	MR = 4;			//!< 小行列の行数
+#  endif
+#else
+    using vec_type	= T;
+    constexpr static size_t	V  = 1;			//!< ベクトルの要素数
+    constexpr static size_t	MR = 4;			//!< 小行列の行数
+#endif
+    constexpr static size_t	NV = (V == 1 ? 4 : 2);	//!< 列方向のベクトル数
+    constexpr static size_t	NR = NV*V;		//!< 小行列の列数
+    constexpr static size_t	KC = 256;		//!< パネルの行数
+    constexpr static size_t	MC = 16*MR;		//!< ブロックの行数
+    constexpr static size_t	NC = 128*NR;		//!< パネルの列数
+
+    static void	pack_a(size_t mc, size_t kc,
+		       const T* a, ptrdiff_t rsa, ptrdiff_t csa, T* ap)	;
+    static void	pack_b(size_t kc, size_t nc,
+		       const T* b, ptrdiff_t rsb, ptrdiff_t csb, T* bp)	;
+    static void	micro_kernel(size_t kc, const T* ap, const T* bp,
+			     T* c, ptrdiff_t ldc,
+			     size_t mr, size_t nr, bool accumulate)	;
+    static void	macro_kernel(size_t mc, size_t nc, size_t kc,
+			     const T* ap, const T* bp,
+			     T* c, ptrdiff_t ldc, bool accumulate)	;
+
+  private:
+#if defined(SIMD)
+    static vec_type	load(const T* p)	{ return simd::load(p); }
+    static void		store(T* p, vec_type x)	{ simd::store(p, x); }
+    static vec_type	fma(vec_type x, vec_type y, vec_type z)
+			{
+			    return simd::fma(x, y, z);
+			}
+#else
+    static vec_type	load(const T* p)	{ return *p; }
+    static void		store(T* p, vec_type x)	{ *p = x; }
+    static vec_type	fma(vec_type x, vec_type y, vec_type z)
+			{
+			    return x*y + z;
+			}
+#endif
+};
+
+//! A の mc x kc ブロックを MR 行ずつの帯に分け，各帯を列優先で詰め直す．
+/*!
+  行数が MR に満たない最後の帯は0で埋める．
+*/
+template <class T> void
+gemm_kernel<T>::pack_a(size_t mc, size_t kc,
+		       const T* a, ptrdiff_t rsa, ptrdiff_t csa, T* ap)
+{
+    for (size_t i = 0; i < mc; i += MR, ap += MR*kc)
+    {
+	const auto	mr = std::min(MR, mc - i);
+
+	for (size_t r = 0; r < mr; ++r)
+	{
+	    auto	q = a + (i + r)*rsa;
+	    for (size_t p = 0; p < kc; ++p, q += csa)
+		ap[p*MR + r] = *q;
+	}
+	for (size_t r = mr; r < MR; ++r)
+	    for (size_t p = 0; p < kc; ++p)
+		ap[p*MR + r] = 0;
+    }
+}
+
+//! B の kc x nc パネルを NR 列ずつの帯に分け，各帯を行優先で詰め直す．
+/*!
+  列数が NR に満たない最後の帯は0で埋める．
+*/
+template <class T> void
+gemm_kernel<T>::pack_b(size_t kc, size_t nc,
+		       const T* b, ptrdiff_t rsb, ptrdiff_t csb, T* bp)
+{
+    for (size_t j = 0; j < nc; j += NR, bp += NR*kc)
+    {
+	const auto	nr = std::min(NR, nc - j);
+
+	for (size_t p = 0; p < kc; ++p)
+	{
+	    auto	q = b + p*rsb + j*csb;
+	    auto	dst = bp + p*NR;
+	    size_t	c = 0;
+	    for (; c < nr; ++c, q += csb)
+		dst[c] = *q;
+	    for (; c < NR; ++c)
+		dst[c] = 0;
+	}
+    }
+}
+
+//! 詰め直された A の帯と B の帯から C の MR x NR 小行列を計算する．
+/*!
+  \param kc		積和をとる長さ
+  \param ap		詰め直された A の帯
+  \param bp		詰め直された B の帯
+  \param c		C の小行列の左上成分
+  \param ldc		C の行の間隔
+  \param mr		C の小行列の実際の行数(<= MR)
+  \param nr		C の小行列の実際の列数(<= NR)
+  \param accumulate	trueならば結果を C に加え，falseならば上書きする
+*/
+template <class T> void
+gemm_kernel<T>::micro_kernel(size_t kc, const T* ap, const T* bp,
+			     T* c, ptrdiff_t ldc,
+			     size_t mr, size_t nr, bool accumulate)
+{
+    vec_type	acc[MR][NV];
+    for (size_t r = 0; r < MR; ++r)
+	for (size_t v = 0; v < NV; ++v)
+	    acc[r][v] = vec_type(0);
+
+    for (size_t p = 0; p < kc; ++p, ap += MR, bp += NR)
+    {
+	vec_type	b[NV];
+	for (size_t v = 0; v < NV; ++v)
+	    b[v] = load(bp + v*V);
+	for (size_t r = 0; r < MR; ++r)
+	{
+	    const vec_type	a(ap[r]);
+	    for (size_t v = 0; v < NV; ++v)
+		acc[r][v] = fma(a, b[v], acc[r][v]);
+	}
+    }
+
+    if (mr == MR && nr == NR)
+    {
+	for (size_t r = 0; r < MR; ++r, c += ldc)
+	    for (size_t v = 0; v < NV; ++v)
+		store(c + v*V, (accumulate ? acc[r][v] + load(c + v*V)
+					   : acc[r][v]));
+    }
+    else
+    {
+	T	buf[MR*NR];
+	for (size_t r = 0; r < MR; ++r)
+	    for (size_t v = 0; v < NV; ++v)
+		store(buf + r*NR + v*V, acc[r][v]);
+	for (size_t r = 0; r < mr; ++r, c += ldc)
+	    for (size_t j = 0; j < nr; ++j)
+		c[j] = (accumulate ? c[j] + buf[r*NR + j] : buf[r*NR + j]);
+    }
+}
+
+//! 詰め直された A のブロックと B のパネルから C の mc x nc 部分を計算する．
+template <class T> void
+gemm_kernel<T>::macro_kernel(size_t mc, size_t nc, size_t kc,
+			     const T* ap, const T* bp,
+			     T* c, ptrdiff_t ldc, bool accumulate)
+{
+    for (size_t j = 0; j < nc; j += NR)
+    {
+	const auto	nr = std::min(NR, nc - j);
+	const auto	bq = bp + j*kc;
+
+	for (size_t i = 0; i < mc; i += MR)
+	    micro_kernel(kc, ap + i*kc, bq, c + i*ldc + j, ldc,
+			 std::min(MR, mc - i), nr, accumulate);
+    }
+}
+}	// namespace detail
+
+/************************************************************************
+*  gemm(m, n, k, a, rsa, csa, b, rsb, csb, c, ldc)			*
+************************************************************************/
+//! 密行列積 C = A*B を計算する．
+/*!
+  A, B は行方向と列方向の間隔によって指定されるので，転置された行列も
+  コピーせずに渡せる．TBB が使える場合は C の MC x NC ブロック毎に並列に
+  計算する．
+  \param m	A と C の行数
+  \param n	B と C の列数
+  \param k	A の列数かつ B の行数
+  \param a	A の左上成分
+  \param rsa	A の行の間隔
+  \param csa	A の列の間隔
+  \param b	B の左上成分
+  \param rsb	B の行の間隔
+  \param csb	B の列の間隔
+  \param c	C の左上成分
+  \param ldc	C の行の間隔
+*/
+template <class T> void
+gemm(size_t m, size_t n, size_t k,
+     const T* a, ptrdiff_t rsa, ptrdiff_t csa,
+     const T* b, ptrdiff_t rsb, ptrdiff_t csb, T* c, ptrdiff_t ldc)
+{
+    using kernel	= detail::gemm_kernel<T>;
+    constexpr auto	NR = kernel::NR;
+    constexpr auto	KC = kernel::KC;
+    constexpr auto	MC = kernel::MC;
+    constexpr auto	NC = kernel::NC;
+
+    if (k == 0)
+    {
+	for (size_t i = 0; i < m; ++i)
+	    std::fill_n(c + i*ldc, n, T(0));
+	return;
+    }
+
+    std::vector<T>	bp(KC*((std::min(NC, n) + NR - 1)/NR)*NR);
+    const auto		nblocks = (m + MC - 1)/MC;
+
+    for (size_t jc = 0; jc < n; jc += NC)
+    {
+	const auto	nc = std::min(NC, n - jc);
+
+	for (size_t pc = 0; pc < k; pc += KC)
+	{
+	    const auto	kc = std::min(KC, k - pc);
+	    const auto	accumulate = (pc != 0);
+
+	    kernel::pack_b(kc, nc, b + pc*rsb + jc*csb, rsb, csb, bp.data());
+
+	    const auto	block = [=, &bp](size_t ib, size_t ie)
+				{
+				    std::vector<T>	ap(MC*kc);
+
+				    for (; ib != ie; ++ib)
+				    {
+					const auto	ic = ib*MC;
+					const auto	mc = std::min(MC, m - ic);
+
+					kernel::pack_a(mc, kc,
+						       a + ic*rsa + pc*csa,
+						       rsa, csa, ap.data());
+					kernel::macro_kernel(mc, nc, kc,
+							     ap.data(),
+							     bp.data(),
+							     c + ic*ldc + jc,
+							     ldc, accumulate);
+				    }
+				};
+#if defined(USE_TBB)
+	    tbb::parallel_for(tbb::blocked_range<size_t>(0, nblocks, 1),
+			      [&block](const tbb::blocked_range<size_t>& r)
+			      {
+				  block(r.begin(), r.end());
+			      });
+#else
+	    block(0, nblocks);
+#endif
+	}
+    }
+}
+
+}	// namespace TU
+#endif	// !TU_GEMM_H
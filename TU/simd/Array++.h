@@ -8,6 +8,7 @@
 
 #include "TU/Array++.h"
 #include "TU/simd/simd.h"
+#include "TU/gemm.h"
 
 namespace TU
 {
@@ -149,5 +150,219 @@ class BufTraits<simd::vec<T>, ALLOC>
     static auto		ptr(pointer p)	{ return p.base(); }
 };
 #endif	// defined(SIMD)
+
+/************************************************************************
+*  products of 2-D arrays evaluated by gemm()				*
+************************************************************************/
+namespace detail
+{
+  //! 2つの2次元配列式の積を gemm() で計算すべきか判定する
+  /*!
+    両辺の成分が同一の浮動小数点型であり，かつ行数がコンパイル時に
+    決まっていない場合に限る．固定サイズの小行列の積は従来通り
+    product_opnode によって計算する．
+  */
+  template <class L, class R,
+	    bool=(TU::rank<L>() == 2 && TU::rank<R>() == 2)>
+  struct use_gemm : std::false_type
+  {
+  };
+  template <class L, class R>
+  struct use_gemm<L, R, true>
+      : std::integral_constant<
+		bool,
+		std::is_same<std::decay_t<TU::element_t<L> >,
+			     std::decay_t<TU::element_t<R> > >::value &&
+		std::is_floating_point<std::decay_t<TU::element_t<L> > >::value &&
+		TU::size0<L>() == 0 && TU::size0<R>() == 0 &&
+		!(is_transposed<L>::value && is_transposed<R>::value)>
+  {
+  };
+
+  //! 2つの2次元配列式の積を表すクラス
+  /*!
+    積の総演算数が閾値以上であれば，両辺を行方向と列方向の間隔で表して
+    gemm() により一括して評価する．閾値未満であれば product_opnode と
+    同じく各行ごとに評価する．
+    \param L	左辺の2次元配列式の型
+    \param R	右辺の2次元配列式の型
+  */
+  template <class L, class R>
+  class gemm_opnode : public opnode<gemm_opnode<L, R> >
+  {
+    private:
+      using element_type = std::decay_t<TU::element_t<L> >;
+      using cache_t	 = array<element_type,
+				 std::allocator<element_type>, 0, 0>;
+
+      struct view
+      {
+	  const element_type*	p;	// 左上成分
+	  ptrdiff_t		rs;	// 行の間隔
+	  ptrdiff_t		cs;	// 列の間隔
+      };
+
+      template <class E_>
+      struct is_dense : std::false_type					{};
+      template <size_t R_, size_t C_>
+      struct is_dense<array<element_type,
+			    std::allocator<element_type>, R_, C_> >
+	  : std::true_type						{};
+
+    // これ未満の乗算回数であれば gemm() を使わない
+      constexpr static size_t	MinOps = 32*32*32;
+
+    public:
+		gemm_opnode(L&& l, R&& r)
+		    :_l(std::forward<L>(l)), _r(std::forward<R>(r)),
+		     _valid(false), _cache()
+		{
+		    assert(TU::size<1>(l) == TU::size<0>(r));
+		}
+
+      constexpr static size_t
+		size0()
+		{
+		    return 0;
+		}
+      auto	begin()	const
+		{
+		    return evaluate().begin();
+		}
+      auto	end() const
+		{
+		    return evaluate().end();
+		}
+      auto	size() const
+		{
+		    return TU::size<0>(_l);
+		}
+      decltype(auto)
+		operator [](size_t i) const
+		{
+		    return evaluate()[i];
+		}
+
+    //! 積を評価してその結果を返す
+      const auto&
+		evaluate() const
+		{
+		    if (!_valid)
+		    {
+			const size_t	m = TU::size<0>(_l);
+			const size_t	k = TU::size<1>(_l);
+			const size_t	n = TU::size<1>(_r);
+
+			if (m*n*k < MinOps)
+			    _cache = make_product_opnode(
+					_l, _r,
+					[](auto&& x, auto&& y)
+					{ return std::forward<decltype(x)>(x)
+					       * std::forward<decltype(y)>(y); });
+			else
+			{
+			    cache_t	tmpl, tmpr;
+			    const auto	a = make_view(_l, tmpl);
+			    const auto	b = make_view(_r, tmpr);
+
+			    _cache.resize(m, n);
+			    gemm(m, n, k, a.p, a.rs, a.cs, b.p, b.rs, b.cs,
+				 _cache.data(), _cache.stride());
+			}
+			_valid = true;
+		    }
+
+		    return _cache;
+		}
+
+    private:
+    // 成分が連続して格納された配列はそのまま参照し，
+    // それ以外の式は評価結果を tmp に保存して参照する
+      template <size_t R_, size_t C_>
+      static view
+		make_view(const array<element_type,
+				      std::allocator<element_type>,
+				      R_, C_>& a, cache_t&)
+		{
+		    return {a.data(), ptrdiff_t(a.stride()), 1};
+		}
+      template <class E_>
+      static view
+		make_view(const transpose_opnode<E_>& expr, cache_t& tmp)
+		{
+		    return make_view(expr, tmp,
+				     std::integral_constant<
+					 bool,
+					 std::is_lvalue_reference<E_>::value &&
+					 is_dense<std::decay_t<E_> >::value>());
+		}
+      template <class E_>
+      static view
+		make_view(const transpose_opnode<E_>& expr, cache_t&,
+			  std::true_type)
+		{
+		    const auto&	a = expr.transpose();
+		    return {a.data(), 1, ptrdiff_t(a.stride())};
+		}
+      template <class E_>
+      static view
+		make_view(const transpose_opnode<E_>& expr, cache_t& tmp,
+			  std::false_type)
+		{
+		    return substantiate(expr, tmp);
+		}
+      template <class E_>
+      static view
+		make_view(const E_& expr, cache_t& tmp)
+		{
+		    return substantiate(expr, tmp);
+		}
+      template <class E_>
+      static view
+		substantiate(const E_& expr, cache_t& tmp)
+		{
+		    tmp = expr;
+		    return {tmp.data(), ptrdiff_t(tmp.stride()), 1};
+		}
+
+    private:
+      const L		_l;		// rank<L>() == 2 である左辺
+      const R		_r;		// rank<R>() == 2 である右辺
+      mutable bool	_valid;		// _cache の有効性
+      mutable cache_t	_cache;		// _l * _r の計算結果
+  };
+
+  template <class L, class R>
+  struct has_blocked_product<L, R, std::enable_if_t<use_gemm<L, R>::value> >
+      : std::true_type
+  {
+  };
+}	// namespace detail
+
+//! 2つの2次元配列式の積の評価結果を返す
+/*!
+  \param expr	gemm() によって評価される積の式
+  \return	積の評価結果である2次元配列
+*/
+template <class L, class R> inline auto
+evaluate(const detail::gemm_opnode<L, R>& expr)
+{
+    return expr.evaluate();
+}
+
+//! 成分が浮動小数点数でサイズが可変な2つの2次元配列式の積をとる.
+/*!
+  積が大きければ評価時に gemm() によってブロック毎に計算される．
+  \param l	左辺の2次元配列式
+  \param r	右辺の2次元配列式
+  \return	積を表す演算子ノード
+*/
+template <class L, class R,
+	  std::enable_if_t<detail::use_gemm<L, R>::value>* = nullptr>
+inline auto
+operator *(L&& l, R&& r)
+{
+    return detail::gemm_opnode<L, R>(std::forward<L>(l), std::forward<R>(r));
+}
 }	// namespace TU
 #endif	// !TU_SIMD_ARRAYPP_H
@@ -11,6 +11,7 @@
 #include "TU/simd/cast.h"
 #include "TU/simd/logical.h"
 #include "TU/simd/zero.h"
+#include "TU/simd/shift.h"
 
 namespace TU
 {
@@ -102,6 +103,33 @@ inline vec<T>	fma(vec<T> x, vec<T> y, vec<T> z)	{return x*y + z;}
 ************************************************************************/
 template <class T> inline T		hadd(vec<T> x)			;
 
+/************************************************************************
+*  Horizontal minimum							*
+************************************************************************/
+template <class T> inline vec<T>
+hmin_impl(vec<T> x, std::integral_constant<size_t, 0>)
+{
+    return x;
+}
+    
+template <class T, size_t I> inline vec<T>
+hmin_impl(vec<T> x, std::integral_constant<size_t, I>)
+{
+    return hmin_impl(min(x, shift_r<I>(x, x)),
+		     std::integral_constant<size_t, (I >> 1)>());
+}
+
+//! ベクトルの全成分の最小値を求める．
+/*!
+  \param x	ベクトル
+  \return	最小値
+*/
+template <class T> inline T
+hmin(vec<T> x)
+{
+    return hmin_impl(x, std::integral_constant<size_t, (vec<T>::size >> 1)>())[0];
+}
+
 /************************************************************************
 *  Arithmetic operators for vec tuples					*
 ************************************************************************/
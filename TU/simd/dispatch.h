@@ -0,0 +1,91 @@
+/*!
+  \file		dispatch.h
+  \author	Toshio UESHIBA
+  \brief	実行時にCPUのSIMD命令セットに応じてカーネルを選択する仕組み
+*/
+#if !defined(TU_SIMD_DISPATCH_H)
+#define TU_SIMD_DISPATCH_H
+
+#include <cstddef>
+#include <cstdint>
+
+namespace TU
+{
+namespace simd
+{
+/************************************************************************
+*  enum class isa							*
+************************************************************************/
+//! SIMD命令セット
+enum class isa
+{
+    none, sse2, sse3, ssse3, sse4, avx, avx2, avx512, neon
+};
+
+//! 実行中のCPUがサポートする最上位のSIMD命令セットを返す．
+isa		cpu_isa()						;
+
+//! SIMD命令セットの名前を返す．
+const char*	isa_name(isa target)					;
+
+/************************************************************************
+*  struct kernels							*
+************************************************************************/
+//! 特定のSIMD命令セット向けにビルドされたカーネルの関数表
+/*!
+  ライブラリを TU_SIMD_DISPATCH を定義してビルドすると，各カーネルは
+  複数のSIMD命令セット向けにそれぞれコンパイルされ，dispatched_kernels()
+  によって実行中のCPUで使える最上位のものが選ばれる．
+*/
+struct kernels
+{
+    isa		target;		//!< このカーネル群が対象とする命令セット
+
+  //! EdgeDetector::strength() の1行分
+    void	(*edge_strength)(const float* eH, const float* eV,
+				 float* out, size_t n)			;
+  //! EdgeDetector::direction4() の1行分
+    void	(*edge_direction4)(const float* eH, const float* eV,
+				   uint8_t* out, size_t n)		;
+  //! EdgeDetector::direction4x() の1行分
+    void	(*edge_direction4x)(const float* eH, const float* eV,
+				    uint8_t* out, size_t n)		;
+  //! EdgeDetector::direction8() の1行分
+    void	(*edge_direction8)(const float* eH, const float* eV,
+				   uint8_t* out, size_t n)		;
+  //! EdgeDetector::direction8x() の1行分
+    void	(*edge_direction8x)(const float* eH, const float* eV,
+				    uint8_t* out, size_t n)		;
+  //! Warp による uint8_t 画像の1行分の変形
+    void	(*warp_line)(const uint8_t* in, ptrdiff_t stride,
+			     size_t ncol,
+			     const int16_t* us, const int16_t* vs,
+			     const uint8_t* du, const uint8_t* dv,
+			     size_t n, uint8_t* out)			;
+  //! BoxFilter2<float>::convolveRows()
+    void	(*box_filter_rows)(const float* in, ptrdiff_t istride,
+				   size_t nrow, size_t ncol,
+				   float* out, ptrdiff_t ostride,
+				   size_t winSizeV, size_t winSizeH,
+				   bool shift)				;
+  //! SADStereo<short, DISP>::updateDissimilarities() の2眼の場合
+    void	(*sad_update)(const uint8_t* colL, const uint8_t* colLe,
+			      const uint8_t* colR,
+			      const uint8_t* colLp, const uint8_t* colRp,
+			      int16_t* Q, ptrdiff_t stride, size_t D,
+			      uint8_t thresh)				;
+};
+
+//! 実行中のCPUに応じて選ばれたカーネル群を返す．
+/*!
+  最初の呼び出し時にCPUがサポートする命令セットを調べ，ライブラリに
+  組み込まれたカーネル群の中から使用可能な最上位のものを選ぶ．環境変数
+  TU_SIMD_ISA に命令セットの名前(sse2, sse4, avx2, avx512 など)を与えると，
+  それを上限として選ぶ．
+  \return	選ばれたカーネル群
+*/
+const kernels&	dispatched_kernels()					;
+
+}	// namespace simd
+}	// namespace TU
+#endif	// !TU_SIMD_DISPATCH_H
@@ -27,6 +27,7 @@
 #  include "TU/simd/misc.h"
 #  include "TU/simd/transform.h"
 #  include "TU/simd/lookup.h"
+#  include "TU/simd/transpose.h"
 
 #  include "TU/simd/load_store_iterator.h"
 #  include "TU/simd/cvtdown_iterator.h"
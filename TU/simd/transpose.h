@@ -0,0 +1,61 @@
+/*!
+  \file		transpose.h
+  \author	Toshio UESHIBA
+  \brief	SIMDベクトルの並びを正方行列とみなして転置する関数の定義
+*/
+#if !defined(TU_SIMD_TRANSPOSE_H)
+#define TU_SIMD_TRANSPOSE_H
+
+#include <algorithm>
+#include "TU/simd/vec.h"
+#include "TU/simd/load_store.h"
+#if defined(SSE2)
+#  include "TU/simd/x86/unpack.h"
+#endif
+
+namespace TU
+{
+namespace simd
+{
+/************************************************************************
+*  Transposition of a square matrix					*
+************************************************************************/
+//! vec<T>::size 本のベクトルをそれぞれ正方行列の行とみなして転置する．
+/*!
+  x86 では unpack による完全シャッフルを log2(vec<T>::size) 段繰り返して
+  レジスタ内で転置し，それ以外ではメモリを介して転置する．
+  \param x	vec<T>::size 本のベクトルの配列．転置結果で上書きされる
+*/
+template <class T> inline void
+transpose(vec<T>* x)
+{
+    constexpr size_t	N = vec<T>::size;
+
+#if defined(SSE2)
+    for (size_t n = 1; n < N; n <<= 1)
+    {
+	vec<T>	y[N];
+	for (size_t i = 0; i < N/2; ++i)
+	{
+	    y[2*i]     = unpack<false>(x[i], x[i + N/2]);
+	    y[2*i + 1] = unpack<true >(x[i], x[i + N/2]);
+	}
+	std::copy(y, y + N, x);
+    }
+#else
+    alignas(sizeof(vec<T>)) T	buf[N*N];
+    for (size_t i = 0; i < N; ++i)
+	store<true>(buf + i*N, x[i]);
+    for (size_t j = 0; j < N; ++j)
+    {
+	alignas(sizeof(vec<T>)) T	col[N];
+	for (size_t i = 0; i < N; ++i)
+	    col[i] = buf[i*N + j];
+	x[j] = load<true>(col);
+    }
+#endif
+}
+
+}	// namespace simd
+}	// namespace TU
+#endif	// !TU_SIMD_TRANSPOSE_H
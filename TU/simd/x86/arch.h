@@ -33,14 +33,21 @@
 // AVX以降では alignr が上下のlaneに分断されて使いにくいので，自然なバージョンを定義
 #if defined(AVX512)
   template <size_t N> inline __m512i
-  emu_alignr_impl(__m512i y, __m512i x, std::integral_constant<int, 0>)
+  emu_alignr_impl(__m512i y, __m512i x, std::true_type)
   {
-      return _mm512_permutex2var_epi8(x, y, 0x21), x, N);
+      return _mm512_alignr_epi8(_mm512_alignr_epi32(y, x, 4*(N/16 + 1)),
+				_mm512_alignr_epi32(y, x, 4*(N/16)), N%16);
+  }
+  template <size_t N> inline __m512i
+  emu_alignr_impl(__m512i y, __m512i x, std::false_type)
+  {
+      return _mm512_alignr_epi8(y, _mm512_alignr_epi32(y, x, 12), N - 48);
+  }
+  template <size_t N> inline __m512i
+  emu_alignr(__m512i y, __m512i x)
+  {
+      return emu_alignr_impl<N>(y, x, std::integral_constant<bool, (N < 48)>());
   }
-
-
-
-
 #endif
 #if defined(AVX)
 #  if defined(AVX2)
@@ -96,6 +103,19 @@
 
 // AVX以降では srli_si256, slli_si256 が上下のlaneに分断されて使いにくいので，
 // 自然なバージョンを定義
+#if defined(AVX512)
+  template <size_t N> inline __m512i
+  emu_srli(__m512i x)
+  {
+      return emu_alignr<N>(_mm512_setzero_si512(), x);
+  }
+
+  template <size_t N> inline __m512i
+  emu_slli(__m512i x)
+  {
+      return emu_alignr<64 - N>(x, _mm512_setzero_si512());
+  }
+#endif
 #if defined(AVX)
 #  if defined(AVX2)
   template <size_t N> inline __m256i
@@ -188,6 +208,53 @@
   }
 #endif
 
+#if defined(AVX512)
+  inline __m512i
+  _mm512_emu_hadd_epi16(__m512i x, __m512i y)
+  {
+      const auto	idx = _mm512_set_epi16(62, 60, 58, 56, 54, 52, 50, 48,
+					       46, 44, 42, 40, 38, 36, 34, 32,
+					       30, 28, 26, 24, 22, 20, 18, 16,
+					       14, 12, 10,  8,  6,  4,  2,  0);
+      return _mm512_add_epi16(
+		 _mm512_permutex2var_epi16(x, idx, y),
+		 _mm512_permutex2var_epi16(
+		     x, _mm512_add_epi16(idx, _mm512_set1_epi16(1)), y));
+  }
+
+  inline __m512i
+  _mm512_emu_hadd_epi32(__m512i x, __m512i y)
+  {
+      const auto	idx = _mm512_set_epi32(30, 28, 26, 24, 22, 20, 18, 16,
+					       14, 12, 10,  8,  6,  4,  2,  0);
+      return _mm512_add_epi32(
+		 _mm512_permutex2var_epi32(x, idx, y),
+		 _mm512_permutex2var_epi32(
+		     x, _mm512_add_epi32(idx, _mm512_set1_epi32(1)), y));
+  }
+
+  inline __m512
+  _mm512_emu_hadd_ps(__m512 x, __m512 y)
+  {
+      const auto	idx = _mm512_set_epi32(30, 28, 26, 24, 22, 20, 18, 16,
+					       14, 12, 10,  8,  6,  4,  2,  0);
+      return _mm512_add_ps(
+		 _mm512_permutex2var_ps(x, idx, y),
+		 _mm512_permutex2var_ps(
+		     x, _mm512_add_epi32(idx, _mm512_set1_epi32(1)), y));
+  }
+
+  inline __m512d
+  _mm512_emu_hadd_pd(__m512d x, __m512d y)
+  {
+      const auto	idx = _mm512_set_epi64(14, 12, 10, 8, 6, 4, 2, 0);
+      return _mm512_add_pd(
+		 _mm512_permutex2var_pd(x, idx, y),
+		 _mm512_permutex2var_pd(
+		     x, _mm512_add_epi64(idx, _mm512_set1_epi64(1)), y));
+  }
+#endif
+
 /************************************************************************
 *  Macros for constructing mnemonics of intrinsics			*
 ************************************************************************/
@@ -82,8 +82,13 @@ SIMD_BINARY_FUNC(mulhi,      mulhi, int16_t)
 
   // その他
   SIMD_UNARY_FUNC(sqrt,  sqrt,  float)
+#  if defined(AVX512)
+  SIMD_UNARY_FUNC(rsqrt, rsqrt14, float)
+  SIMD_UNARY_FUNC(rcp,   rcp14,   float)
+#  else
   SIMD_UNARY_FUNC(rsqrt, rsqrt, float)
   SIMD_UNARY_FUNC(rcp,   rcp,   float)
+#  endif
 #endif
 
 #if defined(SSE2)
@@ -114,6 +119,18 @@ SIMD_BINARY_FUNC(mulhi,      mulhi, int16_t)
   SIMD_MIN_MAX(uint32_t)
 #endif
 
+#if defined(AVX512)
+  // 乗算
+  SIMD_BINARY_FUNC(operator *, mullo, int64_t)
+
+  // Min/Max
+  SIMD_MIN_MAX(int64_t)
+  template <> inline Iu64vec
+  min(Iu64vec x, Iu64vec y)		{return _mm512_min_epu64(x, y);}
+  template <> inline Iu64vec
+  max(Iu64vec x, Iu64vec y)		{return _mm512_max_epu64(x, y);}
+#endif
+
 #undef SIMD_SAT_ADD
 #undef SIMD_ADD
 #undef SIMD_SAT_SUB
@@ -156,6 +173,9 @@ abs(vec<T> x)				{return max(x, -x);}
   SIMD_UNARY_FUNC(abs, abs, int16_t)
   SIMD_UNARY_FUNC(abs, abs, int32_t)
 #endif
+#if defined(AVX512)
+  SIMD_UNARY_FUNC(abs, abs, int64_t)
+#endif
   
 /************************************************************************
 *  Absolute differences							*
@@ -170,7 +190,8 @@ diff(Iu16vec x, Iu16vec y)		{return subs(x, y) | subs(y, x);}
 /************************************************************************
 *  Fused multiply-add							*
 ************************************************************************/
-#if defined(AVX2)
+// FMA命令が使えない場合(-mfma 無しでコンパイルされた場合)は x*y + z で代用する
+#if defined(AVX2) && defined(__FMA__)
   SIMD_TRINARY_FUNC(fma, fmadd, float)
   SIMD_TRINARY_FUNC(fma, fmadd, double)
 #endif
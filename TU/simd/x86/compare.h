@@ -8,6 +8,37 @@ namespace TU
 {
 namespace simd
 {
+#if defined(AVX512)
+// AVX512 の比較演算はマスクレジスタを返すので，それをベクトルに展開する
+#  define SIMD_COMPARE_I(func, type, suffix, opcode)			\
+    template <> inline vec<mask_type<type> >				\
+    func(vec<type> x, vec<type> y)					\
+    {									\
+	return SIMD_MNEMONIC(movm, _mm512_, , SIMD_SIGNED(type))(	\
+		   SIMD_MNEMONIC(cmp_, _mm512_, suffix, mask)		\
+		   (x, y, opcode));					\
+    }
+#  define SIMD_COMPARES(type, suffix)					\
+    SIMD_COMPARE_I(operator ==, type, suffix, _MM_CMPINT_EQ)		\
+    SIMD_COMPARE_I(operator >,  type, suffix, _MM_CMPINT_NLE)		\
+    SIMD_COMPARE_I(operator <,  type, suffix, _MM_CMPINT_LT)		\
+    SIMD_COMPARE_I(operator !=, type, suffix, _MM_CMPINT_NE)		\
+    SIMD_COMPARE_I(operator >=, type, suffix, _MM_CMPINT_NLT)		\
+    SIMD_COMPARE_I(operator <=, type, suffix, _MM_CMPINT_LE)
+
+// 符号なし数に対しても大小比較ができる
+SIMD_COMPARES(int8_t,	epi8)
+SIMD_COMPARES(int16_t,	epi16)
+SIMD_COMPARES(int32_t,	epi32)
+SIMD_COMPARES(int64_t,	epi64)
+SIMD_COMPARES(uint8_t,	epu8)
+SIMD_COMPARES(uint16_t,	epu16)
+SIMD_COMPARES(uint32_t,	epu32)
+SIMD_COMPARES(uint64_t,	epu64)
+
+#  undef SIMD_COMPARE_I
+#  undef SIMD_COMPARES
+#else
 // MMX, SSE, AVX2 には整数に対する cmplt ("less than") がない！
 #define SIMD_COMPARE(func, op, type)					\
     SIMD_SPECIALIZED_FUNC(						\
@@ -33,8 +64,32 @@ SIMD_COMPARE(operator ==, cmpeq, uint32_t)
 SIMD_COMPARES(int8_t)
 SIMD_COMPARES(int16_t)
 SIMD_COMPARES(int32_t)
+#endif
+
+#if defined(AVX512)
+#  define SIMD_COMPARE_F(func, type, itype, opcode)			\
+    template <> inline vec<mask_type<type> >				\
+    func(vec<type> x, vec<type> y)					\
+    {									\
+	return SIMD_MNEMONIC(cast, _mm512_, si512, SIMD_SUFFIX(type))(	\
+		   SIMD_MNEMONIC(movm, _mm512_, , SIMD_SIGNED(itype))(	\
+		       SIMD_MNEMONIC(cmp_, _mm512_, SIMD_SUFFIX(type),	\
+				     mask)(x, y, opcode)));		\
+    }
+#  define SIMD_COMPARES_F(type, itype)					\
+    SIMD_COMPARE_F(operator ==, type, itype, _CMP_EQ_OQ)		\
+    SIMD_COMPARE_F(operator >,  type, itype, _CMP_GT_OS)		\
+    SIMD_COMPARE_F(operator <,  type, itype, _CMP_LT_OS)		\
+    SIMD_COMPARE_F(operator !=, type, itype, _CMP_NEQ_OQ)		\
+    SIMD_COMPARE_F(operator >=, type, itype, _CMP_GE_OS)		\
+    SIMD_COMPARE_F(operator <=, type, itype, _CMP_LE_OS)
 
-#if defined(AVX)	// AVX の浮動小数点数比較演算子はパラメータ形式
+  SIMD_COMPARES_F(float,  int32_t)
+  SIMD_COMPARES_F(double, int64_t)
+
+#  undef SIMD_COMPARE_F
+#  undef SIMD_COMPARES_F
+#elif defined(AVX)	// AVX の浮動小数点数比較演算子はパラメータ形式
 #  define SIMD_COMPARE_F(func, type, opcode)				\
     SIMD_SPECIALIZED_FUNC(						\
 	vec<mask_type<type> > func(vec<type> x, vec<type> y),		\
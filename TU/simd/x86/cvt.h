@@ -22,21 +22,38 @@ cvt(vec<S> x)
 // [1] 整数ベクトル間の変換
 #if defined(SSE4)
 #  if defined(AVX512)
+  namespace detail
+  {
+    // 2倍幅への変換は下位256bit，4倍/8倍幅への変換は下位128bitが源となる
+    inline __m256i
+    cvtup_source(__m512i x, std::integral_constant<size_t, 2>)
+    {
+	return _mm512_castsi512_si256(x);
+    }
+    template <size_t N> inline __m128i
+    cvtup_source(__m512i x, std::integral_constant<size_t, N>)
+    {
+	return _mm512_castsi512_si128(x);
+    }
+  }	// namespace detail
+
 #    define SIMD_CVTUP0(from, to)					\
       template <> inline vec<to>					\
       cvt<to, false>(vec<from> x)					\
       {									\
 	  return SIMD_MNEMONIC(cvt, _mm512_, SIMD_SUFFIX(from),		\
 			       SIMD_SIGNED(to))				\
-	      (_mm256_castsi512_si256(x));				\
+	      (detail::cvtup_source(					\
+		  x, std::integral_constant<size_t,			\
+					    sizeof(to)/sizeof(from)>()));\
       }
 #    define SIMD_CVTUP1(from, to)					\
       template <> inline vec<to>					\
       cvt<to, true>(vec<from> x)					\
       {									\
-	  return SIMD_MNEMONIC(cvt, _mm256_, SIMD_SUFFIX(from),		\
+	  return SIMD_MNEMONIC(cvt, _mm512_, SIMD_SUFFIX(from),		\
 			       SIMD_SIGNED(to))				\
-	      (_mm256_extractf128_si256(x, 0x1));			\
+	      (_mm512_extracti64x4_epi64(x, 0x1));			\
       }
 #  elif defined(AVX2)
 #    define SIMD_CVTUP0(from, to)					\
@@ -104,7 +121,7 @@ cvt(vec<S> x)
   SIMD_CVTUP1(uint32_t, uint64_t)	// u_int -> u_long
 
 #  undef SIMD_CVTUP0
-#  undef SIMF_CVTUP1
+#  undef SIMD_CVTUP1
 #else	// !SSE4
 #  define SIMD_CVTUP_I(from, to)					\
     template <> inline vec<to>						\
@@ -146,7 +163,27 @@ cvt(vec<S> x)
 #  undef SIMD_CVTUP_UI
 #endif
 
-#if defined(AVX2)
+#if defined(AVX512)
+  // packs, packus は128bit lane毎に作用するので，64bit単位で並べ替える
+#  define SIMD_CVTDOWN_I(from, to)					\
+    template <> inline vec<to>						\
+    cvt<to>(vec<from> x, vec<from> y)					\
+    {									\
+	return _mm512_permutexvar_epi64(				\
+		   _mm512_setr_epi64(0, 2, 4, 6, 1, 3, 5, 7),		\
+		   SIMD_MNEMONIC(packs, _mm512_, , SIMD_SUFFIX(from))	\
+		   (x, y));						\
+    }
+#  define SIMD_CVTDOWN_UI(from, to)					\
+    template <> inline vec<to>						\
+    cvt<to>(vec<from> x, vec<from> y)					\
+    {									\
+	return _mm512_permutexvar_epi64(				\
+		   _mm512_setr_epi64(0, 2, 4, 6, 1, 3, 5, 7),		\
+		   SIMD_MNEMONIC(packus, _mm512_, , SIMD_SUFFIX(from))	\
+		   (x, y));						\
+    }
+#elif defined(AVX2)
 #  define SIMD_CVTDOWN_I(from, to)					\
     template <> inline vec<to>						\
     cvt<to>(vec<from> x, vec<from> y)					\
@@ -396,20 +433,14 @@ SIMD_CVTDOWN_UI(int16_t, uint8_t)	// short -> u_char
   template <> inline F64vec
   cvt<double, true>(F32vec x)		// float -> double
   {
-      return _mm512_cvtps_pd(_mm256_insertf128_ps(
-				 _mm256_castps128_ps256(
-				     _mm512_extractf32x4_ps(x, 0x2)),
-				 _mm512_extractf32x4_ps(x, 0x3), 0x1));
+      return _mm512_cvtps_pd(_mm512_extractf32x8_ps(x, 0x1));
   }
 
   template <> inline F32vec		// double -> float
   cvt<float>(F64vec x, F64vec y)
   {
-      const auto	z = _mm512_cvtpd_ps(y);
-      return _mm512_insertf32x4(_mm512_insertf32x4(
-				    _mm512_castps256_ps512(_mm512_cvtpd_ps(x)),
-				    _mm256_extractf128_ps(z, 0x0), 0x2),
-				_mm256_extractf128_ps(z, 0x1), 0x3);
+      return _mm512_insertf32x8(_mm512_castps256_ps512(_mm512_cvtpd_ps(x)),
+				_mm512_cvtpd_ps(y), 0x1);
   }
 #elif defined(AVX)
   template <> inline F64vec
@@ -456,7 +487,32 @@ SIMD_CVTDOWN_UI(int16_t, uint8_t)	// short -> u_char
 *  Mask conversion operators						*
 ************************************************************************/
 // [1] 整数ベクトル間のマスク変換
-#if defined(AVX2)
+#if defined(AVX512)
+#  define SIMD_CVTUP_MASK(from, to)					\
+    template <> inline vec<to>						\
+    cvt<to, false, true>(vec<from> x)					\
+    {									\
+	return SIMD_MNEMONIC(cvt, _mm512_,				\
+			     SIMD_SIGNED(from), SIMD_SIGNED(to))(	\
+				 _mm512_castsi512_si256(x));		\
+    }									\
+    template <> inline vec<to>						\
+    cvt<to, true, true>(vec<from> x)					\
+    {									\
+	return SIMD_MNEMONIC(cvt, _mm512_,				\
+			     SIMD_SIGNED(from), SIMD_SIGNED(to))(	\
+				 _mm512_extracti64x4_epi64(x, 0x1));	\
+    }
+#  define SIMD_CVTDOWN_MASK(from, to)					\
+    template <> inline vec<to>						\
+    cvt<to, true>(vec<from> x, vec<from> y)				\
+    {									\
+	return _mm512_permutexvar_epi64(				\
+		   _mm512_setr_epi64(0, 2, 4, 6, 1, 3, 5, 7),		\
+		   SIMD_MNEMONIC(packs, _mm512_, , SIMD_SIGNED(from))	\
+		   (x, y));						\
+    }
+#elif defined(AVX2)
 #  define SIMD_CVTUP_MASK(from, to)					\
     template <> inline vec<to>						\
     cvt<to, false, true>(vec<from> x)					\
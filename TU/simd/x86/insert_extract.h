@@ -13,7 +13,29 @@ namespace simd
 *  Insertion/Extraction operators					*
 ************************************************************************/
 // [1] 整数ベクトルに対するinsert/extract
-#  if defined(AVX2)
+#  if defined(AVX512)
+#    define SIMD_INSERT_EXTRACT(type)					\
+      template <size_t I> inline vec<type>				\
+      insert(vec<type> x, int val)					\
+      {									\
+	  return _mm512_inserti32x4(					\
+		     x,							\
+		     SIMD_MNEMONIC(insert, _mm_, , SIMD_SIGNED(type))(	\
+			 _mm512_extracti32x4_epi32(			\
+			     x, I / vec<type>::lane_size),		\
+			 val, I % vec<type>::lane_size),		\
+		     I / vec<type>::lane_size);				\
+      }									\
+      template <size_t I> inline int					\
+      extract(vec<type> x)						\
+      {									\
+	  return SIMD_MNEMONIC(extract, _mm_, , SIMD_SIGNED(type))(	\
+		     _mm512_extracti32x4_epi32(				\
+			 x, I / vec<type>::lane_size),			\
+		     I % vec<type>::lane_size);				\
+      }
+
+#  elif defined(AVX2)
 #    define SIMD_INSERT_EXTRACT(type)					\
       template <size_t I> inline vec<type>				\
       insert(vec<type> x, int val)					\
@@ -57,7 +79,19 @@ namespace simd
 #  undef SIMD_INSERT_EXTRACT
 
 // [2] vec<float> に対するinsert/extract
-#  if defined(AVX)
+#  if defined(AVX512)
+    template <size_t I> inline F32vec
+    insert(F32vec x, float val)
+    {
+	return _mm512_insertf32x4(x,
+				  _mm_insert_ps(
+				      _mm512_extractf32x4_ps(
+					  x, I / F32vec::lane_size),
+				      _mm_set_ss(val),
+				      (I % F32vec::lane_size) << 4),
+				  I / F32vec::lane_size);
+    }
+#  elif defined(AVX)
     template <size_t I> inline F32vec
     insert(F32vec x, float val)
     {
@@ -78,7 +112,22 @@ namespace simd
 #  endif
 
 template <size_t I> float	extract(F32vec x)			;
-#  if defined(AVX)
+#  if defined(AVX512)
+#    define SIMD_EXTRACT_F32(I)						\
+      template <> inline float						\
+      extract<I>(F32vec x)						\
+      {									\
+	  return _mm_cvtss_f32(_mm512_extractf32x4_ps(			\
+				   x, I / F32vec::lane_size));		\
+      }
+
+    SIMD_EXTRACT_F32(0)
+    SIMD_EXTRACT_F32(4)
+    SIMD_EXTRACT_F32(8)
+    SIMD_EXTRACT_F32(12)
+
+#    undef SIMD_EXTRACT_F32
+#  elif defined(AVX)
     template <> inline float
     extract<0>(F32vec x)
     {
@@ -101,7 +150,22 @@ template <size_t I> float	extract(F32vec x)			;
 // [3] vec<double> に対するinsert/extract
 #  if defined(SSE2)
     template <size_t I> double	extract(F64vec x)			;
-#    if defined(AVX)
+#    if defined(AVX512)
+#      define SIMD_EXTRACT_F64(I)					\
+	template <> inline double					\
+	extract<I>(F64vec x)						\
+	{								\
+	    return _mm_cvtsd_f64(_mm512_extractf64x2_pd(		\
+				     x, I / F64vec::lane_size));	\
+	}
+
+      SIMD_EXTRACT_F64(0)
+      SIMD_EXTRACT_F64(2)
+      SIMD_EXTRACT_F64(4)
+      SIMD_EXTRACT_F64(6)
+
+#      undef SIMD_EXTRACT_F64
+#    elif defined(AVX)
       template <> inline double
       extract<0>(F64vec x)
       {
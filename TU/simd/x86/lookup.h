@@ -9,16 +9,38 @@ namespace TU
 namespace simd
 {
 #if defined(AVX2)
-#  define SIMD_LOOKUP32(to)						\
-    SIMD_SPECIALIZED_FUNC(vec<to> lookup(const to* p, Is32vec idx),	\
-			  i32gather,					\
-			  (reinterpret_cast<const signed_type<to>*>(p),	\
-			   idx, sizeof(to)), void, to, SIMD_SIGNED)
-#  define SIMD_LOOKUP64(to)						\
-    SIMD_SPECIALIZED_FUNC(vec<to> lookup(const to* p, Is64vec idx),	\
-			  i64gather,					\
-			  (reinterpret_cast<const signed_type<to>*>(p), \
-			   idx, sizeof(to)), void, to, SIMD_SIGNED)
+#  if defined(AVX512)	// AVX512 の gather はindexを第1引数にとる
+  // マスクなしの gather は未初期化のベクトルを転送元とするので，全要素を
+  // 読み込むマスクと0ベクトルを与えたマスク付きの gather を用いる．
+#    define SIMD_LOOKUP32(to)						\
+      SIMD_SPECIALIZED_FUNC(vec<to> lookup(const to* p, Is32vec idx),	\
+			    mask_i32gather,				\
+			    (zero<to>(), 0xffff, idx,			\
+			     reinterpret_cast<const signed_type<to>*>(p), \
+			     sizeof(to)), void, to, SIMD_SIGNED)
+#    define SIMD_LOOKUP64(to)						\
+      SIMD_SPECIALIZED_FUNC(vec<to> lookup(const to* p, Is64vec idx),	\
+			    mask_i64gather,				\
+			    (zero<to>(), 0xff, idx,			\
+			     reinterpret_cast<const signed_type<to>*>(p), \
+			     sizeof(to)), void, to, SIMD_SIGNED)
+#    define SIMD_GATHER_I32(p, idx, scale)				\
+      _mm512_mask_i32gather_epi32(_mm512_setzero_si512(), 0xffff,	\
+				  idx, p, scale)
+#  else
+#    define SIMD_LOOKUP32(to)						\
+      SIMD_SPECIALIZED_FUNC(vec<to> lookup(const to* p, Is32vec idx),	\
+			    i32gather,					\
+			    (reinterpret_cast<const signed_type<to>*>(p), \
+			     idx, sizeof(to)), void, to, SIMD_SIGNED)
+#    define SIMD_LOOKUP64(to)						\
+      SIMD_SPECIALIZED_FUNC(vec<to> lookup(const to* p, Is64vec idx),	\
+			    i64gather,					\
+			    (reinterpret_cast<const signed_type<to>*>(p), \
+			     idx, sizeof(to)), void, to, SIMD_SIGNED)
+#    define SIMD_GATHER_I32(p, idx, scale)				\
+      _mm256_i32gather_epi32(p, idx, scale)
+#  endif
 
   SIMD_LOOKUP32(int32_t)
   SIMD_LOOKUP32(uint32_t)
@@ -38,10 +60,9 @@ namespace simd
     {
         constexpr int	N = sizeof(int32_t)/sizeof(P) - 1;
 
-        return  _mm256_srai_epi32(
-		    _mm256_i32gather_epi32(
-			reinterpret_cast<const int32_t*>(p - N),
-			idx, sizeof(P)),
+	return  SIMD_MNEMONIC(srai, SIMD_PREFIX(int32_t), , epi32)(
+		    SIMD_GATHER_I32(reinterpret_cast<const int32_t*>(p - N),
+				    idx, sizeof(P)),
 		    8*sizeof(P)*N);
     }
     template <class P> inline Is32vec
@@ -49,14 +70,15 @@ namespace simd
     {
 	constexpr int	N = sizeof(int32_t)/sizeof(P) - 1;
 
-	return  _mm256_srli_epi32(
-		    _mm256_i32gather_epi32(
-			reinterpret_cast<const int32_t*>(p - N),
-			idx, sizeof(P)),
+	return  SIMD_MNEMONIC(srli, SIMD_PREFIX(int32_t), , epi32)(
+		    SIMD_GATHER_I32(reinterpret_cast<const int32_t*>(p - N),
+				    idx, sizeof(P)),
 		    8*sizeof(P)*N);
     }
   }	// namespace detail
 
+#  undef SIMD_GATHER_I32
+
   template <class P>
   inline typename std::enable_if<(vec<P>::size > Is32vec::size), Is32vec>::type
   lookup(const P* p, Is32vec idx)
@@ -17,7 +17,44 @@ select(vec<mask_type<T> > mask, vec<T> x, vec<T> y)
 			   detail::base_andnot(mask, y));
 }
     
-#if defined(SSE4)
+#if defined(AVX512)
+// マスクベクトルをマスクレジスタに変換してから blend する
+#  define SIMD_SELECT(type)						\
+    template <> inline vec<type>					\
+    select(vec<mask_type<type> > mask, vec<type> x, vec<type> y)	\
+    {									\
+	return SIMD_MNEMONIC(mask_blend, _mm512_, , SIMD_SIGNED(type))(	\
+		   SIMD_MNEMONIC(mov, _mm512_, SIMD_SIGNED(type),	\
+				 mask)(mask),				\
+		   base_type<type>(y), base_type<type>(x));		\
+    }
+#  define SIMD_SELECT_F(type, itype)					\
+    template <> inline vec<type>					\
+    select(vec<mask_type<type> > mask, vec<type> x, vec<type> y)	\
+    {									\
+	return SIMD_MNEMONIC(mask_blend, _mm512_, , SIMD_SUFFIX(type))(	\
+		   SIMD_MNEMONIC(mov, _mm512_, SIMD_SIGNED(itype),	\
+				 mask)(					\
+		       SIMD_MNEMONIC(cast, _mm512_,			\
+				     SIMD_SUFFIX(type), si512)(mask)),	\
+		   base_type<type>(y), base_type<type>(x));		\
+    }
+
+  SIMD_SELECT(int8_t)
+  SIMD_SELECT(int16_t)
+  SIMD_SELECT(int32_t)
+  SIMD_SELECT(int64_t)
+  SIMD_SELECT(uint8_t)
+  SIMD_SELECT(uint16_t)
+  SIMD_SELECT(uint32_t)
+  SIMD_SELECT(uint64_t)
+
+  SIMD_SELECT_F(float,  int32_t)
+  SIMD_SELECT_F(double, int64_t)
+
+#  undef SIMD_SELECT
+#  undef SIMD_SELECT_F
+#elif defined(SSE4)
 #  define SIMD_SELECT(type)						\
     template <> inline vec<type>					\
     select(vec<mask_type<type> > mask, vec<type> x, vec<type> y)	\
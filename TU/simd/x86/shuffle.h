@@ -58,11 +58,19 @@ shuffle(vec<T> x)							;
     SIMD_FUNC(vec<type> shuffle_high(vec<type> x),			\
 	      shufflehi, (x, _MM_SHUFFLE(I3, I2, I1, I0)),		\
 	      void, type, SIMD_SIGNED)
-#define SIMD_SHUFFLE_I4(type)						\
+#if defined(AVX512)	// AVX512 の shuffle_epi32 は _MM_PERM_ENUM をとる
+#  define SIMD_SHUFFLE_I4(type)						\
+    template <size_t I3, size_t I2, size_t I1, size_t I0>		\
+    SIMD_FUNC(vec<type> shuffle(vec<type> x),				\
+	      shuffle, (x, _MM_PERM_ENUM(_MM_SHUFFLE(I3, I2, I1, I0))),	\
+	      void, type, SIMD_SIGNED)
+#else
+#  define SIMD_SHUFFLE_I4(type)						\
     template <size_t I3, size_t I2, size_t I1, size_t I0>		\
     SIMD_FUNC(vec<type> shuffle(vec<type> x),				\
 	      shuffle, (x, _MM_SHUFFLE(I3, I2, I1, I0)),		\
 	      void, type, SIMD_SIGNED)
+#endif
 
 #if defined(SSE2)
   SIMD_SHUFFLE_I4(int32_t)
@@ -110,11 +118,20 @@ shuffle(vec<T> x, vec<T> y)						;
     SIMD_FUNC(vec<type> shuffle(vec<type> x, vec<type> y),		\
 	      shuffle, (x, y, _MM_SHUFFLE(Yh, Yl, Xh, Xl)),		\
 	      void, type, SIMD_SUFFIX)
-#define SIMD_SHUFFLE_D4(type)						\
+#if defined(AVX512)	// 4つの128bit laneに同じ選択を適用する
+#  define SIMD_SHUFFLE_D4(type)						\
+    template <size_t Yh, size_t Yl, size_t Xh, size_t Xl>		\
+    SIMD_FUNC(vec<type> shuffle(vec<type> x, vec<type> y),		\
+	      shuffle, (x, y, _MM_SHUFFLE4(Yh, Yl, Xh, Xl) |		\
+			      (_MM_SHUFFLE4(Yh, Yl, Xh, Xl) << 4)),	\
+	      void, type, SIMD_SUFFIX)
+#else
+#  define SIMD_SHUFFLE_D4(type)						\
     template <size_t Yh, size_t Yl, size_t Xh, size_t Xl>		\
     SIMD_FUNC(vec<type> shuffle(vec<type> x, vec<type> y),		\
 	      shuffle, (x, y, _MM_SHUFFLE4(Yh, Yl, Xh, Xl)),		\
 	      void, type, SIMD_SUFFIX)
+#endif
 #define SIMD_SHUFFLE_D2(type)						\
     template <size_t Y, size_t X>					\
     SIMD_FUNC(vec<type> shuffle(vec<type> x, vec<type> y),		\
@@ -131,6 +148,7 @@ shuffle(vec<T> x, vec<T> y)						;
 #endif
 
 #undef SIMD_SHUFFLE_D2
+#undef SIMD_SHUFFLE_D4
 #undef SIMD_SHUFFLE_F4
   
 }	// namespace simd
@@ -4,7 +4,17 @@
 #if !defined(TU_SIMD_X86_TYPE_TRAITS_H)
 #define TU_SIMD_X86_TYPE_TRAITS_H
 
-#include <x86intrin.h>
+// GCC 12 以前の AVX512 組込み関数の多くは，自身で初期化したベクトル
+// (__Y = __Y)を転送元とするので，インライン展開先で -Wmaybe-uninitialized
+// の誤検出を生じる．組込み関数ヘッダ内の位置に対する警告だけを抑制する．
+#if defined(__GNUC__) && !defined(__clang__) && (__GNUC__ < 13)
+#  pragma GCC diagnostic push
+#  pragma GCC diagnostic ignored "-Wmaybe-uninitialized"
+#  include <x86intrin.h>
+#  pragma GCC diagnostic pop
+#else
+#  include <x86intrin.h>
+#endif
 
 namespace TU
 {
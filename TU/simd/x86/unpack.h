@@ -10,7 +10,30 @@ namespace simd
 {
 namespace detail
 {
-#if defined(AVX)
+#if defined(AVX512)
+  // x, y の128bit laneを交互に並べたものの下位または上位半分を返す
+  template <bool HI> inline __m512i
+  permute(__m512i x, __m512i y)
+  {
+      return _mm512_permutex2var_epi64(
+		 x,
+		 (HI ? _mm512_setr_epi64(4, 5, 12, 13, 6, 7, 14, 15)
+		     : _mm512_setr_epi64(0, 1,  8,  9, 2, 3, 10, 11)),
+		 y);
+  }
+  template <bool HI> inline __m512
+  permute(__m512 x, __m512 y)
+  {
+      return _mm512_castsi512_ps(permute<HI>(_mm512_castps_si512(x),
+					     _mm512_castps_si512(y)));
+  }
+  template <bool HI> inline __m512d
+  permute(__m512d x, __m512d y)
+  {
+      return _mm512_castsi512_pd(permute<HI>(_mm512_castpd_si512(x),
+					     _mm512_castpd_si512(y)));
+  }
+#elif defined(AVX)
 #  define SIMD_PERMUTE(type)						\
     template <size_t I>							\
     SIMD_FUNC(type permute(type x, type y),				\
@@ -74,8 +97,8 @@ template <bool HI, class T>
 inline typename std::enable_if<(sizeof(vec<T>) == 64), base_type<T> >::type
 unpack(vec<T> x, vec<T> y)
 {
-    return detail::permute<(HI ? 0x31 : 0x20)>(detail::unpack<false>(x, y),
-					       detail::unpack<true >(x, y));
+    return detail::permute<HI>(detail::unpack<false>(x, y),
+			       detail::unpack<true >(x, y));
 }
 #elif defined(AVX)
 template <bool HI, class T>
@@ -199,12 +199,10 @@ SIMD_CONSTRUCTOR_1(uint32_t)
 #endif
 
 #if defined(AVX512)
-//  SIMD_CONSTRUCTOR_64(int8_t)
-//  SIMD_CONSTRUCTOR_64(uint8_t)	
-#  if defined(__INTEL_COMPILER)
+  SIMD_CONSTRUCTOR_64(int8_t)
+  SIMD_CONSTRUCTOR_64(uint8_t)	
   SIMD_CONSTRUCTOR_32(int16_t)
   SIMD_CONSTRUCTOR_32(uint16_t)	
-#  endif
   SIMD_CONSTRUCTOR_16(int32_t)
   SIMD_CONSTRUCTOR_16(uint32_t)
   SIMD_CONSTRUCTOR_8(int64_t)
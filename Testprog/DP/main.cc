@@ -1,6 +1,8 @@
 /*
  *  $Id$
  */
+#include <unistd.h>
+#include <random>
 #include <boost/iterator_adaptors.hpp>
 #include "TU/DP.h"
 
@@ -82,6 +84,104 @@ class Energy
     const array_type&	_f;
     const array2_type&	_g;
 };
+
+/************************************************************************
+*  class StageEnergy<T>							*
+************************************************************************/
+//! 表で与えられたデータ項と平滑化項による1ステージ分の評価関数
+template <class T>
+class StageEnergy
+{
+  public:
+    StageEnergy(const T* f, const Array2<T>& g)	:_f(f), _g(g)		{}
+
+    T		operator ()(int x)		const	{ return _f[x]; }
+    T		operator ()(int x, int y)	const	{ return _g[x][y]; }
+
+  private:
+    const T*		_f;
+    const Array2<T>&	_g;
+};
+    
+/************************************************************************
+*  static functions							*
+************************************************************************/
+//! ラベル列の評価関数の値を求める．
+template <class T> static T
+energy(const Array2<T>& f, const Array2<T>& g, T lambda,
+       const Array<u_int>& x)
+{
+    T	val = f[0][x[0]];
+    for (size_t i = 1; i < x.size(); ++i)
+	val += f[i][x[i]] + lambda * g[x[i-1]][x[i]];
+
+    return val;
+}
+
+//! ランダムなデータ項に対する LabelDP<T> の結果を DP<DOM, T> と比較する．
+/*!
+  データ項は少数の整数値から選ぶので，最小値を与えるラベル列が一意に
+  定まらないことが多い．そこで最小値が一致し，かつ LabelDP<T> のラベル列の
+  評価関数の値がその最小値に等しいことを確かめる．
+  \return	結果が食い違った試行の数
+*/
+template <class T> static size_t
+compareLabelDP(typename LabelDP<T>::Smoothness smoothness, T lambda,
+	       T threshold, size_t nstages, size_t nlabels, size_t ntrials)
+{
+    using namespace	std;
+
+    using domain_type		= Array<u_int>;
+    using domain_iterator	= dummy_iterator<const domain_type*>;
+
+  // 平滑化項の表を作る．
+    Array2<T>	g(nlabels, nlabels);
+    for (size_t x = 0; x < nlabels; ++x)
+	for (size_t y = 0; y < nlabels; ++y)
+	{
+	    const T	d = std::abs(T(x) - T(y));
+	    g[x][y] = (smoothness == LabelDP<T>::QUADRATIC	  ? d*d :
+		       smoothness == LabelDP<T>::TRUNCATED_LINEAR ?
+		       std::min(d, threshold) : d);
+	}
+
+    domain_type	domain(nlabels);
+    for (u_int i = 0; i < domain.size(); ++i)
+	domain[i] = i;
+
+    DP<domain_iterator, T>	dp(lambda);
+    dp.initialize(domain_iterator(&domain, domain),
+		  domain_iterator(&domain + nstages, domain));
+    LabelDP<T>			labelDP(lambda, smoothness, threshold);
+    labelDP.initialize(nstages, nlabels);
+
+    mt19937			generator(nstages*nlabels);
+    uniform_int_distribution<int>	distribution(0, 4);
+    Array2<T>			f(nstages, nlabels);
+    std::vector<StageEnergy<T> >	energies;
+    for (size_t i = 0; i < nstages; ++i)
+	energies.emplace_back(f[i].begin(), g);
+    domain_type			x(nstages), y(nstages);
+    size_t			nerrors = 0;
+    for (size_t n = 0; n < ntrials; ++n)
+    {
+	for (auto row : f)
+	    for (auto& val : row)
+		val = distribution(generator);
+
+	const auto	val  = dp(energies.cbegin(), x.rbegin());
+	const auto	valL = labelDP(f.cbegin(), y.rbegin());
+	if (valL != val || energy(f, g, lambda, y) != val)
+	{
+	    cerr << "  mismatch: DP = " << val << ", LabelDP = " << valL
+		 << " (energy = " << energy(f, g, lambda, y) << ")\n"
+		 << "  f =\n" << f;
+	    ++nerrors;
+	}
+    }
+
+    return nerrors;
+}
     
 }
 
@@ -89,7 +189,7 @@ class Energy
 *  global functions							*
 ************************************************************************/
 int
-main()
+main(int argc, char* argv[])
 {
     using namespace	std;
     using namespace	TU;
@@ -101,8 +201,54 @@ main()
     typedef DP<domain_iterator, value_type>	dp_type;
     typedef Energy<value_type>::Generator	generator_type;
     
+    bool		label = false;
+    for (int c; (c = getopt(argc, argv, "L")) != -1; )
+	switch (c)
+	{
+	  case 'L':
+	    label = true;
+	    break;
+	}
+
     try
     {
+	if (label)
+	{
+	  // LabelDP を線形，2次，打ち切り線形の各平滑化項について DP と
+	  // 比較する．K = 1 および1ステージのみの場合も含める．
+	    using LDP	= LabelDP<value_type>;
+	    using LDPd	= LabelDP<double>;
+
+	    const size_t	nlabels[] = {1, 2, 3, 7, 16};
+	    size_t		nerrors = 0;
+	    for (auto K : nlabels)
+		for (size_t nstages : {1, 2, 10})
+		{
+		    nerrors += compareLabelDP<value_type>(LDP::LINEAR, 1, 0,
+							  nstages, K, 100)
+			     + compareLabelDP<value_type>(LDP::LINEAR, 2, 0,
+							  nstages, K, 100)
+			     + compareLabelDP<value_type>(LDP::QUADRATIC, 1, 0,
+							  nstages, K, 100)
+			     + compareLabelDP<value_type>(LDP::QUADRATIC, 3, 0,
+							  nstages, K, 100)
+			     + compareLabelDP<value_type>(
+				   LDP::TRUNCATED_LINEAR, 1, 2, nstages, K, 100)
+			     + compareLabelDP<value_type>(
+				   LDP::TRUNCATED_LINEAR, 2, 3, nstages, K, 100)
+			     + compareLabelDP<double>(LDPd::LINEAR, 0.5, 0,
+						      nstages, K, 100)
+			     + compareLabelDP<double>(LDPd::QUADRATIC, 0.25, 0,
+						      nstages, K, 100)
+			     + compareLabelDP<double>(
+				   LDPd::TRUNCATED_LINEAR, 1.5, 1.5,
+				   nstages, K, 100);
+		}
+
+	    cerr << nerrors << " mismatches between LabelDP and DP." << endl;
+	    return (nerrors == 0 ? 0 : 1);
+	}
+
 	array2_type	f, g;
 	cin >> f >> g;
 	
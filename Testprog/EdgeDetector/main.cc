@@ -31,9 +31,9 @@ computeEdgeHV(CONVOLVER& convolver,
 	      const Image<T>& in, Image<float>& edgeH, Image<float>& edgeV)
 {
     edgeH.resize(in.height(), in.width());
-    convolver.diffH(in.begin(), in.end(), edgeH.begin());
     edgeV.resize(in.height(), in.width());
-    convolver.diffV(in.begin(), in.end(), edgeV.begin());
+    convolver.derivatives(in.begin(), in.end(), nullptr,
+			  edgeH.begin(), edgeV.begin(), nullptr, nullptr, nullptr);
 }
     
 template <class CONVOLVER, class T> static void
@@ -41,9 +41,9 @@ computeLaplacian(CONVOLVER& convolver,
 		 const Image<T>& in, Image<float>& lap)
 {
     lap.resize(in.height(), in.width());
-    convolver.diffHH(in.begin(), in.end(), lap.begin());
     Image<float>	edgeVV(in.width(), in.height());
-    convolver.diffVV(in.begin(), in.end(), edgeVV.begin());
+    convolver.derivatives(in.begin(), in.end(), nullptr, nullptr, nullptr,
+			  lap.begin(), nullptr, edgeVV.begin());
     lap += edgeVV;
 }
 
@@ -6,6 +6,90 @@
 #include "TU/Quantizer.h"
 #include "TU/Profiler.h"
 
+namespace TU
+{
+//! 量子化結果の平均自乗誤差を返す．
+template <class T> static double
+meanSquaredError(const Image<T>& image, const Quantizer2<T>& quantizer,
+		 const Array2<size_t>& indices)
+{
+    double	sqsum = 0;
+    for (size_t v = 0; v < image.height(); ++v)
+	for (size_t u = 0; u < image.width(); ++u)
+	{
+	    const auto&	x = image[v][u];
+	    const auto&	y = quantizer[indices[v][u]];
+	    const auto	dr = double(x.r) - double(y.r);
+	    const auto	dg = double(x.g) - double(y.g);
+	    const auto	db = double(x.b) - double(y.b);
+	    sqsum += dr*dr + dg*dg + db*db;
+	}
+
+    return sqsum / (image.width() * image.height());
+}
+
+//! 各画素の輝度を d だけずらした画像を返す．
+template <class T> static Image<T>
+shiftIntensity(const Image<T>& image, int d)
+{
+    const auto	clamp = [d](u_char x)
+			{ return u_char(std::min(std::max(x + d, 0), 255)); };
+    Image<T>	shifted(image.width(), image.height());
+    for (size_t v = 0; v < image.height(); ++v)
+	for (size_t u = 0; u < image.width(); ++u)
+	{
+	    const auto&	x = image[v][u];
+	    shifted[v][u] = T(clamp(x.r), clamp(x.g), clamp(x.b));
+	}
+
+    return shifted;
+}
+
+//! パレットを使い回す量子化を毎回作り直す量子化と比較する．
+template <class T> static void
+checkPersistent(const Image<T>& image, size_t nbins)
+{
+    Quantizer2<T>	fresh, persistent;
+    persistent.setPersistent(true);
+
+  // 最初のフレームでは両者とも新たにパレットを作るので結果は一致する．
+    const Array2<size_t>	indices = fresh(image.cbegin(), image.cend(),
+						nbins);
+    persistent(image.cbegin(), image.cend(), nbins);
+    const auto			palette = persistent;
+
+  // 同じフレームを再度与えるとパレットと各画素の番号がそのまま戻る．
+    const auto&	indicesP = persistent(image.cbegin(), image.cend(), nbins);
+    size_t	ndiffs = 0;
+    for (size_t v = 0; v < image.height(); ++v)
+	for (size_t u = 0; u < image.width(); ++u)
+	    if (indicesP[v][u] != indices[v][u])
+		++ndiffs;
+    size_t	ncolors = 0;
+    for (size_t i = 0; i < persistent.size(); ++i)
+	if (persistent[i] != palette[i] || persistent[i] != fresh[i])
+	    ++ncolors;
+    std::cerr << "--- round trip (" << persistent.size() << " bins) ---\n"
+	      << "  #differing indices: " << ndiffs
+	      << ", #differing palette colors: " << ncolors << std::endl;
+
+  // 輝度を変えたフレームについて量子化誤差を比較する．
+    std::cerr << "--- MSE (fresh / persistent) ---" << std::endl;
+    for (int d : {4, 16, 64, 0})
+    {
+	const auto	shifted = shiftIntensity(image, d);
+	const auto&	indicesF = fresh(shifted.cbegin(), shifted.cend(),
+					 nbins);
+	const auto	mseF = meanSquaredError(shifted, fresh, indicesF);
+	const auto&	indicesP = persistent(shifted.cbegin(),
+					      shifted.cend(), nbins);
+	const auto	mseP = meanSquaredError(shifted, persistent, indicesP);
+	std::cerr << "  shift " << d << ":\t" << mseF << " / " << mseP
+		  << std::endl;
+    }
+}
+}
+
 int
 main(int argc, char* argv[])
 {
@@ -14,13 +98,17 @@ main(int argc, char* argv[])
     typedef RGB		value_type;
     
     size_t		nbins = 10;
+    bool		check = false;
     extern char*	optarg;
-    for (int c; (c = getopt(argc, argv, "n:")) != -1; )
+    for (int c; (c = getopt(argc, argv, "n:p")) != -1; )
 	switch (c)
 	{
 	  case 'n':
 	    nbins = atoi(optarg);
 	    break;
+	  case 'p':
+	    check = true;
+	    break;
 	}
     
     Image<value_type>	image;
@@ -41,6 +129,9 @@ main(int argc, char* argv[])
 	profiler.nextFrame();
     }
     profiler.print(std::cerr);
+
+    if (check)
+	checkPersistent(image, nbins);
     
     image.save(std::cout);
     quantizedImage.save(std::cout);
@@ -0,0 +1,32 @@
+/*
+ *  $Id$
+ */
+#include "ScalarSURF.h"
+
+// SIMD命令を使わない SURFCreator を ScalarSURFCreator という名前で作る．
+#define TU_SURF_SIMD	0
+#define SURFCreator	ScalarSURFCreator
+#include "../../SURFCreator.cc"
+#undef SURFCreator
+
+namespace TU
+{
+template <class F> void
+createScalarSURFs(const Image<u_char>& image, float scoreThresh,
+		  std::vector<F>& features)
+{
+    ScalarSURFCreator::Parameters	params;
+    params.scoreThresh = scoreThresh;
+
+    ScalarSURFCreator	creator(params);
+    features.clear();
+    creator.createSURFs<F>(image, std::back_inserter(features));
+}
+
+template void	createScalarSURFs(const Image<u_char>& image,
+				  float scoreThresh,
+				  std::vector<SURF>& features)		;
+template void	createScalarSURFs(const Image<u_char>& image,
+				  float scoreThresh,
+				  std::vector<SURF128>& features)	;
+}
@@ -0,0 +1,24 @@
+/*
+ *  $Id$
+ */
+#ifndef __SCALARSURF_H
+#define __SCALARSURF_H
+
+#include <vector>
+#include "TU/Image++.h"
+#include "TU/Feature.h"
+
+namespace TU
+{
+//! SIMD命令を使わずにSURF特徴の方向と記述子を計算する
+/*!
+  SIMD版の計算結果と比較するための参照実装として用いる．
+  \param image		入力画像
+  \param scoreThresh	特徴点のスコアの閾値
+  \param features	抽出されたSURF特徴が返される
+*/
+template <class F> void
+createScalarSURFs(const Image<u_char>& image, float scoreThresh,
+		  std::vector<F>& features)				;
+}
+#endif	// !__SCALARSURF_H
@@ -5,6 +5,7 @@
 #include "TU/SURFCreator.h"
 #include "TU/ICIA.h"
 #include "MatchImage.h"
+#include "ScalarSURF.h"
 #include <fstream>
 
 namespace TU
@@ -118,6 +119,88 @@ integrateImages(const Image<T>& image0, const Image<T>& image1,
     return result;
 }
 
+//! 長方形領域の反転と積分画像の部分更新を繰り返し，全体を作り直した結果と比べる．
+/*!
+  \param image		原画像
+  \param nupdates	部分更新の回数
+  \param maxUpdates	全体を作り直すまでの部分更新の最大回数
+  \return		部分更新した積分画像と作り直した積分画像の差の最大値
+*/
+template <class T> static float
+checkIntegralUpdate(Image<T> image, size_t nupdates, size_t maxUpdates)
+{
+    IntegralImage<float>	integral(image);
+    integral.setMaxUpdates(maxUpdates);
+
+    const size_t	w = image.width()/4, h = image.height()/4;
+    for (size_t n = 0; n < nupdates; ++n)
+    {
+	const size_t	u = (37*n) % (image.width()  - w);
+	const size_t	v = (53*n) % (image.height() - h);
+	for (size_t y = v; y < v + h; ++y)
+	    for (size_t x = u; x < u + w; ++x)
+		image[y][x] = 255 - image[y][x];
+	integral.update(image, u, v, w, h);
+    }
+
+    const IntegralImage<float>	rebuilt(image);
+    float			diffMax = 0;
+    for (size_t v = 0; v < rebuilt.height(); ++v)
+	for (size_t u = 0; u < rebuilt.width(); ++u)
+	    diffMax = std::max(diffMax,
+			       std::abs(integral[v][u] - rebuilt[v][u]));
+
+    return diffMax;
+}
+
+//! SIMD版とSIMDを使わない版のSURF特徴を比較する．
+/*!
+  \param image	入力画像
+  \param params	SURF特徴抽出のパラメータ
+  \return	方向と記述子の要素の差の絶対値の最大値
+*/
+template <class F> static float
+compareSIMD(const Image<u_char>& image, const SURFCreator::Parameters& params)
+{
+    using namespace	std;
+    
+    SURFCreator	surfCreator(params);
+    vector<F>	features, scalarFeatures;
+    surfCreator.createSURFs<F>(image, back_inserter(features));
+    createScalarSURFs(image, params.scoreThresh, scalarFeatures);
+
+    if (features.size() != scalarFeatures.size())
+	throw runtime_error("compareSIMD(): different numbers of features!!");
+
+  // TBBによる並列処理では出力順が不定なので，位置とスケールで整列する．
+    const auto	less = [](const F& a, const F& b)
+			{
+			    return std::tie(a[1], a[0], a.sigma)
+				 < std::tie(b[1], b[0], b.sigma);
+			};
+    sort(features.begin(),	 features.end(),       less);
+    sort(scalarFeatures.begin(), scalarFeatures.end(), less);
+
+    float	diffMax = 0;
+    for (size_t n = 0; n < features.size(); ++n)
+    {
+	const auto&	f = features[n];
+	const auto&	g = scalarFeatures[n];
+	if (f[0] != g[0] || f[1] != g[1] || f.sigma != g.sigma)
+	    throw runtime_error("compareSIMD(): different feature positions!!");
+
+	diffMax = std::max(diffMax, std::abs(f.angle - g.angle));
+	for (size_t i = 0; i < f.descriptor.size(); ++i)
+	    diffMax = std::max(diffMax,
+			       std::abs(f.descriptor[i] - g.descriptor[i]));
+    }
+
+    cerr << features.size() << " features ("
+	 << F::DescriptorDim << "-dim.): max. diff. = " << diffMax << endl;
+
+    return diffMax;
+}
+
 template <class MAP, class T> static void
 doJob(const Image<T> images[2],
       const SURFCreator::Parameters& surfParams,
@@ -185,10 +268,12 @@ main(int argc, char* argv[])
     SURFCreator::Parameters	surfParams;
     FeatureMatch::Parameters	matchParams;
     bool			refine		= false;
+    size_t			nupdates	= 0;
+    bool			compare		= false;
     element_type		intensityThresh	= DEFAULT_INTENSITY_THRESH;
     const element_type		RAD		= M_PI/180;
     extern char			*optarg;
-    for (int c; (c = getopt(argc, argv, "PAt:a:s:i:c:rk:")) != -1; )
+    for (int c; (c = getopt(argc, argv, "PAt:a:s:i:c:rk:u:V")) != -1; )
 	switch (c)
 	{
 	  case 'P':
@@ -218,6 +303,12 @@ main(int argc, char* argv[])
 	  case 'k':
 	    intensityThresh = atof(optarg);
 	    break;
+	  case 'u':
+	    nupdates = atoi(optarg);
+	    break;
+	  case 'V':
+	    compare = true;
+	    break;
 	}
 
     try
@@ -237,6 +328,32 @@ main(int argc, char* argv[])
 	    images[1].restore(cin);
 	}
 
+	if (nupdates > 0)
+	{
+	  // 積分画像の部分更新を全体の再構築と比較する．
+	    cerr << "Max. diff. after " << nupdates
+		 << " integral image updates: "
+		 << checkIntegralUpdate(images[0], nupdates,
+					IntegralImage<float>().maxUpdates())
+		 << " (periodically rebuilt), "
+		 << checkIntegralUpdate(images[0], nupdates, nupdates)
+		 << " (never rebuilt)" << endl;
+	    return 0;
+	}
+
+	if (compare)
+	{
+	  // SIMD版の方向と記述子をSIMDを使わない版と比較する．
+	    float	diffMax = 0;
+	    for (const auto& image : images)
+		diffMax = std::max({diffMax,
+				    compareSIMD<SURF>(image, surfParams),
+				    compareSIMD<SURF128>(image, surfParams)});
+	    if (diffMax > 1e-5)
+		throw runtime_error("SIMD and scalar SURFs differ!!");
+	    return 0;
+	}
+
 	switch (mapType)
 	{
 	  case PROJECTIVE:
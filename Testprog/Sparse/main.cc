@@ -2,7 +2,7 @@
  *  $Id: main.cc,v 1.4 2011-09-19 18:26:19 ueshiba Exp $
  */
 #include <fstream>
-#include "TU/SparseMatrix++.h"
+#include "TU/SlicedEllpackMatrix.h"
 
 namespace TU
 {
@@ -108,6 +108,110 @@ ioTest()
     cerr << "--- Sa(restored) ---\n" << Sa;
 }
 
+template <class T> void
+solveTest()
+{
+    using namespace	std;
+    
+    Matrix<T>	A;
+    cerr << "A(positive definite)>> " << flush;
+    cin >> A;
+    symmetrize(A);
+    SparseMatrix<T, true>	S = makeSparseMatrix<true>(A);
+    cerr << "--- S ---\n" << S;
+
+    Vector<T>	b;
+    cerr << "b>> " << flush;
+    cin >> b;
+    Vector<T>	x0 = b;
+    solve(A, x0);
+    cerr << "--- x(dense) ---\n" << x0;
+
+    SparseLDL<T>	ldl;
+    ldl.analyze(S, SparseLDL<T>::NATURAL);
+    ldl.factorize(S);
+    Vector<T>	x = b;
+    ldl.substitute(x);
+    cerr << "--- error(LDL, natural): nelements = " << ldl.nelements()
+	 << " ---\n" << x - x0
+	 << "--- residual ---\n" << S * x - b;
+
+    ldl.analyze(S, SparseLDL<T>::MINIMUM_DEGREE);
+    ldl.factorize(S);
+    x = b;
+    ldl.substitute(x);
+    cerr << "--- error(LDL, minimum degree): nelements = " << ldl.nelements()
+	 << " ---\n" << x - x0
+	 << "--- residual ---\n" << S * x - b;
+
+  // 非零成分の配置が異なる行列(A の対角部分)の数値的分解は拒否される．
+    Matrix<T>	Ad(A.nrow(), A.ncol());
+    Ad = 0;
+    for (size_t i = 0; i < Ad.nrow(); ++i)
+	Ad[i][i] = A[i][i];
+    try
+    {
+	ldl.factorize(makeSparseMatrix<true>(Ad));
+	cerr << "--- LDL of diag(A): accepted ---" << endl;
+    }
+    catch (const std::invalid_argument& err)
+    {
+	cerr << "--- LDL of diag(A): rejected ---\n" << err.what() << endl;
+    }
+
+    x.resize(0);
+    auto	niter = solveCG(S, b, x, JacobiPreconditioner<T>(S));
+    cerr << "--- error(CG, Jacobi): niter = " << niter << " ---\n" << x - x0
+	 << "--- residual ---\n" << S * x - b;
+
+  // 2x2の対角ブロック(次元が奇数ならば最後は1x1)による前処理
+    Array<size_t>	dims((S.nrow() + 1)/2);
+    dims = 2;
+    if (S.nrow() % 2)
+	dims[dims.size() - 1] = 1;
+    x.resize(0);
+    niter = solveCG(S, b, x, BlockJacobiPreconditioner<T>(S, dims));
+    cerr << "--- error(CG, block Jacobi): niter = " << niter << " ---\n"
+	 << x - x0
+	 << "--- residual ---\n" << S * x - b;
+
+    x.resize(0);
+    niter = solveCG(S, b, x, IncompleteCholeskyPreconditioner<T>(S));
+    cerr << "--- error(CG, IC(0)): niter = " << niter << " ---\n" << x - x0
+	 << "--- residual ---\n" << S * x - b;
+}
+
+template <class T, bool SYM> void
+multiplyTest()
+{
+    using namespace	std;
+    
+    Matrix<T>	A;
+    cerr << "A>> " << flush;
+    cin >> A;
+    if (SYM)
+	symmetrize(A);
+    SparseMatrix<T, SYM>	S = makeSparseMatrix<SYM>(A);
+    cerr << "--- S ---\n" << S;
+
+    Vector<T>	x;
+    cerr << "x>> " << flush;
+    cin >> x;
+
+  // 作業領域を使い回しても積が変わらないことを確かめる．
+    typename SparseMatrix<T, SYM>::workspace_type	ws;
+    Vector<T>	y;
+    for (size_t n = 0; n < 2; ++n)
+    {
+	S.multiply(x, y, ws);
+	cerr << "--- S*x(" << n << ") error ---\n" << y - A * x;
+    }
+
+    SlicedEllpackMatrix<T>	E(S);
+    E.multiply(x, y);
+    cerr << "--- E*x: nelements = " << E.nelements() << " ---\n" << y;
+    cerr << "--- error ---\n" << y - A * x;
+}
 }
 
 int
@@ -126,6 +230,9 @@ main()
 	     << "A: add test(non-symmetric)\n"
 	     << "i: I/O test(symmetric)\n"
 	     << "I: I/O test(non-symmetric)\n"
+	     << "s: solve test(LDL and CG)\n"
+	     << "m: SELL-C-sigma multiply test(symmetric)\n"
+	     << "M: SELL-C-sigma multiply test(non-symmetric)\n"
 	     << "\n>> " << flush;
 
 	char	c;
@@ -155,6 +262,15 @@ main()
 	      case 'I':
 		ioTest<value_type, false>();
 		break;
+	      case 's':
+		solveTest<value_type>();
+		break;
+	      case 'm':
+		multiplyTest<value_type, true>();
+		break;
+	      case 'M':
+		multiplyTest<value_type, false>();
+		break;
 	    }
 	}
 	catch (std::exception& err)
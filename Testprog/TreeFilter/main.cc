@@ -39,7 +39,7 @@ main()
 						    {10, 20, 40, 80},
 						    {100, 200, 400, 800} });
     array2_type					b(a.nrow(), a.ncol());
-    boost::TreeFilter<weight_type, wfunc_type>	tf(wfunc_type(), sigma);
+    TU::TreeFilter<weight_type, wfunc_type>	tf(wfunc_type(), sigma);
     tf.convolve(a.begin(), a.end(), a.begin(), a.end(), b.begin());
 
     cerr << "-------- all vertices --------" << endl;
@@ -82,7 +82,7 @@ class MyCmdWindow : public CmdWindow
     const Image<G>&				_guide;
     Image<float>				_result;
     Diff<G, float>				_wfunc;
-    boost::TreeFilter<float, Diff<G, float> >	_tf;
+    TU::TreeFilter<float, Diff<G, float> >	_tf;
     MyCanvasPane<T>				_imageCanvas;
     MyCanvasPane<float>				_resultCanvas;
 };
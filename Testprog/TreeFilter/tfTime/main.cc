@@ -4,6 +4,10 @@
 #include "TU/Image++.h"
 #include "TU/TreeFilter.h"
 #include "TU/Profiler.h"
+#if defined(USE_TBB)
+#  include <thread>
+#  include <tbb/global_control.h>
+#endif
 
 namespace TU
 {
@@ -19,30 +23,65 @@ struct Diff
 		}
 };
 
-template <class T, class G, class U> void
-doJob(const Image<T>& image, const Image<G>& guide, U sigma, bool normalize)
+template <class T, class G, class U> double
+doJob(const Image<T>& image, const Image<G>& guide, U sigma, bool normalize,
+      bool save)
 {
     typedef T					value_type;
     typedef G					guide_type;
     typedef U					weight_type;
     typedef Diff<guide_type, weight_type>	wfunc_type;
+    typedef std::chrono::system_clock		clock_type;
     
-    boost::TreeFilter<weight_type, wfunc_type, std::chrono::system_clock>
+    TU::TreeFilter<weight_type, wfunc_type, clock_type>
 			tf(wfunc_type(), sigma);
     Image<weight_type>	out(image.width(), image.height());
     Profiler<>		profiler(1);
-    
-    for (size_t n = 0; n < 10; ++n)
+    constexpr size_t	NFrames = 10;
+
+    const auto	t0 = clock_type::now();
+    for (size_t n = 0; n < NFrames; ++n)
     {
 	profiler.start(0);
 	tf.convolve(image.begin(), image.end(), guide.begin(), guide.end(),
 		    out.begin(), normalize);
 	profiler.nextFrame();
     }
+    const std::chrono::duration<double, std::milli>	t = clock_type::now()
+							  - t0;
     tf.print(std::cerr);
     profiler.print(std::cerr);
 
-    out.save(std::cout);
+    if (save)
+	out.save(std::cout);
+
+    return t.count() / NFrames;
+}
+    
+//! スレッド数を1から順に増やしながら処理時間と速度向上率を表示する
+template <class T, class G, class U> void
+doJobs(const Image<T>& image, const Image<G>& guide, U sigma, bool normalize)
+{
+#if defined(USE_TBB)
+    const size_t	nthreads = std::max(std::thread::hardware_concurrency(),
+					    1u);
+    double		t1 = 0;
+    
+    for (size_t n = 1; n <= nthreads; ++n)
+    {
+	tbb::global_control	control(
+				    tbb::global_control::max_allowed_parallelism,
+				    n);
+	const auto		t = doJob(image, guide, sigma, normalize,
+					  n == nthreads);
+	if (n == 1)
+	    t1 = t;
+	std::cerr << n << " thread(s): " << t << "ms/frame, speedup = "
+		  << t1/t << std::endl;
+    }
+#else
+    doJob(image, guide, sigma, normalize, true);
+#endif
 }
     
 }
@@ -85,7 +124,7 @@ main(int argc, char* argv[])
 		 image.height() != guide.height())
 	    throw std::runtime_error("Mismatched image sizes!");
 
-	doJob(image, guide, sigma, normalize);
+	doJobs(image, guide, sigma, normalize);
     }
     catch (std::exception& err)
     {
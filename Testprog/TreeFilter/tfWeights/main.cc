@@ -118,7 +118,7 @@ class MyCmdWindow : public CmdWindow
     const Image<G>&				_guide;
     Image<T>					_weights;
     Diff<G, float>				_wfunc;
-    boost::TreeFilter<T, Diff<G, float> >	_tf;
+    TU::TreeFilter<T, Diff<G, float> >	_tf;
     MyCanvasPane<G>				_guideCanvas;
     MyCanvasPane<T>				_weightsCanvas;
 };
@@ -1,8 +1,70 @@
 /*
  *  $Id: mtest.cc,v 1.4 2010-03-03 01:36:57 ueshiba Exp $
  */
+#include <random>
 #include "TU/Vector++.h"
 
+namespace TU
+{
+template <class T> Matrix<T>
+randomMatrix(size_t nrow, size_t ncol, std::mt19937& generator)
+{
+    std::uniform_real_distribution<T>	distribution(-1.0, 1.0);
+    Matrix<T>				A(nrow, ncol);
+    for (auto&& row : A)
+	for (auto&& val : row)
+	    val = distribution(generator);
+
+    return A;
+}
+
+template <class T> Matrix<T>
+naiveProduct(const Matrix<T>& A, const Matrix<T>& B)
+{
+    Matrix<T>	C(A.nrow(), B.ncol());
+    for (size_t i = 0; i < C.nrow(); ++i)
+	for (size_t j = 0; j < C.ncol(); ++j)
+	{
+	    T	val = 0;
+	    for (size_t k = 0; k < A.ncol(); ++k)
+		val += A[i][k] * B[k][j];
+	    C[i][j] = val;
+	}
+
+    return C;
+}
+
+template <class T> T
+maxError(const Matrix<T>& A, const Matrix<T>& B)
+{
+    T	err = 0;
+    for (size_t i = 0; i < A.nrow(); ++i)
+	for (size_t j = 0; j < A.ncol(); ++j)
+	    err = std::max(err, std::abs(A[i][j] - B[i][j]));
+
+    return err;
+}
+
+template <class T> void
+gemmTest(size_t m, size_t k, size_t n)
+{
+    using namespace	std;
+
+    mt19937		generator(0);
+    const Matrix<T>	A = randomMatrix<T>(m, k, generator);
+    const Matrix<T>	B = randomMatrix<T>(k, n, generator);
+    const Matrix<T>	At = transpose(A);
+    const Matrix<T>	Bt = transpose(B);
+    const Matrix<T>	C = naiveProduct(A, B);
+
+    cout << "  A * B:          " << maxError<T>(A * B, C) << '\n'
+	 << "  At^t * B:       " << maxError<T>(transpose(At) * B, C) << '\n'
+	 << "  A * Bt^t:       " << maxError<T>(A * transpose(Bt), C) << '\n'
+	 << "  At^t * Bt^t:    "
+	 << maxError<T>(transpose(At) * transpose(Bt), C) << endl;
+}
+}
+
 int
 main()
 {
@@ -31,6 +93,7 @@ main()
 	     << "\n B: bidiagonalize matrix"
 	     << "\n S: sigular value decomposition"
 	     << "\n G: generalized inverse matrix"
+	     << "\n M: matrix product against naive product"
 	  //	     << "\n C: matrix type conversion"
 	     << "\nSelect function >> ";
 	char	c;
@@ -217,6 +280,20 @@ main()
 		 << endl;
 	    break;
 
+	  case 'M':
+	  {
+	    size_t	m, k, n;
+	    cerr << " m k n >> ";
+	    cin >> m >> k >> n;
+	    cout << "--- max. error of " << m << 'x' << k << " * "
+		 << k << 'x' << n << " (double) ---\n";
+	    gemmTest<double>(m, k, n);
+	    cout << "--- max. error of " << m << 'x' << k << " * "
+		 << k << 'x' << n << " (float) ---\n";
+	    gemmTest<float>(m, k, n);
+	  }
+	    break;
+
 	  /*	  case 'C':
 	    cerr << " A >> ";
 	    cin >> A;
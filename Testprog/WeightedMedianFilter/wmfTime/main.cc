@@ -11,9 +11,88 @@ namespace TU
 /************************************************************************
 *  static functions							*
 ************************************************************************/
+//! 窓内の全点を直接調べて重み付けメディアンを求める．
+/*!
+  \return	メディアンの位置に対する (出力値, cut point直後のbalance値)
+*/
+template <class W> static std::pair<u_char, double>
+weightedMedian(const Image<u_char>& in, const Image<u_char>& guide,
+	       const W& wfunc, size_t winSize, size_t v, size_t u,
+	       u_char val)
+{
+    const auto	mid = winSize/2;
+    const auto	gc  = guide[v + mid][u + mid];
+    double	hist[256] = {0};
+    double	total = 0;
+    for (size_t y = v; y < v + winSize; ++y)
+	for (size_t x = u; x < u + winSize; ++x)
+	{
+	    const double	w = wfunc(gc, guide[y][x]);
+	    hist[in[y][x]] += w;
+	    total	   += w;
+	}
+
+  // balance(c) = (c未満の重み) - (c以上の重み) が初めて非負になる
+  // 直前のレベルがメディアン
+    double	below = 0;
+    size_t	median = 0;
+    for (; median < 255; ++median)
+	if (2*(below + hist[median]) - total >= 0)
+	    break;
+	else
+	    below += hist[median];
+
+  // 与えられた値との不一致が同順位によるものか判定するための balance 値
+    double	balance = 0;
+    for (size_t l = 0; l <= std::min<size_t>(median, val); ++l)
+	balance += hist[l];
+
+    return {u_char(median), (2*balance - total)/total};
+}
+
+//! 直接計算した重み付けメディアンおよび単一ストリップでの結果と比較する．
+template <class W> static void
+checkJob(const Image<u_char>& in, const Image<u_char>& guide,
+	 const W& wfunc, WeightedMedianFilter2<u_char, W>& wmf,
+	 const Image<u_char>& out)
+{
+    const auto		winSize = wmf.winSize();
+    const auto		mid	= wmf.offset();
+    const auto		stripWidth = wmf.stripWidth();
+    Image<u_char>	single(in.width(), in.height());
+    wmf.setStripWidth(0);
+    wmf.convolve(in.begin(), in.end(),
+		 guide.begin(), guide.end(), single.begin(), true);
+    wmf.setStripWidth(stripWidth);
+
+    size_t	nerrors = 0, nties = 0, nstrips = 0;
+    for (size_t v = 0; v < wmf.outSizeV(in.height()); ++v)
+	for (size_t u = 0; u < wmf.outSizeH(in.width()); ++u)
+	{
+	    const auto	val = out[v + mid][u + mid];
+	    const auto	ref = weightedMedian(in, guide, wfunc,
+					     winSize, v, u, val);
+	    if (val != ref.first)
+	    {
+		if (std::abs(ref.second) < 1.0e-5)
+		    ++nties;
+		else
+		    ++nerrors;
+	    }
+	    if (val != single[v + mid][u + mid])
+		++nstrips;
+	}
+
+    std::cerr << "--- check ---\n"
+	      << "  #pixels differing from the direct weighted median: "
+	      << nerrors << " (+ " << nties << " ties)\n"
+	      << "  #pixels differing from the single strip result:    "
+	      << nstrips << std::endl;
+}
+    
 template <class T, class G> static void
 doJob(const Image<T>& in, const Image<G>& guide,
-      float sigma, size_t winSize, size_t grainSize)
+      float sigma, size_t winSize, size_t grainSize, bool check)
 {
     typedef ExpDiff<G, float>	wfunc_type;
 
@@ -34,6 +113,9 @@ doJob(const Image<T>& in, const Image<G>& guide,
     }
     wmf.print(std::cerr);
     profiler.print(std::cerr);
+
+    if (check)
+	checkJob(in, guide, wfunc, wmf, out);
     
     out.save(std::cout);
 }
@@ -58,8 +140,9 @@ main(int argc, char* argv[])
     float		sigma = 5.5;
     size_t		winSize = 11;
     size_t		grainSize = 100;
+    bool		check = false;
     extern char*	optarg;
-    for (int c; (c = getopt(argc, argv, "s:w:g:")) != -1; )
+    for (int c; (c = getopt(argc, argv, "s:w:g:c")) != -1; )
 	switch (c)
 	{
 	  case 's':
@@ -71,6 +154,9 @@ main(int argc, char* argv[])
 	  case 'g':
 	    grainSize = atoi(optarg);
 	    break;
+	  case 'c':
+	    check = true;
+	    break;
 	}
 
     try
@@ -84,7 +170,7 @@ main(int argc, char* argv[])
 		 image.height() != guide.height())
 	    throw std::runtime_error("Mismatched image sizes!");
 
-	doJob(image, guide, sigma, winSize, grainSize);
+	doJob(image, guide, sigma, winSize, grainSize, check);
     }
     catch (std::exception& err)
     {
@@ -419,7 +419,7 @@ MyCmdWindow<PIXEL, DISP>::stereoMatch(int algo, OUT out)
       {
 	typedef Diff<pixel_type, float>		wfunc_type;
 
-	boost::TreeFilter<ScoreArray, wfunc_type>	filter(wfunc_type(),
+	TU::TreeFilter<ScoreArray, wfunc_type>	filter(wfunc_type(),
 							       _params.sigma);
 	
 	filter.convolve(ib, ie,
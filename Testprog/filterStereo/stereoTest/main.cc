@@ -125,7 +125,7 @@ doJob(const Image<T>& imageL, const Image<T>& imageR,
       {
 	using wfunc_type = MyDiff<T, S>;
 
-	boost::TreeFilter<Array<S>, wfunc_type>	filter(wfunc_type(),
+	TU::TreeFilter<Array<S>, wfunc_type>	filter(wfunc_type(),
 						       params.sigma);
 	filter.convolve(rowI, rowIe, rowL, rowLe, rowO, true);
       }
@@ -145,7 +145,7 @@ doJob(const Image<T>& imageL, const Image<T>& imageR,
       {
 	using wfunc_type = MyDiff<T, S>;
 
-	boost::TreeFilter<Array<S>, wfunc_type>	filter(wfunc_type(),
+	TU::TreeFilter<Array<S>, wfunc_type>	filter(wfunc_type(),
 						       params.sigma);
 
 	for (size_t i = 0; i < ntrials; ++i)
@@ -0,0 +1,109 @@
+/*
+ *  $Id$
+ */
+#include <random>
+#include "TU/Camera++.h"
+
+namespace TU
+{
+//! 一括処理の結果と1点ずつの処理の結果の差の最大値を返す．
+template <class T, class F> static T
+maxError(const PointBatch<T>& Y, F f)
+{
+    T	err = 0;
+    for (size_t k = 0; k < Y.ncol(); ++k)
+	for (size_t i = 0; i < Y.nrow(); ++i)
+	    err = std::max(err, std::abs(Y[i][k] - f(i, k)));
+
+    return err;
+}
+
+template <class T> static void
+doJob(size_t npoints)
+{
+    using namespace	std;
+    
+    mt19937				generator(0);
+    uniform_real_distribution<T>	distribution(-1, 1);
+
+  // 平面射影変換
+    Homography<T>	H;
+    for (size_t i = 0; i < 3; ++i)
+	for (size_t j = 0; j < 3; ++j)
+	    H[i][j] = (i == j ? 1 : 0) + T(0.1)*distribution(generator);
+
+    PointBatch<T>	x(2, npoints);
+    for (size_t k = 0; k < npoints; ++k)
+	for (size_t i = 0; i < 2; ++i)
+	    x[i][k] = distribution(generator);
+
+    PointBatch<T>	y;
+    H(x, y);
+    cout << "  Homography::operator ():\t"
+	 << maxError(y, [&](size_t i, size_t k)
+			{ return H(Point2<T>{x[0][k], x[1][k]})[i]; })
+	 << endl;
+    H.mapP(x, y);
+    cout << "  Homography::mapP():\t\t"
+	 << maxError(y, [&](size_t i, size_t k)
+			{ return H.mapP(Point2<T>{x[0][k], x[1][k]})[i]; })
+	 << endl;
+    H.jacobian(x, y);
+    cout << "  Homography::jacobian():\t"
+	 << maxError(y, [&](size_t i, size_t k)
+			{
+			    return H.jacobian(Point2<T>{x[0][k], x[1][k]})
+					     [i/2][i%2];
+			})
+	 << endl;
+
+  // 放射歪曲を持つカメラ
+    using camera_type	= Camera<IntrinsicWithDistortion<Intrinsic<T> > >;
+
+    camera_type		camera({T(0.1), T(-0.2), T(-5)},
+			       rotation(T(0.1), T(-0.2), T(0.3)),
+			       {T(800), {T(320), T(240)}, T(1.1), T(0.01),
+				T(-0.2), T(0.05)});
+    PointBatch<T>	X(3, npoints);
+    for (size_t k = 0; k < npoints; ++k)
+	for (size_t i = 0; i < 3; ++i)
+	    X[i][k] = distribution(generator);
+
+    const auto	point = [&X](size_t k)
+			{
+			    return Point3<T>{X[0][k], X[1][k], X[2][k]};
+			};
+    camera.CanonicalCamera<T>::x(X, y);
+    cout << "  CanonicalCamera::x():\t\t"
+	 << maxError(y, [&](size_t i, size_t k)
+			{ return camera.CanonicalCamera<T>::x(point(k))[i]; })
+	 << endl;
+    camera.CanonicalCamera<T>::jacobian(X, y);
+    cout << "  CanonicalCamera::jacobian():\t"
+	 << maxError(y, [&](size_t i, size_t k)
+			{
+			    return camera.CanonicalCamera<T>::jacobian(
+					point(k))[i/3][i%3];
+			})
+	 << endl;
+    camera(X, y);
+    cout << "  Camera::operator ():\t\t"
+	 << maxError(y, [&](size_t i, size_t k)
+			{ return camera(point(k))[i]; })
+	 << endl;
+}
+    
+}
+
+int
+main(int argc, char* argv[])
+{
+    size_t	npoints = (argc > 1 ? atoi(argv[1]) : 1003);
+
+    std::cout << "--- max. error of batched results (float) ---" << std::endl;
+    TU::doJob<float>(npoints);
+    std::cout << "--- max. error of batched results (double) ---" << std::endl;
+    TU::doJob<double>(npoints);
+
+    return 0;
+}
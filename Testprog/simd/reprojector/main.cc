@@ -0,0 +1,165 @@
+/*
+ *  $Id$
+ */
+#include <random>
+#include "TU/StereoUtility.h"
+
+namespace TU
+{
+//! 視差画像の各画素を1点ずつ Q によって3次元点に変換する．
+template <class T> static std::vector<Point3<double> >
+reprojectEach(const Reprojector<T>& reprojector, const Image<float>& disparityMap)
+{
+    const auto&				Q = reprojector.Q();
+    std::vector<Point3<double> >	points;
+    for (size_t v = 0; v < disparityMap.height(); ++v)
+	for (size_t u = 0; u < disparityMap.width(); ++u)
+	{
+	    const double	d = disparityMap[v][u];
+	    if (!(d > 0 && d <= std::numeric_limits<T>::max()))
+		continue;
+
+	    double	x[4];
+	    for (size_t i = 0; i < 4; ++i)
+		x[i] = Q[i][0]*double(u) + Q[i][1]*double(v) + Q[i][2]
+		     + Q[i][3]*d;
+	    points.push_back({x[0]/x[3], x[1]/x[3], x[2]/x[3]});
+	}
+
+    return points;
+}
+
+//! 一括変換の結果と1点ずつの変換の結果の相対誤差の最大値を返す．
+template <class POINT> static double
+maxError(const std::vector<POINT>& points,
+	 const std::vector<Point3<double> >& expected)
+{
+    if (points.size() != expected.size())
+	throw std::runtime_error("maxError(): mismatched number of points!!");
+
+    double	err = 0;
+    for (size_t n = 0; n < points.size(); ++n)
+    {
+	const auto&	p = points[n];
+	const auto&	q = expected[n];
+	const double	s = std::max({1.0, std::abs(q[0]),
+				      std::abs(q[1]), std::abs(q[2])});
+	err = std::max({err, std::abs(p.x - q[0])/s,
+			     std::abs(p.y - q[1])/s, std::abs(p.z - q[2])/s});
+    }
+
+    return err;
+}
+
+template <class T> static void
+doJob(size_t width, size_t height, size_t nrowsPerBand)
+{
+    using namespace	std;
+
+    mt19937				generator(0);
+    uniform_real_distribution<float>	distribution(0, 64);
+
+  // 平行化されたステレオカメラ
+    Matrix34d	Pl, Pr;
+    Pl[0][0] = Pl[1][1] = Pr[0][0] = Pr[1][1] = 500;
+    Pl[0][2] = Pr[0][2] = 0.5*width;
+    Pl[1][2] = Pr[1][2] = 0.5*height;
+    Pl[2][2] = Pr[2][2] = 1;
+    Pr[0][3] = -500*0.1;
+    Reprojector<T>	reprojector(Pl, Pr, nrowsPerBand, 3);
+
+  // 0，負値，NaN，無限大の無効な視差を混ぜ，第1行は全画素を無効にする．
+    const float	invalid[] = {0, -1, numeric_limits<float>::quiet_NaN(),
+			     numeric_limits<float>::infinity()};
+    Image<float>	disparityMap(width, height);
+    Image<RGB>		image(width, height);
+    for (size_t v = 0; v < height; ++v)
+	for (size_t u = 0; u < width; ++u)
+	{
+	    const auto	d = distribution(generator);
+	    disparityMap[v][u] = (v == 1 || d < 16 ? invalid[(u + v) % 4] : d);
+	    image[v][u] = RGB(u, v, u + v);
+	}
+
+    const auto	check = [](double err)
+			{
+			    if (err > 64*numeric_limits<T>::epsilon())
+				throw runtime_error("doJob(): too large errors!!");
+			    return err;
+			};
+
+  // 2回目は有効な画素を増やして出力点の領域が拡げられることを確かめる．
+    for (size_t n = 0; n < 2; ++n)
+    {
+	if (n == 1)
+	    for (size_t v = 2; v < height; ++v)
+		for (size_t u = 0; u < width; ++u)
+		    if (!(disparityMap[v][u] > 0))
+			disparityMap[v][u] = 1 + u % 8;
+
+	const auto		expected = reprojectEach(reprojector,
+							 disparityMap);
+	vector<typename Reprojector<T>::PointXYZ>	points;
+	reprojector(disparityMap, points);
+	cout << "  " << expected.size() << " points:\t\t"
+	     << check(maxError(points, expected)) << endl;
+
+	vector<typename Reprojector<T>::PointXYZRGB>	pointsRGB;
+	size_t	vb_next = 0;
+	reprojector(disparityMap, image,
+		    [&](size_t vb, size_t ve,
+			const typename Reprojector<T>::PointXYZRGB* p,
+			const typename Reprojector<T>::PointXYZRGB* q)
+		    {
+			if (vb != vb_next ||
+			    ve != min(vb + nrowsPerBand, height))
+			    throw runtime_error("doJob(): wrong band order!!");
+			vb_next = ve;
+			pointsRGB.insert(pointsRGB.end(), p, q);
+		    });
+	if (vb_next != height)
+	    throw runtime_error("doJob(): missing bands!!");
+	cout << "  " << pointsRGB.size() << " colored points:\t"
+	     << check(maxError(pointsRGB, expected)) << endl;
+
+	size_t	k = 0;
+	for (size_t v = 0; v < height; ++v)
+	    for (size_t u = 0; u < width; ++u)
+		if (disparityMap[v][u] > 0 &&
+		    disparityMap[v][u] <= numeric_limits<T>::max())
+		{
+		    const auto&	rgb = pointsRGB[k++].rgb;
+		    if (rgb.r != image[v][u].r || rgb.g != image[v][u].g ||
+			rgb.b != image[v][u].b)
+			throw runtime_error("doJob(): mismatched colors!!");
+		}
+    }
+}
+
+}
+
+int
+main(int argc, char* argv[])
+{
+  // 幅はSIMDベクトルの要素数の倍数でなく，最後の行帯は nrowsPerBand 行に満たない．
+    const size_t	width	     = (argc > 1 ? atoi(argv[1]) : 101);
+    const size_t	height	     = (argc > 2 ? atoi(argv[2]) : 37);
+    const size_t	nrowsPerBand = (argc > 3 ? atoi(argv[3]) : 8);
+
+    try
+    {
+	std::cout << "--- max. relative error of reprojected points (float) ---"
+		  << std::endl;
+	TU::doJob<float>(width, height, nrowsPerBand);
+	std::cout << "--- max. relative error of reprojected points (double) ---"
+		  << std::endl;
+	TU::doJob<double>(width, height, nrowsPerBand);
+    }
+    catch (std::exception& err)
+    {
+	std::cerr << err.what() << std::endl;
+	return 1;
+    }
+
+    return 0;
+}
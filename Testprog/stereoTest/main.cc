@@ -4,10 +4,13 @@
 #include <unistd.h>
 #include <algorithm>
 #include <limits>
+#include <random>
 #include "TU/io.h"
 #include "TU/Rectify.h"
 #include "TU/SADStereo.h"
 #include "TU/GFStereo.h"
+#include "TU/SGMStereo.h"
+#include "TU/PyramidStereo.h"
 
 #define DEFAULT_PARAM_FILE	"stereo"
 #define DEFAULT_CONFIG_DIRS	".:/usr/local/etc"
@@ -19,12 +22,163 @@ namespace TU
 /************************************************************************
 *  static functions							*
 ************************************************************************/
+//! 画像ピラミッドによるマッチング結果を単一段でのマッチング結果と比較する．
+template <class STEREO, class T> static void
+comparePyramid(const STEREO& stereo, const Image<T>& imageL,
+	       const Image<T>& imageR, const Image<float>& disparityMap,
+	       size_t nlevels)
+{
+    using namespace	std;
+    
+    PyramidStereo<STEREO, T>	pyramid(stereo.getParameters(), nlevels);
+    Image<float>		pyramidMap;
+    pyramid(imageL, imageR, pyramidMap);
+
+    size_t	nvalid = 0, nvalidP = 0, nboth = 0, nerrors = 0;
+    double	sum = 0;
+    for (size_t v = 0; v < disparityMap.height(); ++v)
+	for (size_t u = 0; u < disparityMap.width(); ++u)
+	{
+	    const auto	d  = disparityMap[v][u];
+	    const auto	dp = pyramidMap[v][u];
+	    if (d != 0)
+		++nvalid;
+	    if (dp != 0)
+		++nvalidP;
+	    if (d != 0 && dp != 0)
+	    {
+		++nboth;
+		sum += std::abs(dp - d);
+		if (std::abs(dp - d) > 1)
+		    ++nerrors;
+	    }
+	}
+
+    cerr << "--- Pyramid(" << nlevels << " levels) vs. single level ---\n"
+	 << "  #valid pixels:\t" << nvalidP << " / " << nvalid << '\n'
+	 << "  mean |difference|:\t" << (nboth ? sum/nboth : 0.0) << '\n'
+	 << "  #|difference| > 1:\t" << nerrors << " / " << nboth << endl;
+
+    pyramidMap.save(cout);
+
+  // 両者で1画素を越えて食い違う画素は1%以下でなければならない．
+    if (100*nerrors > nboth)
+	throw runtime_error("comparePyramid(): too many differences!!");
+}
+
+template <class S, class T> static void
+comparePyramid(const SGMStereo<S, T>&, const Image<T>&, const Image<T>&,
+	       const Image<float>&, size_t)
+{
+    throw std::runtime_error("PyramidStereo does not support SGMStereo!!");
+}
+    
+//! 合成画像によってサブピクセル視差の当てはめを検査する．
+/*!
+  右画像を左画像から横方向にずらした3つの帯からなる合成画像を作る．
+  第1の帯のずれは端数を持ち，第2, 3の帯のずれは視差の探索範囲の両端
+  (dmax および dmin)に一致する．放物線および等角直線の当てはめについて，
+  第1の帯の視差の平均が真値に近いこと，および第2, 3の帯の端から0.5画素
+  未満の視差が補正されずに整数値のまま出力されることを確かめる．隣の
+  視差からの補正量は0.5未満なので，この範囲の視差は全て端の視差である．
+*/
+template <class STEREO, class T> static void
+checkSubpixel(typename STEREO::Parameters params)
+{
+    using namespace	std;
+
+    constexpr size_t	W = 320, H = 120, B = H/3;
+    STEREO		stereo(params);
+    stereo.setParameters(params);
+    params = stereo.getParameters();
+    const float		dmax  = params.disparityMax;
+    const float		dmin  = params.disparityMin();
+    const float		dfrac = floor(0.5f*(dmax + dmin)) + 0.35f;
+
+  // 周期と位相がランダムな正弦波の和をテクスチャとし，帯毎に右画像の
+  // 横方向のずれ dmax - d を与えて左右の画像を標本化する．
+    constexpr size_t			NWAVES = 4;
+    mt19937				generator(0);
+    uniform_real_distribution<float>	distribution(0, 1);
+    float				freq[H][NWAVES], phase[H][NWAVES];
+    for (size_t v = 0; v < H; ++v)
+	for (size_t k = 0; k < NWAVES; ++k)
+	{
+	    freq[v][k]  = 2*M_PI/(6 + 30*distribution(generator));
+	    phase[v][k] = 2*M_PI*distribution(generator);
+	}
+    const auto	texture = [&](size_t v, float x)
+			  {
+			      float	val = 128;
+			      for (size_t k = 0; k < NWAVES; ++k)
+				  val += 30*sin(freq[v][k]*x + phase[v][k]);
+			      return T(val + 0.5f);
+			  };
+
+    const float		truth[] = {dfrac, dmax, dmin};
+    Image<T>		imageL(W, H), imageR(W, H);
+    for (size_t v = 0; v < H; ++v)
+	for (size_t u = 0; u < W; ++u)
+	{
+	    imageL[v][u] = texture(v, u);
+	    imageR[v][u] = texture(v, u - (dmax - truth[v/B]));
+	}
+
+    using fitting_type	= typename STEREO::SubpixelFitting;
+    const pair<fitting_type, const char*>
+			fittings[] = {{STEREO::PARABOLA,    "parabola"},
+				      {STEREO::EQUIANGULAR, "equiangular"}};
+    for (const auto& fitting : fittings)
+    {
+	params.subpixelFitting = fitting.first;
+	stereo.setParameters(params);
+
+	Image<float>	disparityMap(W, H);
+	stereo(imageL.cbegin(), imageL.cend(), imageR.cbegin(),
+	       disparityMap.begin());
+
+      // 第1の帯は真値から1画素未満，第2, 3の帯は0.5画素未満の視差を評価する．
+	double	sum = 0;
+	size_t	nvalid[3] = {0, 0, 0}, nrefined = 0;
+	for (size_t v = 0; v < H; ++v)
+	    for (auto d : disparityMap[v])
+		if (d != 0 && std::abs(d - truth[v/B]) < (v < B ? 1 : 0.5))
+		{
+		    ++nvalid[v/B];
+		    if (v < B)
+			sum += d;
+		    else if (d != truth[v/B])
+			++nrefined;
+		}
+	const auto	mean = (nvalid[0] ? sum/nvalid[0] : 0.0);
+
+	cerr << "--- Subpixel fitting (" << fitting.second << ") ---\n"
+	     << "  d = " << dfrac << ":\tmean = " << mean
+	     << " (" << nvalid[0] << " pixels)\n"
+	     << "  d = " << dmax << ", " << dmin << ":\t" << nrefined
+	     << " / " << nvalid[1] + nvalid[2] << " pixels refined" << endl;
+
+      // 放物線当てはめは整数視差に引き寄せられる傾向があるので許容誤差を大きくとる．
+	const auto	tolerance = (fitting.first == STEREO::PARABOLA ? 0.2 : 0.1);
+	if (4*nvalid[0] < W*B || std::abs(mean - dfrac) > tolerance)
+	    throw runtime_error("checkSubpixel(): inaccurate subpixel disparities!!");
+	if (nvalid[1] == 0 || nvalid[2] == 0 || nrefined != 0)
+	    throw runtime_error("checkSubpixel(): disparities at the ends of the search range refined!!");
+    }
+}
+
 template <class STEREO, class T> static void
 doJob(std::istream& in, const typename STEREO::Parameters& params,
-      double scale, bool binocular)
+      double scale, bool binocular, size_t nlevels, bool fitting)
 {
     using namespace	std;
     
+    if (fitting)
+    {
+	checkSubpixel<STEREO, T>(params);
+	return;
+    }
+
   // ステレオマッチングパラメータを設定．
     cerr << "--- Stereo matching parameters ---\n";
     params.put(cerr);
@@ -79,6 +233,15 @@ doJob(std::istream& in, const typename STEREO::Parameters& params,
     }
 
     disparityMap.save(cout);
+
+  // 画像ピラミッドによるマッチング結果と比較する．
+    if (nlevels > 0)
+    {
+	if (!binocular)
+	    throw runtime_error("PyramidStereo supports binocular stereo only!!");
+	comparePyramid(stereo, rectifiedImages[0], rectifiedImages[1],
+		       disparityMap, nlevels);
+    }
 }
 
 }
@@ -94,12 +257,15 @@ main(int argc, char* argv[])
 #if defined(HUGE_IMAGE)
     typedef SADStereo<int,   u_short>	SADStereoType;
     typedef GFStereo<float,  u_short>	GFStereoType;
+    typedef SGMStereo<int,   u_short>	SGMStereoType;
 #else    
     typedef SADStereo<short, u_char>	SADStereoType;
     typedef GFStereo<float,  u_char>	GFStereoType;
+    typedef SGMStereo<short, u_char>	SGMStereoType;
 #endif
 
     bool	gfstereo		= false;
+    bool	sgmstereo		= false;
     bool	doHorizontalBackMatch	= true;
     bool	doVerticalBackMatch	= true;
     string	paramFile		= DEFAULT_PARAM_FILE;
@@ -111,15 +277,20 @@ main(int argc, char* argv[])
     size_t	disparitySearchWidth	= 0;
     size_t	disparityMax		= 0;
     size_t	grainSize		= DEFAULT_GRAINSIZE;
+    size_t	nlevels			= 0;
+    bool	fitting			= false;
     
   // コマンド行の解析．
     extern char*	optarg;
-    for (int c; (c = getopt(argc, argv, "GHVp:d:s:BW:D:M:b:g:")) != EOF; )
+    for (int c; (c = getopt(argc, argv, "GSHVp:d:s:BW:D:M:b:g:P:F")) != EOF; )
 	switch (c)
 	{
 	  case 'G':
 	    gfstereo = true;
 	    break;
+	  case 'S':
+	    sgmstereo = true;
+	    break;
 	  case 'H':
 	    doHorizontalBackMatch = false;
 	    break;
@@ -153,6 +324,12 @@ main(int argc, char* argv[])
 	  case 'g':
 	    grainSize = atoi(optarg);
 	    break;
+	  case 'P':
+	    nlevels = atoi(optarg);
+	    break;
+	  case 'F':
+	    fitting = true;
+	    break;
 	}
     
   // 本当のお仕事．
@@ -177,7 +354,26 @@ main(int argc, char* argv[])
 	    params.blend		 = blend;
 	    params.grainSize		 = grainSize;
 
-	    doJob<GFStereoType, u_char>(in, params, scale, binocular);
+	    doJob<GFStereoType, u_char>(in, params, scale, binocular,
+					nlevels, fitting);
+	}
+	else if (sgmstereo)
+	{
+	    SGMStereoType::Parameters	params;
+	    params.get(in);
+	    
+	    if (windowSize != 0)
+		params.windowSize = windowSize;
+	    if (disparityMax != 0)
+		params.disparityMax = disparityMax;
+	    if (disparitySearchWidth != 0)
+		params.disparitySearchWidth = disparitySearchWidth;
+	    params.doHorizontalBackMatch = doHorizontalBackMatch;
+	    params.doVerticalBackMatch	 = doVerticalBackMatch;
+	    params.grainSize		 = grainSize;
+
+	    doJob<SGMStereoType, u_char>(in, params, scale, binocular,
+					 nlevels, fitting);
 	}
 	else
 	{
@@ -195,7 +391,8 @@ main(int argc, char* argv[])
 	    params.blend		 = blend;
 	    params.grainSize		 = grainSize;
 
-	    doJob<SADStereoType, u_char>(in, params, scale, binocular);
+	    doJob<SADStereoType, u_char>(in, params, scale, binocular,
+					 nlevels, fitting);
 	}
     }
     catch (exception& err)
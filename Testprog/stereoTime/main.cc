@@ -8,6 +8,7 @@
 #include "TU/Rectify.h"
 #include "TU/SADStereo.h"
 #include "TU/GFStereo.h"
+#include "TU/StereoPipeline.h"
 #include "TU/Profiler.h"
 
 #define DEFAULT_PARAM_FILE	"stereo"
@@ -22,7 +23,7 @@ namespace TU
 ************************************************************************/
 template <class STEREO, class T> static void
 doJob(std::istream& in, const typename STEREO::Parameters& params,
-      double scale, bool binocular, size_t ntrials)
+      double scale, bool binocular, size_t ntrials, size_t nframes)
 {
     using namespace	std;
     
@@ -63,7 +64,38 @@ doJob(std::istream& in, const typename STEREO::Parameters& params,
     cerr << "Disparity map: "
 	 << disparityMap.width() << 'x' << disparityMap.height() << endl;
     
-    if (binocular)    
+    if (nframes > 0)
+    {
+      // $BJ?9T2=!$%^%C%A%s%0!$=PNO$r%U%l!<%`C10L$G%Q%$%W%i%$%s2=$7$F9T$&!%(B
+	StereoPipeline<STEREO, T>	pipeline(rectify, stereo,
+						 binocular, nframes);
+	Profiler<>			profiler(1);
+	for (size_t i = 0; i < ntrials; ++i)
+	{
+	    size_t	n = 0;
+	    profiler.start(0);			// 10$B%U%l!<%`A4BN$N=jMW;~4V(B
+	    pipeline([&](Image<T>& imageL, Image<T>& imageR, Image<T>& imageV)
+		     {
+			 if (n++ == 10)
+			     return false;
+			 imageL = images[0];
+			 imageR = images[1];
+			 if (!binocular)
+			     imageV = images[2];
+			 return true;
+		     },
+		     [&](const Image<T>&, const Image<float>& disparity)
+		     {
+			 disparityMap = disparity;
+		     });
+	    profiler.stop();
+	    for (size_t j = 0; j < 10; ++j)	// 1$B%U%l!<%`$"$?$j$K49;;(B
+		profiler.nextFrame();
+	    cerr << "------------------------------------" << endl;
+	    profiler.print(cerr);		// $B%Q%$%W%i%$%sA4BN$N%9%k!<%W%C%H(B
+	}
+    }
+    else if (binocular)    
 	for (size_t i = 0; i < ntrials; ++i)
 	{
 	    for (size_t j = 0; j < 10; ++j)
@@ -136,10 +168,11 @@ main(int argc, char* argv[])
     float	blend			= 0;
     size_t	grainSize		= DEFAULT_GRAINSIZE;
     size_t	ntrials			= 5;
+    size_t	nframes			= 0;
     
   // $B%3%^%s%I9T$N2r@O!%(B
     extern char*	optarg;
-    for (int c; (c = getopt(argc, argv, "GHVp:d:s:BCW:D:M:b:g:n:")) != EOF; )
+    for (int c; (c = getopt(argc, argv, "GHVp:d:s:BCW:D:M:b:g:n:P:")) != EOF; )
 	switch (c)
 	{
 	  case 'G':
@@ -184,6 +217,9 @@ main(int argc, char* argv[])
 	  case 'n':
 	    ntrials = atoi(optarg);
 	    break;
+	  case 'P':
+	    nframes = atoi(optarg);
+	    break;
 	}
 
   // $BK\Ev$N$*;E;v!%(B
@@ -208,7 +244,8 @@ main(int argc, char* argv[])
 	    params.blend		 = blend;
 	    params.grainSize		 = grainSize;
 
-	    doJob<GFStereoType, u_char>(in, params, scale, binocular, ntrials);
+	    doJob<GFStereoType, u_char>(in, params, scale, binocular, ntrials,
+					nframes);
 	}
 	else
 	{
@@ -226,7 +263,8 @@ main(int argc, char* argv[])
 	    params.blend		 = blend;
 	    params.grainSize		 = grainSize;
 	    
-	    doJob<SADStereoType, u_char>(in, params, scale, binocular, ntrials);
+	    doJob<SADStereoType, u_char>(in, params, scale, binocular, ntrials,
+					 nframes);
 	}
     }
     catch (exception& err)
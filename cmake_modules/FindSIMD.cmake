@@ -67,6 +67,21 @@ IF(CMAKE_SYSTEM_NAME MATCHES "Linux")
     set(AVX2_FOUND false CACHE BOOL "AVX2 available on host")
   ENDIF (AVX2_TRUE)
 
+  # Skylake-X 以降の AVX512 のうち F, BW, DQ, VL をすべて要求する
+  set(AVX512_TRUE true)
+  foreach(ext avx512f avx512bw avx512dq avx512vl)
+    STRING(REGEX REPLACE "^.*(${ext}).*$" "\\1" SIMD_THERE ${CPUINFO})
+    STRING(COMPARE EQUAL "${ext}" "${SIMD_THERE}" EXT_TRUE)
+    IF (NOT EXT_TRUE)
+      set(AVX512_TRUE false)
+    ENDIF (NOT EXT_TRUE)
+  endforeach()
+  IF (AVX512_TRUE)
+    set(AVX512_FOUND true CACHE BOOL "AVX512 available on host")
+  ELSE (AVX512_TRUE)
+    set(AVX512_FOUND false CACHE BOOL "AVX512 available on host")
+  ENDIF (AVX512_TRUE)
+
   STRING(REGEX REPLACE "^.*(neon).*$" "\\1" SIMD_THERE ${CPUINFO})
   STRING(COMPARE EQUAL "neon" "${SIMD_THERE}" NEON_TRUE)
   IF (NEON_TRUE)
@@ -140,6 +155,20 @@ ELSEIF(CMAKE_SYSTEM_NAME MATCHES "Darwin")
     ELSE (AVX2_TRUE)
       set(AVX2_FOUND false CACHE BOOL "AVX2 available on host")
     ENDIF (AVX2_TRUE)
+
+    set(AVX512_TRUE true)
+    foreach(ext AVX512F AVX512BW AVX512DQ AVX512VL)
+      STRING(REGEX REPLACE "^.*(${ext}).*$" "\\1" SIMD_THERE ${LEAF7_CPUINFO})
+      STRING(COMPARE EQUAL "${ext}" "${SIMD_THERE}" EXT_TRUE)
+      IF (NOT EXT_TRUE)
+	set(AVX512_TRUE false)
+      ENDIF (NOT EXT_TRUE)
+    endforeach()
+    IF (AVX512_TRUE)
+      set(AVX512_FOUND true CACHE BOOL "AVX512 available on host")
+    ELSE (AVX512_TRUE)
+      set(AVX512_FOUND false CACHE BOOL "AVX512 available on host")
+    ENDIF (AVX512_TRUE)
   ENDIF (ARM64_TRUE)
 
 ELSEIF(CMAKE_SYSTEM_NAME MATCHES "Windows")
@@ -151,6 +180,7 @@ ELSEIF(CMAKE_SYSTEM_NAME MATCHES "Windows")
   set(SSE4_2_FOUND false CACHE BOOL "SSE4.2 available on host")
   set(AVX_FOUND    false CACHE BOOL "AVX available on host")
   set(AVX2_FOUND   false CACHE BOOL "AVX2 available on host")
+  set(AVX512_FOUND false CACHE BOOL "AVX512 available on host")
 ELSE(CMAKE_SYSTEM_NAME MATCHES "Linux")
   set(SSE2_FOUND   true  CACHE BOOL "SSE2 available on host")
   set(SSE3_FOUND   false CACHE BOOL "SSE3 available on host")
@@ -159,6 +189,7 @@ ELSE(CMAKE_SYSTEM_NAME MATCHES "Linux")
   set(SSE4_2_FOUND false CACHE BOOL "SSE4.2 available on host")
   set(AVX_FOUND    false CACHE BOOL "AVX available on host")
   set(AVX2_FOUND   false CACHE BOOL "AVX2 available on host")
+  set(AVX512_FOUND false CACHE BOOL "AVX512 available on host")
 ENDIF(CMAKE_SYSTEM_NAME MATCHES "Linux")
 
 IF(CMAKE_COMPILER_IS_GNUCXX)
@@ -169,6 +200,7 @@ IF(CMAKE_COMPILER_IS_GNUCXX)
     set(SSE4_2_FOUND false CACHE BOOL "SSE4.2 available on host" FORCE)
     set(AVX_FOUND    false CACHE BOOL "AVX available on host" FORCE)
     set(AVX2_FOUND   false CACHE BOOL "AVX2 available on host" FORCE)
+    set(AVX512_FOUND false CACHE BOOL "AVX512 available on host" FORCE)
   ENDIF()
 ENDIF(CMAKE_COMPILER_IS_GNUCXX)
 
@@ -193,11 +225,14 @@ endif(AVX_FOUND)
 if(AVX2_FOUND)
   MESSAGE(STATUS "Found support for AVX2 on this machine.")
 endif(AVX2_FOUND)
+if(AVX512_FOUND)
+  MESSAGE(STATUS "Found support for AVX512 on this machine.")
+endif(AVX512_FOUND)
 if(NEON_FOUND)
   MESSAGE(STATUS "Found support for NEON on this machine.")
 endif(NEON_FOUND)
 
-mark_as_advanced(SSE2_FOUND SSE3_FOUND SSSE3_FOUND SSE4_1_FOUND SSE4_2_FOUND AVX_FOUND AVX2_FOUND NEON_FOUND)
+mark_as_advanced(SSE2_FOUND SSE3_FOUND SSSE3_FOUND SSE4_1_FOUND SSE4_2_FOUND AVX_FOUND AVX2_FOUND AVX512_FOUND NEON_FOUND)
 
 ENDMACRO(FindSIMD)
 
@@ -0,0 +1,248 @@
+/*!
+  \file		dispatch.cc
+  \author	Toshio UESHIBA
+  \brief	SIMD命令セットごとのカーネルの生成と実行時の選択
+
+  このファイルは2通りにコンパイルされる．
+
+  - TU_SIMD_KERNEL_ISA が定義されている場合：そのSIMD命令セット向けの
+    コンパイルオプションとともにコンパイルされ，カーネルの関数表
+    TU::simd::kernels_<isa> を生成する．異なる命令セット向けにコンパイル
+    された同名のインライン関数が結合時に混同されないように，ヘッダ中の
+    名前空間 TU は TU_kernels_<isa> に置き換えられる．
+  - TU_SIMD_DISPATCH のみが定義されている場合：ライブラリ全体と共通の
+    (最下位の)命令セット向けにコンパイルされ，CPUに応じて関数表を選ぶ
+    TU::simd::dispatched_kernels() などを生成する．
+*/
+#if defined(TU_SIMD_KERNEL_ISA)
+#  include <cstdlib>
+#  include "TU/simd/dispatch.h"
+
+#  define TU_SIMD_CAT_(a, b)	a##_##b
+#  define TU_SIMD_CAT(a, b)	TU_SIMD_CAT_(a, b)
+#  define TU			TU_SIMD_CAT(TU_kernels, TU_SIMD_KERNEL_ISA)
+#  include "TU/EdgeDetector.h"
+#  include "TU/Warp.h"
+#  include "TU/BoxFilter.h"
+
+namespace TU
+{
+namespace
+{
+/************************************************************************
+*  kernels for a specific instruction set				*
+************************************************************************/
+void
+warpLine(const u_char* in, ptrdiff_t stride, size_t ncol,
+	 const short* us, const short* vs, const u_char* du, const u_char* dv,
+	 size_t n, u_char* out)
+{
+    Warp::warpLine(make_range_iterator(in, stride, ncol), out,
+		   us, us + n, vs, du, dv);
+}
+
+void
+boxFilterRows(const float* in, ptrdiff_t istride, size_t nrow, size_t ncol,
+	      float* out, ptrdiff_t ostride,
+	      size_t winSizeV, size_t winSizeH, bool shift)
+{
+    const auto	ib = make_range_iterator(in, istride, ncol);
+
+    BoxFilter2<float>(winSizeV, winSizeH)
+	.convolveRows(ib, ib + nrow,
+		      make_range_iterator(out, ostride, ncol), shift);
+}
+
+void
+sadUpdate(const u_char* colL, const u_char* colLe, const u_char* colR,
+	  const u_char* colLp, const u_char* colRp,
+	  short* Q, ptrdiff_t stride, size_t D, u_char thresh)
+{
+#if defined(SIMD)
+    using namespace	simd;
+
+    const size_t	DD = Iu8vec::floor(D);
+    const Iu8vec	th(thresh);
+#else
+    const size_t	DD = 0;
+#endif
+    for (; colL != colLe; ++colL, ++colR, ++colLp, ++colRp, Q += stride)
+    {
+#if defined(SIMD)
+	const Iu8vec	ln(*colL), lp(*colLp);
+
+	for (size_t d = 0; d < DD; d += Iu8vec::size)
+	{
+	    const auto	x = min(diff(ln, load(colR  + d)), th)
+			  - min(diff(lp, load(colRp + d)), th);
+	    const auto	q = Q + d;
+
+	    store(q, load(q) + cvt<short, false>(x));
+	    store(q + Is16vec::size, load(q + Is16vec::size) +
+				     cvt<short, true>(x));
+	}
+#endif
+	for (size_t d = DD; d < D; ++d)
+	{
+	    using	std::min;
+
+	    const int	dn = std::abs(int(*colL)  - int(colR[d]));
+	    const int	dp = std::abs(int(*colLp) - int(colRp[d]));
+	    Q[d] += min(dn, int(thresh)) - min(dp, int(thresh));
+	}
+    }
+#if defined(SIMD)
+    empty();
+#endif
+}
+
+}	// namespace
+}	// namespace TU
+#  undef TU
+
+namespace TU
+{
+namespace simd
+{
+extern const kernels	TU_SIMD_CAT(kernels, TU_SIMD_KERNEL_ISA);
+
+const kernels		TU_SIMD_CAT(kernels, TU_SIMD_KERNEL_ISA) =
+{
+    isa::TU_SIMD_KERNEL_ISA,
+    TU_SIMD_CAT(TU_kernels, TU_SIMD_KERNEL_ISA)::detail::edgeStrength,
+    TU_SIMD_CAT(TU_kernels, TU_SIMD_KERNEL_ISA)::detail::edgeDirection4,
+    TU_SIMD_CAT(TU_kernels, TU_SIMD_KERNEL_ISA)::detail::edgeDirection4x,
+    TU_SIMD_CAT(TU_kernels, TU_SIMD_KERNEL_ISA)::detail::edgeDirection8,
+    TU_SIMD_CAT(TU_kernels, TU_SIMD_KERNEL_ISA)::detail::edgeDirection8x,
+    TU_SIMD_CAT(TU_kernels, TU_SIMD_KERNEL_ISA)::warpLine,
+    TU_SIMD_CAT(TU_kernels, TU_SIMD_KERNEL_ISA)::boxFilterRows,
+    TU_SIMD_CAT(TU_kernels, TU_SIMD_KERNEL_ISA)::sadUpdate
+};
+
+}	// namespace simd
+}	// namespace TU
+
+#elif defined(TU_SIMD_DISPATCH)
+#  include <cstdlib>
+#  include <cstring>
+#  include <iterator>
+#  include "TU/simd/dispatch.h"
+
+namespace TU
+{
+namespace simd
+{
+#  if defined(TU_SIMD_HAVE_AVX512)
+extern const kernels	kernels_avx512;
+#  endif
+#  if defined(TU_SIMD_HAVE_AVX2)
+extern const kernels	kernels_avx2;
+#  endif
+#  if defined(TU_SIMD_HAVE_AVX)
+extern const kernels	kernels_avx;
+#  endif
+#  if defined(TU_SIMD_HAVE_SSE4)
+extern const kernels	kernels_sse4;
+#  endif
+#  if defined(TU_SIMD_HAVE_SSE2)
+extern const kernels	kernels_sse2;
+#  endif
+
+/************************************************************************
+*  static functions							*
+************************************************************************/
+static const kernels* const	candidates[] =
+{
+#  if defined(TU_SIMD_HAVE_AVX512)
+    &kernels_avx512,
+#  endif
+#  if defined(TU_SIMD_HAVE_AVX2)
+    &kernels_avx2,
+#  endif
+#  if defined(TU_SIMD_HAVE_AVX)
+    &kernels_avx,
+#  endif
+#  if defined(TU_SIMD_HAVE_SSE4)
+    &kernels_sse4,
+#  endif
+#  if defined(TU_SIMD_HAVE_SSE2)
+    &kernels_sse2,
+#  endif
+};
+
+static const char* const	names[] =
+{
+    "none", "sse2", "sse3", "ssse3", "sse4", "avx", "avx2", "avx512", "neon"
+};
+
+static const kernels&
+select_kernels()
+{
+    auto	limit = cpu_isa();
+
+    if (const char* const name = std::getenv("TU_SIMD_ISA"))
+	for (size_t i = 0; i < std::size(names); ++i)
+	    if (!std::strcmp(name, names[i]) && isa(i) < limit)
+	    {
+		limit = isa(i);
+		break;
+	    }
+
+    for (const auto k : candidates)
+	if (k->target <= limit)
+	    return *k;
+
+    return *candidates[std::size(candidates) - 1];
+}
+
+/************************************************************************
+*  global functions							*
+************************************************************************/
+isa
+cpu_isa()
+{
+#  if defined(__x86_64__) || defined(__i386__)
+    __builtin_cpu_init();
+
+    if (__builtin_cpu_supports("avx512f")  &&
+	__builtin_cpu_supports("avx512bw") &&
+	__builtin_cpu_supports("avx512dq") &&
+	__builtin_cpu_supports("avx512vl"))
+	return isa::avx512;
+    if (__builtin_cpu_supports("avx2"))
+	return isa::avx2;
+    if (__builtin_cpu_supports("avx"))
+	return isa::avx;
+    if (__builtin_cpu_supports("sse4.2") && __builtin_cpu_supports("popcnt"))
+	return isa::sse4;
+    if (__builtin_cpu_supports("ssse3"))
+	return isa::ssse3;
+    if (__builtin_cpu_supports("sse3"))
+	return isa::sse3;
+    if (__builtin_cpu_supports("sse2"))
+	return isa::sse2;
+    return isa::none;
+#  elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+    return isa::neon;
+#  else
+    return isa::none;
+#  endif
+}
+
+const char*
+isa_name(isa target)
+{
+    return names[size_t(target)];
+}
+
+const kernels&
+dispatched_kernels()
+{
+    static const kernels&	selected = select_kernels();
+
+    return selected;
+}
+
+}	// namespace simd
+}	// namespace TU
+#endif